@@ -3,6 +3,7 @@
 
 #include "MathGeoLib/include/MathGeoLib.h"
 #include "MathGeoLib/include/MathBuildConfig.h"
+#ifndef HEADLESS_BUILD
 #include "ModuleWindow.h"
 #include "ModuleInput.h"
 #include "ModuleScene.h"
@@ -10,45 +11,75 @@
 #include "ModuleCamera3D.h"
 #include "ModuleEditor.h"
 #include "ModuleViewportFrameBuffer.h"
+#include "ModuleDebugDraw.h"
+#endif // !HEADLESS_BUILD
+#include "ModuleImport.h"
 #include "ModuleFileSystem.h"
 #include "ModuleTextures.h"
+#include "JobSystem.h"
 #include "Globals.h"
 
 
 
-Application::Application()
+Application::Application(bool headless, bool nullRender) : headless(headless), nullRender(nullRender)
 {
 	PERF_START(ptimer);
-	window = new ModuleWindow(this);
-	input = new ModuleInput(this);
-	scene = new ModuleScene(this);
-	renderer3D = new ModuleRenderer3D(this);
-	camera = new ModuleCamera3D(this);
-	editor = new ModuleEditor(this);
-	viewportBuffer = new ModuleViewportFrameBuffer(this);
-	import = new ModuleImport(this);
-	fileSystem = new ModuleFileSystem(this);
-	textures = new ModuleTextures(this);
-
-	// The order of calls is very important!
-	// Modules will Init() Start() and Update in this order
-	// They will CleanUp() in reverse order
-
-	// Main Modules
-	AddModule(fileSystem);
-	AddModule(window);
-	AddModule(camera);
-	AddModule(input);
-	AddModule(textures);
-	AddModule(import);
-	
-	// Scenes
-	AddModule(viewportBuffer);
-	AddModule(scene);
-	AddModule(editor);
+	jobs = new JobSystem();
 
-	// Renderer last!
-	AddModule(renderer3D);
+#ifdef HEADLESS_BUILD
+	// The cooker build has none of the windowed modules compiled in
+	this->headless = true;
+#endif // HEADLESS_BUILD
+
+	if (this->headless)
+	{
+		// Asset cooking only, no SDL window, input or GL context
+		fileSystem = new ModuleFileSystem(this);
+		textures = new ModuleTextures(this);
+		import = new ModuleImport(this);
+
+		AddModule(fileSystem);
+		AddModule(textures);
+		AddModule(import);
+	}
+#ifndef HEADLESS_BUILD
+	else
+	{
+		window = new ModuleWindow(this);
+		input = new ModuleInput(this);
+		scene = new ModuleScene(this);
+		renderer3D = new ModuleRenderer3D(this);
+		camera = new ModuleCamera3D(this);
+		editor = new ModuleEditor(this);
+		viewportBuffer = new ModuleViewportFrameBuffer(this);
+		import = new ModuleImport(this);
+		fileSystem = new ModuleFileSystem(this);
+		textures = new ModuleTextures(this);
+		debugDraw = new ModuleDebugDraw(this);
+
+		// The order of calls is very important!
+		// Modules will Init() Start() and Update in this order
+		// They will CleanUp() in reverse order
+
+		// Main Modules
+		AddModule(fileSystem);
+		AddModule(window);
+		AddModule(camera);
+		AddModule(input);
+		AddModule(textures);
+		AddModule(import);
+	
+		// Scenes
+		AddModule(viewportBuffer);
+		AddModule(scene);
+		AddModule(editor);
+		// Draws what the scene and the editor added this frame
+		AddModule(debugDraw);
+
+		// Renderer last!
+		AddModule(renderer3D);
+	}
+#endif // !HEADLESS_BUILD
 
 	// Control variable to close app
 	closeEngine = false;
@@ -67,6 +98,7 @@ Application::~Application()
 	
 	modules.clear();
 
+	RELEASE(jobs);
 }
 
 bool Application::Init()
@@ -150,6 +182,7 @@ void Application::FinishUpdate()
 
 }
 
+#ifndef HEADLESS_BUILD
 void Application::OnGui()
 {
 	if (ImGui::CollapsingHeader("Application"))
@@ -164,6 +197,7 @@ void Application::OnGui()
 	}
 
 }
+#endif // !HEADLESS_BUILD
 
 // Call PreUpdate, Update and PostUpdate on all modules
 UpdateStatus Application::Update()
@@ -192,6 +226,10 @@ UpdateStatus Application::Update()
 	// If main menu bar exit button pressed changes closeEngine bool to true and closes app
 	if (closeEngine) ret = UpdateStatus::UPDATE_STOP;
 
+	// Scripted runs close on their own
+	if (frameLimit != 0 && frameCount >= frameLimit && ret == UpdateStatus::UPDATE_CONTINUE)
+		ret = UpdateStatus::UPDATE_STOP;
+
 	FinishUpdate();
 
 	return ret;
@@ -202,7 +240,10 @@ UpdateStatus Application::Update()
 bool Application::CleanUp()
 {
 	bool ret = true;
-	SaveEngineConfig();
+
+	// The cooker only knows a few modules, saving would drop the settings of the rest
+	if (!headless)
+		SaveEngineConfig();
 
 	for (size_t i = 0; i < modules.size() && ret == true; i++)
 	{
@@ -239,6 +280,7 @@ void Application::AddModule(Module* mod)
 	modules.push_back(mod);
 }
 
+#ifndef HEADLESS_BUILD
 void Application::DrawFPSDiagram() {
 
 	ImGui::InputText("App Name", TITLE, 20);
@@ -259,9 +301,9 @@ void Application::DrawFPSDiagram() {
 	}
 
 	char title[25];
-	sprintf_s(title, 25, "Framerate %.1f", fpsLog[fpsLog.size() - 1]);
+	snprintf(title, 25, "Framerate %.1f", fpsLog[fpsLog.size() - 1]);
 	ImGui::PlotHistogram("##framerate", &fpsLog[0], fpsLog.size(), 0, title, 0.0f, 100.0f, ImVec2(310, 100));
-	sprintf_s(title, 25, "Milliseconds %.1f", msLog[msLog.size() - 1]);
+	snprintf(title, 25, "Milliseconds %.1f", msLog[msLog.size() - 1]);
 	ImGui::PlotHistogram("##framerate", &msLog[0], msLog.size(), 0, title, 0.0f, 100.0f, ImVec2(310, 100));
 
 	if (ImGui::Checkbox("VSYNC:", &renderer3D->vsyncActive)) {
@@ -320,4 +362,5 @@ void Application::DrawHardwareConsole() {
 	ImGui::SameLine();
 	if (SDL_HasSSE42() == SDL_TRUE)ImGui::TextColored(ImVec4(1, 1, 0, 1), "SSE42, ");
 	
-}
\ No newline at end of file
+}
+#endif // !HEADLESS_BUILD
\ No newline at end of file
@@ -21,6 +21,8 @@ class ModuleViewportFrameBuffer;
 class ModuleImport;
 class ModuleFileSystem;
 class ModuleTextures;
+class ModuleDebugDraw;
+class JobSystem;
 // --------------------------------
 
 class Application
@@ -39,12 +41,21 @@ public:
 	ModuleImport* import { nullptr };
 	ModuleFileSystem* fileSystem { nullptr };
 	ModuleTextures* textures { nullptr };
+	ModuleDebugDraw* debugDraw { nullptr };
 	// -------------------
 
+
+	// ----- Tools -----
+
+	JobSystem* jobs { nullptr };
+	// -----------------
+
 public:
 
-	// Application Constructor
-	Application();
+	// Application Constructor, a headless Application only creates the modules that work without a window or GL context
+	// HEADLESS_BUILD builds (the cooker) compile the windowed modules out and are always headless
+	// A null render Application runs the whole editor but only records its render calls
+	Application(bool headless = false, bool nullRender = false);
 	// Application Destructor
 	~Application();
 
@@ -84,6 +95,16 @@ public:
 	
 	bool closeEngine;
 	bool vsync;
+	bool headless;
+	bool nullRender;
+	// Whether the null renderer reports multi draw support
+	bool nullMultiDraw = false;
+	// Stop after this many frames, 0 runs until closed
+	uint64 frameLimit = 0;
+	// Capture the render stats of every frame to this file, nullptr disables
+	const char* renderStatsFile = nullptr;
+	// Grab every viewport frame into this directory, nullptr disables
+	const char* captureDirectory = nullptr;
 	// --------------------------------
 	
 
@@ -0,0 +1,49 @@
+#ifndef __ASSET_ID_H__
+#define __ASSET_ID_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <string>
+
+// 64 bit FNV-1a
+#define ASSET_ID_OFFSET 14695981039346656037ull
+#define ASSET_ID_PRIME 1099511628211ull
+#define INVALID_ASSET_ID 0ull
+
+
+
+typedef uint64 AssetId;
+
+// Id of an asset path, computed once and used for every lookup afterwards
+// Separators and ASCII case are folded so every spelling of the same file gets the same id
+// Hashing is incremental, the id of "a/b" is HashAssetPath("b", HashAssetPath("a/"))
+inline AssetId HashAssetPath(const char* path, AssetId seed = ASSET_ID_OFFSET)
+{
+	AssetId hash = seed;
+	for (; *path != '\0'; ++path)
+	{
+		char c = *path;
+		if (c == '\\')
+			c = '/';
+		else if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+
+		hash ^= static_cast<uchar>(c);
+		hash *= ASSET_ID_PRIME;
+	}
+	return hash;
+}
+
+inline AssetId HashAssetPath(const std::string& path, AssetId seed = ASSET_ID_OFFSET)
+{
+	return HashAssetPath(path.c_str(), seed);
+}
+
+// Ids are already well mixed, hash tables can use them as they are
+struct AssetIdHash
+{
+	inline size_t operator()(AssetId id) const { return static_cast<size_t>(id ^ (id >> 32)); }
+};
+
+#endif // !__ASSET_ID_H__
\ No newline at end of file
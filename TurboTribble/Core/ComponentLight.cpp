@@ -0,0 +1,62 @@
+#include "ComponentLight.h"
+
+#include "Application.h"
+#include "ModuleRenderer3D.h"
+#include "ComponentTransform.h"
+
+#include "Globals.h"
+
+#include <math.h>
+#include "ImGui/imgui.h"
+
+
+
+ComponentLight::ComponentLight(GameObject* parent, Type type) : Component(parent), type(type), color(1.f, 1.f, 1.f) {}
+
+bool ComponentLight::Update(float dt)
+{
+	//-- Queue the light, the renderer bins every queued light before flushing the meshes --//
+	if (active)
+		app->renderer3D->AddLight(this);
+
+	return true;
+}
+
+void ComponentLight::GetClusterLight(ClusterLight& light) const
+{
+	const float4x4& transform = owner->transform->transformMatrix;
+
+	// Points fade between two cosines no direction reaches, the shader needs the inner one above the outer one
+	float cosInner = POINT_LIGHT_COS + 1.f;
+	float cosOuter = POINT_LIGHT_COS;
+	if (type == Type::SPOT)
+	{
+		const float outer = MIN(outerAngle, 89.f) * DEGTORAD;
+		cosOuter = cosf(outer);
+		cosInner = MAX(cosf(MIN(innerAngle * DEGTORAD, outer)), cosOuter + 0.001f);
+	}
+
+	light.positionRange = float4(transform.TranslatePart(), range);
+	light.colorCosInner = float4(color.r * intensity, color.g * intensity, color.b * intensity, cosInner);
+	light.directionCosOuter = float4(transform.Col3(2).Normalized(), cosOuter);
+}
+
+void ComponentLight::OnGui()
+{
+	if (ImGui::CollapsingHeader("Light"))
+	{
+		int current = static_cast<int>(type);
+		if (ImGui::Combo("Type", &current, "Point\0Spot\0"))
+			type = static_cast<Type>(current);
+
+		ImGui::ColorEdit3("Color", &color);
+		ImGui::DragFloat("Intensity", &intensity, 0.05f, 0.f, 100.f);
+		ImGui::DragFloat("Range", &range, 0.1f, 0.f, 1000.f);
+
+		if (type == Type::SPOT)
+		{
+			ImGui::SliderFloat("Inner Angle", &innerAngle, 0.f, outerAngle);
+			ImGui::SliderFloat("Outer Angle", &outerAngle, 1.f, 89.f);
+		}
+	}
+}
\ No newline at end of file
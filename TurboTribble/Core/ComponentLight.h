@@ -0,0 +1,42 @@
+#ifndef __COMPONENT_LIGHT_H__
+#define __COMPONENT_LIGHT_H__
+
+#include "Component.h"
+
+#include "Color.h"
+#include "LightClusters.h"
+
+
+
+// Dynamic point or spot light at its owner's position, spots shine along the owner's Z axis
+// Binned into the light clusters every frame, only the meshes inside its range pay for it
+class ComponentLight : public Component {
+
+public:
+
+	enum class Type
+	{
+		POINT,
+		SPOT
+	};
+
+	ComponentLight(GameObject* parent, Type type = Type::POINT);
+
+	bool Update(float dt) override;
+	void OnGui() override;
+
+	// Entry of the Lights uniform block in world space
+	void GetClusterLight(ClusterLight& light) const;
+
+public:
+
+	Type type = Type::POINT;
+	Color color;
+	float intensity = 1.f;
+	float range = 10.f;
+	// Half angles in degrees, light fades out between the inner and the outer one
+	float innerAngle = 20.f;
+	float outerAngle = 30.f;
+};
+
+#endif // !__COMPONENT_LIGHT_H__
\ No newline at end of file
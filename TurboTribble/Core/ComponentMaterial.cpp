@@ -7,23 +7,39 @@
 
 ComponentMaterial::ComponentMaterial(GameObject* parent) : Component(parent) {}
 
-void ComponentMaterial::SetTexture(const TextureObject& texture)
+void ComponentMaterial::SetTexture(const TextureHandle& texture)
 {
-	textureName = texture.name;
-	textureId = texture.id;
-	width = texture.width;
-	height = texture.height;
+	this->texture = texture;
+}
+
+uint ComponentMaterial::GetTextureId() const
+{
+	return texture != nullptr ? texture->id : 0;
+}
+
+void ComponentMaterial::MarkUsed() const
+{
+	if (texture != nullptr)
+		texture->lastUsedFrame = app->textures->GetFrame();
+}
+
+void ComponentMaterial::ReportScreenSize(float size) const
+{
+	if (texture != nullptr)
+		texture->screenSize = MAX(texture->screenSize, size);
 }
 
 void ComponentMaterial::OnGui()
 {
 	if (ImGui::CollapsingHeader("Material"))
 	{
-		if (textureId != 0)
+		if (texture != nullptr && texture->id != 0)
 		{
-			ImGui::Text("Name: %s", textureName.c_str());
-			ImGui::Image((ImTextureID)textureId, ImVec2(128, 128), ImVec2(0, 1), ImVec2(1, 0));
-			ImGui::Text("Size: %d x %d", width, height);
+			ImGui::Text("Name: %s", texture->name.c_str());
+			ImGui::Image((ImTextureID)texture->id, ImVec2(128, 128), ImVec2(0, 1), ImVec2(1, 0));
+			ImGui::Text("Size: %d x %d", texture->width, texture->height);
+			if (texture->streamable)
+				ImGui::Text("Resident mip: %d of %d", texture->residentMip, texture->numLevels);
 		}
 	}
 }
\ No newline at end of file
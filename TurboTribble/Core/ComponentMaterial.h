@@ -3,9 +3,12 @@
 
 #include "Component.h"
 
+#include <memory>
+
 
 
 struct TextureObject;
+typedef std::shared_ptr<TextureObject> TextureHandle;
 
 class ComponentMaterial : public Component {
 
@@ -13,14 +16,19 @@ public:
 
 	ComponentMaterial(GameObject* parent);
 
-	void SetTexture(const TextureObject& texture);
+	void SetTexture(const TextureHandle& texture);
 	void OnGui() override;
-	inline uint GetTextureId() const { return textureId; }
+	// GL id to bind, only reads so the render jobs can call it
+	uint GetTextureId() const;
+	// Marks the texture as used this frame, main thread only
+	void MarkUsed() const;
+	// Projected size in pixels of a mesh drawn with the texture, drives mip streaming, main thread only
+	void ReportScreenSize(float size) const;
 
 private:
 
-	std::string textureName;
-	uint textureId = 0, width = 0, height = 0;
+	// Keeps the texture resident while the material uses it
+	TextureHandle texture;
 };
 
 #endif // !__COMPONENT_MATERIAL_H__
\ No newline at end of file
@@ -2,14 +2,17 @@
 
 #include "Application.h"
 #include "ModuleRenderer3D.h"
+#include "ModuleDebugDraw.h"
+#include "ModuleImport.h"
 #include "ComponentMaterial.h"
 #include "ComponentTransform.h"
 #include "GameObject.h"
+#include "RenderDevice.h"
 
-#include "glew.h"
-#include "SDL/include/SDL_opengl.h"
 #include "ImGui/imgui.h"
 #include "Geometry/Sphere.h"
+#include "Math/float3x3.h"
+#include <math.h>
 #include "par_shapes.h"
 
 
@@ -33,9 +36,24 @@ ComponentMesh::ComponentMesh(GameObject* parent, Shape shape) : Component(parent
 
 ComponentMesh::~ComponentMesh()
 {
-	vertexBufferId ? glDeleteBuffers(1, &vertexBufferId) : 0;
-	textureBufferId ? glDeleteBuffers(1, &textureBufferId) : 0;
-	indexBufferId ? glDeleteBuffers(1, &indexBufferId) : 0;
+	if (!libraryPath.empty())
+		app->import->RemoveResidentMesh(this);
+
+	// Meshes without buffers never touched the renderer, the cooker builds those
+	if (vertexBufferId == 0 && indexBufferId == 0)
+		return;
+
+	if (geometry.IsValid())
+	{
+		app->renderer3D->GetGeometry().Free(geometry);
+		return;
+	}
+
+	RenderDevice* device = app->renderer3D->GetDevice();
+	device->DeleteBuffer(vertexBufferId);
+	device->DeleteBuffer(normalBufferId);
+	device->DeleteBuffer(textureBufferId);
+	device->DeleteBuffer(indexBufferId);
 }
 
 void ComponentMesh::CopyParMesh(par_shapes_mesh* parMesh)
@@ -68,26 +86,35 @@ void ComponentMesh::CopyParMesh(par_shapes_mesh* parMesh)
 
 void ComponentMesh::GenerateBuffers() {
 	
+	//-- Static geometry goes to the shared pool, so its draws can share a multi draw
+	const float3* normalData = normals.size() == numVertices ? &normals[0] : nullptr;
+	const float2* texCoordData = texCoords.size() == numVertices ? &texCoords[0] : nullptr;
+	GeometryPool& pool = app->renderer3D->GetGeometry();
+	if (pool.Allocate(numVertices, &vertices[0], normalData, texCoordData, numIndices, &indices[0], geometry))
+	{
+		const GeometryPage& page = pool.GetPage(geometry.page);
+		vertexBufferId = page.positionBuffer;
+		normalBufferId = page.normalBuffer;
+		textureBufferId = page.texCoordBuffer;
+		indexBufferId = page.indexBuffer;
+		return;
+	}
+
+	RenderDevice* device = app->renderer3D->GetDevice();
+
 	//-- Generate Vertex
-	vertexBufferId = 0;
-	glGenBuffers(1, &vertexBufferId);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float3) * numVertices, &vertices[0], GL_STATIC_DRAW);
+	vertexBufferId = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, sizeof(float3) * numVertices, &vertices[0], BufferUsage::USAGE_STATIC);
+
+	//-- Generate Normals
+	if (normals.size() == numVertices)
+		normalBufferId = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, sizeof(float3) * numVertices, &normals[0], BufferUsage::USAGE_STATIC);
 
 	//-- Generate Index
-	indexBufferId = 0;
-	glGenBuffers(1, &indexBufferId);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint) * numIndices, &indices[0], GL_STATIC_DRAW);
+	indexBufferId = device->CreateBuffer(BufferTarget::BUFFER_INDEX, sizeof(uint) * numIndices, &indices[0], BufferUsage::USAGE_STATIC);
 
 	//-- Generate Texture_Buffers
 	if (texCoords.size() != 0)
-	{
-		textureBufferId = 0;
-		glGenBuffers(1, &textureBufferId);
-		glBindBuffer(GL_ARRAY_BUFFER, textureBufferId);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float2) * texCoords.size(), &texCoords[0], GL_STATIC_DRAW);
-	}
+		textureBufferId = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, sizeof(float2) * texCoords.size(), &texCoords[0], BufferUsage::USAGE_STATIC);
 	if (vertexBufferId == 0 || indexBufferId == 0)
 		TTLOG("Error creating mesh on gameobject %s\n", owner->name.c_str());
 }
@@ -95,7 +122,7 @@ void ComponentMesh::GenerateBuffers() {
 void ComponentMesh::ComputeNormals()
 {
 
-	numNormalFaces = numIndices * 3;
+	numNormalFaces = numIndices / 3;
 	faceNormals.resize(numNormalFaces);
 	faceCenters.resize(numNormalFaces);
 
@@ -119,10 +146,14 @@ void ComponentMesh::GenerateBounds()
 	localAABB.SetNegativeInfinity();
 	localAABB.Enclose(&vertices[0], vertices.size());
 		
-	Sphere sphere;	
-	sphere.r = 0.f;
-	sphere.pos = localAABB.CenterPoint();
-	sphere.Enclose(localAABB);
+	// Ritter's sphere hugs the vertices, the one around the box only wins for box shaped meshes
+	Sphere sphere = Sphere::FastEnclosingSphere(&vertices[0], static_cast<int>(vertices.size()));
+	const float boxRadius = localAABB.HalfDiagonal().Length();
+	if (boxRadius < sphere.r)
+	{
+		sphere.pos = localAABB.CenterPoint();
+		sphere.r = boxRadius;
+	}
 
 	radius = sphere.r;
 	centerPoint = sphere.pos;
@@ -134,80 +165,126 @@ void ComponentMesh::DrawNormals() const
 	{
 		for (size_t i = 0; i < faceNormals.size(); ++i)
 		{
-			glColor3f(0.f, 0.f, 1.f);
-			glBegin(GL_LINES);			
 			const float3 faceCenter = owner->transform->transformMatrix.TransformPos(faceCenters[i]);
 			const float3 faceNormalPoint = faceCenter + faceNormals[i] * normalScale;
-			glVertex3f(faceCenter.x, faceCenter.y, faceCenter.z);
-			glVertex3f(faceNormalPoint.x, faceNormalPoint.y, faceNormalPoint.z);
-			glEnd();
+			app->debugDraw->DrawLine(faceCenter, faceNormalPoint, Color(0.f, 0.f, 1.f));
 		}
 	}
 	if (drawVertexNormals)
 	{
 		for (size_t i = 0; i < normals.size(); ++i)
 		{
-			glColor3f(1.f, 0.f, 0.f);
-			glBegin(GL_LINES);
 			const float3 vertexPos = owner->transform->transformMatrix.TransformPos(vertices[i]);
 			const float3 vertexNormalPoint = vertexPos + normals[i] * normalScale;
-			glVertex3f(vertexPos.x, vertexPos.y, vertexPos.z);
-			glVertex3f(vertexNormalPoint.x, vertexNormalPoint.y, vertexNormalPoint.z);
-			glEnd();
+			app->debugDraw->DrawLine(vertexPos, vertexNormalPoint, Color(1.f, 0.f, 0.f));
 		}
 	}
 }
 
-float3 ComponentMesh::GetCenterPointInWorldCoords() const
+void ComponentMesh::ReleaseCPUData()
 {
-	return owner->transform->transformMatrix.TransformPos(centerPoint);
+	std::vector<float3>().swap(vertices);
+	std::vector<float3>().swap(normals);
+	std::vector<float3>().swap(faceNormals);
+	std::vector<float3>().swap(faceCenters);
+	std::vector<float2>().swap(texCoords);
+	std::vector<uint>().swap(indices);
 }
 
-bool ComponentMesh::Update(float dt)
+bool ComponentMesh::ReloadCPUData()
 {
+	if (libraryPath.empty())
+		return false;
 
-	drawWireframe || app->renderer3D->wireframeMode ? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		//app->renderer3D->wireframeMode ? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	// Charged to the import budget like the copies of a streamed import, older copies are released to make room
+	app->import->ReserveMeshLoad(libraryPath);
+	if (!app->import->LoadMesh(libraryPath, this))
+		return false;
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	ComputeNormals();
+	app->import->AddResidentMesh(this);
+	return true;
+}
 
-	//--Enable States--//
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+bool ComponentMesh::EnsureCPUData()
+{
+	if (!vertices.empty())
+		return true;
 
-	//-- Buffers--//
-	glBindBuffer(GL_ARRAY_BUFFER, this->textureBufferId);
-	glTexCoordPointer(2, GL_FLOAT, 0, NULL);
+	if (reloadFailed)
+		return false;
 
-	glBindBuffer(GL_ARRAY_BUFFER, this->vertexBufferId);
-	glVertexPointer(3, GL_FLOAT, 0, NULL);
+	if (ReloadCPUData())
+		return true;
+
+	// Reported once, retrying would read the disk again every frame
+	reloadFailed = true;
+	TTLOG("### Could not reload the CPU copy of mesh %s from %s ###\n", owner->name.c_str(), libraryPath.empty() ? "an empty Library path" : libraryPath.c_str());
+	return false;
+}
 
-	if (ComponentMaterial* material = owner->GetComponent<ComponentMaterial>())
-	{	
-		drawWireframe || !app->renderer3D->useTexture || app->renderer3D->wireframeMode ? 0 : glBindTexture(GL_TEXTURE_2D, material->GetTextureId());
+uint64 ComponentMesh::GetCPUSizeInBytes() const
+{
+	uint64 size = 0;
+	size += sizeof(float3) * (vertices.capacity() + normals.capacity() + faceNormals.capacity() + faceCenters.capacity());
+	size += sizeof(float2) * texCoords.capacity();
+	size += sizeof(uint) * indices.capacity();
+	return size;
+}
+
+float3 ComponentMesh::GetCenterPointInWorldCoords() const
+{
+	return owner->transform->transformMatrix.TransformPos(centerPoint);
+}
+
+float ComponentMesh::GetWorldSphereRadius() const
+{
+	const float3x3 linear = owner->transform->transformMatrix.Float3x3Part();
+	const float3 x = linear.Col(0), y = linear.Col(1), z = linear.Col(2);
+	const float3 scaleSq(x.LengthSq(), y.LengthSq(), z.LengthSq());
+
+	// Without shear the longest axis is as far as the sphere stretches, scaled children of rotated parents need the sum of all three
+	const float shear = fabsf(x.Dot(y)) + fabsf(y.Dot(z)) + fabsf(z.Dot(x));
+	if (shear <= 0.0001f * scaleSq.MaxElement())
+		return radius * sqrtf(scaleSq.MaxElement());
+
+	return radius * sqrtf(scaleSq.x + scaleSq.y + scaleSq.z);
+}
+
+AABB ComponentMesh::GetWorldAABB() const
+{
+	AABB worldAABB = localAABB;
+	worldAABB.TransformAsAABB(owner->transform->transformMatrix);
+	return worldAABB;
+}
+
+void ComponentMesh::BuildDrawCommand(DrawCommand& command) const
+{
+	const bool wireframe = drawWireframe || app->renderer3D->wireframeMode;
+
+	command.pass = wireframe ? RenderPass::PASS_WIREFRAME : RenderPass::PASS_OPAQUE;
+	command.vertexBuffer = vertexBufferId;
+	command.normalBuffer = normalBufferId;
+	command.texCoordBuffer = textureBufferId;
+	command.indexBuffer = indexBufferId;
+	command.numIndices = numIndices;
+	command.firstIndex = geometry.firstIndex;
+	command.baseVertex = static_cast<int>(geometry.firstVertex);
+	command.transform = &owner->transform->transformMatrix;
+
+	if (!wireframe && app->renderer3D->useTexture)
+	{
+		if (const ComponentMaterial* material = owner->GetComponent<ComponentMaterial>())
+			command.texture = material->GetTextureId();
 	}
+}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBufferId);
-
-	//-- Draw --//
-	glPushMatrix();
-	glMultMatrixf(owner->transform->transformMatrix.Transposed().ptr());
-	glColor3f(1.0f, 1.0f, 1.0f);
-	glDrawElements(GL_TRIANGLES, this->numIndices, GL_UNSIGNED_INT, NULL);
-	glPopMatrix();
-	//-- UnBind Buffers--//
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_TEXTURE_COORD_ARRAY, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	//--Disables States--//
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	
-	app->renderer3D->wireframeMode ? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+bool ComponentMesh::Update(float dt)
+{
+	//-- Queue the mesh, the renderer records, sorts and submits its draw after the traversal --//
+	app->renderer3D->AddMesh(this);
 
-	if (drawFaceNormals || drawVertexNormals)
+	if ((drawFaceNormals || drawVertexNormals) && EnsureCPUData())
 		DrawNormals();
 
 	return true;
@@ -219,7 +296,16 @@ void ComponentMesh::OnGui()
 	{
 		ImGui::Text("Num vertices %d", numVertices);
 		ImGui::Text("Num faces %d", numIndices / 3);
+		if (vertices.empty() && !libraryPath.empty())
+			ImGui::TextColored(ImVec4(1, 1, 0, 1), "CPU copy released, streamed from %s", libraryPath.c_str());
+		if (reloadFailed)
+			ImGui::TextColored(ImVec4(1, 0, 0, 1), "CPU copy could not be reloaded");
 		ImGui::Checkbox("Wireframe", &drawWireframe);
+		// Occluders rasterize their CPU copy, it is read back once here rather than during the traversal
+		if (ImGui::Checkbox("Occluder", &occluder) && occluder)
+			EnsureCPUData();
+		if (occluder && vertices.empty())
+			ImGui::TextColored(ImVec4(1, 1, 0, 1), "No CPU copy, the mesh does not occlude anything");
 		ImGui::DragFloat("Normal draw scale", &normalScale);
 		ImGui::Checkbox("Draw face normals", &drawFaceNormals);
 		ImGui::Checkbox("Draw vertex normals", &drawVertexNormals);
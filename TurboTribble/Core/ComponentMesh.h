@@ -2,8 +2,11 @@
 #define __COMPONENT_MESH_H__
 
 #include "Component.h"
+#include "AssetId.h"
 
 #include "Globals.h"
+#include "RenderQueue.h"
+#include "GeometryPool.h"
 
 #include <string.h>
 #include "Math/float3.h"
@@ -34,14 +37,29 @@ public:
 	void ComputeNormals();
 	void GenerateBounds();
 	void DrawNormals() const;
+	// Free the CPU side copies once they live in GL buffers, they are read back from the Library when needed
+	void ReleaseCPUData();
+	bool ReloadCPUData();
+	// Reload the CPU copy if it was released, a reload that failed once is not tried again
+	bool EnsureCPUData();
+	uint64 GetCPUSizeInBytes() const;
 	float3 GetCenterPointInWorldCoords() const;
+	AABB GetWorldAABB() const;
 	inline float GetSphereRadius() const { return radius; }
+	// Radius of the bounding sphere around GetCenterPointInWorldCoords
+	float GetWorldSphereRadius() const;
+
+	// Fill the draw of this mesh, only reads so recording jobs can call it
+	void BuildDrawCommand(DrawCommand& command) const;
 
 	bool Update(float dt) override;
 	void OnGui() override;
 
-	uint vertexBufferId = 0, indexBufferId = 0, textureBufferId = 0;
-	std::string texturePath;
+	// Buffers of the pool page when the mesh is pooled, owned by the mesh otherwise
+	uint vertexBufferId = 0, normalBufferId = 0, indexBufferId = 0, textureBufferId = 0;
+	GeometryAllocation geometry;
+	AssetId textureId = INVALID_ASSET_ID;
+	std::string libraryPath;
 
 	uint numVertices = 0;
 	std::vector<float3> vertices;
@@ -60,9 +78,14 @@ public:
 	bool drawVertexNormals = false;
 	bool drawFaceNormals = false;
 	float normalScale = 1.f;
+	// Rasterized into the occlusion buffer to hide what is behind, keeps its CPU copy
+	bool occluder = false;
 
 private:
 
+	// The Library file could not be read back, the CPU copy stays released
+	bool reloadFailed = false;
+
 	//Bounding sphere
 	float3 centerPoint = float3::zero;
 	float radius;
@@ -0,0 +1,129 @@
+// ----------------------------------------------------
+// CookerMain.cpp
+// Headless entry point that cooks every asset into the Library
+// ----------------------------------------------------
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include "Application.h"
+#include "ModuleFileSystem.h"
+#include "ModuleImport.h"
+#include "ModuleTextures.h"
+#include "JobSystem.h"
+#include "PerfTimer.h"
+#include "Globals.h"
+
+#define MODELS_FOLDER "Assets/Models"
+#define TEXTURES_FOLDER "Assets/Textures"
+
+
+
+struct CookEntry
+{
+	std::string path;
+	bool isModel = false;
+	bool success = false;
+	double ms = 0.0;
+};
+
+Application* app = NULL;
+
+// Append every file of a folder that matches any of the extensions
+static void GatherAssets(const char* folder, const std::vector<std::string>& extensions, bool isModel, std::vector<CookEntry>& entries)
+{
+	for (const std::string& extension : extensions)
+	{
+		std::vector<std::string> files;
+		app->fileSystem->GetAllFilesWithExtension(folder, extension.c_str(), files);
+
+		for (const std::string& file : files)
+		{
+			CookEntry entry;
+			entry.path = std::string(folder) + "/" + file;
+			entry.isModel = isModel;
+			entries.push_back(entry);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	app = new Application(true);
+	if (app->Init() == false)
+	{
+		printf("Cooker could not initialize the file system and importers\n");
+		delete app;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<CookEntry> entries;
+	GatherAssets(MODELS_FOLDER, { "fbx", "FBX", "obj", "OBJ" }, true, entries);
+	GatherAssets(TEXTURES_FOLDER, { "png", "PNG", "jpg", "JPG", "tga", "TGA", "dds", "DDS" }, false, entries);
+
+	printf("Cooking %u assets on %u threads\n", static_cast<uint>(entries.size()), app->jobs->GetNumThreads());
+
+	std::mutex printMutex;
+	PerfTimer totalTimer;
+
+	auto cook = [&](uint i)
+	{
+		CookEntry& entry = entries[i];
+		PerfTimer timer;
+
+		uint meshesCooked = 0;
+		std::string libraryPath;
+		if (entry.isModel)
+			entry.success = app->import->CookModel(entry.path.c_str(), meshesCooked);
+		else
+			entry.success = app->textures->Cook(entry.path, libraryPath);
+
+		entry.ms = timer.ReadMs();
+
+		std::lock_guard<std::mutex> lock(printMutex);
+		if (entry.isModel)
+			printf("[%s] %-48s %9.2f ms (%u meshes)\n", entry.success ? " ok " : "FAIL", entry.path.c_str(), entry.ms, meshesCooked);
+		else
+			printf("[%s] %-48s %9.2f ms\n", entry.success ? " ok " : "FAIL", entry.path.c_str(), entry.ms);
+	};
+
+	// Models go first, their materials tell the texture cooks which textures hold normals
+	uint numModels = 0;
+	while (numModels < entries.size() && entries[numModels].isModel)
+		++numModels;
+
+	app->jobs->ParallelFor(numModels, cook);
+	app->jobs->ParallelFor(static_cast<uint>(entries.size()) - numModels, [&](uint i) { cook(numModels + i); });
+
+	const double wallMs = totalTimer.ReadMs();
+
+	uint models = 0, textures = 0, failed = 0;
+	double modelsMs = 0.0, texturesMs = 0.0;
+	for (const CookEntry& entry : entries)
+	{
+		if (entry.isModel)
+		{
+			++models;
+			modelsMs += entry.ms;
+		}
+		else
+		{
+			++textures;
+			texturesMs += entry.ms;
+		}
+
+		if (!entry.success)
+			++failed;
+	}
+
+	printf("Models:   %u in %.2f ms\n", models, modelsMs);
+	printf("Textures: %u in %.2f ms\n", textures, texturesMs);
+	printf("Total:    %u assets, %u failed, %.2f ms of work in %.2f ms wall time\n", models + textures, failed, modelsMs + texturesMs, wallMs);
+
+	app->CleanUp();
+	delete app;
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "CpuInfo.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+
+
+struct CpuFeatures
+{
+	bool sse41 = false;
+	bool avx = false;
+	bool avx2 = false;
+};
+
+static void CpuId(uint leaf, uint subleaf, uint registers[4])
+{
+#ifdef _MSC_VER
+	__cpuidex(reinterpret_cast<int*>(registers), leaf, subleaf);
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Register state the OS saves on a context switch, bits 1 and 2 are the SSE and AVX halves
+static uint64 ReadXCR0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint low = 0, high = 0;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return (static_cast<uint64>(high) << 32) | low;
+#endif
+}
+
+static CpuFeatures Detect()
+{
+	CpuFeatures features;
+
+	uint registers[4] = { 0, 0, 0, 0 };
+	CpuId(0, 0, registers);
+	const uint maxLeaf = registers[0];
+	if (maxLeaf < 1)
+		return features;
+
+	CpuId(1, 0, registers);
+	features.sse41 = (registers[2] & (1u << 19)) != 0;
+
+	const bool osSavesAVX = (registers[2] & (1u << 27)) != 0 && (ReadXCR0() & 6) == 6;
+	features.avx = osSavesAVX && (registers[2] & (1u << 28)) != 0;
+
+	if (features.avx && maxLeaf >= 7)
+	{
+		CpuId(7, 0, registers);
+		features.avx2 = (registers[1] & (1u << 5)) != 0;
+	}
+
+	return features;
+}
+
+static const CpuFeatures& GetFeatures()
+{
+	static const CpuFeatures features = Detect();
+	return features;
+}
+
+bool HasSSE41()
+{
+	return GetFeatures().sse41;
+}
+
+bool HasAVX()
+{
+	return GetFeatures().avx;
+}
+
+bool HasAVX2()
+{
+	return GetFeatures().avx2;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef __CPU_INFO_H__
+#define __CPU_INFO_H__
+
+#include "Globals.h"
+
+
+
+// Instruction sets the SIMD paths dispatch on, read once with cpuid
+// The AVX ones also need the OS to save the wide registers, a CPU that has them is not enough
+bool HasSSE41();
+bool HasAVX();
+bool HasAVX2();
+
+#endif // !__CPU_INFO_H__
\ No newline at end of file
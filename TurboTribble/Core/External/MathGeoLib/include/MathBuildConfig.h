@@ -17,7 +17,7 @@
 	@brief Specifies all build flags for the library. */
 #pragma once
 
-#if !defined(WIN32)
+#if !defined(WIN32) && defined(_WIN32)
 #define WIN32
 #endif
 
@@ -16,7 +16,7 @@
 /** @file Clock.h
 	@brief The Clock class. Supplies timing facilities. */
 
-#ifndef WIN32
+#if !defined(WIN32) && defined(_WIN32)
 #define WIN32
 #endif
 
@@ -19,6 +19,11 @@
   3. This notice may not be removed or altered from any source distribution.
 */
 
+/* Only the prototypes are needed off Windows, the system SDL2 library is linked there */
+#if !defined(_WIN32)
+#include "SDL_config_minimal.h"
+#else
+
 #ifndef SDL_config_windows_h_
 #define SDL_config_windows_h_
 #define SDL_config_h_
@@ -258,3 +263,5 @@ typedef unsigned int uintptr_t;
 #endif
 
 #endif /* SDL_config_windows_h_ */
+
+#endif /* !_WIN32 */
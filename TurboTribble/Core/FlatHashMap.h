@@ -0,0 +1,225 @@
+#ifndef __FLAT_HASH_MAP_H__
+#define __FLAT_HASH_MAP_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <vector>
+#include <utility>
+#include <functional>
+
+#define FLAT_HASH_MAP_MIN_CAPACITY 16
+
+
+
+// Open addressing hash map with linear probing, every entry lives in one contiguous array
+// Erasing shifts the following entries back, so there are no tombstones and lookups never slow down
+// Any insert or erase may move entries, pointers and iterators are only valid until the next one
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatHashMap
+{
+public:
+
+	typedef std::pair<Key, Value> Entry;
+
+	class Iterator
+	{
+	public:
+
+		Iterator(FlatHashMap* map, uint slot) : map(map), slot(slot) { SkipEmpty(); }
+
+		inline Entry& operator*() const { return map->entries[slot]; }
+		inline Entry* operator->() const { return &map->entries[slot]; }
+		inline Iterator& operator++() { ++slot; SkipEmpty(); return *this; }
+		inline bool operator!=(const Iterator& other) const { return slot != other.slot; }
+		inline bool operator==(const Iterator& other) const { return slot == other.slot; }
+
+	private:
+
+		inline void SkipEmpty() { while (slot < map->used.size() && !map->used[slot]) ++slot; }
+
+	private:
+
+		FlatHashMap* map;
+		uint slot;
+
+	};
+
+	class ConstIterator
+	{
+	public:
+
+		ConstIterator(const FlatHashMap* map, uint slot) : map(map), slot(slot) { SkipEmpty(); }
+
+		inline const Entry& operator*() const { return map->entries[slot]; }
+		inline const Entry* operator->() const { return &map->entries[slot]; }
+		inline ConstIterator& operator++() { ++slot; SkipEmpty(); return *this; }
+		inline bool operator!=(const ConstIterator& other) const { return slot != other.slot; }
+		inline bool operator==(const ConstIterator& other) const { return slot == other.slot; }
+
+	private:
+
+		inline void SkipEmpty() { while (slot < map->used.size() && !map->used[slot]) ++slot; }
+
+	private:
+
+		const FlatHashMap* map;
+		uint slot;
+
+	};
+
+	// Value of a key, nullptr when missing
+	Value* Find(const Key& key)
+	{
+		const uint slot = FindSlot(key);
+		return slot != INVALID_SLOT ? &entries[slot].second : nullptr;
+	}
+
+	const Value* Find(const Key& key) const
+	{
+		const uint slot = FindSlot(key);
+		return slot != INVALID_SLOT ? &entries[slot].second : nullptr;
+	}
+
+	inline bool Contains(const Key& key) const { return FindSlot(key) != INVALID_SLOT; }
+
+	// Insert or overwrite
+	Value& Insert(const Key& key, const Value& value)
+	{
+		Value& stored = operator[](key);
+		stored = value;
+		return stored;
+	}
+
+	// Value of a key, default constructed when missing
+	Value& operator[](const Key& key)
+	{
+		const uint found = FindSlot(key);
+		if (found != INVALID_SLOT)
+			return entries[found].second;
+
+		// Keep the load factor under 3/4
+		if ((count + 1) * 4 > used.size() * 3)
+			Rehash(MAX(FLAT_HASH_MAP_MIN_CAPACITY, static_cast<uint>(used.size()) * 2));
+
+		uint slot = IdealSlot(key);
+		while (used[slot])
+			slot = (slot + 1) & mask;
+
+		used[slot] = true;
+		entries[slot] = Entry(key, Value());
+		++count;
+		return entries[slot].second;
+	}
+
+	bool Erase(const Key& key)
+	{
+		uint hole = FindSlot(key);
+		if (hole == INVALID_SLOT)
+			return false;
+
+		// Backward shift, move every following entry that can reach the hole into it
+		uint next = hole;
+		while (true)
+		{
+			next = (next + 1) & mask;
+			if (!used[next])
+				break;
+
+			const uint ideal = IdealSlot(entries[next].first);
+			const bool reachable = hole <= next ? (ideal <= hole || ideal > next) : (ideal <= hole && ideal > next);
+			if (reachable)
+			{
+				entries[hole] = std::move(entries[next]);
+				hole = next;
+			}
+		}
+
+		used[hole] = false;
+		entries[hole] = Entry();
+		--count;
+		return true;
+	}
+
+	void Clear()
+	{
+		entries.clear();
+		used.clear();
+		count = 0;
+		mask = 0;
+	}
+
+	// Make room for a number of entries without rehashing
+	void Reserve(uint size)
+	{
+		uint capacity = FLAT_HASH_MAP_MIN_CAPACITY;
+		while (capacity * 3 < size * 4)
+			capacity *= 2;
+
+		if (capacity > used.size())
+			Rehash(capacity);
+	}
+
+	inline uint Size() const { return count; }
+	inline bool Empty() const { return count == 0; }
+
+	inline Iterator begin() { return Iterator(this, 0); }
+	inline Iterator end() { return Iterator(this, static_cast<uint>(used.size())); }
+	inline ConstIterator begin() const { return ConstIterator(this, 0); }
+	inline ConstIterator end() const { return ConstIterator(this, static_cast<uint>(used.size())); }
+
+private:
+
+	static const uint INVALID_SLOT = 0xFFFFFFFF;
+
+	inline uint IdealSlot(const Key& key) const { return static_cast<uint>(Hash()(key)) & mask; }
+
+	uint FindSlot(const Key& key) const
+	{
+		if (count == 0)
+			return INVALID_SLOT;
+
+		for (uint slot = IdealSlot(key); used[slot]; slot = (slot + 1) & mask)
+		{
+			if (entries[slot].first == key)
+				return slot;
+		}
+		return INVALID_SLOT;
+	}
+
+	void Rehash(uint capacity)
+	{
+		std::vector<Entry> oldEntries;
+		std::vector<bool> oldUsed;
+		oldEntries.swap(entries);
+		oldUsed.swap(used);
+
+		entries.resize(capacity);
+		used.assign(capacity, false);
+		mask = capacity - 1;
+
+		for (uint i = 0; i < oldUsed.size(); ++i)
+		{
+			if (!oldUsed[i])
+				continue;
+
+			uint slot = IdealSlot(oldEntries[i].first);
+			while (used[slot])
+				slot = (slot + 1) & mask;
+
+			used[slot] = true;
+			entries[slot] = std::move(oldEntries[i]);
+		}
+	}
+
+private:
+
+	std::vector<Entry> entries;
+	std::vector<bool> used;
+	uint count = 0;
+	// Capacity is a power of two
+	uint mask = 0;
+
+};
+
+#endif // !__FLAT_HASH_MAP_H__
\ No newline at end of file
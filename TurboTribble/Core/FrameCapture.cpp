@@ -0,0 +1,244 @@
+#include "FrameCapture.h"
+
+#include "Application.h"
+#include "ModuleFileSystem.h"
+#include "JobSystem.h"
+#include "PerfTimer.h"
+
+#include <vector>
+#include <thread>
+#include <string.h>
+#include "ImGui/imgui.h"
+
+#define TGA_HEADER_SIZE 18
+// Longest CleanUp waits for the GPU to finish a copy
+#define CAPTURE_FLUSH_TIMEOUT_NS 1000000000ull
+
+
+
+void FrameCapture::Init(RenderDevice* device)
+{
+	this->device = device;
+}
+
+void FrameCapture::CleanUp()
+{
+	if (recording)
+		StopSequence();
+
+	// The last frames of a sequence are still worth writing
+	for (Slot& slot : slots)
+	{
+		if (slot.state == SlotState::SLOT_READING)
+		{
+			device->WaitFence(slot.fence, CAPTURE_FLUSH_TIMEOUT_NS);
+			Map(slot);
+		}
+	}
+
+	for (Slot& slot : slots)
+	{
+		while (slot.state == SlotState::SLOT_ENCODING && !slot.encoded)
+			std::this_thread::yield();
+	}
+	Retire();
+
+	for (Slot& slot : slots)
+	{
+		device->DeleteBuffer(slot.buffer);
+		slot.buffer = 0;
+		slot.capacity = 0;
+	}
+}
+
+void FrameCapture::Grab(const char* file)
+{
+	pendingGrab = file;
+}
+
+void FrameCapture::StartSequence(const char* directory)
+{
+	if (recording)
+		StopSequence();
+
+	sequenceDirectory = directory;
+	sequenceFrame = 0;
+	sequenceWritten = writtenFrames;
+	sequenceFailed = failedFrames;
+	sequenceDropped = droppedFrames;
+	recording = true;
+	app->fileSystem->CreateDir(directory);
+
+	TTLOG("+++ Recording frames to %s +++\n", directory);
+}
+
+void FrameCapture::StopSequence()
+{
+	if (!recording)
+		return;
+
+	recording = false;
+
+	// Frames still being encoded are not counted as written yet
+	TTLOG("+++ Recorded %u frames to %s: %u written, %u dropped, %u failed +++\n", sequenceFrame, sequenceDirectory.c_str(),
+		writtenFrames - sequenceWritten, droppedFrames - sequenceDropped, failedFrames - sequenceFailed);
+}
+
+void FrameCapture::Update(uint framebuffer, uint width, uint height)
+{
+	PerfTimer timer;
+
+	Retire();
+
+	// Never wait, a copy the GPU has not finished is looked at again next frame
+	for (Slot& slot : slots)
+	{
+		if (slot.state == SlotState::SLOT_READING && device->WaitFence(slot.fence, 0))
+			Map(slot);
+	}
+
+	// A grab that found no free slot is tried again on the next frame
+	if (!pendingGrab.empty() && Read(framebuffer, width, height, pendingGrab, false))
+		pendingGrab.clear();
+
+	// Dropped frames leave a gap in the numbering
+	if (recording)
+	{
+		char file[256];
+		snprintf(file, 256, "%s/frame_%06u.%s", sequenceDirectory.c_str(), sequenceFrame++, format == CaptureFormat::CAPTURE_TGA ? "tga" : "raw");
+		if (!Read(framebuffer, width, height, file, true))
+			++droppedFrames;
+	}
+
+	updateMs = static_cast<float>(timer.ReadMs());
+}
+
+void FrameCapture::OnGui()
+{
+	const char* formats[] = { "TGA", "Raw BGRA" };
+	int current = static_cast<int>(format);
+	if (ImGui::Combo("Capture Format", &current, formats, 2))
+		format = static_cast<CaptureFormat>(current);
+
+	ImGui::InputText("Grab File", fileInput, sizeof(fileInput));
+	if (ImGui::Button("Grab Frame") && fileInput[0] != '\0')
+		Grab(fileInput);
+
+	if (recording)
+	{
+		ImGui::Text("Recording to %s: %u frames", sequenceDirectory.c_str(), sequenceFrame);
+		if (ImGui::Button("Stop Recording"))
+			StopSequence();
+	}
+	else
+	{
+		ImGui::InputText("Sequence Directory", directoryInput, sizeof(directoryInput));
+		if (ImGui::Button("Start Recording") && directoryInput[0] != '\0')
+			StartSequence(directoryInput);
+	}
+
+	ImGui::Text("Written: %u, main thread %.3f ms", writtenFrames.load(), updateMs);
+	if (droppedFrames > 0)
+		ImGui::TextColored(ImVec4(1, 1, 0, 1), "%u frames dropped, every readback buffer was busy", droppedFrames);
+	if (failedFrames > 0)
+		ImGui::TextColored(ImVec4(1, 0, 0, 1), "%u frames could not be written", failedFrames.load());
+}
+
+bool FrameCapture::Read(uint framebuffer, uint width, uint height, const std::string& file, bool quiet)
+{
+	Slot* slot = nullptr;
+	for (Slot& candidate : slots)
+	{
+		if (candidate.state == SlotState::SLOT_FREE)
+		{
+			slot = &candidate;
+			break;
+		}
+	}
+
+	if (slot == nullptr)
+		return false;
+
+	// Buffers only grow, a smaller panel reuses the storage
+	const uint64 size = static_cast<uint64>(width) * height * 4;
+	if (slot->buffer == 0)
+		slot->buffer = device->CreateBuffer(BufferTarget::BUFFER_PIXEL, size, nullptr, BufferUsage::USAGE_READBACK);
+	else if (slot->capacity < size)
+		device->SetBufferData(BufferTarget::BUFFER_PIXEL, slot->buffer, size, nullptr, BufferUsage::USAGE_READBACK);
+	slot->capacity = MAX(slot->capacity, size);
+
+	device->ReadFramebuffer(framebuffer, width, height, slot->buffer);
+	slot->fence = device->InsertFence();
+	slot->width = width;
+	slot->height = height;
+	slot->format = format;
+	slot->file = file;
+	slot->quiet = quiet;
+	slot->state = SlotState::SLOT_READING;
+
+	return true;
+}
+
+void FrameCapture::Map(Slot& slot)
+{
+	device->DeleteFence(slot.fence);
+	slot.fence = nullptr;
+
+	slot.pixels = device->MapBuffer(slot.buffer, static_cast<uint64>(slot.width) * slot.height * 4);
+	if (slot.pixels == nullptr)
+	{
+		TTLOG("### Error mapping the capture of %s ###\n", slot.file.c_str());
+		++failedFrames;
+		slot.state = SlotState::SLOT_FREE;
+		return;
+	}
+
+	// The worker reads straight from the mapped buffer, the main thread unmaps it once encoded is set
+	slot.encoded = false;
+	slot.state = SlotState::SLOT_ENCODING;
+
+	Slot* encoding = &slot;
+	app->jobs->Schedule([this, encoding]()
+	{
+		if (Encode(*encoding))
+			++writtenFrames;
+		else
+			++failedFrames;
+
+		encoding->encoded = true;
+	});
+}
+
+void FrameCapture::Retire()
+{
+	for (Slot& slot : slots)
+	{
+		if (slot.state == SlotState::SLOT_ENCODING && slot.encoded)
+		{
+			device->UnmapBuffer(slot.buffer);
+			slot.pixels = nullptr;
+			slot.state = SlotState::SLOT_FREE;
+		}
+	}
+}
+
+bool FrameCapture::Encode(const Slot& slot) const
+{
+	const uint size = slot.width * slot.height * 4;
+
+	if (slot.format == CaptureFormat::CAPTURE_RAW)
+		return app->fileSystem->Save(slot.file.c_str(), slot.pixels, size, false, !slot.quiet) == size;
+
+	// Bottom left origin and BGRA are what TGA stores, the rows go in as they were read
+	std::vector<uchar> image(TGA_HEADER_SIZE + size, 0);
+	image[2] = 2;
+	image[12] = slot.width & 0xFF;
+	image[13] = (slot.width >> 8) & 0xFF;
+	image[14] = slot.height & 0xFF;
+	image[15] = (slot.height >> 8) & 0xFF;
+	image[16] = 32;
+	image[17] = 8;
+	memcpy(&image[TGA_HEADER_SIZE], slot.pixels, size);
+
+	return app->fileSystem->Save(slot.file.c_str(), image.data(), static_cast<uint>(image.size()), false, !slot.quiet) == image.size();
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef __FRAME_CAPTURE_H__
+#define __FRAME_CAPTURE_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "RenderDevice.h"
+
+#include <string>
+#include <atomic>
+
+// Readbacks in flight, a frame is mapped once the GPU finished copying it, usually two frames later
+#define CAPTURE_RING_SIZE 3
+
+
+
+enum class CaptureFormat
+{
+	// Uncompressed 32 bit TGA, opens in any image viewer
+	CAPTURE_TGA,
+	// Pixels only, BGRA8 rows from bottom to top
+	CAPTURE_RAW
+};
+
+// Grabs frames from a framebuffer without stalling on the GPU
+// Each grab is copied into one of a ring of readback buffers and fenced, the buffer is mapped once the fence passed
+// Workers write the mapped pixels to file, a grab that finds every buffer busy is dropped instead of waiting
+class FrameCapture
+{
+public:
+
+	void Init(RenderDevice* device);
+	// Finish the grabs still in flight, waiting for the GPU and the workers
+	void CleanUp();
+
+	// Grab the next frame into file inside the write directory
+	void Grab(const char* file);
+	// Grab every frame into numbered files inside directory until StopSequence
+	void StartSequence(const char* directory);
+	void StopSequence();
+	inline bool IsRecording() const { return recording; }
+
+	// Queue the readback of framebuffer when a grab is due and hand the finished ones to the workers
+	// Called once per frame after the frame was drawn
+	void Update(uint framebuffer, uint width, uint height);
+
+	// Grab and sequence controls
+	void OnGui();
+
+public:
+
+	CaptureFormat format = CaptureFormat::CAPTURE_TGA;
+
+private:
+
+	enum class SlotState
+	{
+		SLOT_FREE,
+		// Copy queued, waiting for the fence
+		SLOT_READING,
+		// Mapped and owned by a worker until encoded is set
+		SLOT_ENCODING
+	};
+
+	struct Slot
+	{
+		SlotState state = SlotState::SLOT_FREE;
+		uint buffer = 0;
+		uint64 capacity = 0;
+		RenderFence fence = nullptr;
+		uint width = 0, height = 0;
+		CaptureFormat format = CaptureFormat::CAPTURE_TGA;
+		std::string file;
+		// Frames of a sequence are written without a log line each
+		bool quiet = false;
+		const void* pixels = nullptr;
+		std::atomic<bool> encoded { false };
+	};
+
+	// Queue the copy of the frame into a free slot, false when none is free
+	bool Read(uint framebuffer, uint width, uint height, const std::string& file, bool quiet);
+	// Map a slot whose fence passed and schedule its encode
+	void Map(Slot& slot);
+	// Unmap the slots the workers are done with
+	void Retire();
+	// Write the pixels of a mapped slot to its file, runs on a worker
+	bool Encode(const Slot& slot) const;
+
+private:
+
+	RenderDevice* device = nullptr;
+	Slot slots[CAPTURE_RING_SIZE];
+
+	std::string pendingGrab;
+	bool recording = false;
+	std::string sequenceDirectory;
+	uint sequenceFrame = 0;
+	// Counters when the sequence started, its summary reports the difference
+	uint sequenceWritten = 0, sequenceFailed = 0, sequenceDropped = 0;
+
+	// Written by the workers
+	std::atomic<uint> writtenFrames { 0 };
+	std::atomic<uint> failedFrames { 0 };
+	uint droppedFrames = 0;
+	// Main thread cost of the last Update
+	float updateMs = 0.f;
+
+	char fileInput[128] = "capture.tga";
+	char directoryInput[128] = "Captures";
+
+};
+
+#endif // !__FRAME_CAPTURE_H__
\ No newline at end of file
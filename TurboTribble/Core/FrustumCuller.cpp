@@ -0,0 +1,114 @@
+#include "FrustumCuller.h"
+
+#include "CpuInfo.h"
+
+#include "Geometry/Plane.h"
+
+
+
+FrustumCuller::FrustumCuller() : hasAVX(HasAVX())
+{}
+
+void FrustumCuller::Begin(const Frustum& frustum, uint numObjects)
+{
+	Plane frustumPlanes[6];
+	frustum.GetPlanes(frustumPlanes);
+	for (uint i = 0; i < 6; ++i)
+	{
+		planes[i][0] = frustumPlanes[i].normal.x;
+		planes[i][1] = frustumPlanes[i].normal.y;
+		planes[i][2] = frustumPlanes[i].normal.z;
+		planes[i][3] = frustumPlanes[i].d;
+	}
+
+	this->numObjects = numObjects;
+
+	// The padding lanes are read by the last batch and masked out afterwards
+	const uint padded = (numObjects + FRUSTUM_BATCH_SIZE - 1) / FRUSTUM_BATCH_SIZE * FRUSTUM_BATCH_SIZE;
+	centerX.assign(padded, 0.f);
+	centerY.assign(padded, 0.f);
+	centerZ.assign(padded, 0.f);
+	radius.assign(padded, 0.f);
+	for (uint axis = 0; axis < 3; ++axis)
+	{
+		boxMin[axis].assign(padded, 0.f);
+		boxMax[axis].assign(padded, 0.f);
+	}
+}
+
+void FrustumCuller::SetBounds(uint index, const float3& center, float radius, const AABB& box)
+{
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	this->radius[index] = radius;
+
+	for (uint axis = 0; axis < 3; ++axis)
+	{
+		boxMin[axis][index] = box.minPoint[axis];
+		boxMax[axis][index] = box.maxPoint[axis];
+	}
+}
+
+void FrustumCuller::Cull()
+{
+	visible.clear();
+	numBoxBatches = 0;
+
+	for (uint first = 0; first < numObjects; first += FRUSTUM_BATCH_SIZE)
+	{
+		const uint lanes = MIN(numObjects - first, static_cast<uint>(FRUSTUM_BATCH_SIZE));
+		uint mask = (hasAVX ? CullBatchAVX(first) : CullBatch(first)) & ((1u << lanes) - 1);
+
+		for (uint index = first; mask != 0; ++index, mask >>= 1)
+		{
+			if ((mask & 1) != 0)
+				visible.push_back(index);
+		}
+	}
+
+	// Same as the occlusion culler, the SSE code after it must not pay for dirty upper halves
+	if (hasAVX)
+		EndAVX();
+}
+
+uint FrustumCuller::CullBatch(uint first)
+{
+	uint mask = 0;
+	bool boxTested = false;
+
+	for (uint lane = 0; lane < FRUSTUM_BATCH_SIZE; ++lane)
+	{
+		const uint i = first + lane;
+		bool outside = false;
+		bool crossing = false;
+
+		for (uint p = 0; p < 6 && !outside; ++p)
+		{
+			const float distance = planes[p][0] * centerX[i] + planes[p][1] * centerY[i] + planes[p][2] * centerZ[i] - planes[p][3];
+			outside = distance > radius[i];
+			crossing = crossing || distance > -radius[i];
+		}
+
+		// The corner furthest inside each plane, the box is out when even that one is outside
+		if (!outside && crossing)
+		{
+			boxTested = true;
+			for (uint p = 0; p < 6 && !outside; ++p)
+			{
+				float distance = -planes[p][3];
+				for (uint axis = 0; axis < 3; ++axis)
+					distance += planes[p][axis] * (planes[p][axis] > 0.f ? boxMin[axis][i] : boxMax[axis][i]);
+				outside = distance > 0.f;
+			}
+		}
+
+		if (!outside)
+			mask |= 1u << lane;
+	}
+
+	if (boxTested)
+		++numBoxBatches;
+
+	return mask;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef __FRUSTUM_CULLER_H__
+#define __FRUSTUM_CULLER_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <vector>
+#include "Math/float3.h"
+#include "Geometry/AABB.h"
+#include "Geometry/Frustum.h"
+
+// Objects tested together, the bounds arrays are padded to a multiple of it
+#define FRUSTUM_BATCH_SIZE 8
+
+
+
+// Visibility of many objects against the six planes of a frustum, a whole batch at a time
+// Bounds live in one array per component, each plane is broadcast and tested against every object of the batch
+// The bounding sphere settles most objects, the box is only tested in batches where some sphere crosses a plane
+// Conservative, an object outside the frustum can pass when it sits past a corner, never the other way around
+class FrustumCuller
+{
+public:
+
+	// Constructor, AVX is used when the CPU has it
+	FrustumCuller();
+
+	// Take the planes of frustum and make room for the bounds of numObjects objects
+	void Begin(const Frustum& frustum, uint numObjects);
+	// World bounds of one object, every slot is written alone so jobs can fill them in parallel
+	void SetBounds(uint index, const float3& center, float radius, const AABB& box);
+	// Test every object and list the visible ones in index order
+	void Cull();
+
+	inline const std::vector<uint>& GetVisible() const { return visible; }
+	inline uint GetNumObjects() const { return numObjects; }
+	inline uint GetNumCulled() const { return numObjects - static_cast<uint>(visible.size()); }
+	// Batches of the last Cull that needed the box test
+	inline uint GetNumBoxBatches() const { return numBoxBatches; }
+	inline bool UsesAVX() const { return hasAVX; }
+
+private:
+
+	// One bit per visible object of the batch starting at first
+	uint CullBatch(uint first);
+	uint CullBatchAVX(uint first);
+	// Clear the upper halves once the AVX batches are done
+	static void EndAVX();
+
+private:
+
+	bool hasAVX = false;
+
+	// Outward normal and distance of each plane, a point p is outside when normal.Dot(p) > d
+	float planes[6][4];
+
+	uint numObjects = 0;
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> boxMin[3];
+	std::vector<float> boxMax[3];
+
+	std::vector<uint> visible;
+	uint numBoxBatches = 0;
+
+};
+
+#endif // !__FRUSTUM_CULLER_H__
\ No newline at end of file
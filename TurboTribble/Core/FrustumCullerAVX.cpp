@@ -0,0 +1,60 @@
+#include "FrustumCuller.h"
+
+// Built with AVX enabled, only called after the CPU check of the constructor
+#include <immintrin.h>
+
+
+
+uint FrustumCuller::CullBatchAVX(uint first)
+{
+	const __m256 x = _mm256_loadu_ps(&centerX[first]);
+	const __m256 y = _mm256_loadu_ps(&centerY[first]);
+	const __m256 z = _mm256_loadu_ps(&centerZ[first]);
+	const __m256 r = _mm256_loadu_ps(&radius[first]);
+	const __m256 negativeR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+
+	__m256 outside = _mm256_setzero_ps();
+	__m256 crossing = _mm256_setzero_ps();
+	for (uint p = 0; p < 6; ++p)
+	{
+		const __m256 distance = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_set1_ps(planes[p][0]), x),
+			_mm256_mul_ps(_mm256_set1_ps(planes[p][1]), y)),
+			_mm256_mul_ps(_mm256_set1_ps(planes[p][2]), z)),
+			_mm256_set1_ps(planes[p][3]));
+
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, r, _CMP_GT_OQ));
+		crossing = _mm256_or_ps(crossing, _mm256_cmp_ps(distance, negativeR, _CMP_GT_OQ));
+	}
+
+	uint culled = static_cast<uint>(_mm256_movemask_ps(outside));
+
+	// Only spheres crossing a plane are left undecided, fully inside ones are visible as they are
+	if ((static_cast<uint>(_mm256_movemask_ps(crossing)) & ~culled) != 0)
+	{
+		++numBoxBatches;
+
+		__m256 boxOutside = _mm256_setzero_ps();
+		for (uint p = 0; p < 6; ++p)
+		{
+			// The sign of the normal picks the same corner for the whole batch
+			__m256 distance = _mm256_set1_ps(-planes[p][3]);
+			for (uint axis = 0; axis < 3; ++axis)
+			{
+				const __m256 corner = _mm256_loadu_ps(planes[p][axis] > 0.f ? &boxMin[axis][first] : &boxMax[axis][first]);
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes[p][axis]), corner));
+			}
+
+			boxOutside = _mm256_or_ps(boxOutside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GT_OQ));
+		}
+
+		culled |= static_cast<uint>(_mm256_movemask_ps(boxOutside));
+	}
+
+	return ~culled & 0xFF;
+}
+
+void FrustumCuller::EndAVX()
+{
+	_mm256_zeroupper();
+}
\ No newline at end of file
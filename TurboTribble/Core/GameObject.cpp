@@ -6,6 +6,7 @@
 #include "ComponentTransform.h"
 
 #include "ImGui/imgui.h"
+#include <algorithm>
 
 
 
@@ -0,0 +1,162 @@
+#include "GeometryPool.h"
+
+#include "RenderDevice.h"
+
+#include <iterator>
+
+
+
+// ----- RangeAllocator -----
+
+void RangeAllocator::Init(uint capacity)
+{
+	this->capacity = capacity;
+	used = 0;
+	freeRanges.clear();
+	freeRanges[0] = capacity;
+}
+
+bool RangeAllocator::Allocate(uint size, uint& offset)
+{
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		if (it->second < size)
+			continue;
+
+		offset = it->first;
+		const uint remaining = it->second - size;
+		freeRanges.erase(it);
+		if (remaining > 0)
+			freeRanges[offset + size] = remaining;
+
+		used += size;
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::Free(uint offset, uint size)
+{
+	used -= size;
+	auto next = freeRanges.lower_bound(offset);
+
+	// Merge with the free range right after
+	if (next != freeRanges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	// And with the one right before
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			return;
+		}
+	}
+
+	freeRanges[offset] = size;
+}
+// --------------------------
+
+void GeometryPool::Init(RenderDevice* device)
+{
+	this->device = device;
+}
+
+void GeometryPool::CleanUp()
+{
+	for (GeometryPage& page : pages)
+	{
+		device->DeleteBuffer(page.positionBuffer);
+		device->DeleteBuffer(page.normalBuffer);
+		device->DeleteBuffer(page.texCoordBuffer);
+		device->DeleteBuffer(page.indexBuffer);
+	}
+	pages.clear();
+	numMeshes = 0;
+}
+
+bool GeometryPool::Allocate(uint numVertices, const float3* positions, const float3* normals, const float2* texCoords, uint numIndices, const uint* indices, GeometryAllocation& allocation)
+{
+	if (numVertices == 0 || numIndices == 0 || numVertices > GEOMETRY_PAGE_VERTICES || numIndices > GEOMETRY_PAGE_INDICES)
+		return false;
+
+	uint page = 0, firstVertex = 0, firstIndex = 0;
+	for (; page < pages.size(); ++page)
+	{
+		if (!pages[page].vertices.Allocate(numVertices, firstVertex))
+			continue;
+		if (pages[page].indices.Allocate(numIndices, firstIndex))
+			break;
+		pages[page].vertices.Free(firstVertex, numVertices);
+	}
+
+	if (page == pages.size())
+	{
+		AddPage();
+		pages[page].vertices.Allocate(numVertices, firstVertex);
+		pages[page].indices.Allocate(numIndices, firstIndex);
+	}
+
+	const GeometryPage& target = pages[page];
+	device->UpdateBuffer(BufferTarget::BUFFER_VERTEX, target.positionBuffer, sizeof(float3) * firstVertex, sizeof(float3) * numVertices, positions);
+	device->UpdateBuffer(BufferTarget::BUFFER_INDEX, target.indexBuffer, sizeof(uint) * firstIndex, sizeof(uint) * numIndices, indices);
+
+	// Same values the queue gives meshes without these streams: normals facing +Z and uv 0
+	if (normals != nullptr)
+	{
+		device->UpdateBuffer(BufferTarget::BUFFER_VERTEX, target.normalBuffer, sizeof(float3) * firstVertex, sizeof(float3) * numVertices, normals);
+	}
+	else
+	{
+		const std::vector<float3> defaults(numVertices, float3(0.f, 0.f, 1.f));
+		device->UpdateBuffer(BufferTarget::BUFFER_VERTEX, target.normalBuffer, sizeof(float3) * firstVertex, sizeof(float3) * numVertices, defaults.data());
+	}
+
+	if (texCoords != nullptr)
+	{
+		device->UpdateBuffer(BufferTarget::BUFFER_VERTEX, target.texCoordBuffer, sizeof(float2) * firstVertex, sizeof(float2) * numVertices, texCoords);
+	}
+	else
+	{
+		const std::vector<float2> defaults(numVertices, float2(0.f, 0.f));
+		device->UpdateBuffer(BufferTarget::BUFFER_VERTEX, target.texCoordBuffer, sizeof(float2) * firstVertex, sizeof(float2) * numVertices, defaults.data());
+	}
+
+	allocation.page = page;
+	allocation.firstVertex = firstVertex;
+	allocation.numVertices = numVertices;
+	allocation.firstIndex = firstIndex;
+	allocation.numIndices = numIndices;
+	++numMeshes;
+	return true;
+}
+
+void GeometryPool::Free(GeometryAllocation& allocation)
+{
+	if (!allocation.IsValid() || allocation.page >= pages.size())
+		return;
+
+	pages[allocation.page].vertices.Free(allocation.firstVertex, allocation.numVertices);
+	pages[allocation.page].indices.Free(allocation.firstIndex, allocation.numIndices);
+	allocation = GeometryAllocation();
+	--numMeshes;
+}
+
+void GeometryPool::AddPage()
+{
+	GeometryPage page;
+	page.positionBuffer = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, sizeof(float3) * GEOMETRY_PAGE_VERTICES, nullptr, BufferUsage::USAGE_STATIC);
+	page.normalBuffer = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, sizeof(float3) * GEOMETRY_PAGE_VERTICES, nullptr, BufferUsage::USAGE_STATIC);
+	page.texCoordBuffer = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, sizeof(float2) * GEOMETRY_PAGE_VERTICES, nullptr, BufferUsage::USAGE_STATIC);
+	page.indexBuffer = device->CreateBuffer(BufferTarget::BUFFER_INDEX, sizeof(uint) * GEOMETRY_PAGE_INDICES, nullptr, BufferUsage::USAGE_STATIC);
+	page.vertices.Init(GEOMETRY_PAGE_VERTICES);
+	page.indices.Init(GEOMETRY_PAGE_INDICES);
+	pages.push_back(page);
+
+	TTLOG("+++ Geometry pool page %u created +++\n", static_cast<uint>(pages.size()));
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef __GEOMETRY_POOL_H__
+#define __GEOMETRY_POOL_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <map>
+#include <vector>
+#include "Math/float2.h"
+#include "Math/float3.h"
+
+// Capacity of the buffers of one page, a mesh larger than a page keeps its own buffers
+#define GEOMETRY_PAGE_VERTICES (256 * 1024)
+#define GEOMETRY_PAGE_INDICES (768 * 1024)
+#define INVALID_GEOMETRY_PAGE 0xFFFFFFFF
+
+
+
+class RenderDevice;
+
+// First fit free list over [0, capacity), neighbouring free ranges are merged when given back
+class RangeAllocator
+{
+public:
+
+	void Init(uint capacity);
+
+	// Offset of a free range of size elements, false when none is large enough
+	bool Allocate(uint size, uint& offset);
+	void Free(uint offset, uint size);
+
+	inline uint GetCapacity() const { return capacity; }
+	inline uint GetUsed() const { return used; }
+	inline uint GetNumFreeRanges() const { return static_cast<uint>(freeRanges.size()); }
+
+private:
+
+	// Offset to size of every free range, ordered so neighbours are found in log time
+	std::map<uint, uint> freeRanges;
+	uint capacity = 0;
+	uint used = 0;
+
+};
+
+// Where a mesh lives inside the pool, its indices are relative to firstVertex
+struct GeometryAllocation
+{
+	uint page = INVALID_GEOMETRY_PAGE;
+	uint firstVertex = 0;
+	uint numVertices = 0;
+	uint firstIndex = 0;
+	uint numIndices = 0;
+
+	inline bool IsValid() const { return page != INVALID_GEOMETRY_PAGE; }
+};
+
+// Shared vertex streams and index buffer, every pooled mesh is a range of them
+struct GeometryPage
+{
+	uint positionBuffer = 0;
+	uint normalBuffer = 0;
+	uint texCoordBuffer = 0;
+	uint indexBuffer = 0;
+	RangeAllocator vertices;
+	RangeAllocator indices;
+};
+
+// Static meshes sub-allocated from a few large buffers, so draws of different meshes share their bindings
+// Pages are created when the ones there are run out of space and live until CleanUp
+class GeometryPool
+{
+public:
+
+	void Init(RenderDevice* device);
+	// Delete every page, the meshes still in them must not be drawn anymore
+	void CleanUp();
+
+	// Copy a mesh into the first page with room, normals and texCoords can be nullptr
+	// Missing streams are filled with the values the shader uses for meshes without them
+	bool Allocate(uint numVertices, const float3* positions, const float3* normals, const float2* texCoords, uint numIndices, const uint* indices, GeometryAllocation& allocation);
+	void Free(GeometryAllocation& allocation);
+
+	inline const GeometryPage& GetPage(uint page) const { return pages[page]; }
+	inline uint GetNumPages() const { return static_cast<uint>(pages.size()); }
+	inline uint GetNumMeshes() const { return numMeshes; }
+
+private:
+
+	// Reserve the buffers of a new page
+	void AddPage();
+
+private:
+
+	RenderDevice* device = nullptr;
+	std::vector<GeometryPage> pages;
+	uint numMeshes = 0;
+
+};
+
+#endif // !__GEOMETRY_POOL_H__
\ No newline at end of file
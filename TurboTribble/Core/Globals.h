@@ -4,10 +4,15 @@
 
 
 // Warning disabled ---
+#ifdef _MSC_VER
 #pragma warning( disable : 4577 ) // Warning that exceptions are disabled
 #pragma warning( disable : 4530 ) // Warning that exceptions are disabled
+#endif
 
+// Only the Windows build needs it, the GL headers there depend on it
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <stdio.h>
 
 
@@ -16,11 +21,16 @@
 #define SAVE_JSON_BOOL(b) { writer.String(#b); writer.Bool(b); }
 #define LOAD_JSON_FLOAT(b) { b = config.HasMember(#b) ? config[#b].GetFloat() : b; }
 #define SAVE_JSON_FLOAT(b) { writer.String(#b); writer.Double(b); }
+#define LOAD_JSON_INT(b) { b = config.HasMember(#b) ? config[#b].GetInt() : b; }
+#define SAVE_JSON_INT(b) { writer.String(#b); writer.Int(b); }
 
 
 // Definition of Log process done in Log.cpp
-#define TTLOG(format, ...) TTLog(__FILE__, __LINE__, format, __VA_ARGS__);
+#define TTLOG(format, ...) TTLog(__FILE__, __LINE__, format, ##__VA_ARGS__);
 void TTLog(const char file[], int line, const char* format, ...);
+// Gets every logged line besides the debugger output, the editor console sets one
+typedef void (*LogListener)(const char* text);
+void SetLogListener(LogListener listener);
 
 
 #define CAP(n) ((n <= 0.0f) ? n=0.0f : (n >= 1.0f) ? n=1.0f : n=n)
@@ -31,12 +41,15 @@ void TTLog(const char file[], int line, const char* format, ...);
 #define RADTODEG 57.295779513082320876f
 #define HAVE_M_PI
 
+// Memory definitions
+#define BYTES_TO_MB(b) (static_cast<float>(b) / (1024.f * 1024.f))
+
 
 
 // Unsigned int redefinitions
 typedef unsigned int uint;
-typedef unsigned __int32 uint32;
-typedef unsigned __int64 uint64;
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
 
 
 // Status of the Application's Update()
@@ -57,6 +70,8 @@ enum class UpdateStatus
 #define WIN_BORDERLESS false
 #define WIN_FULLSCREEN_DESKTOP false
 #define VSYNC true
+// Core profile context, nothing draws with the fixed function pipeline anymore
+#define CORE_PROFILE true
 #define TITLE "TurboTribble"
 #define ORGANITZATION "CITM-UPC"
 
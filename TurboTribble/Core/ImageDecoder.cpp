@@ -0,0 +1,105 @@
+#include "ImageDecoder.h"
+
+#include <string.h>
+
+#define TGA_TYPE_TRUE_COLOR 2
+#define TGA_TYPE_TRUE_COLOR_RLE 10
+// Image descriptor bits
+#define TGA_ALPHA_BITS 0x0F
+#define TGA_RIGHT_TO_LEFT 0x10
+#define TGA_UPPER_LEFT 0x20
+
+
+
+bool ImageDecoder::DecodeTGA(const char* buffer, uint size, TextureData& texture, bool& upperLeft)
+{
+	if (buffer == nullptr || size < TGA_HEADER_SIZE)
+		return false;
+
+	// TGA has no magic, the header has to make sense instead, PNG, JPEG, DDS and BMP all fail the color map byte
+	const uchar* header = reinterpret_cast<const uchar*>(buffer);
+	const uint idLength = header[0];
+	const uint colorMapType = header[1];
+	const uint imageType = header[2];
+	const uint width = header[12] | (header[13] << 8);
+	const uint height = header[14] | (header[15] << 8);
+	const uint bitsPerPixel = header[16];
+	const uint descriptor = header[17];
+
+	if (colorMapType != 0 || (imageType != TGA_TYPE_TRUE_COLOR && imageType != TGA_TYPE_TRUE_COLOR_RLE))
+		return false;
+	if ((bitsPerPixel != 24 && bitsPerPixel != 32) || (descriptor & TGA_RIGHT_TO_LEFT) != 0)
+		return false;
+	if (width == 0 || height == 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE)
+		return false;
+
+	const uint bytesPerPixel = bitsPerPixel / 8;
+	const uint levelSize = width * height * bytesPerPixel;
+	if (size - TGA_HEADER_SIZE < idLength)
+		return false;
+
+	const uchar* cursor = header + TGA_HEADER_SIZE + idLength;
+	const uchar* end = header + size;
+
+	TextureLevel level;
+	level.width = width;
+	level.height = height;
+
+	if (imageType == TGA_TYPE_TRUE_COLOR)
+	{
+		if (static_cast<uint>(end - cursor) < levelSize)
+			return false;
+		level.data.assign(cursor, cursor + levelSize);
+	}
+	else
+	{
+		// Packets of up to 128 pixels, a repeated pixel or a run of raw ones, they may cross rows
+		level.data.resize(levelSize);
+		uchar* out = level.data.data();
+		uint written = 0;
+		while (written < levelSize)
+		{
+			if (cursor == end)
+				return false;
+
+			const uint packet = *cursor++;
+			const uint count = (packet & 0x7F) + 1;
+			const uint bytes = count * bytesPerPixel;
+			if (bytes > levelSize - written)
+				return false;
+
+			if ((packet & 0x80) != 0)
+			{
+				if (static_cast<uint>(end - cursor) < bytesPerPixel)
+					return false;
+				for (uint i = 0; i < count; ++i)
+					memcpy(out + written + i * bytesPerPixel, cursor, bytesPerPixel);
+				cursor += bytesPerPixel;
+			}
+			else
+			{
+				if (static_cast<uint>(end - cursor) < bytes)
+					return false;
+				memcpy(out + written, cursor, bytes);
+				cursor += bytes;
+			}
+			written += bytes;
+		}
+	}
+
+	// 32 bit files that declare no alpha bits only pad the pixels, they are opaque
+	if (bytesPerPixel == 4 && (descriptor & TGA_ALPHA_BITS) == 0)
+	{
+		for (uint i = 3; i < levelSize; i += 4)
+			level.data[i] = 255;
+	}
+
+	texture.format = bytesPerPixel == 4 ? TextureFormat::RGBA8 : TextureFormat::RGB8;
+	texture.width = width;
+	texture.height = height;
+	texture.levels.clear();
+	texture.levels.push_back(std::move(level));
+
+	upperLeft = (descriptor & TGA_UPPER_LEFT) != 0;
+	return true;
+}
\ No newline at end of file
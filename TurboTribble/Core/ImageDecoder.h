@@ -0,0 +1,26 @@
+#ifndef __IMAGE_DECODER_H__
+#define __IMAGE_DECODER_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "TextureData.h"
+
+// Bytes of the TGA header before the image id
+#define TGA_HEADER_SIZE 18
+
+
+
+// Decoders that keep no global state, the workers run them at the same time without the DevIL lock
+// Only formats that are simple to read are here, anything else is left to DevIL
+class ImageDecoder
+{
+public:
+
+	// Decode an uncompressed or RLE true color TGA into one RGB8/RGBA8 level, rows in file order
+	// upperLeft tells where the first row goes, the pixels are BGR(A) so they still need a red and blue swap
+	// False when the buffer is anything else, it does not log so callers can try DevIL next
+	static bool DecodeTGA(const char* buffer, uint size, TextureData& texture, bool& upperLeft);
+};
+
+#endif // !__IMAGE_DECODER_H__
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "JobSystem.h"
+
+#include "p2Defs.h"
+
+#include <atomic>
+#include <memory>
+
+
+
+// Shared between the caller and the helper jobs of a single ParallelFor
+struct ParallelForState
+{
+	std::atomic<uint> next { 0 };
+	std::atomic<uint> done { 0 };
+	uint count = 0;
+	std::function<void(uint)> func;
+
+	std::mutex mutex;
+	std::condition_variable finished;
+};
+
+JobSystem::JobSystem(uint numThreads)
+{
+	if (numThreads == 0)
+	{
+		const uint hardwareThreads = std::thread::hardware_concurrency();
+		numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	workers.reserve(numThreads);
+	for (uint i = 0; i < numThreads; ++i)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		stopping = true;
+	}
+	jobsCondition.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	workers.clear();
+}
+
+void JobSystem::Schedule(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		jobs.push(job);
+	}
+	jobsCondition.notify_one();
+}
+
+void JobSystem::ParallelFor(uint count, const std::function<void(uint)>& func)
+{
+	if (count == 0)
+		return;
+
+	if (count == 1 || workers.empty())
+	{
+		for (uint i = 0; i < count; ++i)
+			func(i);
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->count = count;
+	state->func = func;
+
+	// Every runner keeps claiming indices until none are left, so the caller never waits on a job that has not started
+	auto run = [state]()
+	{
+		uint i = 0;
+		while ((i = state->next.fetch_add(1)) < state->count)
+		{
+			state->func(i);
+			if (state->done.fetch_add(1) + 1 == state->count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	const uint helpers = MIN(count - 1, static_cast<uint>(workers.size()));
+	for (uint i = 0; i < helpers; ++i)
+		Schedule(run);
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->done.load() == state->count; });
+}
+
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobsMutex);
+			jobsCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+			if (jobs.empty())
+				return;
+
+			job = jobs.front();
+			jobs.pop();
+		}
+		job();
+	}
+}
\ No newline at end of file
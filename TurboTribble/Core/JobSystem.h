@@ -0,0 +1,50 @@
+#ifndef __JOB_SYSTEM_H__
+#define __JOB_SYSTEM_H__
+
+#include "Globals.h"
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+
+class JobSystem
+{
+public:
+
+	// Constructor, 0 threads spawns one worker per hardware thread except the caller's
+	JobSystem(uint numThreads = 0);
+	// Destructor, waits for the queued jobs and joins all workers
+	~JobSystem();
+
+	// Queue a job to be run by any worker
+	void Schedule(const std::function<void()>& job);
+	// Run func(i) for every i in [0, count) on the workers and the calling thread, returns when all are done
+	void ParallelFor(uint count, const std::function<void(uint)>& func);
+
+	// Workers plus the calling thread
+	inline uint GetNumThreads() const { return static_cast<uint>(workers.size()) + 1; }
+
+private:
+
+	// Pop and run jobs until the system stops
+	void WorkerLoop();
+
+private:
+
+	// ----- Workers -----
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex jobsMutex;
+	std::condition_variable jobsCondition;
+	bool stopping = false;
+	// -------------------
+
+};
+
+#endif // !__JOB_SYSTEM_H__
\ No newline at end of file
@@ -2,19 +2,11 @@
 
 #include "Globals.h"
 
-#include <gl/GL.h>
 
 
-
-Light::Light() : ref(-1), on(false), position(0.0f, 0.0f, 0.0f)
+Light::Light() : on(false), position(0.0f, 0.0f, 0.0f)
 {}
 
-void Light::Init()
-{
-	glLightfv(ref, GL_AMBIENT, &ambient);
-	glLightfv(ref, GL_DIFFUSE, &diffuse);
-}
-
 void Light::SetPos(float x, float y, float z)
 {
 	position.x = x;
@@ -22,24 +14,7 @@ void Light::SetPos(float x, float y, float z)
 	position.z = z;
 }
 
-void Light::Render()
-{
-	if(on)
-	{
-		float pos[] = {position.x, position.y, position.z, 1.0f};
-		glLightfv(ref, GL_POSITION, pos);
-	}
-}
-
 void Light::Active(bool active)
 {
-	if(on != active)
-	{
-		on = !on;
-
-		if(on)
-			glEnable(ref);
-		else
-			glDisable(ref);
-	}
+	on = active;
 }
\ No newline at end of file
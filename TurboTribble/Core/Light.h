@@ -10,16 +10,14 @@ struct Light
 {
 	Light();
 
-	void Init();
 	void SetPos(float x, float y, float z);
 	void Active(bool active);
-	void Render();
 
 	Color ambient;
 	Color diffuse;
 	float3 position;
 
-	int ref;
+	// Only lights that are on reach the Frame uniform block
 	bool on;
 };
 
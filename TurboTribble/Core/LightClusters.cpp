@@ -0,0 +1,246 @@
+#include "LightClusters.h"
+
+#include "JobSystem.h"
+
+#include <math.h>
+#include <string.h>
+#include <emmintrin.h>
+
+// Mask words per cluster
+#define CLUSTER_MASK_WORDS (MAX_CLUSTER_LIGHTS / 32)
+
+
+
+void LightClusters::Init(JobSystem* jobs)
+{
+	this->jobs = jobs;
+
+	for (uint axis = 0; axis < 3; ++axis)
+	{
+		boxMin[axis].resize(CLUSTER_COUNT);
+		boxMax[axis].resize(CLUSTER_COUNT);
+	}
+
+	masks.resize(CLUSTER_COUNT * CLUSTER_MASK_WORDS);
+	clusters.assign(CLUSTER_COUNT, 0);
+	indices.assign(MAX_CLUSTER_INDICES / 2, 0);
+}
+
+void LightClusters::SetProjection(float tanHalfFovX, float tanHalfFovY, float nearPlane, float farPlane)
+{
+	if (tanHalfFovX == this->tanHalfFovX && tanHalfFovY == this->tanHalfFovY && nearPlane == this->nearPlane && farPlane == this->farPlane)
+		return;
+
+	this->tanHalfFovX = tanHalfFovX;
+	this->tanHalfFovY = tanHalfFovY;
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+
+	const float depthRatio = farPlane / nearPlane;
+	sliceScale = CLUSTER_SLICES / logf(depthRatio);
+	sliceBias = -logf(nearPlane) * sliceScale;
+
+	// A tile spans the same NDC range at every depth, in view space it widens with the distance
+	for (uint slice = 0; slice < CLUSTER_SLICES; ++slice)
+	{
+		const float nearDepth = nearPlane * powf(depthRatio, static_cast<float>(slice) / CLUSTER_SLICES);
+		const float farDepth = nearPlane * powf(depthRatio, static_cast<float>(slice + 1) / CLUSTER_SLICES);
+
+		for (uint y = 0; y < CLUSTER_TILES_Y; ++y)
+		{
+			const float bottom = (-1.f + 2.f * y / CLUSTER_TILES_Y) * tanHalfFovY;
+			const float top = (-1.f + 2.f * (y + 1) / CLUSTER_TILES_Y) * tanHalfFovY;
+
+			for (uint x = 0; x < CLUSTER_TILES_X; ++x)
+			{
+				const float left = (-1.f + 2.f * x / CLUSTER_TILES_X) * tanHalfFovX;
+				const float right = (-1.f + 2.f * (x + 1) / CLUSTER_TILES_X) * tanHalfFovX;
+
+				const uint cluster = GetClusterIndex(x, y, slice);
+				boxMin[0][cluster] = MIN(left * nearDepth, left * farDepth);
+				boxMax[0][cluster] = MAX(right * nearDepth, right * farDepth);
+				boxMin[1][cluster] = MIN(bottom * nearDepth, bottom * farDepth);
+				boxMax[1][cluster] = MAX(top * nearDepth, top * farDepth);
+				boxMin[2][cluster] = -farDepth;
+				boxMax[2][cluster] = -nearDepth;
+			}
+		}
+	}
+}
+
+void LightClusters::Bin(const float4x4& view, const ClusterLight* lights, uint numLights)
+{
+	numBinned = MIN(numLights, static_cast<uint>(MAX_CLUSTER_LIGHTS));
+	numVisible = 0;
+
+	// Lights outside the grid get an empty slice range and are skipped by every job
+	bounds.resize(numBinned);
+	for (uint i = 0; i < numBinned; ++i)
+	{
+		if (nearPlane > 0.f && Bound(view, lights[i], bounds[i]))
+		{
+			++numVisible;
+		}
+		else
+		{
+			bounds[i].minSlice = 0;
+			bounds[i].maxSlice = -1;
+		}
+	}
+
+	memset(masks.data(), 0, masks.size() * sizeof(uint));
+
+	if (jobs != nullptr)
+	{
+		jobs->ParallelFor(CLUSTER_SLICES, [this](uint slice) { BinSlice(slice); });
+	}
+	else
+	{
+		for (uint slice = 0; slice < CLUSTER_SLICES; ++slice)
+			BinSlice(slice);
+	}
+
+	Compact();
+}
+
+uint LightClusters::GetSlice(float depth) const
+{
+	const float slice = logf(MAX(depth, nearPlane)) * sliceScale + sliceBias;
+	if (slice <= 0.f)
+		return 0;
+
+	return MIN(static_cast<uint>(slice), static_cast<uint>(CLUSTER_SLICES - 1));
+}
+
+bool LightClusters::Bound(const float4x4& view, const ClusterLight& light, LightBounds& bounds) const
+{
+	const float range = light.positionRange.w;
+	float3 center = light.positionRange.xyz();
+	float radius = range;
+
+	// Spots are bounded by the sphere around their cone, wide ones by the sphere through the rim
+	const float cosOuter = light.directionCosOuter.w;
+	if (cosOuter > 0.f)
+	{
+		const float3 direction = light.directionCosOuter.xyz();
+		if (cosOuter < 0.70710678f)
+		{
+			radius = range * sqrtf(1.f - cosOuter * cosOuter);
+			center += direction * (range * cosOuter);
+		}
+		else
+		{
+			radius = range / (2.f * cosOuter);
+			center += direction * radius;
+		}
+	}
+
+	const float3 position = view.TransformPos(center);
+	const float depth = -position.z;
+	if (radius <= 0.f || depth + radius < nearPlane || depth - radius > farPlane)
+		return false;
+
+	const float nearDepth = MAX(depth - radius, nearPlane);
+	const float farDepth = MIN(depth + radius, farPlane);
+
+	// x / depth is the largest or smallest at a corner of the sphere's box, test both depths
+	const float minNdcX = MIN((position.x - radius) / (nearDepth * tanHalfFovX), (position.x - radius) / (farDepth * tanHalfFovX));
+	const float maxNdcX = MAX((position.x + radius) / (nearDepth * tanHalfFovX), (position.x + radius) / (farDepth * tanHalfFovX));
+	const float minNdcY = MIN((position.y - radius) / (nearDepth * tanHalfFovY), (position.y - radius) / (farDepth * tanHalfFovY));
+	const float maxNdcY = MAX((position.y + radius) / (nearDepth * tanHalfFovY), (position.y + radius) / (farDepth * tanHalfFovY));
+	if (maxNdcX < -1.f || minNdcX > 1.f || maxNdcY < -1.f || minNdcY > 1.f)
+		return false;
+
+	bounds.x = position.x;
+	bounds.y = position.y;
+	bounds.z = position.z;
+	bounds.radius = radius;
+	bounds.minX = MIN(static_cast<int>((MAX(minNdcX, -1.f) + 1.f) * 0.5f * CLUSTER_TILES_X), CLUSTER_TILES_X - 1);
+	bounds.maxX = MIN(static_cast<int>((MIN(maxNdcX, 1.f) + 1.f) * 0.5f * CLUSTER_TILES_X), CLUSTER_TILES_X - 1);
+	bounds.minY = MIN(static_cast<int>((MAX(minNdcY, -1.f) + 1.f) * 0.5f * CLUSTER_TILES_Y), CLUSTER_TILES_Y - 1);
+	bounds.maxY = MIN(static_cast<int>((MIN(maxNdcY, 1.f) + 1.f) * 0.5f * CLUSTER_TILES_Y), CLUSTER_TILES_Y - 1);
+	bounds.minSlice = static_cast<int>(GetSlice(nearDepth));
+	bounds.maxSlice = static_cast<int>(GetSlice(farDepth));
+	return true;
+}
+
+void LightClusters::BinSlice(uint slice)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const int current = static_cast<int>(slice);
+
+	for (uint i = 0; i < numBinned; ++i)
+	{
+		const LightBounds& light = bounds[i];
+		if (current < light.minSlice || current > light.maxSlice)
+			continue;
+
+		const __m128 centerX = _mm_set1_ps(light.x);
+		const __m128 centerY = _mm_set1_ps(light.y);
+		const __m128 centerZ = _mm_set1_ps(light.z);
+		const __m128 radiusSq = _mm_set1_ps(light.radius * light.radius);
+		const uint word = i >> 5;
+		const uint bit = 1u << (i & 31);
+
+		for (int y = light.minY; y <= light.maxY; ++y)
+		{
+			const uint row = GetClusterIndex(0, y, slice);
+
+			// Groups of 4 start aligned, the tile count across is a multiple of 4 so a group never leaves the row
+			for (int x = light.minX & ~3; x <= light.maxX; x += 4)
+			{
+				const uint first = row + x;
+
+				// Distance from the center to the closest point of each box
+				const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[0][first]), centerX), _mm_sub_ps(centerX, _mm_loadu_ps(&boxMax[0][first]))), zero);
+				const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[1][first]), centerY), _mm_sub_ps(centerY, _mm_loadu_ps(&boxMax[1][first]))), zero);
+				const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[2][first]), centerZ), _mm_sub_ps(centerZ, _mm_loadu_ps(&boxMax[2][first]))), zero);
+				const __m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				const int hits = _mm_movemask_ps(_mm_cmple_ps(distanceSq, radiusSq));
+
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					if ((hits & (1 << lane)) != 0 && x + lane >= light.minX && x + lane <= light.maxX)
+						masks[(first + lane) * CLUSTER_MASK_WORDS + word] |= bit;
+				}
+			}
+		}
+	}
+}
+
+void LightClusters::Compact()
+{
+	memset(indices.data(), 0, indices.size() * sizeof(uint));
+	numIndices = 0;
+	droppedIndices = 0;
+	maxPerCluster = 0;
+
+	for (uint cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+	{
+		const uint offset = numIndices;
+		const uint* clusterMasks = &masks[cluster * CLUSTER_MASK_WORDS];
+
+		for (uint word = 0; word < CLUSTER_MASK_WORDS; ++word)
+		{
+			uint bits = clusterMasks[word];
+			for (uint light = word * 32; bits != 0; ++light, bits >>= 1)
+			{
+				if ((bits & 1) == 0)
+					continue;
+
+				if (numIndices == MAX_CLUSTER_INDICES)
+				{
+					++droppedIndices;
+					continue;
+				}
+
+				indices[numIndices >> 1] |= light << ((numIndices & 1) * 16);
+				++numIndices;
+			}
+		}
+
+		const uint count = numIndices - offset;
+		clusters[cluster] = offset | (count << 16);
+		maxPerCluster = MAX(maxPerCluster, count);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef __LIGHT_CLUSTERS_H__
+#define __LIGHT_CLUSTERS_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <vector>
+#include "Math/float3.h"
+#include "Math/float4.h"
+#include "Math/float4x4.h"
+
+// Clusters across the screen and along the view depth, the tile count across must be a multiple of 4
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 8
+#define CLUSTER_SLICES 24
+#define CLUSTER_COUNT (CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+// Lights binned per frame, a multiple of 32, the rest are ignored
+#define MAX_CLUSTER_LIGHTS 256
+// Light indices of every cluster together, 16 bits each so they fill one 16KB uniform block
+#define MAX_CLUSTER_INDICES 8192
+// Cosine of the outer angle of point lights, lower than any real cosine so every direction is lit
+#define POINT_LIGHT_COS -2.f
+
+
+
+// One light of the Lights uniform block, std140 layout
+struct ClusterLight
+{
+	// World position and range, nothing past the range is lit
+	float4 positionRange;
+	// Color times intensity, w is the cosine of the spot inner angle
+	float4 colorCosInner;
+	// World direction, w is the cosine of the spot outer angle or POINT_LIGHT_COS
+	float4 directionCosOuter;
+};
+
+class JobSystem;
+
+// Assigns lights to the clusters of a froxel grid in view space, all on the CPU
+// Slices split the depth between the near and far planes exponentially, so clusters keep roughly the same shape
+// Every light is bounded by a sphere and tested against the boxes of the clusters its screen rectangle covers, four at a time
+// The result is an offset and count per cluster into a shared list of light indices, in light order inside each cluster
+class LightClusters
+{
+public:
+
+	// Without a job system every slice is binned on the calling thread
+	void Init(JobSystem* jobs);
+
+	// Shape of the grid, a symmetric perspective projection, the cluster boxes are rebuilt when it changes
+	void SetProjection(float tanHalfFovX, float tanHalfFovY, float nearPlane, float farPlane);
+	// Bin the lights seen through view, world to view space with the camera looking down -Z, M * v convention
+	void Bin(const float4x4& view, const ClusterLight* lights, uint numLights);
+
+	// Offset in the low 16 bits and count in the high 16 bits, one per cluster
+	inline const std::vector<uint>& GetClusters() const { return clusters; }
+	// Light indices two per word, the low half first, laid out as the shader reads them
+	inline const std::vector<uint>& GetIndices() const { return indices; }
+	inline uint GetNumIndices() const { return numIndices; }
+	inline uint GetIndex(uint i) const { return (indices[i >> 1] >> ((i & 1) * 16)) & 0xFFFF; }
+	inline uint GetOffset(uint cluster) const { return clusters[cluster] & 0xFFFF; }
+	inline uint GetCount(uint cluster) const { return clusters[cluster] >> 16; }
+	static inline uint GetClusterIndex(uint x, uint y, uint slice) { return x + (y + slice * CLUSTER_TILES_Y) * CLUSTER_TILES_X; }
+
+	// Slice of a view depth, clamped to the grid
+	uint GetSlice(float depth) const;
+	// Slice of a depth is log(depth) * scale + bias, what the shader needs to find it again
+	inline float GetSliceScale() const { return sliceScale; }
+	inline float GetSliceBias() const { return sliceBias; }
+
+	// Stats of the last Bin
+	inline uint GetNumLights() const { return numBinned; }
+	// Lights whose bounds overlap the grid
+	inline uint GetNumVisibleLights() const { return numVisible; }
+	// Indices that did not fit, their lights are missing from some clusters
+	inline uint GetNumDroppedIndices() const { return droppedIndices; }
+	inline uint GetMaxLightsPerCluster() const { return maxPerCluster; }
+
+private:
+
+	// View space bounding sphere of a light and the clusters it can touch
+	struct LightBounds
+	{
+		float x, y, z, radius;
+		int minX, maxX, minY, maxY, minSlice, maxSlice;
+	};
+
+	// Sphere of the light in view space, false when it is outside the grid
+	bool Bound(const float4x4& view, const ClusterLight& light, LightBounds& bounds) const;
+	// Mark the lights overlapping the clusters of one slice, jobs own whole slices
+	void BinSlice(uint slice);
+	// Turn the masks into the offsets, counts and index list
+	void Compact();
+
+private:
+
+	JobSystem* jobs = nullptr;
+
+	float tanHalfFovX = 0.f, tanHalfFovY = 0.f;
+	float nearPlane = 0.f, farPlane = 0.f;
+	float sliceScale = 0.f, sliceBias = 0.f;
+
+	// View space boxes of the clusters, one array per bound and axis
+	std::vector<float> boxMin[3];
+	std::vector<float> boxMax[3];
+
+	std::vector<LightBounds> bounds;
+	// One bit per light and cluster, MAX_CLUSTER_LIGHTS / 32 words per cluster
+	std::vector<uint> masks;
+
+	std::vector<uint> clusters;
+	std::vector<uint> indices;
+	uint numIndices = 0;
+
+	uint numBinned = 0;
+	uint numVisible = 0;
+	uint droppedIndices = 0;
+	uint maxPerCluster = 0;
+
+};
+
+#endif // !__LIGHT_CLUSTERS_H__
\ No newline at end of file
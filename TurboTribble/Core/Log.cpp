@@ -3,24 +3,40 @@
 
 #include "Globals.h"
 
-#include "Application.h"
-#include "ModuleEditor.h"
+#include <stdarg.h>
+#include <mutex>
 
 
 
+// Worker threads log too and the buffers below are shared
+static std::mutex logMutex;
+static LogListener logListener = nullptr;
+
+void SetLogListener(LogListener listener)
+{
+	std::lock_guard<std::mutex> lock(logMutex);
+	logListener = listener;
+}
+
 void TTLog(const char file[], int line, const char* format, ...)
 {
+	std::lock_guard<std::mutex> lock(logMutex);
+
 	static char tmpString1[4096];
 	static char tmpString2[4096];
 	static va_list ap;
 
 	// Construct the string from variable arguments
 	va_start(ap, format);
-	vsprintf_s(tmpString1, 4096, format, ap);
+	vsnprintf(tmpString1, 4096, format, ap);
 	va_end(ap);
-	sprintf_s(tmpString2, 4096, "\n%s(%d) : %s", file, line, tmpString1);
+	snprintf(tmpString2, 4096, "\n%s(%d) : %s", file, line, tmpString1);
+#ifdef _WIN32
 	OutputDebugString(tmpString2);
-	if (app != nullptr) app->editor->UpdateText(tmpString1);
+#else
+	fputs(tmpString2, stderr);
+#endif
+	if (logListener != nullptr) logListener(tmpString1);
 }
 
 #endif // !__LOG_CPP__
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include "Application.h"
 #include "Globals.h"
 
@@ -21,7 +22,28 @@ Application* app = NULL;
 
 int main(int argc, char** argv)
 {
-	
+	// --null-render runs without a GL context, --frames N closes after N frames
+	// --null-multi-draw makes the null renderer report multi draw support, off it takes the path of a GL 3.3 context
+	// --render-stats FILE writes the render stats of every frame to FILE
+	// --capture DIR writes every viewport frame to DIR
+	bool nullRender = false;
+	bool nullMultiDraw = false;
+	uint64 frameLimit = 0;
+	const char* renderStatsFile = nullptr;
+	const char* captureDirectory = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--null-render") == 0)
+			nullRender = true;
+		else if (strcmp(argv[i], "--null-multi-draw") == 0)
+			nullMultiDraw = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frameLimit = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--render-stats") == 0 && i + 1 < argc)
+			renderStatsFile = argv[++i];
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+			captureDirectory = argv[++i];
+	}
 
 	int mainReturn = EXIT_FAILURE;
 	MainStates state = MainStates::MAIN_CREATION;
@@ -33,7 +55,11 @@ int main(int argc, char** argv)
 		{
 		case MainStates::MAIN_CREATION:
 		{
-			app = new Application();
+			app = new Application(false, nullRender);
+			app->nullMultiDraw = nullMultiDraw;
+			app->frameLimit = frameLimit;
+			app->renderStatsFile = renderStatsFile;
+			app->captureDirectory = captureDirectory;
 			TTLOG("~~~~~~~~~~ Starting %s Engine ~~~~~~~~~~\n", TITLE);
 			TTLOG("++++++++ Application Creation ++++++++\n");
 			state = MainStates::MAIN_START;
@@ -0,0 +1,241 @@
+#include "MipGenerator.h"
+
+#include "JobSystem.h"
+
+#include <math.h>
+#include <emmintrin.h>
+
+#define KAISER_ALPHA 4.f
+#define KAISER_WIDTH 1.5f
+#define PI_F 3.14159265358979f
+
+
+
+// Zeroth order modified Bessel function of the first kind, series expansion
+static float BesselI0(float x)
+{
+	float sum = 1.f, term = 1.f;
+	const float halfSquared = x * x * 0.25f;
+	for (uint k = 1; k < 16; ++k)
+	{
+		term *= halfSquared / static_cast<float>(k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+static float SrgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.f / 2.4f) - 0.055f;
+}
+
+MipGenerator::MipGenerator(MipFilter filter, bool gammaCorrect, JobSystem* jobs) : filter(filter), gammaCorrect(gammaCorrect), jobs(jobs)
+{
+	// Source pixels 2x-2 .. 2x+3 sit at these distances from the destination pixel center, in destination pixels
+	float sum = 0.f;
+	for (uint i = 0; i < KAISER_TAPS; ++i)
+	{
+		const float t = (static_cast<float>(i) - 2.5f) * 0.5f;
+		const float sinc = t == 0.f ? 1.f : sinf(PI_F * t) / (PI_F * t);
+		const float ratio = t / KAISER_WIDTH;
+		const float window = BesselI0(KAISER_ALPHA * sqrtf(MAX(0.f, 1.f - ratio * ratio))) / BesselI0(KAISER_ALPHA);
+
+		kaiserWeights[i] = sinc * window;
+		sum += kaiserWeights[i];
+	}
+
+	for (uint i = 0; i < KAISER_TAPS; ++i)
+		kaiserWeights[i] /= sum;
+}
+
+bool MipGenerator::Generate(TextureData& texture) const
+{
+	const uint bytesPerPixel = texture.GetBytesPerPixel();
+	if (bytesPerPixel == 0 || texture.levels.empty() || texture.width == 0 || texture.height == 0)
+		return false;
+
+	texture.levels.resize(1);
+
+	// Every level is filtered from the float version of the previous one, so rounding does not pile up
+	std::vector<float> current, next;
+	ToFloat(texture.levels[0], bytesPerPixel, current);
+
+	uint width = texture.width, height = texture.height;
+	while (width > 1 || height > 1)
+	{
+		const uint nextWidth = MAX(1u, width / 2);
+		const uint nextHeight = MAX(1u, height / 2);
+		next.resize(nextWidth * nextHeight * 4);
+
+		Downsample(current, width, height, next, nextWidth, nextHeight);
+
+		texture.levels.push_back(TextureLevel());
+		TextureLevel& level = texture.levels.back();
+		level.width = nextWidth;
+		level.height = nextHeight;
+		ToLevel(next, bytesPerPixel, level);
+
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	return true;
+}
+
+void MipGenerator::Downsample(const std::vector<float>& source, uint width, uint height, std::vector<float>& destination, uint destinationWidth, uint destinationHeight) const
+{
+	switch (filter)
+	{
+	case MipFilter::KAISER:
+		DownsampleKaiser(source, width, height, destination, destinationWidth, destinationHeight);
+		break;
+	default:
+		DownsampleBox(source, width, height, destination, destinationWidth, destinationHeight);
+		break;
+	}
+}
+
+void MipGenerator::DownsampleBox(const std::vector<float>& source, uint width, uint height, std::vector<float>& destination, uint destinationWidth, uint destinationHeight) const
+{
+	const __m128 quarter = _mm_set1_ps(0.25f);
+
+	ForEachRow(destinationHeight, [&](uint y)
+	{
+		// Odd sizes and 1 pixel wide levels reuse the last row or column
+		const float* row0 = &source[(MIN(y * 2, height - 1) * width) * 4];
+		const float* row1 = &source[(MIN(y * 2 + 1, height - 1) * width) * 4];
+		float* output = &destination[(y * destinationWidth) * 4];
+
+		for (uint x = 0; x < destinationWidth; ++x)
+		{
+			const uint x0 = MIN(x * 2, width - 1) * 4;
+			const uint x1 = MIN(x * 2 + 1, width - 1) * 4;
+
+			__m128 sum = _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1));
+			sum = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+			_mm_storeu_ps(output + x * 4, _mm_mul_ps(sum, quarter));
+		}
+	});
+}
+
+void MipGenerator::DownsampleKaiser(const std::vector<float>& source, uint width, uint height, std::vector<float>& destination, uint destinationWidth, uint destinationHeight) const
+{
+	__m128 weights[KAISER_TAPS];
+	for (uint i = 0; i < KAISER_TAPS; ++i)
+		weights[i] = _mm_set1_ps(kaiserWeights[i]);
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+
+	// Separable, horizontal into a full height buffer first and then vertical
+	std::vector<float> horizontal(destinationWidth * height * 4);
+
+	ForEachRow(height, [&](uint y)
+	{
+		const float* input = &source[(y * width) * 4];
+		float* output = &horizontal[(y * destinationWidth) * 4];
+
+		for (uint x = 0; x < destinationWidth; ++x)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (uint i = 0; i < KAISER_TAPS; ++i)
+			{
+				const int sourceX = static_cast<int>(x * 2 + i) - 2;
+				const uint clamped = static_cast<uint>(sourceX < 0 ? 0 : MIN(static_cast<uint>(sourceX), width - 1));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(input + clamped * 4), weights[i]));
+			}
+			_mm_storeu_ps(output + x * 4, sum);
+		}
+	});
+
+	ForEachRow(destinationHeight, [&](uint y)
+	{
+		const float* rows[KAISER_TAPS];
+		for (uint i = 0; i < KAISER_TAPS; ++i)
+		{
+			const int sourceY = static_cast<int>(y * 2 + i) - 2;
+			const uint clamped = static_cast<uint>(sourceY < 0 ? 0 : MIN(static_cast<uint>(sourceY), height - 1));
+			rows[i] = &horizontal[(clamped * destinationWidth) * 4];
+		}
+
+		float* output = &destination[(y * destinationWidth) * 4];
+		for (uint x = 0; x < destinationWidth; ++x)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (uint i = 0; i < KAISER_TAPS; ++i)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[i] + x * 4), weights[i]));
+
+			// The negative lobes can ring past the valid range
+			_mm_storeu_ps(output + x * 4, _mm_min_ps(_mm_max_ps(sum, zero), one));
+		}
+	});
+}
+
+void MipGenerator::ToFloat(const TextureLevel& level, uint bytesPerPixel, std::vector<float>& pixels) const
+{
+	float table[256];
+	for (uint i = 0; i < 256; ++i)
+		table[i] = gammaCorrect ? SrgbToLinear(i / 255.f) : i / 255.f;
+
+	const uint count = level.width * level.height;
+	pixels.resize(count * 4);
+
+	for (uint i = 0; i < count; ++i)
+	{
+		const uchar* pixel = &level.data[i * bytesPerPixel];
+		float* output = &pixels[i * 4];
+		output[0] = table[pixel[0]];
+		output[1] = table[pixel[1]];
+		output[2] = table[pixel[2]];
+		// Alpha is coverage, never gamma encoded
+		output[3] = bytesPerPixel == 4 ? pixel[3] / 255.f : 1.f;
+	}
+}
+
+void MipGenerator::ToLevel(const std::vector<float>& pixels, uint bytesPerPixel, TextureLevel& level) const
+{
+	const uint count = level.width * level.height;
+	level.data.resize(count * bytesPerPixel);
+
+	const __m128 scale = _mm_set1_ps(255.f);
+	for (uint i = 0; i < count; ++i)
+	{
+		alignas(16) float color[4];
+		_mm_store_ps(color, _mm_loadu_ps(&pixels[i * 4]));
+
+		if (gammaCorrect)
+		{
+			color[0] = LinearToSrgb(color[0]);
+			color[1] = LinearToSrgb(color[1]);
+			color[2] = LinearToSrgb(color[2]);
+		}
+
+		// Round to nearest and saturate to bytes
+		const __m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(color), scale));
+		const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(rounded, rounded), _mm_setzero_si128());
+		const uint rgba = static_cast<uint>(_mm_cvtsi128_si32(packed));
+
+		uchar* output = &level.data[i * bytesPerPixel];
+		for (uint c = 0; c < bytesPerPixel; ++c)
+			output[c] = static_cast<uchar>((rgba >> (c * 8)) & 0xFF);
+	}
+}
+
+void MipGenerator::ForEachRow(uint rows, const std::function<void(uint)>& func) const
+{
+	if (jobs != nullptr)
+	{
+		jobs->ParallelFor(rows, func);
+	}
+	else
+	{
+		for (uint row = 0; row < rows; ++row)
+			func(row);
+	}
+}
\ No newline at end of file
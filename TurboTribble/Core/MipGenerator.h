@@ -0,0 +1,60 @@
+#ifndef __MIP_GENERATOR_H__
+#define __MIP_GENERATOR_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "TextureData.h"
+
+#include <vector>
+#include <functional>
+
+#define KAISER_TAPS 6
+
+
+
+class JobSystem;
+
+enum class MipFilter
+{
+	// 2x2 average
+	BOX = 0,
+	// 6 tap Kaiser windowed sinc, sharper minification
+	KAISER
+};
+
+// Builds the full mip chain of a texture on the CPU when cooking, SSE2 per pixel and one job per row
+class MipGenerator
+{
+public:
+
+	// Constructor, gamma correct filtering averages sRGB colors in linear space
+	MipGenerator(MipFilter filter, bool gammaCorrect, JobSystem* jobs = nullptr);
+
+	// Replace the levels of an RGB8/RGBA8 texture with level 0 followed by every mip down to 1x1
+	bool Generate(TextureData& texture) const;
+
+private:
+
+	// Halve a float RGBA image
+	void Downsample(const std::vector<float>& source, uint width, uint height, std::vector<float>& destination, uint destinationWidth, uint destinationHeight) const;
+	void DownsampleBox(const std::vector<float>& source, uint width, uint height, std::vector<float>& destination, uint destinationWidth, uint destinationHeight) const;
+	void DownsampleKaiser(const std::vector<float>& source, uint width, uint height, std::vector<float>& destination, uint destinationWidth, uint destinationHeight) const;
+
+	void ToFloat(const TextureLevel& level, uint bytesPerPixel, std::vector<float>& pixels) const;
+	void ToLevel(const std::vector<float>& pixels, uint bytesPerPixel, TextureLevel& level) const;
+
+	// Run func(row) for every row, on the workers when there are any
+	void ForEachRow(uint rows, const std::function<void(uint)>& func) const;
+
+private:
+
+	MipFilter filter;
+	bool gammaCorrect;
+	JobSystem* jobs = nullptr;
+
+	float kaiserWeights[KAISER_TAPS];
+
+};
+
+#endif // !__MIP_GENERATOR_H__
\ No newline at end of file
@@ -9,6 +9,9 @@
 
 #include "Globals.h"
 
+#include "SDL/include/SDL.h"
+#include <math.h>
+
 
 
 ModuleCamera3D::ModuleCamera3D(Application* app, bool startEnabled) : Module(app, startEnabled)
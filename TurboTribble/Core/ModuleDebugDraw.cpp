@@ -0,0 +1,305 @@
+#include "ModuleDebugDraw.h"
+
+#include "Application.h"
+#include "ModuleRenderer3D.h"
+#include "RenderDevice.h"
+
+#include "ImGui/imgui.h"
+#include "Geometry/LineSegment.h"
+#include "Math/MathFunc.h"
+#include "Math/MathConstants.h"
+#include <stddef.h>
+
+#define ATTRIB_POSITION 0
+#define ATTRIB_COLOR 1
+// How long writing a region waits for the GPU before giving up on the fence
+#define DEBUG_DRAW_FENCE_TIMEOUT 1000000000ull
+
+
+
+// Only the matrices of the Frame block, std140 puts them at the same offsets as the full block
+static const char* debugVertexSource = R"(
+#version 330 core
+layout(std140) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+};
+
+in vec3 position;
+in vec4 color;
+
+out vec4 lineColor;
+
+void main()
+{
+	lineColor = color;
+	gl_Position = projection * view * vec4(position, 1.0);
+}
+)";
+
+static const char* debugFragmentSource = R"(
+#version 330 core
+in vec4 lineColor;
+
+out vec4 color;
+
+void main()
+{
+	color = lineColor;
+}
+)";
+
+ModuleDebugDraw::ModuleDebugDraw(Application* app, bool startEnabled) : Module(app, startEnabled)
+{}
+
+ModuleDebugDraw::~ModuleDebugDraw()
+{}
+
+bool ModuleDebugDraw::Start()
+{
+	TTLOG("+++++ Loading Debug Draw Module +++++\n");
+
+	device = app->renderer3D->GetDevice();
+	if (!shader.Create(device, debugVertexSource, debugFragmentSource, { "position", "color" }))
+	{
+		TTLOG("### Error creating the debug draw shader ###\n");
+		return true;
+	}
+	shader.BindUniformBlock("Frame", FRAME_BLOCK_BINDING);
+
+	const uint64 ringSize = sizeof(DebugVertex) * DEBUG_DRAW_MAX_VERTICES * DEBUG_DRAW_FRAMES;
+
+	// Mapped once for the whole run
+	vertices = static_cast<DebugVertex*>(device->CreateMappedBuffer(BufferTarget::BUFFER_VERTEX, ringSize, vertexBuffer));
+	persistent = vertices != nullptr;
+	if (!persistent)
+	{
+		TTLOG("+++ Persistent buffers not available, debug lines are uploaded every frame +++\n");
+		vertexBuffer = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, ringSize, nullptr, BufferUsage::USAGE_STREAM);
+		staging = new DebugVertex[DEBUG_DRAW_MAX_VERTICES];
+	}
+
+	vertexArray = device->CreateVertexArray();
+	device->BindVertexArray(vertexArray);
+	device->SetVertexAttribute(ATTRIB_POSITION, vertexBuffer, 3, AttributeType::ATTRIBUTE_FLOAT, sizeof(DebugVertex), offsetof(DebugVertex, position));
+	device->SetVertexAttribute(ATTRIB_COLOR, vertexBuffer, 4, AttributeType::ATTRIBUTE_UNORM8, sizeof(DebugVertex), offsetof(DebugVertex, color));
+	device->BindVertexArray(0);
+
+	return true;
+}
+
+UpdateStatus ModuleDebugDraw::Update(float dt)
+{
+	lastVertices = numDepthVertices + numOverlayVertices;
+	lastDroppedVertices = droppedVertices;
+	droppedVertices = 0;
+
+	if (lastVertices == 0 || !shader.IsValid())
+		return UpdateStatus::UPDATE_CONTINUE;
+
+	const uint first = region * DEBUG_DRAW_MAX_VERTICES;
+	const uint firstOverlay = first + DEBUG_DRAW_MAX_VERTICES - numOverlayVertices;
+
+	if (!persistent)
+	{
+		device->UpdateBuffer(BufferTarget::BUFFER_VERTEX, vertexBuffer, sizeof(DebugVertex) * first, sizeof(DebugVertex) * numDepthVertices, staging);
+		device->UpdateBuffer(BufferTarget::BUFFER_VERTEX, vertexBuffer, sizeof(DebugVertex) * firstOverlay, sizeof(DebugVertex) * numOverlayVertices, staging + DEBUG_DRAW_MAX_VERTICES - numOverlayVertices);
+	}
+
+	RenderProfiler& profiler = app->renderer3D->GetProfiler();
+	profiler.BeginPass("Debug Draw");
+
+	device->UseProgram(shader.GetProgram());
+	device->BindVertexArray(vertexArray);
+
+	if (numDepthVertices > 0)
+		device->Draw(Primitive::PRIMITIVE_LINES, first, numDepthVertices);
+
+	if (numOverlayVertices > 0)
+	{
+		device->SetDepthTest(false);
+		device->Draw(Primitive::PRIMITIVE_LINES, firstOverlay, numOverlayVertices);
+		if (app->renderer3D->depthTestEnabled)
+			device->SetDepthTest(true);
+	}
+
+	device->BindVertexArray(0);
+	device->UseProgram(0);
+	profiler.EndPass();
+
+	// The GPU reads this region until the fence passes, the next frames write the others
+	if (persistent)
+		fences[region] = device->InsertFence();
+
+	region = (region + 1) % DEBUG_DRAW_FRAMES;
+	numDepthVertices = numOverlayVertices = 0;
+	WaitForRegion();
+
+	return UpdateStatus::UPDATE_CONTINUE;
+}
+
+bool ModuleDebugDraw::CleanUp()
+{
+	TTLOG("+++++ Quitting Debug Draw Module +++++\n");
+
+	if (device == nullptr)
+		return true;
+
+	for (RenderFence& fence : fences)
+	{
+		device->DeleteFence(fence);
+		fence = nullptr;
+	}
+
+	// Deleting the buffer also unmaps it
+	device->DeleteBuffer(vertexBuffer);
+	vertexBuffer = 0;
+	vertices = nullptr;
+	RELEASE_ARRAY(staging);
+
+	device->DeleteVertexArray(vertexArray);
+	vertexArray = 0;
+	shader.Destroy();
+
+	return true;
+}
+
+void ModuleDebugDraw::OnGui()
+{
+	if (ImGui::CollapsingHeader("Debug Draw"))
+	{
+		ImGui::Text("Vertices: %u of %u", lastVertices, DEBUG_DRAW_MAX_VERTICES);
+		ImGui::Text("Dropped vertices: %u", lastDroppedVertices);
+		ImGui::Text("Persistent mapping: %s", persistent ? "yes" : "no");
+	}
+}
+
+void ModuleDebugDraw::DrawLine(const float3& from, const float3& to, const Color& color, bool depthTest)
+{
+	if (DebugVertex* vertex = Reserve(2, depthTest))
+	{
+		const uint packed = PackColor(color);
+		vertex[0].position = from;
+		vertex[0].color = packed;
+		vertex[1].position = to;
+		vertex[1].color = packed;
+	}
+}
+
+void ModuleDebugDraw::DrawBox(const AABB& box, const Color& color, bool depthTest)
+{
+	DebugVertex* vertex = Reserve(AABB::NumEdges() * 2, depthTest);
+	if (vertex == nullptr)
+		return;
+
+	const uint packed = PackColor(color);
+	for (int i = 0; i < AABB::NumEdges(); ++i)
+	{
+		const LineSegment edge = box.Edge(i);
+		vertex[i * 2].position = edge.a;
+		vertex[i * 2].color = packed;
+		vertex[i * 2 + 1].position = edge.b;
+		vertex[i * 2 + 1].color = packed;
+	}
+}
+
+void ModuleDebugDraw::DrawSphere(const float3& center, float radius, const Color& color, bool depthTest)
+{
+	// One circle around each axis
+	DebugVertex* vertex = Reserve(DEBUG_DRAW_SPHERE_SEGMENTS * 2 * 3, depthTest);
+	if (vertex == nullptr)
+		return;
+
+	const uint packed = PackColor(color);
+	const float step = 2.f * pi / DEBUG_DRAW_SPHERE_SEGMENTS;
+	for (uint i = 0; i < DEBUG_DRAW_SPHERE_SEGMENTS; ++i)
+	{
+		const float a0 = step * i, a1 = step * (i + 1);
+		const float c0 = Cos(a0) * radius, s0 = Sin(a0) * radius;
+		const float c1 = Cos(a1) * radius, s1 = Sin(a1) * radius;
+
+		const float3 points[6] = {
+			center + float3(c0, s0, 0.f), center + float3(c1, s1, 0.f),
+			center + float3(c0, 0.f, s0), center + float3(c1, 0.f, s1),
+			center + float3(0.f, c0, s0), center + float3(0.f, c1, s1) };
+
+		for (const float3& point : points)
+		{
+			vertex->position = point;
+			vertex->color = packed;
+			++vertex;
+		}
+	}
+}
+
+void ModuleDebugDraw::DrawFrustum(const Frustum& frustum, const Color& color, bool depthTest)
+{
+	DebugVertex* vertex = Reserve(frustum.NumEdges() * 2, depthTest);
+	if (vertex == nullptr)
+		return;
+
+	const uint packed = PackColor(color);
+	for (int i = 0; i < frustum.NumEdges(); ++i)
+	{
+		const LineSegment edge = frustum.Edge(i);
+		vertex[i * 2].position = edge.a;
+		vertex[i * 2].color = packed;
+		vertex[i * 2 + 1].position = edge.b;
+		vertex[i * 2 + 1].color = packed;
+	}
+}
+
+void ModuleDebugDraw::DrawAxes(const float4x4& transform, float size, bool depthTest)
+{
+	const float3 origin = transform.TranslatePart();
+	DrawLine(origin, origin + transform.Col3(0).Normalized() * size, Color(1.f, 0.f, 0.f), depthTest);
+	DrawLine(origin, origin + transform.Col3(1).Normalized() * size, Color(0.f, 1.f, 0.f), depthTest);
+	DrawLine(origin, origin + transform.Col3(2).Normalized() * size, Color(0.f, 0.f, 1.f), depthTest);
+}
+
+ModuleDebugDraw::DebugVertex* ModuleDebugDraw::Reserve(uint count, bool depthTest)
+{
+	DebugVertex* regionStart = persistent ? vertices : staging;
+	if (regionStart == nullptr || numDepthVertices + numOverlayVertices + count > DEBUG_DRAW_MAX_VERTICES)
+	{
+		droppedVertices += count;
+		return nullptr;
+	}
+
+	if (persistent)
+		regionStart += region * DEBUG_DRAW_MAX_VERTICES;
+
+	if (depthTest)
+	{
+		DebugVertex* vertex = regionStart + numDepthVertices;
+		numDepthVertices += count;
+		return vertex;
+	}
+
+	numOverlayVertices += count;
+	return regionStart + DEBUG_DRAW_MAX_VERTICES - numOverlayVertices;
+}
+
+void ModuleDebugDraw::WaitForRegion()
+{
+	RenderFence& fence = fences[region];
+	if (fence == nullptr)
+		return;
+
+	// Normally signaled long ago, the region was drawn DEBUG_DRAW_FRAMES - 1 frames back
+	if (!device->WaitFence(fence, DEBUG_DRAW_FENCE_TIMEOUT))
+		TTLOG("### Debug draw waited too long for the GPU ###\n");
+
+	device->DeleteFence(fence);
+	fence = nullptr;
+}
+
+uint ModuleDebugDraw::PackColor(const Color& color)
+{
+	const uint r = static_cast<uint>(Clamp01(color.r) * 255.f + .5f);
+	const uint g = static_cast<uint>(Clamp01(color.g) * 255.f + .5f);
+	const uint b = static_cast<uint>(Clamp01(color.b) * 255.f + .5f);
+	const uint a = static_cast<uint>(Clamp01(color.a) * 255.f + .5f);
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef __MODULE_DEBUG_DRAW_H__
+#define __MODULE_DEBUG_DRAW_H__
+
+#include "Module.h"
+
+#include "Globals.h"
+#include "p2Defs.h"
+#include "Color.h"
+#include "Shader.h"
+#include "RenderDevice.h"
+
+#include "Math/float3.h"
+#include "Math/float4x4.h"
+#include "Geometry/AABB.h"
+#include "Geometry/Frustum.h"
+
+// Vertices one frame can hold, primitives past it are dropped
+#define DEBUG_DRAW_MAX_VERTICES 65536
+// Frames the GPU can be behind before writing waits on it
+#define DEBUG_DRAW_FRAMES 3
+#define DEBUG_DRAW_SPHERE_SEGMENTS 24
+
+
+
+// Debug lines written straight into a persistently mapped ring buffer, one region per frame in flight
+// Everything added during the frame is drawn with one draw for depth tested lines and one for overlay lines
+class ModuleDebugDraw : public Module
+{
+public:
+
+	// Constructor
+	ModuleDebugDraw(Application* app, bool startEnabled = true);
+	// Destructor
+	~ModuleDebugDraw();
+
+	// Create the shader and map the ring buffer, the render device exists by now
+	bool Start() override;
+	// Draw the primitives of the frame, runs after the scene and the editor added theirs
+	UpdateStatus Update(float dt) override;
+	// Unmap and free the ring buffer
+	bool CleanUp() override;
+
+	// Draws Debug Draw Info
+	void OnGui() override;
+
+	// ----- Primitives, the ones without depth test are drawn over the scene -----
+
+	void DrawLine(const float3& from, const float3& to, const Color& color, bool depthTest = true);
+	void DrawBox(const AABB& box, const Color& color, bool depthTest = true);
+	void DrawSphere(const float3& center, float radius, const Color& color, bool depthTest = true);
+	void DrawFrustum(const Frustum& frustum, const Color& color, bool depthTest = true);
+	// X, Y and Z of the transform in red, green and blue
+	void DrawAxes(const float4x4& transform, float size, bool depthTest = true);
+	// ----------------------------------------------------------------------------
+
+private:
+
+	struct DebugVertex
+	{
+		float3 position;
+		// RGBA8
+		uint color;
+	};
+
+	// Room for count vertices in the region of this frame, nullptr when it is full
+	DebugVertex* Reserve(uint count, bool depthTest);
+	// Wait until the GPU is done with the region this frame writes
+	void WaitForRegion();
+
+	static uint PackColor(const Color& color);
+
+private:
+
+	RenderDevice* device = nullptr;
+	Shader shader;
+	uint vertexArray = 0;
+	uint vertexBuffer = 0;
+
+	// Whole ring when persistently mapped, otherwise a CPU copy of one region uploaded on draw
+	DebugVertex* vertices = nullptr;
+	DebugVertex* staging = nullptr;
+	bool persistent = false;
+	RenderFence fences[DEBUG_DRAW_FRAMES] = {};
+	uint region = 0;
+
+	// Depth tested vertices grow from the start of the region and overlay ones from its end
+	uint numDepthVertices = 0;
+	uint numOverlayVertices = 0;
+
+	uint lastVertices = 0;
+	uint lastDroppedVertices = 0;
+	uint droppedVertices = 0;
+
+};
+
+#endif // !__MODULE_DEBUG_DRAW_H__
\ No newline at end of file
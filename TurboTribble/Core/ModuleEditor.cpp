@@ -12,23 +12,124 @@
 #include "ModuleTextures.h"
 #include "ComponentMaterial.h"
 #include "ComponentMesh.h"
+#include "ComponentLight.h"
 #include "ComponentTransform.h"
 
 #include "Globals.h"
 
 //Tools
 #include <string>
+#include <mutex>
 #include <stack>
 #include "ImGui/imgui_impl_opengl3.h"
 #include "ImGui/imgui_impl_sdl.h"
 #include "ImGui/imgui_internal.h"
+#include "RenderDevice.h"
+#include "RenderQueue.h"
 #include "glew.h"
-#include <gl/GL.h>
+#include <GL/gl.h>
 
+// Size of the smallest grid cell in world units, every level above is ten times larger
+#define GRID_CELL_SIZE "1.0"
+// Smallest spacing in pixels before a level of lines fades out
+#define GRID_MIN_CELL_PIXELS "4.0"
+// View distance where the grid is gone, grows with the camera height
+#define GRID_FADE_DISTANCE "150.0"
 
 
+
+// Fullscreen triangle, each corner unprojected onto the near and far planes, no vertex attributes
+static const char* gridVertexSource = R"(
+#version 330 core
+layout(std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+};
+
+out vec4 nearPoint;
+out vec4 farPoint;
+
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    mat4 unproject = inverse(projection * view);
+
+    // Homogeneous points interpolate linearly across the triangle, they are divided per fragment
+    nearPoint = unproject * vec4(corner, -1.0, 1.0);
+    farPoint = unproject * vec4(corner, 1.0, 1.0);
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
+)";
+
+// Intersects the view ray of each pixel with the y = 0 plane and draws the lines around the hit
+// Levels of ten times larger cells blend in as the smaller ones get too dense
+static const char* gridFragmentSource = R"(
+#version 330 core
+#define CELL_SIZE )" GRID_CELL_SIZE R"(
+#define MIN_CELL_PIXELS )" GRID_MIN_CELL_PIXELS R"(
+#define FADE_DISTANCE )" GRID_FADE_DISTANCE R"(
+layout(std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+};
+
+in vec4 nearPoint;
+in vec4 farPoint;
+
+out vec4 color;
+
+// Coverage of the lines every cellSize world units, about one pixel wide
+float Lines(vec2 position, vec2 derivative, float cellSize)
+{
+    vec2 coord = position / cellSize;
+    vec2 width = max(derivative / cellSize, vec2(1e-6));
+    vec2 line = abs(fract(coord - 0.5) - 0.5) / width;
+    return 1.0 - min(min(line.x, line.y), 1.0);
+}
+
+void main()
+{
+    vec3 from = nearPoint.xyz / nearPoint.w;
+    vec3 to = farPoint.xyz / farPoint.w;
+    float t = -from.y / (to.y - from.y);
+    vec3 position = from + t * (to - from);
+
+    vec4 clip = projection * view * vec4(position, 1.0);
+    float depth = clip.z / clip.w;
+    gl_FragDepth = depth * 0.5 + 0.5;
+
+    // Derivatives before any discard, the neighbour pixels must run the same code
+    vec2 derivative = fwidth(position.xz);
+    float lod = max(0.0, log(length(derivative) * MIN_CELL_PIXELS / CELL_SIZE) / log(10.0) + 1.0);
+    float level = floor(lod);
+    float blend = fract(lod);
+
+    float cellSize = CELL_SIZE * pow(10.0, level);
+    float small = Lines(position.xz, derivative, cellSize) * (1.0 - blend) * 0.5;
+    float medium = Lines(position.xz, derivative, cellSize * 10.0) * (1.0 - blend * 0.5);
+    float large = Lines(position.xz, derivative, cellSize * 100.0);
+
+    color = vec4(vec3(0.5), max(max(small, medium), large) * 0.6);
+
+    // The X axis runs along z = 0 and the Z axis along x = 0, darker on their negative side
+    if (abs(position.z) < derivative.y)
+        color = vec4(position.x >= 0.0 ? vec3(1.0, 0.1, 0.1) : vec3(0.5, 0.05, 0.05), 1.0);
+    else if (abs(position.x) < derivative.x)
+        color = vec4(position.z >= 0.0 ? vec3(0.1, 0.1, 1.0) : vec3(0.05, 0.05, 0.5), 1.0);
+
+    color.a *= 1.0 - smoothstep(0.5, 1.0, clip.w / (FADE_DISTANCE + abs(from.y) * 10.0));
+
+    if (t <= 0.0 || depth > 1.0 || color.a <= 0.0)
+        discard;
+}
+)";
+
 ModuleEditor::ModuleEditor(Application* app, bool startEnabled) : Module(app, startEnabled)
 {
+    // The console shows everything logged from here on, the cooker has no editor and keeps the debugger output only
+    SetLogListener([](const char* text) { if (::app != nullptr && ::app->editor != nullptr) ::app->editor->UpdateText(text); });
    
     showDemoWindow = false;
     showAnotherWindow = false;
@@ -78,10 +179,21 @@ bool ModuleEditor::Start()
     ImGui::StyleColorsDark();
 
     // Setup Platform/Renderer bindings
-	ImGui_ImplOpenGL3_Init();
+    device = app->renderer3D->GetDevice();
+    if (!device->IsNull())
+    {
+        ImGui_ImplOpenGL3_Init("#version 330 core");
+    }
+    else
+    {
+        // Nothing uploads the font atlas without a GL backend, but every frame needs it built
+        unsigned char* pixels = nullptr;
+        int width = 0, height = 0;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    }
     ImGui_ImplSDL2_InitForOpenGL(app->window->window, app->renderer3D->context);
     
-    CreateGridBuffer();
+    CreateGrid();
 
     return ret;
 }
@@ -90,7 +202,8 @@ UpdateStatus ModuleEditor::PreUpdate(float dt)
 {
 
     // Start the Dear ImGui frame
-    ImGui_ImplOpenGL3_NewFrame();
+    if (!device->IsNull())
+        ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame(app->window->window);
     ImGui::NewFrame();
 
@@ -101,7 +214,10 @@ UpdateStatus ModuleEditor::PreUpdate(float dt)
 // PreUpdate: clear buffer
 UpdateStatus ModuleEditor::Update(float dt)
 {
+    RenderProfiler& profiler = app->renderer3D->GetProfiler();
+    profiler.BeginPass("Grid");
     DrawGrid();
+    profiler.EndPass();
     // Creating MenuBar item as a root for docking windows
     if (DockingRootItem("Viewport", ImGuiWindowFlags_MenuBar)) {
         MenuBar();
@@ -121,8 +237,12 @@ UpdateStatus ModuleEditor::PostUpdate(float dt)
 
     // Rendering
     ImGui::Render();
-    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    RenderProfiler& profiler = app->renderer3D->GetProfiler();
+    profiler.BeginPass("Editor UI");
+    device->SetViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (!device->IsNull())
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    profiler.EndPass();
 
     // Update and Render additional Platform Windows
         // (Platform functions may change the current OpenGL context, so we save/restore it to make it easier to paste this code elsewhere.
@@ -146,103 +266,55 @@ bool ModuleEditor::CleanUp()
 {
     TTLOG("+++++ Quitting Editor Module +++++\n");
 
-    ImGui_ImplOpenGL3_Shutdown();
+    if (device != nullptr)
+    {
+        if (!device->IsNull())
+            ImGui_ImplOpenGL3_Shutdown();
+
+        grid.shader.Destroy();
+        device->DeleteVertexArray(grid.vertexArray);
+        grid.vertexArray = 0;
+    }
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
 
 	return true;
 }
 
-void ModuleEditor::CreateGridBuffer()
+void ModuleEditor::CreateGrid()
 {
-    std::vector<float3> vertices;
-    std::vector<uint> indices;
-    constexpr int slices = 200;
-    constexpr float size = 2000.f;
-    constexpr float halfSize = size * .5f;
-    constexpr float sliceSize = size / static_cast<float>(slices);
-
-   for (int i = 0; i < slices; ++i) 
-   {
-        const float x = -halfSize + static_cast<float>(i) * sliceSize;
-        if (x > 0.01f || x < -0.01f)
-        {
-            vertices.push_back(float3(x, 0.f, -halfSize));
-            vertices.push_back(float3(x, 0.f, halfSize));
-            indices.push_back(vertices.size() - 2);
-            indices.push_back(vertices.size() - 1);
-        }
-        const float z = -halfSize + static_cast<float>(i) * sliceSize;
-        if (z > 0.01f || z < -0.01f)
-        {
-            vertices.push_back(float3(-halfSize, 0.f, z));
-            vertices.push_back(float3(halfSize, 0.f, z));
-            indices.push_back(vertices.size() - 2);
-            indices.push_back(vertices.size() - 1);
-        }
-   }
-
-    glGenVertexArrays(1, &grid.VAO);
-    glBindVertexArray(grid.VAO);
-
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float3), &vertices[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-    GLuint ibo;
-    glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint), &indices[0], GL_STATIC_DRAW);
-
-    glBindVertexArray(0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!grid.shader.Create(device, gridVertexSource, gridFragmentSource, {}))
+    {
+        TTLOG("### Error creating the grid shader ###\n");
+        return;
+    }
+    grid.shader.BindUniformBlock("Frame", FRAME_BLOCK_BINDING);
 
-    grid.length = (GLuint)indices.size() * 4;
+    grid.vertexArray = device->CreateVertexArray();
 }
 
 void ModuleEditor::DrawGrid()
 {
-    GLboolean isLightingOn, isDepthTestOn;
-    glGetBooleanv(GL_LIGHTING, &isLightingOn);
-    glGetBooleanv(GL_DEPTH_TEST, &isDepthTestOn);
-
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
-    glBindVertexArray(grid.VAO);
-
-    glColor3f(.5f, .5f, .5f);
-    glDrawElements(GL_LINES, grid.length, GL_UNSIGNED_INT, NULL);
-
-    glBindVertexArray(0);
-    
-    glBegin(GL_LINES);
-        //x Axis
-        glColor3f(1.f, 0.f, 0.f);
-        glVertex3f(0.f, 0.0f, 0.f);
-        glColor3f(1.f, 0.f, 0.f);
-        glVertex3f(1000.f, 0.0f, 0.f);
-        glColor3f(.2f, 0.f, 0.f);
-        glVertex3f(0.f, 0.0f, 0.f);
-        glColor3f(.2f, 0.f, 0.f);
-        glVertex3f(-1000.f, 0.0f, 0.f);
-        //z Axis
-        glColor3f(0.f, 0.f, 1.f);
-        glVertex3f(0.f, 0.0f, 0.f);
-        glColor3f(0.f, 0.f, 1.f);
-        glVertex3f(0.f, 0.0f, 1000.f);
-        glColor3f(0.f, 0.f, .2f);
-        glVertex3f(0.f, 0.0f, 0.f);
-        glColor3f(0.f, 0.f, .2f);
-        glVertex3f(0.f, 0.0f, -1000.f);
-    glEnd();
-
-    isLightingOn ? glEnable(GL_LIGHTING) : 0;
-    !isDepthTestOn ? glDisable(GL_DEPTH_TEST) : 0;
-
+    if (!grid.shader.IsValid())
+        return;
+
+    // Blended over the meshes drawn before it, filled even in wireframe mode
+    // Tested against their depth but never writes its own, the lines and gizmos drawn later must show through the plane
+    device->SetDepthTest(true);
+    device->SetDepthWrite(false);
+    device->SetPolygonMode(false);
+    device->SetBlend(true);
+
+    device->UseProgram(grid.shader.GetProgram());
+    device->BindVertexArray(grid.vertexArray);
+    device->Draw(Primitive::PRIMITIVE_TRIANGLES, 0, 3);
+    device->BindVertexArray(0);
+    device->UseProgram(0);
+
+    device->SetBlend(false);
+    device->SetDepthWrite(true);
+    device->SetPolygonMode(app->renderer3D->wireframeMode);
+    device->SetDepthTest(app->renderer3D->depthTestEnabled);
 }
 
 void ModuleEditor::AboutWindow()
@@ -289,7 +361,8 @@ void ModuleEditor::AboutWindow()
 
 void ModuleEditor::UpdateText(const char* text)
 {
-    consoleText.appendf(text);
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    consoleText.append(text);
 }
 
 bool ModuleEditor::DockingRootItem(char* id, ImGuiWindowFlags winFlags)
@@ -367,6 +440,18 @@ void ModuleEditor::MenuBar()
                 }
                 ImGui::EndMenu();
             }
+
+            if (ImGui::BeginMenu("Lights")) {
+                if (ImGui::MenuItem("Point Light")) {
+                    GameObject* newGameObject = app->scene->CreateGameObject("Point Light");
+                    ComponentLight* newLight = new ComponentLight(newGameObject, ComponentLight::Type::POINT);
+                }
+                if (ImGui::MenuItem("Spot Light")) {
+                    GameObject* newGameObject = app->scene->CreateGameObject("Spot Light");
+                    ComponentLight* newLight = new ComponentLight(newGameObject, ComponentLight::Type::SPOT);
+                }
+                ImGui::EndMenu();
+            }
             ImGui::EndMenu();
         }
 
@@ -445,11 +530,31 @@ void ModuleEditor::UpdateWindowStatus()
     if (showTextures)
     {
         ImGui::Begin("Textures", &showTextures);
+
+        // Residency
+        ImGui::Text("Resident: ");
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1, 1, 0, 1), "%.2f / %.2f MB in %d textures", BYTES_TO_MB(app->textures->GetResidentBytes()), app->textures->budgetMB, (int)app->textures->textures.Size());
+        if (ImGui::Button("Evict unused"))
+            app->textures->EvictUnused(0);
+        ImGui::Separator();
+
+        // Handles are copied, eviction from the buttons below must not invalidate the loop
+        std::vector<TextureHandle> residentTextures;
         for (auto& t : app->textures->textures)
+            residentTextures.push_back(t.second);
+
+        for (const TextureHandle& texture : residentTextures)
         {
-            ImGui::Image((ImTextureID)t.second.id, ImVec2(128, 128), ImVec2(0, 1), ImVec2(1, 0));
+            ImGui::Image((ImTextureID)texture->id, ImVec2(64, 64), ImVec2(0, 1), ImVec2(1, 0));
             ImGui::SameLine();
-            ImGui::PushID(t.second.id);
+            ImGui::BeginGroup();
+            ImGui::Text("%s", texture->name.c_str());
+            // The cache and this loop hold one reference each
+            ImGui::Text("%d x %d, %.2f MB, %d refs, last used %d frames ago", texture->width, texture->height, BYTES_TO_MB(texture->size), (int)texture.use_count() - 2, (int)(app->textures->GetFrame() - texture->lastUsedFrame));
+            if (texture->streamable)
+                ImGui::Text("Resident mip %d of %d%s", texture->residentMip, texture->numLevels, texture->streaming ? ", streaming" : "");
+            ImGui::PushID(texture->id);
             if (ImGui::Button("Assign to selected"))
             {
                 if (gameobjectSelected)
@@ -457,11 +562,12 @@ void ModuleEditor::UpdateWindowStatus()
                     ComponentMaterial* material = gameobjectSelected->GetComponent<ComponentMaterial>();
                     if (material)
                     {
-                        material->SetTexture(t.second);
+                        material->SetTexture(texture);
                     }
                 }
             }
             ImGui::PopID();
+            ImGui::EndGroup();
         }
         ImGui::End();
     }
@@ -470,7 +576,10 @@ void ModuleEditor::UpdateWindowStatus()
     if (showConsoleWindow) {
 
         ImGui::Begin("Console", &showConsoleWindow);
-        ImGui::TextUnformatted(consoleText.begin(), consoleText.end());
+        {
+            std::lock_guard<std::mutex> lock(consoleMutex);
+            ImGui::TextUnformatted(consoleText.begin(), consoleText.end());
+        }
         ImGui::SetScrollHere(1.0f);
         ImGui::End();
     }
@@ -596,7 +705,9 @@ void ModuleEditor::UpdateWindowStatus()
             app->camera->aspectRatio = viewPortRegion.x / viewPortRegion.y;
             app->camera->RecalculateProjection();
         }
-        ImGui::Image((ImTextureID)app->viewportBuffer->texture, viewPortRegion, ImVec2(0, 1), ImVec2(1, 0));
+        // Render targets follow the panel, so no pixel is drawn that is not shown
+        app->viewportBuffer->SetPanelSize(static_cast<uint>(MAX(viewPortRegion.x, 1.f)), static_cast<uint>(MAX(viewPortRegion.y, 1.f)));
+        ImGui::Image((ImTextureID)app->viewportBuffer->GetDisplayTexture(), viewPortRegion, ImVec2(0, 1), ImVec2(1, 0));
         ImGui::End();
     }
 }
@@ -605,9 +716,4 @@ void ModuleEditor::InspectorGameObject()
 {
     if (gameobjectSelected)
         gameobjectSelected->OnGui();
-}
-
-ModuleEditor::Grid::~Grid()
-{
-    glDeleteBuffers(1, &VAO);
 }
\ No newline at end of file
@@ -4,27 +4,31 @@
 #include "Module.h"
 
 #include "Globals.h"
+#include "Shader.h"
 
 #include "ImGui/imgui.h"
 #include <string>
+#include <mutex>
 
 
 
 class GameObject;
+class RenderDevice;
 
 class ModuleEditor : public Module
 {
 private:
 
+	// Ground grid drawn by one fullscreen triangle, the lines are computed per pixel
 	struct Grid
 	{
-		uint VAO;
-		uint length;
-
-		~Grid();
+		Shader shader;
+		// Core profile needs one bound to draw, the triangle reads no attributes
+		uint vertexArray = 0;
 	};
 
 	Grid grid;
+	RenderDevice* device = nullptr;
 
 public:
 
@@ -57,7 +61,7 @@ private:
 
 	// ----- Background Grid -----
 	
-	void CreateGridBuffer();
+	void CreateGrid();
 	void DrawGrid();
 	// ---------------------------
 
@@ -98,8 +102,9 @@ private:
 	// ---------------------------------
 
 
-	// Text
+	// Text, appended from any thread that logs
 	ImGuiTextBuffer consoleText;
+	std::mutex consoleMutex;
 	ImVec4 currentColor;
 
 	// Scene
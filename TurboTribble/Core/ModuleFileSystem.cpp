@@ -7,31 +7,129 @@
 
 #include "PhysFS/include/physfs.h"
 #include <fstream>
-#include <filesystem>
 #include "Assimp/include/cfileio.h"
 #include "Assimp/include/types.h"
 
+#ifdef _MSC_VER
 #pragma comment( lib, "Core/External/PhysFS/libx86/physfs.lib" )
+#endif
+
+
+
+// ----- Assimp IO over PhysFS -----
+
+static size_t AssimpWrite(aiFile* file, const char* data, size_t size, size_t chunks)
+{
+	PHYSFS_sint64 ret = PHYSFS_writeBytes((PHYSFS_File*)file->UserData, (void*)data, size * chunks);
+	if (ret == -1)
+		TTLOG("### File System error while writing for Assimp: %s ###\n", PHYSFS_getLastError());
+
+	return ret == -1 || size == 0 ? 0 : (size_t)ret / size;
+}
+
+static size_t AssimpRead(aiFile* file, char* data, size_t size, size_t chunks)
+{
+	PHYSFS_sint64 ret = PHYSFS_readBytes((PHYSFS_File*)file->UserData, (void*)data, size * chunks);
+	if (ret == -1)
+		TTLOG("### File System error while reading for Assimp: %s ###\n", PHYSFS_getLastError());
+
+	return ret == -1 || size == 0 ? 0 : (size_t)ret / size;
+}
+
+static size_t AssimpTell(aiFile* file)
+{
+	PHYSFS_sint64 ret = PHYSFS_tell((PHYSFS_File*)file->UserData);
+	return ret == -1 ? 0 : (size_t)ret;
+}
+
+static size_t AssimpSize(aiFile* file)
+{
+	PHYSFS_sint64 ret = PHYSFS_fileLength((PHYSFS_File*)file->UserData);
+	return ret == -1 ? 0 : (size_t)ret;
+}
+
+static void AssimpFlush(aiFile* file)
+{
+	if (PHYSFS_flush((PHYSFS_File*)file->UserData) == 0)
+		TTLOG("### File System error while flushing for Assimp: %s ###\n", PHYSFS_getLastError());
+}
+
+static aiReturn AssimpSeek(aiFile* file, size_t pos, aiOrigin from)
+{
+	PHYSFS_File* physfsFile = (PHYSFS_File*)file->UserData;
+	PHYSFS_sint64 target = (PHYSFS_sint64)pos;
+
+	switch (from)
+	{
+	case aiOrigin_CUR:
+		target += PHYSFS_tell(physfsFile);
+		break;
+	case aiOrigin_END:
+		target += PHYSFS_fileLength(physfsFile);
+		break;
+	default:
+		break;
+	}
+
+	if (target < 0 || PHYSFS_seek(physfsFile, (PHYSFS_uint64)target) == 0)
+		return aiReturn_FAILURE;
+
+	return aiReturn_SUCCESS;
+}
+
+static aiFile* AssimpOpen(aiFileIO* io, const char* name, const char* format)
+{
+	PHYSFS_File* physfsFile = strchr(format, 'w') != nullptr ? PHYSFS_openWrite(name) : PHYSFS_openRead(name);
+	if (physfsFile == nullptr)
+	{
+		TTLOG("### File System error while opening %s for Assimp: %s ###\n", name, PHYSFS_getLastError());
+		return nullptr;
+	}
+
+	aiFile* file = new aiFile;
+	file->UserData = (char*)physfsFile;
+	file->ReadProc = AssimpRead;
+	file->WriteProc = AssimpWrite;
+	file->TellProc = AssimpTell;
+	file->FileSizeProc = AssimpSize;
+	file->FlushProc = AssimpFlush;
+	file->SeekProc = AssimpSeek;
+
+	return file;
+}
+
+static void AssimpClose(aiFileIO* io, aiFile* file)
+{
+	if (PHYSFS_close((PHYSFS_File*)file->UserData) == 0)
+		TTLOG("### File System error while closing for Assimp: %s ###\n", PHYSFS_getLastError());
+
+	delete file;
+}
+// ---------------------------------
 
 
 
 ModuleFileSystem::ModuleFileSystem(Application* app, bool startEnabled) : Module(app, startEnabled)
 {
 	// Needs to be created before Init so other modules can use it
-	char* basePath = SDL_GetBasePath();
-	systemBasePath = std::string(basePath);
 	PHYSFS_init(nullptr);
-	SDL_free(basePath);
+	systemBasePath = std::string(PHYSFS_getBaseDir());
 		
 	AddPath(".");
 	AddPath("./Assets");
 	AddPath("./Assets/Textures");
 	AddPath("./Assets/Models");
+
+	assimpIO = new aiFileIO;
+	assimpIO->OpenProc = AssimpOpen;
+	assimpIO->CloseProc = AssimpClose;
+	assimpIO->UserData = nullptr;
 }
 
 // Destructor
 ModuleFileSystem::~ModuleFileSystem()
 {
+	RELEASE(assimpIO);
 	PHYSFS_deinit();
 }
 
@@ -71,13 +169,13 @@ bool ModuleFileSystem::Read(const std::string& path, void* data, unsigned size)
 	{
 		TTLOG("+++ Reading outside filesystem. +++\n");
 		FILE* file = nullptr;
-		fopen_s(&file, path.c_str(), "rb");
+		file = fopen(path.c_str(), "rb");
 		if (file == nullptr)
 		{
 			TTLOG("### Impossible to read %s ###\n", path.c_str());
 			return 0;
 		}
-		fread_s(data, size, 1, size, file);
+		fread(data, 1, size, file);
 		fclose(file);
 		return true;
 	}
@@ -112,7 +210,7 @@ unsigned ModuleFileSystem::Size(const std::string& path) const
 	{
 		TTLOG("+++++ Reading outside filesystem. +++++\n");
 		FILE* file = nullptr;
-		fopen_s(&file, path.c_str(), "rb");
+		file = fopen(path.c_str(), "rb");
 		if (file == nullptr)
 		{
 			TTLOG("##### Impossible to read %s #####\n", path.c_str());
@@ -133,6 +231,9 @@ void ModuleFileSystem::CreateLibraryDirectories()
 {
 	CreateDir("Assets/Models/");
 	CreateDir("Assets/Textures/");
+	CreateDir(LIBRARY_PATH);
+	CreateDir(MESHES_PATH);
+	CreateDir(TEXTURES_PATH);
 }
 
 // Add a new zip file or folder
@@ -394,6 +495,38 @@ uint ModuleFileSystem::Load(const char* file, char** buffer) const
 	return ret;
 }
 
+uint ModuleFileSystem::LoadRange(const char* file, uint offset, uint size, char** buffer) const
+{
+	uint ret = 0;
+
+	PHYSFS_file* fs_file = PHYSFS_openRead(file);
+
+	if (fs_file != nullptr)
+	{
+		const PHYSFS_sint64 length = PHYSFS_fileLength(fs_file);
+		const uint available = length > offset ? static_cast<uint>(MIN(length - offset, static_cast<PHYSFS_sint64>(size))) : 0;
+
+		if (available > 0 && PHYSFS_seek(fs_file, offset) != 0)
+		{
+			*buffer = new char[available];
+			if (PHYSFS_readBytes(fs_file, *buffer, available) != static_cast<PHYSFS_sint64>(available))
+			{
+				TTLOG("### File System error while reading from file %s: %s ###\n", file, PHYSFS_getLastError());
+				RELEASE_ARRAY(*buffer);
+			}
+			else
+				ret = available;
+		}
+
+		if (PHYSFS_close(fs_file) == 0)
+			TTLOG("### File System error while closing file %s: %s ###\n", file, PHYSFS_getLastError());
+	}
+	else
+		TTLOG("### File System error while opening file %s: %s ###\n", file, PHYSFS_getLastError());
+
+	return ret;
+}
+
 bool ModuleFileSystem::DuplicateFile(const char* file, const char* dstFolder, std::string& relativePath)
 {
 	std::string fileStr, extensionStr;
@@ -432,15 +565,8 @@ bool ModuleFileSystem::DuplicateFile(const char* srcFile, const char* dstFile)
 	}
 }
 
-int closeSDLRWops(SDL_RWops *rw)
-{
-	RELEASE_ARRAY(rw->hidden.mem.base);
-	SDL_FreeRW(rw);
-	return 0;
-}
-
 // Save a whole buffer to disk
-uint ModuleFileSystem::Save(const char* file, const void* buffer, unsigned int size, bool append) const
+uint ModuleFileSystem::Save(const char* file, const void* buffer, unsigned int size, bool append, bool log) const
 {
 	unsigned int ret = 0;
 
@@ -456,9 +582,12 @@ uint ModuleFileSystem::Save(const char* file, const void* buffer, unsigned int s
 		}
 		else
 		{
-			if (append == true) { TTLOG("+++ Added %u data to [%s%s] +++\n", size, GetWriteDir(), file); }
-			else if (overwrite == true) { TTLOG("+++ File [%s%s] overwritten with %u bytes +++\n", GetWriteDir(), file, size); }
-			else { TTLOG("+++ New file created [%s%s] of %u bytes +++\n", GetWriteDir(), file, size); }
+			if (log == true)
+			{
+				if (append == true) { TTLOG("+++ Added %u data to [%s%s] +++\n", size, GetWriteDir(), file); }
+				else if (overwrite == true) { TTLOG("+++ File [%s%s] overwritten with %u bytes +++\n", GetWriteDir(), file, size); }
+				else { TTLOG("+++ New file created [%s%s] of %u bytes +++\n", GetWriteDir(), file, size); }
+			}
 
 			ret = written;
 		}
@@ -498,12 +627,14 @@ bool ModuleFileSystem::Remove(const char * file)
 	return ret;
 }
 */
-/*
-uint64 ModuleFileSystem::GetLastModTime(const char* filename)
+uint64 ModuleFileSystem::GetLastModTime(const char* file) const
 {
-	return PHYSFS_getLastModTime(filename);
+	PHYSFS_Stat stat;
+	if (PHYSFS_stat(file, &stat) == 0 || stat.modtime < 0)
+		return 0;
+
+	return static_cast<uint64>(stat.modtime);
 }
-*/
 std::string ModuleFileSystem::GetUniqueName(const char* path, const char* name) const
 {
 	//TODO: modify to distinguix files and dirs?
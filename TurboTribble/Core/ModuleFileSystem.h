@@ -5,10 +5,12 @@
 #include <vector>
 #include <string>
 
+// Library folders where cooked assets are stored
+#define LIBRARY_PATH "Library/"
+#define MESHES_PATH "Library/Meshes/"
+#define TEXTURES_PATH "Library/Textures/"
 
 
-struct SDL_RWops;
-int closeSDLRWops(SDL_RWops* rw);
 
 struct aiFileIO;
 
@@ -35,6 +37,9 @@ public:
 	// Creates Library Directories
 	void CreateLibraryDirectories();
 
+	// Assimp file callbacks that stream through PhysFS
+	inline aiFileIO* GetAssimpIO() const { return assimpIO; }
+
 
 	// ----- Utility functions -----
 	
@@ -51,6 +56,7 @@ public:
 	bool Read(const std::string& path, void* data, unsigned size) const; // reads from path and allocates in data. NOTE: The caller should be responsible to clean it
 	bool Exists(const std::string& path) const;
 	unsigned Size(const std::string& path) const;
+	uint64 GetLastModTime(const char* file) const;
 
 	bool HasExtension(const char* path) const;
 	bool HasExtension(const char* path, std::string extension) const;
@@ -65,6 +71,8 @@ public:
 	
 	unsigned int Load(const char* path, const char* file, char** buffer) const;
 	unsigned int Load(const char* file, char** buffer) const;
+	// Read up to size bytes from an offset on, less when the file ends first
+	unsigned int LoadRange(const char* file, unsigned int offset, unsigned int size, char** buffer) const;
 	// -------------------------------
 
 
@@ -72,7 +80,8 @@ public:
 	
 	bool DuplicateFile(const char* file, const char* dstFolder, std::string& relativePath);
 	bool DuplicateFile(const char* srcFile, const char* dstFile);
-	unsigned int Save(const char* file, const void* buffer, unsigned int size, bool append = false) const;
+	// Errors are always logged, log off keeps successful writes quiet for callers writing many files
+	unsigned int Save(const char* file, const void* buffer, unsigned int size, bool append = false, bool log = true) const;
 	// ------------------
 
 
@@ -84,6 +93,10 @@ public:
 
 
 	std::string systemBasePath;
+
+private:
+
+	aiFileIO* assimpIO = nullptr;
 };
 
 #endif // __MODULEFILESYSTEM_H__
\ No newline at end of file
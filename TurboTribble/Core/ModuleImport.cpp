@@ -1,26 +1,64 @@
 #include "ModuleImport.h"
 
 #include "Application.h"
-#include "ModuleWindow.h"
 #include "ModuleTextures.h"
 #include "ModuleFileSystem.h"
+#ifndef HEADLESS_BUILD
 #include "ModuleScene.h"
 #include "ComponentMesh.h"
 #include "ComponentMaterial.h"
 #include "GameObject.h"
+#endif // !HEADLESS_BUILD
 
 #include "Globals.h"
 
 #include <vector>
 #include <queue>
-#include "SDL/include/SDL_opengl.h"
+#include <algorithm>
+#include "ImGui/imgui.h"
 #include "Math/float2.h"
+#include "Math/float3.h"
 // Assimp
 #include "Assimp/include/cimport.h"
 #include "Assimp/include/scene.h"
 #include "Assimp/include/postprocess.h"
 #include "Assimp/include/mesh.h"
 
+#define TEXTURES_ASSETS_FOLDER "Assets/Textures/"
+#define ATLAS_UV_EPSILON 0.001f
+
+// Cooked meshes start with "TTMS", the format version and the import options they were cooked with
+#define MESH_FILE_MAGIC 0x534D5454
+#define MESH_FILE_VERSION 1
+// Assimp flipped the UVs because the textures are kept in file order
+#define MESH_FLAG_FLIPPED_UVS 0x1
+
+// The scene arrays come from the Assimp DLL and can only be freed here when both allocate from the same heap
+// The release UCRT uses the process heap linked statically or not, the debug CRT wraps every block with its own header
+#if !defined(_MSC_VER) || !defined(_DEBUG)
+#define ASSIMP_SHARED_HEAP
+#endif
+
+
+struct MeshFileHeader
+{
+	uint magic;
+	uint version;
+	uint flags;
+	// Element count of the indices, vertices, normals and texCoords arrays
+	uint ranges[4];
+};
+
+// Read the header of a cooked mesh, files of other versions are cooked again
+static bool ReadMeshHeader(const char* buffer, uint size, MeshFileHeader& header)
+{
+	if (buffer == nullptr || size < sizeof(MeshFileHeader))
+		return false;
+
+	memcpy(&header, buffer, sizeof(MeshFileHeader));
+	return header.magic == MESH_FILE_MAGIC && header.version == MESH_FILE_VERSION;
+}
+
 
 
 ModuleImport::ModuleImport(Application* app, bool startEnabled) : Module(app, startEnabled) {}
@@ -31,14 +69,19 @@ bool ModuleImport::Init()
 	TTLOG("+++++ Loading Import Module +++++\n");
 	bool ret = true;
 
-	// Stream log messages to Debug window
-	struct aiLogStream stream;
-	stream = aiGetPredefinedLogStream(aiDefaultLogStream_DEBUGGER, nullptr);
-	aiAttachLogStream(&stream);
+	// Stream log messages to Debug window, the cooker imports on many threads and the Assimp logger is shared
+	if (!app->headless)
+	{
+		struct aiLogStream stream;
+		stream = aiGetPredefinedLogStream(aiDefaultLogStream_DEBUGGER, nullptr);
+		aiAttachLogStream(&stream);
+	}
 
 	return ret;
 }
 
+#ifndef HEADLESS_BUILD
+// Building the scene needs the windowed modules, the cooker only runs the cook functions below
 bool ModuleImport::LoadGeometry(const char* path)
 {
 
@@ -46,29 +89,26 @@ bool ModuleImport::LoadGeometry(const char* path)
 	GameObject* root = nullptr;
 	std::string newRootName(path);
 
+	if (streamingImport)
+		return LoadGeometryStreamed(path);
+
 	// Assimp stuff
 	aiMesh* assimpMesh = nullptr;
 	const aiScene* scene = nullptr;
-	aiMaterial* texture = nullptr;
-	aiString texturePath;
 
-	// Create path buffer and import to scene
-	char* buffer = nullptr;
-	uint bytesFile = app->fileSystem->Load(path, &buffer);
+	scene = ImportScene(path);
 
-	if (buffer == nullptr) {
-		std::string normPathShort = "Assets/Models/" + app->fileSystem->SetNormalName(path);
-		bytesFile = app->fileSystem->Load(normPathShort.c_str(), &buffer);
-	}
-	if (buffer != nullptr) {
-		scene = aiImportFileFromMemory(buffer, bytesFile, aiProcessPreset_TargetRealtime_MaxQuality, NULL);
-	}
-	else {
-		scene = aiImportFile(path, aiProcessPreset_TargetRealtime_MaxQuality);
-	}
+	if (scene != nullptr && scene->HasMeshes()) {
+		// Decode every texture of the model at once on the workers before building the GameObjects
+		std::vector<AssetId> materialTextures;
+		std::vector<std::string> texturePaths;
+		ResolveMaterials(scene, materialTextures, texturePaths);
+		app->textures->LoadBatch(texturePaths);
 
+		FlatHashMap<AssetId, AtlasRegion, AssetIdHash> atlasRegions;
+		if (packAtlases)
+			PackAtlases(path, scene, materialTextures, atlasRegions);
 
-	if (scene != nullptr && scene->HasMeshes()) {
 		// Use scene->mNumMeshes to iterate on scene->mMeshes array
 		for (size_t i = 0; i < scene->mNumMeshes; i++)
 		{		
@@ -80,30 +120,13 @@ bool ModuleImport::LoadGeometry(const char* path)
 			ComponentMesh* mesh = newGameObject->CreateComponent<ComponentMesh>();
 			assimpMesh = scene->mMeshes[i];
 			
-			if (scene->HasMaterials()) {
-				texture = scene->mMaterials[assimpMesh->mMaterialIndex];
-
-				if (texture != nullptr) {
-					aiGetMaterialTexture(texture, aiTextureType_DIFFUSE, assimpMesh->mMaterialIndex, &texturePath);
-					std::string newPath(texturePath.C_Str());
-					if (newPath.size() > 0) {
-						mesh->texturePath = "Assets/Textures/" + newPath;
-						if (!app->textures->Find(mesh->texturePath))
-						{
-							const TextureObject& textureObject = app->textures->Load(mesh->texturePath);							
-							ComponentMaterial* materialComp = newGameObject->CreateComponent<ComponentMaterial>();
-							materialComp->SetTexture(textureObject);
-							
-						}
-						else
-						{
-							const TextureObject& textureObject = app->textures->Get(mesh->texturePath);
-							ComponentMaterial* materialComp = newGameObject->CreateComponent<ComponentMaterial>();
-							materialComp->SetTexture(textureObject);
-						}
-					}
-				}
-			}
+			mesh->textureId = materialTextures.empty() ? INVALID_ASSET_ID : materialTextures[assimpMesh->mMaterialIndex];
+			const AtlasRegion* atlasRegion = atlasRegions.Find(mesh->textureId);
+			if (atlasRegion != nullptr)
+				mesh->textureId = atlasRegion->page->assetId;
+
+			if (mesh->textureId != INVALID_ASSET_ID)
+				AttachMaterial(newGameObject, app->textures->Get(mesh->textureId));
 	
 			mesh->numVertices = assimpMesh->mNumVertices;
 			mesh->vertices.resize(assimpMesh->mNumVertices);
@@ -142,6 +165,13 @@ bool ModuleImport::LoadGeometry(const char* path)
 				{
 					memcpy(&mesh->texCoords[j], &assimpMesh->mTextureCoords[0][j], sizeof(float2));
 				}
+
+				// Packed textures only cover their region of the atlas page
+				if (atlasRegion != nullptr)
+				{
+					for (float2& uv : mesh->texCoords)
+						uv = float2(atlasRegion->offset[0] + uv.x * atlasRegion->scale[0], atlasRegion->offset[1] + uv.y * atlasRegion->scale[1]);
+				}
 			}
 			
 			mesh->GenerateBuffers();
@@ -149,17 +179,514 @@ bool ModuleImport::LoadGeometry(const char* path)
 			mesh->ComputeNormals();
 		}
 		aiReleaseImport(scene);		
-		RELEASE_ARRAY(buffer);
 
 	}
 	else 
 		TTLOG("### Error loading scene %s ###\n", path);
 
+	return true;
+}
+#endif // !HEADLESS_BUILD
+
+const aiScene* ModuleImport::ImportScene(const char* path)
+{
+	// Assimp reads through PhysFS streams, so no copy of the whole file is kept on our side
+	const std::string filePath = GetModelPath(path);
+
+	// Textures kept in file order are sampled with V flipped
+	const uint flags = aiProcessPreset_TargetRealtime_MaxQuality | ((GetMeshFlags() & MESH_FLAG_FLIPPED_UVS) != 0 ? aiProcess_FlipUVs : 0);
+
+	if (app->fileSystem->Exists(filePath))
+		return aiImportFileEx(filePath.c_str(), flags, app->fileSystem->GetAssimpIO());
+
+	return aiImportFile(path, flags);
+}
+
+bool ModuleImport::CookModel(const char* path, uint& meshesCooked)
+{
+	meshesCooked = 0;
+
+	const aiScene* scene = ImportScene(path);
+	if (scene == nullptr || !scene->HasMeshes())
+	{
+		TTLOG("### Error cooking scene %s ###\n", path);
+		if (scene != nullptr)
+			aiReleaseImport(scene);
+		return false;
+	}
+
+	HintTextureUsage(scene);
+
+	bool ret = true;
+	for (uint i = 0; i < scene->mNumMeshes; ++i)
+	{
+		if (SaveMesh(scene->mMeshes[i], GetMeshLibraryPath(path, i)))
+			++meshesCooked;
+		else
+			ret = false;
+
+		ReleaseMeshData(scene->mMeshes[i]);
+	}
+
+	aiReleaseImport(scene);
+
+	return ret;
+}
+
+std::string ModuleImport::GetMeshLibraryPath(const char* path, uint meshIndex) const
+{
+	std::string file;
+	app->fileSystem->SplitFilePath(path, nullptr, &file);
+
+	return MESHES_PATH + file + "_" + std::to_string(meshIndex) + ".mesh";
+}
+
+std::string ModuleImport::GetModelPath(const char* path) const
+{
+	std::string filePath(path);
+	if (!app->fileSystem->Exists(filePath))
+		filePath = "Assets/Models/" + app->fileSystem->SetNormalName(path);
+
+	return filePath;
+}
+
+uint ModuleImport::GetMeshFlags() const
+{
+	return app->textures->flipImages ? 0 : MESH_FLAG_FLIPPED_UVS;
+}
+
+bool ModuleImport::IsMeshCookedUpToDate(const char* path, const std::string& libraryPath) const
+{
+	// Models read from outside the file system have no modification time to compare with
+	const std::string modelPath = GetModelPath(path);
+	if (!app->fileSystem->Exists(modelPath) || !app->fileSystem->Exists(libraryPath) || app->fileSystem->GetLastModTime(libraryPath.c_str()) < app->fileSystem->GetLastModTime(modelPath.c_str()))
+		return false;
+
+	char* buffer = nullptr;
+	const uint size = app->fileSystem->LoadRange(libraryPath.c_str(), 0, sizeof(MeshFileHeader), &buffer);
+
+	// Meshes cooked with the other UV flip would not match the textures any more
+	MeshFileHeader header;
+	const bool ret = ReadMeshHeader(buffer, size, header) && header.flags == GetMeshFlags();
 	RELEASE_ARRAY(buffer);
 
+	return ret;
+}
+
+bool ModuleImport::SaveMesh(const aiMesh* assimpMesh, const std::string& libraryPath) const
+{
+	const uint numIndices = assimpMesh->HasFaces() ? assimpMesh->mNumFaces * 3 : 0;
+	const uint numVertices = assimpMesh->mNumVertices;
+	const uint numNormals = assimpMesh->HasNormals() ? numVertices : 0;
+	const uint numTexCoords = assimpMesh->HasTextureCoords(0) ? numVertices : 0;
+	const MeshFileHeader header = { MESH_FILE_MAGIC, MESH_FILE_VERSION, GetMeshFlags(), { numIndices, numVertices, numNormals, numTexCoords } };
+
+	const uint size = sizeof(header) + sizeof(uint) * numIndices + sizeof(float3) * (numVertices + numNormals) + sizeof(float2) * numTexCoords;
+	char* buffer = new char[size];
+	char* cursor = buffer;
+
+	memcpy(cursor, &header, sizeof(header));
+	cursor += sizeof(header);
+
+	for (uint i = 0; i < numIndices / 3; ++i)
+	{
+		if (assimpMesh->mFaces[i].mNumIndices != 3) {
+			TTLOG("### WARNING, geometry face with != 3 indices! ###\n")
+			memset(cursor, 0, 3 * sizeof(uint));
+		}
+		else {
+			memcpy(cursor, assimpMesh->mFaces[i].mIndices, 3 * sizeof(uint));
+		}
+		cursor += 3 * sizeof(uint);
+	}
+
+	memcpy(cursor, assimpMesh->mVertices, sizeof(float3) * numVertices);
+	cursor += sizeof(float3) * numVertices;
+
+	if (numNormals > 0)
+	{
+		memcpy(cursor, assimpMesh->mNormals, sizeof(float3) * numNormals);
+		cursor += sizeof(float3) * numNormals;
+	}
+
+	for (uint i = 0; i < numTexCoords; ++i)
+	{
+		memcpy(cursor, &assimpMesh->mTextureCoords[0][i], sizeof(float2));
+		cursor += sizeof(float2);
+	}
+
+	const bool ret = app->fileSystem->Save(libraryPath.c_str(), buffer, size) == size;
+	RELEASE_ARRAY(buffer);
+
+	return ret;
+}
+
+#ifndef HEADLESS_BUILD
+bool ModuleImport::LoadGeometryStreamed(const char* path)
+{
+	// The CPU copies of earlier imports are still charged
+	peakBytes = trackedBytes;
+	const uint64 budget = static_cast<uint64>(memoryBudgetMB * 1024.f * 1024.f);
+
+	const aiScene* scene = ImportScene(path);
+	if (scene == nullptr || !scene->HasMeshes())
+	{
+		TTLOG("### Error loading scene %s ###\n", path);
+		if (scene != nullptr)
+			aiReleaseImport(scene);
+		return true;
+	}
+
+	// Assimp cannot hand out a scene piece by piece, it is the one allocation the budget can not split
+	uint64 sceneBytes = 0;
+	for (uint i = 0; i < scene->mNumMeshes; ++i)
+		sceneBytes += EstimateMeshSize(scene->mMeshes[i]);
+	TrackAlloc(sceneBytes);
+	if (sceneBytes > budget)
+		TTLOG("### WARNING, Assimp scene of %s needs %.2f MB, over the %.2f MB import budget ###\n", path, BYTES_TO_MB(sceneBytes), memoryBudgetMB);
+
+	std::vector<AssetId> materialTextures;
+	std::vector<std::string> texturePaths;
+	ResolveMaterials(scene, materialTextures, texturePaths);
+
+	// Cook every mesh and keep only what is needed to build the GameObjects later
+	std::vector<StreamedMesh> streamedMeshes(scene->mNumMeshes);
+	for (uint i = 0; i < scene->mNumMeshes; ++i)
+	{
+		StreamedMesh& streamed = streamedMeshes[i];
+		FindNodeName(scene, i, streamed.name);
+		streamed.textureId = materialTextures.empty() ? INVALID_ASSET_ID : materialTextures[scene->mMeshes[i]->mMaterialIndex];
+		streamed.libraryPath = GetMeshLibraryPath(path, i);
+
+		// Meshes cooked from this version of the model with the same UV flip are kept, changing the option cooks them again
+		if (!IsMeshCookedUpToDate(path, streamed.libraryPath) && !SaveMesh(scene->mMeshes[i], streamed.libraryPath))
+			TTLOG("### Error cooking mesh %u of %s ###\n", i, path);
+
+		// Cooked meshes are only read back from the Library, their arrays are not needed until the scene goes
+		const uint64 meshBytes = EstimateMeshSize(scene->mMeshes[i]);
+		ReleaseMeshData(scene->mMeshes[i]);
+		const uint64 freedBytes = meshBytes - EstimateMeshSize(scene->mMeshes[i]);
+		sceneBytes -= freedBytes;
+		TrackFree(freedBytes);
+	}
+
+	aiReleaseImport(scene);
+	TrackFree(sceneBytes);
+
+	app->textures->LoadBatch(texturePaths);
+
+	// Build one mesh at a time from the Library, dropping the CPU copies of older meshes when the budget is reached
+	for (const StreamedMesh& streamed : streamedMeshes)
+	{
+		GameObject* newGameObject = app->scene->CreateGameObject(streamed.name);
+		ComponentMesh* mesh = newGameObject->CreateComponent<ComponentMesh>();
+		mesh->libraryPath = streamed.libraryPath;
+		mesh->textureId = streamed.textureId;
+
+		if (mesh->textureId != INVALID_ASSET_ID)
+			AttachMaterial(newGameObject, app->textures->Get(mesh->textureId));
+
+		ReserveMeshLoad(streamed.libraryPath);
+		if (LoadMesh(streamed.libraryPath, mesh))
+		{
+			TTLOG("+++ New mesh with %d vertices +++\n", mesh->numVertices);
+			mesh->GenerateBuffers();
+			mesh->GenerateBounds();
+			mesh->ComputeNormals();
+
+			AddResidentMesh(mesh);
+		}
+	}
+
+	lastImportPeakBytes = peakBytes;
+	TTLOG("+++ Streamed %s: peak %.2f MB of a %.2f MB budget +++\n", path, BYTES_TO_MB(peakBytes), memoryBudgetMB);
+
 	return true;
 }
 
+bool ModuleImport::LoadMesh(const std::string& libraryPath, ComponentMesh* mesh)
+{
+	char* buffer = nullptr;
+	const uint size = app->fileSystem->Load(libraryPath.c_str(), &buffer);
+
+	// The UVs are read as they were cooked, the mesh keeps matching the buffers it was imported with
+	MeshFileHeader header;
+	const bool validHeader = ReadMeshHeader(buffer, size, header);
+	const uint* ranges = header.ranges;
+
+	if (!validHeader || size < sizeof(header) + sizeof(uint) * ranges[0] + sizeof(float3) * (ranges[1] + ranges[2]) + sizeof(float2) * ranges[3])
+	{
+		TTLOG("### Error loading cooked mesh %s ###\n", libraryPath.c_str());
+		RELEASE_ARRAY(buffer);
+		return false;
+	}
+
+	TrackAlloc(size);
+	const char* cursor = buffer + sizeof(header);
+
+	mesh->numIndices = ranges[0];
+	mesh->indices.resize(ranges[0]);
+	if (ranges[0] > 0)
+		memcpy(&mesh->indices[0], cursor, sizeof(uint) * ranges[0]);
+	cursor += sizeof(uint) * ranges[0];
+
+	mesh->numVertices = ranges[1];
+	mesh->vertices.resize(ranges[1]);
+	if (ranges[1] > 0)
+		memcpy(&mesh->vertices[0], cursor, sizeof(float3) * ranges[1]);
+	cursor += sizeof(float3) * ranges[1];
+
+	mesh->normals.resize(ranges[2]);
+	if (ranges[2] > 0)
+		memcpy(&mesh->normals[0], cursor, sizeof(float3) * ranges[2]);
+	cursor += sizeof(float3) * ranges[2];
+
+	mesh->texCoords.resize(ranges[3]);
+	if (ranges[3] > 0)
+		memcpy(&mesh->texCoords[0], cursor, sizeof(float2) * ranges[3]);
+
+	RELEASE_ARRAY(buffer);
+	TrackFree(size);
+
+	return true;
+}
+
+void ModuleImport::ReserveMeshLoad(const std::string& libraryPath)
+{
+	const uint64 budget = static_cast<uint64>(memoryBudgetMB * 1024.f * 1024.f);
+	// While loading, the file buffer and the component copies are alive at the same time
+	const uint64 loadBytes = static_cast<uint64>(app->fileSystem->Size(libraryPath)) * 2;
+
+	// Meshes that read their copy every frame go to the back instead, releasing them would only reload them
+	for (size_t checked = residentMeshes.size(); checked > 0 && trackedBytes + loadBytes > budget; --checked)
+	{
+		ComponentMesh* oldMesh = residentMeshes.front();
+		residentMeshes.pop_front();
+		if (oldMesh->occluder || oldMesh->drawFaceNormals || oldMesh->drawVertexNormals)
+		{
+			residentMeshes.push_back(oldMesh);
+			continue;
+		}
+
+		TrackFree(oldMesh->GetCPUSizeInBytes());
+		oldMesh->ReleaseCPUData();
+	}
+}
+
+void ModuleImport::AddResidentMesh(ComponentMesh* mesh)
+{
+	TrackAlloc(mesh->GetCPUSizeInBytes());
+	residentMeshes.push_back(mesh);
+}
+
+void ModuleImport::RemoveResidentMesh(ComponentMesh* mesh)
+{
+	auto found = std::find(residentMeshes.begin(), residentMeshes.end(), mesh);
+	if (found == residentMeshes.end())
+		return;
+
+	TrackFree(mesh->GetCPUSizeInBytes());
+	residentMeshes.erase(found);
+}
+#endif // !HEADLESS_BUILD
+
+void ModuleImport::HintTextureUsage(const aiScene* scene) const
+{
+	static const AssetId texturesFolderId = HashAssetPath(TEXTURES_ASSETS_FOLDER);
+	const aiTextureType colorTypes[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_EMISSIVE };
+	const aiTextureType normalTypes[] = { aiTextureType_NORMALS, aiTextureType_HEIGHT };
+
+	for (uint i = 0; i < scene->mNumMaterials; ++i)
+	{
+		const aiMaterial* material = scene->mMaterials[i];
+		if (material == nullptr)
+			continue;
+
+		aiString textureName;
+		for (aiTextureType type : colorTypes)
+		{
+			for (uint j = 0; j < aiGetMaterialTextureCount(material, type); ++j)
+			{
+				if (aiGetMaterialTexture(material, type, j, &textureName) == aiReturn_SUCCESS && textureName.length > 0)
+					app->textures->SetNormalMapHint(HashAssetPath(textureName.C_Str(), texturesFolderId), false);
+			}
+		}
+
+		for (aiTextureType type : normalTypes)
+		{
+			for (uint j = 0; j < aiGetMaterialTextureCount(material, type); ++j)
+			{
+				if (aiGetMaterialTexture(material, type, j, &textureName) == aiReturn_SUCCESS && textureName.length > 0)
+					app->textures->SetNormalMapHint(HashAssetPath(textureName.C_Str(), texturesFolderId), true);
+			}
+		}
+	}
+}
+
+void ModuleImport::ResolveMaterials(const aiScene* scene, std::vector<AssetId>& materialTextures, std::vector<std::string>& texturesToLoad) const
+{
+	static const AssetId texturesFolderId = HashAssetPath(TEXTURES_ASSETS_FOLDER);
+
+	// Before any texture of the model is cooked
+	HintTextureUsage(scene);
+
+	materialTextures.assign(scene->mNumMaterials, INVALID_ASSET_ID);
+	for (uint i = 0; i < scene->mNumMaterials; ++i)
+	{
+		aiString textureName;
+		if (scene->mMaterials[i] == nullptr || aiGetMaterialTexture(scene->mMaterials[i], aiTextureType_DIFFUSE, 0, &textureName) != aiReturn_SUCCESS || textureName.length == 0)
+			continue;
+
+		// The id is hashed straight from the Assimp string, only textures that still have to be loaded build their path
+		materialTextures[i] = HashAssetPath(textureName.C_Str(), texturesFolderId);
+		if (!app->textures->Find(materialTextures[i]))
+			texturesToLoad.push_back(TEXTURES_ASSETS_FOLDER + std::string(textureName.C_Str()));
+	}
+}
+
+#ifndef HEADLESS_BUILD
+void ModuleImport::AttachMaterial(GameObject* gameObject, const TextureHandle& texture)
+{
+	ComponentMaterial* materialComp = gameObject->CreateComponent<ComponentMaterial>();
+	materialComp->SetTexture(texture);
+}
+#endif // !HEADLESS_BUILD
+
+void ModuleImport::PackAtlases(const char* path, const aiScene* scene, const std::vector<AssetId>& materialTextures, FlatHashMap<AssetId, AtlasRegion, AssetIdHash>& regions)
+{
+	// Textures sampled outside [0, 1] rely on GL_REPEAT and can not be moved into an atlas
+	FlatHashMap<AssetId, bool, AssetIdHash> tiled;
+	for (uint i = 0; i < scene->mNumMeshes; ++i)
+	{
+		const aiMesh* assimpMesh = scene->mMeshes[i];
+		const AssetId textureId = materialTextures.empty() ? INVALID_ASSET_ID : materialTextures[assimpMesh->mMaterialIndex];
+		if (textureId == INVALID_ASSET_ID || tiled.Contains(textureId) || !assimpMesh->HasTextureCoords(0))
+			continue;
+
+		for (uint j = 0; j < assimpMesh->mNumVertices; ++j)
+		{
+			const aiVector3D& uv = assimpMesh->mTextureCoords[0][j];
+			if (uv.x < -ATLAS_UV_EPSILON || uv.x > 1.f + ATLAS_UV_EPSILON || uv.y < -ATLAS_UV_EPSILON || uv.y > 1.f + ATLAS_UV_EPSILON)
+			{
+				tiled.Insert(textureId, true);
+				break;
+			}
+		}
+	}
+
+	std::vector<AssetId> candidates;
+	FlatHashMap<AssetId, bool, AssetIdHash> added;
+	for (AssetId textureId : materialTextures)
+	{
+		if (textureId == INVALID_ASSET_ID || tiled.Contains(textureId) || added.Contains(textureId) || !app->textures->Find(textureId))
+			continue;
+
+		const TextureHandle texture = app->textures->Get(textureId);
+		if (texture->width <= static_cast<uint>(atlasMaxTextureSize) && texture->height <= static_cast<uint>(atlasMaxTextureSize))
+		{
+			candidates.push_back(textureId);
+			added.Insert(textureId, true);
+		}
+	}
+
+	app->textures->BuildAtlases(path, candidates, static_cast<uint>(atlasPageSize), regions);
+}
+
+uint64 ModuleImport::EstimateMeshSize(const aiMesh* assimpMesh) const
+{
+	uint vertexStreams = (assimpMesh->mVertices != nullptr ? 1 : 0) + assimpMesh->GetNumUVChannels() + assimpMesh->GetNumColorChannels();
+	if (assimpMesh->HasNormals())
+		vertexStreams += 1;
+	if (assimpMesh->HasTangentsAndBitangents())
+		vertexStreams += 2;
+
+	uint64 size = sizeof(aiMesh);
+	size += static_cast<uint64>(assimpMesh->mNumVertices) * vertexStreams * sizeof(aiVector3D);
+	size += static_cast<uint64>(assimpMesh->mNumFaces) * (sizeof(aiFace) + 3 * sizeof(uint));
+	return size;
+}
+
+void ModuleImport::ReleaseMeshData(aiMesh* assimpMesh) const
+{
+#ifdef ASSIMP_SHARED_HEAP
+	// Deleted the way the aiMesh destructor does it, which then finds null arrays
+	delete[] assimpMesh->mVertices;
+	delete[] assimpMesh->mNormals;
+	delete[] assimpMesh->mTangents;
+	delete[] assimpMesh->mBitangents;
+	assimpMesh->mVertices = assimpMesh->mNormals = assimpMesh->mTangents = assimpMesh->mBitangents = nullptr;
+
+	for (uint i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++i)
+	{
+		delete[] assimpMesh->mTextureCoords[i];
+		assimpMesh->mTextureCoords[i] = nullptr;
+	}
+	for (uint i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; ++i)
+	{
+		delete[] assimpMesh->mColors[i];
+		assimpMesh->mColors[i] = nullptr;
+	}
+
+	delete[] assimpMesh->mFaces;
+	assimpMesh->mFaces = nullptr;
+	assimpMesh->mNumVertices = assimpMesh->mNumFaces = 0;
+#endif // ASSIMP_SHARED_HEAP
+}
+
+void ModuleImport::TrackAlloc(uint64 bytes)
+{
+	trackedBytes += bytes;
+	peakBytes = MAX(peakBytes, trackedBytes);
+}
+
+void ModuleImport::TrackFree(uint64 bytes)
+{
+	trackedBytes = bytes > trackedBytes ? 0 : trackedBytes - bytes;
+}
+
+void ModuleImport::OnGui()
+{
+	if (ImGui::CollapsingHeader("Import"))
+	{
+		ImGui::Checkbox("Streaming import", &streamingImport);
+		ImGui::Checkbox("Pack small textures into atlases", &packAtlases);
+		ImGui::DragInt("Atlas page size", &atlasPageSize, 16.f, 256, 8192);
+		ImGui::DragInt("Max packed texture size", &atlasMaxTextureSize, 8.f, 16, 1024);
+		// Packed textures need room for their padding on both sides
+		atlasMaxTextureSize = MIN(atlasMaxTextureSize, atlasPageSize - 2 * ATLAS_PADDING);
+		ImGui::DragFloat("Memory budget (MB)", &memoryBudgetMB, 1.f, 16.f, 65536.f);
+		ImGui::Text("Last streamed import peak: ");
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(1, 1, 0, 1), "%.2f MB", BYTES_TO_MB(lastImportPeakBytes));
+		ImGui::Text("CPU copies charged: %.2f MB in %u meshes", BYTES_TO_MB(trackedBytes), static_cast<uint>(residentMeshes.size()));
+	}
+}
+
+void ModuleImport::OnLoad(const JSONReader& reader)
+{
+	if (reader.HasMember("import"))
+	{
+		const auto& config = reader["import"];
+		LOAD_JSON_BOOL(streamingImport)
+		LOAD_JSON_FLOAT(memoryBudgetMB)
+		LOAD_JSON_BOOL(packAtlases)
+		LOAD_JSON_INT(atlasPageSize)
+		LOAD_JSON_INT(atlasMaxTextureSize)
+	}
+}
+
+void ModuleImport::OnSave(JSONWriter& writer) const
+{
+	writer.String("import");
+	writer.StartObject();
+	SAVE_JSON_BOOL(streamingImport)
+	SAVE_JSON_FLOAT(memoryBudgetMB)
+	SAVE_JSON_BOOL(packAtlases)
+	SAVE_JSON_INT(atlasPageSize)
+	SAVE_JSON_INT(atlasMaxTextureSize)
+	writer.EndObject();
+}
+
 void ModuleImport::FindNodeName(const aiScene* scene, const size_t i, std::string& name)
 {
 	bool nameFound = false;
@@ -2,13 +2,19 @@
 #define __MODULE_IMPORT_H__
 
 #include "Module.h"
+#include "AssetId.h"
+#include "ModuleTextures.h"
 
 #include <string>
+#include <vector>
+#include <deque>
 
 
 
 class ComponentMesh;
+class GameObject;
 struct aiScene;
+struct aiMesh;
 
 class ModuleImport : public Module
 {
@@ -22,12 +28,101 @@ public:
 	// Called before quitting
 	bool CleanUp() override;
 
+	// Draws Import options
+	void OnGui() override;
+	// Load Import options
+	void OnLoad(const JSONReader& reader) override;
+	// Save Import options
+	void OnSave(JSONWriter& writer) const override;
+
 
 	// Load a Geometry from a given path
 	bool LoadGeometry(const char* path);
 	// Find nodw in given scene
 	void FindNodeName(const aiScene* scene, const size_t i, std::string& name);
 
+	// Cook every mesh of a model into the Library without creating GameObjects or GL buffers
+	bool CookModel(const char* path, uint& meshesCooked);
+	// Library file that stores the cooked mesh number meshIndex of a model
+	std::string GetMeshLibraryPath(const char* path, uint meshIndex) const;
+	// Fill a mesh component with the CPU data of a cooked mesh, does not create GL buffers
+	bool LoadMesh(const std::string& libraryPath, ComponentMesh* mesh);
+
+	// ----- CPU copies of streamed meshes -----
+
+	// Release the oldest CPU copies until a cooked mesh can be loaded under the memory budget
+	void ReserveMeshLoad(const std::string& libraryPath);
+	// Charge the CPU copy a mesh just loaded to the budget, copies are released in the order they were added
+	void AddResidentMesh(ComponentMesh* mesh);
+	// Stop charging a mesh that is being destroyed
+	void RemoveResidentMesh(ComponentMesh* mesh);
+	// -----------------------------------------
+
+private:
+
+	// What is kept of each mesh once the Assimp scene is released
+	struct StreamedMesh
+	{
+		std::string name;
+		AssetId textureId = INVALID_ASSET_ID;
+		std::string libraryPath;
+	};
+
+	// Cook every mesh first, release Assimp and then build the meshes one by one under the memory budget
+	bool LoadGeometryStreamed(const char* path);
+	// Tell the texture importer which textures the materials sample as colors and which as normals
+	void HintTextureUsage(const aiScene* scene) const;
+	// Diffuse texture id of every material of the scene, paths of the ones not loaded yet are added to texturesToLoad
+	void ResolveMaterials(const aiScene* scene, std::vector<AssetId>& materialTextures, std::vector<std::string>& texturesToLoad) const;
+	// Add a material using an already loaded texture
+	void AttachMaterial(GameObject* gameObject, const TextureHandle& texture);
+	// Pack the small textures of the model that are never tiled into atlases
+	void PackAtlases(const char* path, const aiScene* scene, const std::vector<AssetId>& materialTextures, FlatHashMap<AssetId, AtlasRegion, AssetIdHash>& regions);
+	// Bytes held by a mesh of an Assimp scene
+	uint64 EstimateMeshSize(const aiMesh* assimpMesh) const;
+	// Free the vertex and face arrays of a cooked mesh while the rest of the scene is still in use
+	void ReleaseMeshData(aiMesh* assimpMesh) const;
+
+	// Read the model file and let Assimp import it, the caller releases the scene
+	const aiScene* ImportScene(const char* path);
+	// Model file the path refers to, looked up in the models folder when it is not in the file system
+	std::string GetModelPath(const char* path) const;
+	// Import options a mesh cooked now is stored with
+	uint GetMeshFlags() const;
+	// Whether the cooked mesh is newer than its model and was cooked with the current import options
+	bool IsMeshCookedUpToDate(const char* path, const std::string& libraryPath) const;
+	// Write a mesh in the Library format: magic, version, flags and ranges [indices, vertices, normals, texCoords] followed by each array
+	bool SaveMesh(const aiMesh* assimpMesh, const std::string& libraryPath) const;
+
+	// ----- Import memory tracking -----
+
+	void TrackAlloc(uint64 bytes);
+	void TrackFree(uint64 bytes);
+	// ----------------------------------
+
+public:
+
+	// ----- Import configuration -----
+
+	bool streamingImport = false;
+	float memoryBudgetMB = 512.f;
+	bool packAtlases = false;
+	int atlasPageSize = 2048;
+	int atlasMaxTextureSize = 256;
+	// --------------------------------
+
+private:
+
+	// ----- Import memory tracking -----
+
+	// Everything charged to the budget, the CPU copies of streamed meshes stay charged after their import
+	uint64 trackedBytes = 0;
+	uint64 peakBytes = 0;
+	uint64 lastImportPeakBytes = 0;
+	// Meshes whose CPU copy is charged, the oldest first
+	std::deque<ComponentMesh*> residentMeshes;
+	// ----------------------------------
+
 };
 
 #endif // !__MODULE_IMPORT_H__
\ No newline at end of file
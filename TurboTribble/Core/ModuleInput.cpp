@@ -147,7 +147,7 @@ UpdateStatus ModuleInput::PreUpdate(float dt)
 					std::string realFileName = fileName.substr(fileName.find_last_of("\\") + 1); 					
 					if (app->textures->Find(realFileName))
 					{
-						TextureObject texture = app->textures->Get(realFileName);
+						TextureHandle texture = app->textures->Get(realFileName);
 						if (app->editor->gameobjectSelected)
 						{
 							if (ComponentMaterial* material = app->editor->gameobjectSelected->GetComponent<ComponentMaterial>())
@@ -158,7 +158,7 @@ UpdateStatus ModuleInput::PreUpdate(float dt)
 					}
 					else
 					{
-						TextureObject texture = app->textures->Load(realFileName);
+						TextureHandle texture = app->textures->Load(realFileName);
 						if (app->editor->gameobjectSelected)
 						{
 							if (ComponentMaterial* material = app->editor->gameobjectSelected->GetComponent<ComponentMaterial>())
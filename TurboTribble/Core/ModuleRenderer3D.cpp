@@ -5,13 +5,26 @@
 #include "ModuleCamera3D.h"
 #include "ModuleScene.h"
 #include "ModuleEditor.h"
+#include "ModuleTextures.h"
+#include "ModuleViewportFrameBuffer.h"
+#include "ComponentMesh.h"
+#include "ComponentLight.h"
+#include "ComponentMaterial.h"
+#include "ComponentTransform.h"
+#include "GameObject.h"
+#include "TextureStreamer.h"
+#include "JobSystem.h"
+#include "RenderDeviceGL.h"
+#include "RenderDeviceNull.h"
 
 #include "Globals.h"
 
+#include <math.h>
+#include <string.h>
 #include "glew.h"
 #include "SDL/include/SDL_opengl.h"
-#include <gl/GL.h>
-#include <gl/GLU.h>
+#include <GL/gl.h>
+#include <GL/glu.h>
 
 
 
@@ -24,6 +37,11 @@ ModuleRenderer3D::ModuleRenderer3D(Application* app, bool startEnabled) : Module
 	useLighting = true;
 	useTexture = true;
 	wireframeMode = false;
+	useInstancing = true;
+	useOcclusion = true;
+	useMultiDraw = true;
+	useClusteredLights = true;
+	useFrustumCulling = true;
 }
 
 // Destructor
@@ -35,134 +53,82 @@ bool ModuleRenderer3D::Init()
 {
 	TTLOG("+++++ Loading Renderer Module +++++\n");
 	bool ret = true;
-		
-	// Create context
-	context = SDL_GL_CreateContext(app->window->window);
-	if(context == NULL)
+
+	if (app->nullRender)
 	{
-		TTLOG("##### OpenGL context could not be created! SDL_Error: %s #####\n", SDL_GetError());
-		ret = false;
+		TTLOG("+++ Null renderer, draws are only recorded +++\n");
+		device = new RenderDeviceNull(app->nullMultiDraw);
+	}
+	else
+	{
+		ret = CreateContext();
+		if (ret)
+			device = new RenderDeviceGL();
 	}
-
-	GLenum err = glewInit();
-
-	TTLOG("+++ Using Glew %s +++\n", glewGetString(GLEW_VERSION));
-	TTLOG("+++ Vendor: %s +++\n", glGetString(GL_VENDOR));
-	TTLOG("+++ Renderer: %s +++\n", glGetString(GL_RENDERER));
-	TTLOG("+++ OpenGL version supported %s +++\n", glGetString(GL_VERSION));
-	TTLOG("+++ GLSL: %s +++\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
-	
 
 	if(ret == true)
 	{
-		// Use Vsync
-		if(VSYNC && SDL_GL_SetSwapInterval(1) < 0)
-			TTLOG("##### Warning: Unable to set VSync! SDL Error: %s #####\n", SDL_GetError());
-
-		// Initialize Projection Matrix
-		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-
-		// Check for error
-		GLenum error = glGetError();
-		if(error != GL_NO_ERROR)
-		{
-			TTLOG("##### Error initializing OpenGL! %s #####\n", gluErrorString(error));
-			ret = false;
-		}
+		ambient.Set(0.3f, 0.3f, 0.3f, 1.0f);
 
-		// Initialize Modelview Matrix
-		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-
-		// Check for error
-		error = glGetError();
-		if(error != GL_NO_ERROR)
-		{
-			TTLOG("##### Error initializing OpenGL! %s #####\n", gluErrorString(error));
-			ret = false;
-		}
-		
-		glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
-		glClearDepth(1.0f);
-		
-		// Initialize clear color
-		glClearColor(0.f, 0.f, 0.f, 1.f);
-
-		// Initialize BlendFunc
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-		// Check for error
-		error = glGetError();
-		if(error != GL_NO_ERROR)
-		{
-			TTLOG("##### Error initializing OpenGL! %s #####\n", gluErrorString(error));
-			ret = false;
-		}
-		
-		GLfloat lightModelAmbient[] = {0.3f, 0.3f, 0.3f, 1.0f};
-		glLightModelfv(GL_LIGHT_MODEL_AMBIENT, lightModelAmbient);
-		
-		lights[0].ref = GL_LIGHT0;
 		lights[0].ambient.Set(0.25f, 0.25f, 0.25f, 1.0f);
 		lights[0].diffuse.Set(0.9f, 0.9f, 0.9f, 1.0f);
 		lights[0].SetPos(0.0f, 0.0f, 2.5f);
-		lights[0].Init();
 		lights[0].Active(true);
 
-		
-		GLfloat materialAmbient[] = {1.0f, 1.0f, 1.0f, 1.0f};
-		glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, materialAmbient);
+		device->SetDepthTest(true);
+		device->SetCullFace(true);
 
-		GLfloat materialDiffuse[] = {1.0f, 1.0f, 1.0f, 1.0f};
-		glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, materialDiffuse);
-		
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
-		glEnable(GL_LIGHTING);
-		glEnable(GL_COLOR_MATERIAL);
-		glEnable(GL_TEXTURE_2D);
-	}
+		// Camera and lights for every shader, bound once for the whole run
+		frameUniformBuffer = device->CreateBuffer(BufferTarget::BUFFER_UNIFORM, sizeof(FrameUniforms), nullptr, BufferUsage::USAGE_DYNAMIC);
+		device->BindUniformBuffer(FRAME_BLOCK_BINDING, frameUniformBuffer, 0, sizeof(FrameUniforms));
+
+		// Dynamic lights and their clusters, also bound for the whole run and refilled every frame
+		lightsBuffer = device->CreateBuffer(BufferTarget::BUFFER_UNIFORM, sizeof(ClusterLight) * MAX_CLUSTER_LIGHTS, nullptr, BufferUsage::USAGE_DYNAMIC);
+		clustersBuffer = device->CreateBuffer(BufferTarget::BUFFER_UNIFORM, sizeof(ClusterUniforms), nullptr, BufferUsage::USAGE_DYNAMIC);
+		lightIndicesBuffer = device->CreateBuffer(BufferTarget::BUFFER_UNIFORM, MAX_CLUSTER_INDICES * 2, nullptr, BufferUsage::USAGE_DYNAMIC);
+		device->BindUniformBuffer(LIGHTS_BLOCK_BINDING, lightsBuffer, 0, sizeof(ClusterLight) * MAX_CLUSTER_LIGHTS);
+		device->BindUniformBuffer(CLUSTERS_BLOCK_BINDING, clustersBuffer, 0, sizeof(ClusterUniforms));
+		device->BindUniformBuffer(LIGHT_INDICES_BLOCK_BINDING, lightIndicesBuffer, 0, MAX_CLUSTER_INDICES * 2);
+		clusters.Init(app->jobs);
 
-	// Projection matrix for
-	OnResize(SCREEN_WIDTH, SCREEN_HEIGHT);
+		if (!renderQueue.Init(device, app->jobs))
+			ret = false;
+
+		geometry.Init(device);
+		profiler.Init(device);
+		occlusion.Init(app->jobs);
+		TTLOG("+++ Occlusion culling rasterizes with %s +++\n", occlusion.UsesAVX2() ? "AVX2" : "scalar code");
+
+		// Projection matrix for
+		OnResize(SCREEN_WIDTH, SCREEN_HEIGHT);
+	}
 
 	return ret;
 }
 
 bool ModuleRenderer3D::Start()
 {
-	DrawingModes(depthTestEnabled, GL_DEPTH_TEST);
-
-	DrawingModes(cullFace, GL_CULL_FACE);
+	device->SetDepthTest(depthTestEnabled);
+	device->SetCullFace(cullFace);
+	device->SetPolygonMode(wireframeMode);
 
-	DrawingModes(useLighting, GL_LIGHTING);
-
-	DrawingModes(useTexture, GL_TEXTURE_2D);
-
-	wireframeMode ? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	if (app->renderStatsFile != nullptr)
+		profiler.StartCapture(app->renderStatsFile);
+	frameTimer.Start();
 
 	return true;
 }
 
-// PreUpdate: clear buffer
+// PreUpdate: set up the frame, the viewport buffer already cleared its target
 UpdateStatus ModuleRenderer3D::PreUpdate(float dt)
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
 	// Recalculate matrix -------------
 	app->camera->CalculateViewMatrix();
 
-	glMatrixMode(GL_PROJECTION);
-	glLoadMatrixf(app->camera->cameraFrustum.ProjectionMatrix().Transposed().ptr());
-	glMatrixMode(GL_MODELVIEW);
-	glLoadMatrixf(app->camera->viewMatrix.Transposed().ptr());
-
 	// light 0 on cam pos
 	lights[0].SetPos(app->camera->position.x, app->camera->position.y, app->camera->position.z);
 
-	for(uint i = 0; i < MAX_LIGHTS; ++i)
-		lights[i].Render();
+	UpdateFrameUniforms();
 
 	return UpdateStatus::UPDATE_CONTINUE;
 }
@@ -170,7 +136,12 @@ UpdateStatus ModuleRenderer3D::PreUpdate(float dt)
 // PostUpdate present buffer to screen
 UpdateStatus ModuleRenderer3D::PostUpdate(float dt)
 {
-	SDL_GL_SwapWindow(app->window->window);
+	if (!device->IsNull())
+		SDL_GL_SwapWindow(app->window->window);
+
+	profiler.EndFrame(static_cast<float>(frameTimer.ReadMs()), device->GetStats());
+	frameTimer.Start();
+	device->EndFrame();
 
 	return UpdateStatus::UPDATE_CONTINUE;
 }
@@ -180,37 +151,118 @@ bool ModuleRenderer3D::CleanUp()
 {
 	TTLOG("+++++ Quitting Renderer Module +++++\n");
 
-	SDL_GL_DeleteContext(context);
+	if (device != nullptr)
+	{
+		const RenderStats& total = device->GetTotalStats();
+		TTLOG("+++ Rendered %u draws (%u instanced, %u multi draws holding %u indirect draws), %llu primitives, %llu vertices, %u texture binds +++\n", total.drawCalls, total.instancedDrawCalls, total.multiDrawCalls, total.indirectDraws, total.primitives, total.vertices, total.textureBinds);
+		TTLOG("+++ %u state changes, %u redundant state calls filtered +++\n", total.stateChanges, total.filteredCalls);
+		TTLOG("+++ Uploaded %llu buffer bytes in %u uploads to %u buffers and %llu texture bytes to %u textures +++\n", total.bufferBytes, total.bufferUploads, total.buffersCreated, total.textureBytes, total.texturesCreated);
+
+		profiler.CleanUp();
+		renderQueue.CleanUp();
+		geometry.CleanUp();
+		device->DeleteBuffer(frameUniformBuffer);
+		device->DeleteBuffer(lightsBuffer);
+		device->DeleteBuffer(clustersBuffer);
+		device->DeleteBuffer(lightIndicesBuffer);
+		frameUniformBuffer = lightsBuffer = clustersBuffer = lightIndicesBuffer = 0;
+		RELEASE(device);
+	}
+
+	if (context != nullptr)
+		SDL_GL_DeleteContext(context);
 
 	return true;
 }
 
 void ModuleRenderer3D::OnResize(int width, int height)
 {
-	glViewport(0, 0, width, height);
+	device->SetViewport(0, 0, width, height);
 	app->camera->RecalculateProjection();
 }
 
+void ModuleRenderer3D::AddMesh(const ComponentMesh* mesh)
+{
+	meshes.push_back(mesh);
+
+	if (mesh->occluder && !mesh->vertices.empty())
+		occluders.push_back(mesh);
+}
+
+void ModuleRenderer3D::AddLight(const ComponentLight* light)
+{
+	dynamicLights.push_back(light);
+}
+
+void ModuleRenderer3D::FlushQueue()
+{
+	BinLights();
+	RecordMeshes();
+
+	profiler.BeginPass("Meshes");
+	renderQueue.Flush(useInstancing, useMultiDraw, useLighting);
+	profiler.EndPass();
+
+	// Later debug drawing expects the global polygon mode
+	device->SetPolygonMode(wireframeMode);
+}
+
 void ModuleRenderer3D::OnGui()
 {
+	if (ImGui::CollapsingHeader("Render Stats"))
+	{
+		const RenderStats& frame = device->GetLastFrameStats();
+		ImGui::Text("Backend: %s", device->IsNull() ? "Null" : "OpenGL");
+		ImGui::Text("Draw calls: %u (%u instanced)", frame.drawCalls, frame.instancedDrawCalls);
+		ImGui::Text("Primitives: %llu, vertices: %llu", frame.primitives, frame.vertices);
+		ImGui::Text("State changes: %u, redundant calls filtered: %u", frame.stateChanges, frame.filteredCalls);
+		ImGui::Text("Texture binds: %u", frame.textureBinds);
+		ImGui::Text("Buffer uploads: %u, %llu bytes", frame.bufferUploads, frame.bufferBytes);
+		ImGui::Text("Texture uploads: %llu bytes", frame.textureBytes);
+		ImGui::Text("Mesh draw calls: %u, state changes: %u", renderQueue.GetNumDraws(), renderQueue.GetNumStateChanges());
+		ImGui::Text("Instanced draws: %u", renderQueue.GetNumInstancedDraws());
+		ImGui::Text("Multi draws: %u holding %u indirect draws%s", renderQueue.GetNumMultiDraws(), renderQueue.GetNumIndirectDraws(), device->SupportsMultiDraw() ? "" : " (not supported)");
+		ImGui::Text("Geometry pool: %u meshes in %u pages", geometry.GetNumMeshes(), geometry.GetNumPages());
+		for (uint i = 0; i < geometry.GetNumPages(); ++i)
+		{
+			const GeometryPage& page = geometry.GetPage(i);
+			ImGui::BulletText("Page %u: %u / %u vertices, %u / %u indices, %u free ranges", i, page.vertices.GetUsed(), page.vertices.GetCapacity(), page.indices.GetUsed(), page.indices.GetCapacity(), page.vertices.GetNumFreeRanges());
+		}
+		ImGui::Text("Recording jobs: %u", renderQueue.GetNumLists());
+		ImGui::Text("Occluders: %u, triangles: %u, meshes culled: %u", occlusion.GetNumOccluders(), occlusion.GetNumTriangles(), lastCulled);
+		ImGui::Text("Occlusion rasterizer: %s", occlusion.UsesAVX2() ? "AVX2" : "Scalar");
+		ImGui::Text("Outside the frustum: %u of %u meshes, %.3f ms", lastFrustumCulled, static_cast<uint>(meshScreenSizes.size()), cullMs);
+		ImGui::Text("Frustum culler: %s, batches needing the box test: %u", frustumCuller.UsesAVX() ? "AVX" : "Scalar", frustumCuller.GetNumBoxBatches());
+		ImGui::Text("Dynamic lights: %u binned, %u in view, binning %.3f ms", clusters.GetNumLights(), clusters.GetNumVisibleLights(), binMs);
+		ImGui::Text("Light indices: %u / %u, most lights in a cluster: %u", clusters.GetNumIndices(), MAX_CLUSTER_INDICES, clusters.GetMaxLightsPerCluster());
+		if (clusters.GetNumDroppedIndices() > 0 || droppedLights > 0)
+			ImGui::TextColored(ImVec4(1, 1, 0, 1), "Light budget exceeded, %u lights and %u indices dropped", droppedLights, clusters.GetNumDroppedIndices());
+		ImGui::Separator();
+		profiler.OnGui();
+	}
+
 	if (ImGui::CollapsingHeader("Render"))
 	{
 		ImGui::TextUnformatted("Render Options");
 		if (ImGui::Checkbox("Depth Test", &depthTestEnabled))
-			DrawingModes(depthTestEnabled, GL_DEPTH_TEST);
+			device->SetDepthTest(depthTestEnabled);
 
 		if (ImGui::Checkbox("Cull Face", &cullFace))
-			DrawingModes(cullFace, GL_CULL_FACE);
+			device->SetCullFace(cullFace);
 
-		if (ImGui::Checkbox("Lighting ON/OFF", &useLighting))
-			DrawingModes(useLighting, GL_LIGHTING);
+		ImGui::Checkbox("Lighting ON/OFF", &useLighting);
 
-		if (ImGui::Checkbox("Texture Draw", &useTexture))
-			DrawingModes(useTexture, GL_TEXTURE_2D);
+		ImGui::Checkbox("Texture Draw", &useTexture);
 
 		if (ImGui::Checkbox("Wireframe Mode", &wireframeMode)) {
-			wireframeMode ? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			device->SetPolygonMode(wireframeMode);
 		}
+
+		ImGui::Checkbox("Instancing", &useInstancing);
+		ImGui::Checkbox("Multi Draw Indirect", &useMultiDraw);
+		ImGui::Checkbox("Frustum Culling", &useFrustumCulling);
+		ImGui::Checkbox("Occlusion Culling", &useOcclusion);
+		ImGui::Checkbox("Clustered Lights", &useClusteredLights);
 	}
 }
 
@@ -224,6 +276,11 @@ void ModuleRenderer3D::OnLoad(const JSONReader& reader)
 		LOAD_JSON_BOOL(useTexture)
 		LOAD_JSON_BOOL(wireframeMode)
 		LOAD_JSON_BOOL(vsyncActive)
+		LOAD_JSON_BOOL(useInstancing)
+		LOAD_JSON_BOOL(useOcclusion)
+		LOAD_JSON_BOOL(useMultiDraw)
+		LOAD_JSON_BOOL(useClusteredLights)
+		LOAD_JSON_BOOL(useFrustumCulling)
 	}
 }
 
@@ -237,10 +294,232 @@ void ModuleRenderer3D::OnSave(JSONWriter& writer) const
 	SAVE_JSON_BOOL(useTexture)
 	SAVE_JSON_BOOL(wireframeMode)
 	SAVE_JSON_BOOL(vsyncActive)
+	SAVE_JSON_BOOL(useInstancing)
+	SAVE_JSON_BOOL(useOcclusion)
+	SAVE_JSON_BOOL(useMultiDraw)
+	SAVE_JSON_BOOL(useClusteredLights)
+	SAVE_JSON_BOOL(useFrustumCulling)
 	writer.EndObject();
 }
 
-void ModuleRenderer3D::DrawingModes(bool currentState, int glMode)
+void ModuleRenderer3D::UpdateFrameUniforms()
+{
+	FrameUniforms frame;
+	frame.view = app->camera->viewMatrix.Transposed();
+	frame.projection = app->camera->cameraFrustum.ProjectionMatrix().Transposed();
+	frame.ambient = float4(ambient.r, ambient.g, ambient.b, ambient.a);
+
+	frame.numLights = 0;
+	for (uint i = 0; i < MAX_LIGHTS; ++i)
+	{
+		if (!lights[i].on)
+			continue;
+
+		const int index = frame.numLights++;
+		frame.lightPositions[index] = float4(lights[i].position, 1.f);
+		frame.lightAmbients[index] = float4(lights[i].ambient.r, lights[i].ambient.g, lights[i].ambient.b, lights[i].ambient.a);
+		frame.lightDiffuses[index] = float4(lights[i].diffuse.r, lights[i].diffuse.g, lights[i].diffuse.b, lights[i].diffuse.a);
+	}
+
+	device->UpdateBuffer(BufferTarget::BUFFER_UNIFORM, frameUniformBuffer, 0, sizeof(FrameUniforms), &frame);
+}
+
+void ModuleRenderer3D::BinLights()
 {
-	currentState ? glEnable(glMode) : glDisable(glMode);
+	PerfTimer timer;
+
+	const Frustum& frustum = app->camera->cameraFrustum;
+	clusters.SetProjection(tanf(frustum.horizontalFov * 0.5f), tanf(frustum.verticalFov * 0.5f), frustum.nearPlaneDistance, frustum.farPlaneDistance);
+
+	// Past the budget the extra lights are left out rather than overflowing the block
+	clusterLights.resize(useClusteredLights ? MIN(dynamicLights.size(), static_cast<size_t>(MAX_CLUSTER_LIGHTS)) : 0);
+	for (uint i = 0; i < clusterLights.size(); ++i)
+		dynamicLights[i]->GetClusterLight(clusterLights[i]);
+	droppedLights = useClusteredLights ? static_cast<uint>(dynamicLights.size() - clusterLights.size()) : 0;
+
+	clusters.Bin(app->camera->viewMatrix, clusterLights.data(), static_cast<uint>(clusterLights.size()));
+	dynamicLights.clear();
+
+	clusterUniforms.sliceParams = float4(clusters.GetSliceScale(), clusters.GetSliceBias(), 0.f, 0.f);
+	memcpy(clusterUniforms.clusters, clusters.GetClusters().data(), sizeof(clusterUniforms.clusters));
+
+	// Only the used part of the light and index blocks, clusters past it have a count of 0
+	if (!clusterLights.empty())
+		device->UpdateBuffer(BufferTarget::BUFFER_UNIFORM, lightsBuffer, 0, sizeof(ClusterLight) * clusterLights.size(), clusterLights.data());
+	if (clusters.GetNumIndices() > 0)
+		device->UpdateBuffer(BufferTarget::BUFFER_UNIFORM, lightIndicesBuffer, 0, ((clusters.GetNumIndices() + 1) / 2) * sizeof(uint), clusters.GetIndices().data());
+	device->UpdateBuffer(BufferTarget::BUFFER_UNIFORM, clustersBuffer, 0, sizeof(ClusterUniforms), &clusterUniforms);
+
+	binMs = static_cast<float>(timer.ReadMs());
+}
+
+void ModuleRenderer3D::RasterizeOccluders()
+{
+	occlusion.Begin(app->camera->cameraFrustum.ViewProjMatrix());
+
+	if (useOcclusion)
+	{
+		for (const ComponentMesh* mesh : occluders)
+			occlusion.AddOccluder(mesh->owner->transform->transformMatrix, mesh->vertices.data(), static_cast<uint>(mesh->vertices.size()), mesh->indices.data(), static_cast<uint>(mesh->indices.size()));
+	}
+
+	occlusion.Rasterize();
+	occluders.clear();
+}
+
+void ModuleRenderer3D::CullMeshes()
+{
+	PerfTimer timer;
+
+	const uint numMeshes = static_cast<uint>(meshes.size());
+	const uint numChunks = (numMeshes + MIN_MESHES_PER_LIST - 1) / MIN_MESHES_PER_LIST;
+	const bool streaming = app->textures->streamTextures;
+	const bool culling = useFrustumCulling;
+	meshScreenSizes.resize(numMeshes);
+	frustumCuller.Begin(app->camera->cameraFrustum, culling ? numMeshes : 0);
+	// Pixels the scene is really rendered at, the panel is smaller than the window and the render scale shrinks it further
+	const float viewportHeight = static_cast<float>(MAX(app->viewportBuffer->GetRenderHeight(), 1u));
+
+	// Every job writes the bounds and screen sizes of its own meshes
+	app->jobs->ParallelFor(numChunks, [this, numMeshes, streaming, culling, viewportHeight](uint chunk)
+	{
+		const Frustum& frustum = app->camera->cameraFrustum;
+
+		const uint last = MIN((chunk + 1) * MIN_MESHES_PER_LIST, numMeshes);
+		for (uint i = chunk * MIN_MESHES_PER_LIST; i < last; ++i)
+		{
+			const ComponentMesh* mesh = meshes[i];
+			const AABB box = mesh->GetWorldAABB();
+
+			// Meshes outside the frustum get a size of 0, their textures can drop to the smallest mip
+			if (streaming)
+				meshScreenSizes[i] = TextureStreamer::ProjectedSize(frustum, box, viewportHeight);
+
+			if (culling)
+				frustumCuller.SetBounds(i, mesh->GetCenterPointInWorldCoords(), mesh->GetWorldSphereRadius(), box);
+		}
+	});
+
+	if (culling)
+	{
+		frustumCuller.Cull();
+		visibleMeshes = frustumCuller.GetVisible();
+	}
+	else
+	{
+		visibleMeshes.resize(numMeshes);
+		for (uint i = 0; i < numMeshes; ++i)
+			visibleMeshes[i] = i;
+	}
+
+	lastFrustumCulled = numMeshes - static_cast<uint>(visibleMeshes.size());
+	cullMs = static_cast<float>(timer.ReadMs());
+}
+
+void ModuleRenderer3D::RecordMeshes()
+{
+	RasterizeOccluders();
+	CullMeshes();
+
+	const uint numVisible = static_cast<uint>(visibleMeshes.size());
+	const uint numLists = MAX(1u, MIN(app->jobs->GetNumThreads(), (numVisible + MIN_MESHES_PER_LIST - 1) / MIN_MESHES_PER_LIST));
+	renderQueue.SetNumLists(numLists);
+	listCulled.assign(numLists, 0);
+
+	const bool culling = occlusion.HasOccluders();
+
+	// The jobs only read the scene and the materials and every one writes its own list, texture use is marked after them
+	app->jobs->ParallelFor(numLists, [this, numVisible, numLists, culling](uint list)
+	{
+		const Frustum& frustum = app->camera->cameraFrustum;
+		RenderCommandList& commands = renderQueue.GetList(list);
+
+		const uint last = numVisible * (list + 1) / numLists;
+		for (uint i = numVisible * list / numLists; i < last; ++i)
+		{
+			const ComponentMesh* mesh = meshes[visibleMeshes[i]];
+
+			// Occluders never hide themselves
+			if (culling && !mesh->occluder && !occlusion.IsVisible(mesh->GetWorldAABB()))
+			{
+				++listCulled[list];
+				continue;
+			}
+
+			DrawCommand command;
+			mesh->BuildDrawCommand(command);
+
+			const float depth = (mesh->GetCenterPointInWorldCoords() - frustum.pos).Dot(frustum.front) / frustum.farPlaneDistance;
+			commands.Add(command, depth);
+		}
+	});
+
+	lastCulled = 0;
+	for (uint culled : listCulled)
+		lastCulled += culled;
+
+	// Several meshes can share a texture, so the use and the sizes are written from this thread only
+	// Occluded meshes count as used, they are only hidden for this frame
+	for (uint i : visibleMeshes)
+	{
+		if (const ComponentMaterial* material = meshes[i]->owner->GetComponent<ComponentMaterial>())
+			material->MarkUsed();
+	}
+
+	if (app->textures->streamTextures)
+	{
+		for (uint i = 0; i < meshes.size(); ++i)
+		{
+			if (const ComponentMaterial* material = meshes[i]->owner->GetComponent<ComponentMaterial>())
+				material->ReportScreenSize(meshScreenSizes[i]);
+		}
+	}
+
+	meshes.clear();
+}
+
+bool ModuleRenderer3D::CreateContext()
+{
+	context = SDL_GL_CreateContext(app->window->window);
+	if(context == NULL)
+	{
+		TTLOG("##### OpenGL context could not be created! SDL_Error: %s #####\n", SDL_GetError());
+		return false;
+	}
+
+	// Core profile contexts need the experimental loader, which leaves an invalid enum error behind
+	glewExperimental = GL_TRUE;
+	glewInit();
+	glGetError();
+
+	TTLOG("+++ Using Glew %s +++\n", glewGetString(GLEW_VERSION));
+	TTLOG("+++ Vendor: %s +++\n", glGetString(GL_VENDOR));
+	TTLOG("+++ Renderer: %s +++\n", glGetString(GL_RENDERER));
+	TTLOG("+++ OpenGL version supported %s +++\n", glGetString(GL_VERSION));
+	TTLOG("+++ GLSL: %s +++\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+	if (!GLEW_VERSION_3_3)
+	{
+		TTLOG("##### OpenGL 3.3 is not available! #####\n");
+		return false;
+	}
+
+	// Use Vsync
+	if(VSYNC && SDL_GL_SetSwapInterval(1) < 0)
+		TTLOG("##### Warning: Unable to set VSync! SDL Error: %s #####\n", SDL_GetError());
+
+	glClearDepth(1.0f);
+
+	// Initialize BlendFunc
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// Check for error
+	GLenum error = glGetError();
+	if(error != GL_NO_ERROR)
+	{
+		TTLOG("##### Error initializing OpenGL! %s #####\n", gluErrorString(error));
+		return false;
+	}
+
+	return true;
 }
\ No newline at end of file
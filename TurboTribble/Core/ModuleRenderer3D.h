@@ -5,12 +5,25 @@
 
 #include "Globals.h"
 #include "Light.h"
+#include "RenderQueue.h"
+#include "OcclusionCuller.h"
+#include "FrustumCuller.h"
+#include "RenderProfiler.h"
+#include "GeometryPool.h"
+#include "LightClusters.h"
+#include "PerfTimer.h"
 #include "SDL/include/SDL.h"
 
-#define MAX_LIGHTS 8
+#define MAX_LIGHTS MAX_FRAME_LIGHTS
+// Fewer meshes than this per job are not worth waking a worker
+#define MIN_MESHES_PER_LIST 64
 
 
 
+class ComponentMesh;
+class ComponentLight;
+class RenderDevice;
+
 class ModuleRenderer3D : public Module
 {
 public:
@@ -35,6 +48,20 @@ public:
 	// Control what happens when the window is resized
 	void OnResize(int width, int height);
 
+	// Queue a mesh, its draw is recorded on the workers when the queue is flushed
+	void AddMesh(const ComponentMesh* mesh);
+	// Queue a dynamic light, the queued lights are binned into the clusters when the queue is flushed
+	void AddLight(const ComponentLight* light);
+	// Record, sort and submit every mesh queued since the last flush
+	void FlushQueue();
+
+	// Every render call of the engine goes through it, exists from Init to CleanUp
+	inline RenderDevice* GetDevice() const { return device; }
+	// Shared buffers of the static meshes
+	inline GeometryPool& GetGeometry() { return geometry; }
+	// Modules time their GPU passes through it
+	inline RenderProfiler& GetProfiler() { return profiler; }
+
 	// Draws Render Info
 	void OnGui() override;
 
@@ -45,23 +72,76 @@ public:
 
 private:
 
-	// Set specific drawing mode
-	void DrawingModes(bool currentState, int glMode);
+	// GL context, glew and the state the device does not track
+	bool CreateContext();
+	// Upload camera and lights to the Frame uniform block
+	void UpdateFrameUniforms();
+	// Rasterize the queued occluders for this frame's camera
+	void RasterizeOccluders();
+	// Gather the world bounds of the queued meshes and keep the ones inside the camera frustum
+	void CullMeshes();
+	// Turn the visible meshes into draws, one command list per job
+	void RecordMeshes();
+	// Bin the queued lights for this frame's camera and upload the light blocks
+	void BinLights();
 
 public:
 
 	// ---- Renderer Variables -----
 	
 	Light lights[MAX_LIGHTS];
-	SDL_GLContext context;
+	Color ambient;
+	SDL_GLContext context = nullptr;
 	bool depthTestEnabled;
 	bool cullFace;
 	bool useLighting;
 	bool useTexture;
 	bool wireframeMode;
 	bool vsyncActive;
+	bool useInstancing;
+	bool useOcclusion;
+	bool useMultiDraw;
+	bool useClusteredLights;
+	bool useFrustumCulling;
 	// -----------------------------
 
+private:
+
+	RenderDevice* device = nullptr;
+	RenderQueue renderQueue;
+	GeometryPool geometry;
+	RenderProfiler profiler;
+	// Wall time of the frame, restarted when a frame ends
+	PerfTimer frameTimer;
+	std::vector<const ComponentMesh*> meshes;
+	// Queued meshes that hide others, only the ones with their CPU copy loaded
+	std::vector<const ComponentMesh*> occluders;
+	FrustumCuller frustumCuller;
+	// Indices into meshes of the ones inside the frustum, all of them with frustum culling off
+	std::vector<uint> visibleMeshes;
+	uint lastFrustumCulled = 0;
+	float cullMs = 0.f;
+	OcclusionCuller occlusion;
+	// Meshes each recording job dropped behind the occluders
+	std::vector<uint> listCulled;
+	uint lastCulled = 0;
+	// Written by the culling jobs, one slot per mesh, reported to the texture streamer afterwards
+	std::vector<float> meshScreenSizes;
+	uint frameUniformBuffer = 0;
+
+	// ----- Dynamic lights -----
+
+	std::vector<const ComponentLight*> dynamicLights;
+	std::vector<ClusterLight> clusterLights;
+	LightClusters clusters;
+	ClusterUniforms clusterUniforms;
+	uint lightsBuffer = 0;
+	uint clustersBuffer = 0;
+	uint lightIndicesBuffer = 0;
+	uint droppedLights = 0;
+	float binMs = 0.f;
+	// --------------------------
+
 };
 
 #endif // !__MODULE_RENDERER_3D_H__
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "ModuleTextures.h"
 #include "ModuleCamera3D.h"
 #include "ModuleEditor.h"
+#include "ModuleRenderer3D.h"
+#include "ModuleDebugDraw.h"
 #include "Component.h"
 #include "ComponentTransform.h"
 
@@ -86,29 +88,19 @@ UpdateStatus ModuleScene::Update(float dt)
 		}
 	}
 
-	glDisable(GL_DEPTH_TEST);
+	// Meshes were only queued during the traversal
+	app->renderer3D->FlushQueue();
 
+	// Gizmo over the scene
 	if (app->editor->gameobjectSelected)
 	{
 		ComponentTransform* transform = app->editor->gameobjectSelected->GetComponent<ComponentTransform>();
-		float3 pos = transform->GetPosition();
-		glLineWidth(10.f);
-		glBegin(GL_LINES);
-		glColor3f(1.f, 0.f, 0.f);
-		glVertex3f(pos.x, pos.y, pos.z);
-		glVertex3f(pos.x + transform->Right().x, pos.y + transform->Right().y, pos.z + transform->Right().z);
-		glColor3f(0.f, 0.f, 1.f);
-		glVertex3f(pos.x, pos.y, pos.z);
-		glVertex3f(pos.x + transform->Front().x, pos.y + transform->Front().y, pos.z + transform->Front().z);
-		glColor3f(0.f, 1.f, 0.f);
-		glVertex3f(pos.x, pos.y, pos.z);
-		glVertex3f(pos.x + transform->Up().x, pos.y + transform->Up().y, pos.z + transform->Up().z);
-		glEnd();
-		glLineWidth(1.f);
+		const float3 pos = transform->GetPosition();
+		app->debugDraw->DrawLine(pos, pos + transform->Right(), Color(1.f, 0.f, 0.f), false);
+		app->debugDraw->DrawLine(pos, pos + transform->Front(), Color(0.f, 0.f, 1.f), false);
+		app->debugDraw->DrawLine(pos, pos + transform->Up(), Color(0.f, 1.f, 0.f), false);
 	}
 
-	glEnable(GL_DEPTH_TEST);
-
 	return UpdateStatus::UPDATE_CONTINUE;
 }
 
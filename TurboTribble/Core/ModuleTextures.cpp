@@ -2,25 +2,83 @@
 
 #include "Application.h"
 #include "ModuleFileSystem.h"
-#include "ModuleEditor.h"
+#ifndef HEADLESS_BUILD
+#include "ModuleRenderer3D.h"
+#endif // !HEADLESS_BUILD
+#include "TextureData.h"
+#include "TextureCompressor.h"
+#include "MipGenerator.h"
+#include "TextureAtlas.h"
+#include "TextureStreamer.h"
+#include "PixelOps.h"
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+#include "RenderDevice.h"
+#include "PerfTimer.h"
 
 #include "Globals.h"
 
-#include "glew.h"
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include "ImGui/imgui.h"
 // DevIL Image Library
-#include "DevIL\include\ilu.h"
-#include "DevIL\include\ilut.h"
+#include "DevIL/include/ilu.h"
 
 #define CHECKERS_HEIGHT 64
 #define CHECKERS_WIDTH 64
+// Frames between streaming decisions
+#define STREAMING_INTERVAL 15
+// Streamed textures swapped per frame, keeps the uploads from hitching
+#define MAX_STREAMED_UPLOADS 2
 
+// DevIL keeps one bound image for the whole process, its calls from worker threads have to take turns
+static std::mutex devilMutex;
 
+// Decoded images waiting for the thread that owns the GL context
+struct DecodeQueue
+{
+	struct Entry
+	{
+		std::string path;
+		bool success = false;
+		TextureData texture;
+	};
+
+	std::queue<Entry> decoded;
+	std::mutex mutex;
+	std::condition_variable ready;
+};
+
+// Cache name of an atlas page, the owner is the full asset path so models with the same file name do not share pages
+static std::string GetAtlasPageName(const std::string& owner, uint page)
+{
+	return owner + "_atlas" + std::to_string(page);
+}
+
+// Data textures that only need two channels, by naming convention
+static bool HasNormalMapSuffix(const std::string& path)
+{
+	std::string name = path.substr(0, path.find_last_of('.'));
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+	for (const char* suffix : { "_n", "_nrm", "_normal" })
+	{
+		const size_t length = strlen(suffix);
+		if (name.size() > length && name.compare(name.size() - length, length, suffix) == 0)
+			return true;
+	}
+	return false;
+}
 
-ModuleTextures::ModuleTextures(Application* app, bool startEnabled) : Module(app, startEnabled)
+ModuleTextures::ModuleTextures(Application* app, bool startEnabled) : Module(app, startEnabled), streamQueue(std::make_shared<DecodeQueue>())
 {
 	ilInit();
 	iluInit();
-	ilutInit();
 }
 
 bool ModuleTextures::Init()
@@ -31,58 +89,56 @@ bool ModuleTextures::Init()
 
 bool ModuleTextures::Start()
 {
-	GLubyte fallbackImageWhite[4] = { GLubyte(255), GLubyte(255), GLubyte(255), GLubyte(255) };
+	// Fallback textures live in VRAM, the headless cooker has no render device
+#ifdef HEADLESS_BUILD
+	return true;
+#else
+	if (app->headless)
+		return true;
+
+	device = app->renderer3D->GetDevice();
+#endif // HEADLESS_BUILD
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glGenTextures(1, &whiteFallback);
-	glBindTexture(GL_TEXTURE_2D, whiteFallback);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, fallbackImageWhite);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	TextureData fallbackImage;
+	fallbackImage.width = fallbackImage.height = 1;
+	fallbackImage.levels.resize(1);
+	fallbackImage.levels[0].width = fallbackImage.levels[0].height = 1;
 
-	GLubyte fallbackImageBlack[4] = { GLubyte(0), GLubyte(0), GLubyte(0), GLubyte(0) };
+	fallbackImage.levels[0].data.assign(4, uchar(255));
+	whiteFallback = device->CreateTexture(fallbackImage, false, true);
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glGenTextures(1, &blackFallback);
-	glBindTexture(GL_TEXTURE_2D, blackFallback);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, fallbackImageBlack);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	fallbackImage.levels[0].data.assign(4, uchar(0));
+	blackFallback = device->CreateTexture(fallbackImage, false, true);
 
-	GLubyte checkerImage[CHECKERS_HEIGHT][CHECKERS_HEIGHT][4];
+	TextureData checkerImage;
+	checkerImage.width = CHECKERS_WIDTH;
+	checkerImage.height = CHECKERS_HEIGHT;
+	checkerImage.levels.resize(1);
+	checkerImage.levels[0].width = CHECKERS_WIDTH;
+	checkerImage.levels[0].height = CHECKERS_HEIGHT;
+	checkerImage.levels[0].data.resize(CHECKERS_WIDTH * CHECKERS_HEIGHT * 4);
 
 	for (int i = 0; i < CHECKERS_HEIGHT; i++) {
 		for (int j = 0; j < CHECKERS_WIDTH; j++) {
 			int c = ((((i & 0x8) == 0) ^ (((j & 0x8)) == 0))) * 255;
-			checkerImage[i][j][0] = (GLubyte)c;
-			checkerImage[i][j][1] = (GLubyte)c;
-			checkerImage[i][j][2] = (GLubyte)c;
-			checkerImage[i][j][3] = (GLubyte)255;
+			uchar* pixel = &checkerImage.levels[0].data[(i * CHECKERS_WIDTH + j) * 4];
+			pixel[0] = (uchar)c;
+			pixel[1] = (uchar)c;
+			pixel[2] = (uchar)c;
+			pixel[3] = (uchar)255;
 		}
 	}
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glGenTextures(1, &checkers);
-	glBindTexture(GL_TEXTURE_2D, checkers);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, CHECKERS_WIDTH, CHECKERS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, checkerImage[0]);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	checkers = device->CreateTexture(checkerImage, false, true);
 
 
 	if (blackFallback != 0u && whiteFallback != 0u && checkers != 0u)
 	{
-		textures.insert(std::make_pair("BLACK_FALLBACK", TextureObject("BLACK_FALLBACK", static_cast<uint>(blackFallback), 1, 1)));
-		textures.insert(std::make_pair("WHITE_BALLBACK", TextureObject("WHITE_BALLBACK", static_cast<uint>(whiteFallback), 1, 1)));
-		textures.insert(std::make_pair("CHECKERS", TextureObject("CHECKERS", static_cast<uint>(checkers), CHECKERS_WIDTH, CHECKERS_HEIGHT)));
+		textures.Insert(HashAssetPath("BLACK_FALLBACK"), std::make_shared<TextureObject>("BLACK_FALLBACK", static_cast<uint>(blackFallback), 1, 1));
+		textures.Insert(HashAssetPath("WHITE_BALLBACK"), std::make_shared<TextureObject>("WHITE_BALLBACK", static_cast<uint>(whiteFallback), 1, 1));
+		textures.Insert(HashAssetPath("CHECKERS"), std::make_shared<TextureObject>("CHECKERS", static_cast<uint>(checkers), CHECKERS_WIDTH, CHECKERS_HEIGHT));
+		for (auto& t : textures)
+			t.second->persistent = true;
 		return true;
 	}
 
@@ -93,101 +149,782 @@ bool ModuleTextures::Start()
 bool ModuleTextures::CleanUp() // can be called to reset stored textures
 {
 	TTLOG("+++++ Quitting Textures Module +++++\n");
+
+	// Reads still in flight must not outlive the module
+	for (; pendingStreams > 0; --pendingStreams)
+	{
+		std::unique_lock<std::mutex> lock(streamQueue->mutex);
+		streamQueue->ready.wait(lock, [this]() { return !streamQueue->decoded.empty(); });
+		streamQueue->decoded.pop();
+	}
 	
+	// Handles still held by components keep their object, but not the GL texture
 	for (auto& t : textures)
-		glDeleteTextures(1, &t.second.id);
+	{
+		if (device != nullptr)
+			device->DeleteTexture(t.second->id);
+		t.second->id = 0;
+	}
 	
-	textures.clear();
+	for (TextureHandle& texture : retiredTextures)
+	{
+		if (device != nullptr)
+			device->DeleteTexture(texture->id);
+		texture->id = 0;
+	}
+
+	textures.Clear();
+	retiredTextures.clear();
+	residentBytes = 0;
 	return true;
 }
 
+UpdateStatus ModuleTextures::PreUpdate(float dt)
+{
+	++frame;
+
+	if (streamTextures && !app->headless)
+		UpdateStreaming();
+
+	// Replaced textures go as soon as the last object drawing with them does
+	for (uint i = 0; i < retiredTextures.size();)
+	{
+		if (retiredTextures[i].use_count() > 1)
+		{
+			++i;
+			continue;
+		}
+
+		device->DeleteTexture(retiredTextures[i]->id);
+		residentBytes -= retiredTextures[i]->size;
+		retiredTextures[i] = retiredTextures.back();
+		retiredTextures.pop_back();
+	}
+
+	const uint64 budget = static_cast<uint64>(budgetMB * 1024.f * 1024.f);
+	if (residentBytes > budget)
+		EvictUnused(budget);
+
+	return UpdateStatus::UPDATE_CONTINUE;
+}
+
+void ModuleTextures::OnGui()
+{
+	if (ImGui::CollapsingHeader("Textures"))
+	{
+		ImGui::Checkbox("Block compression", &compressTextures);
+		ImGui::Combo("Quality", &compressionQuality, "Fast (BC1/BC3)\0Normal (BC1/BC3)\0High (BC7)\0");
+		ImGui::Checkbox("Generate mipmaps", &generateMips);
+		ImGui::Combo("Mip filter", &mipFilter, "Box\0Kaiser\0");
+		ImGui::Checkbox("Gamma correct mips", &gammaCorrectMips);
+		ImGui::DragFloat("VRAM budget (MB)", &budgetMB, 1.f, 16.f, 16384.f);
+		ImGui::Checkbox("Stream mips", &streamTextures);
+		ImGui::DragInt("Always resident size", &streamingMinSize, 1.f, 1, 4096);
+		ImGui::Checkbox("Expand RGB to RGBA", &expandRGB);
+		ImGui::Checkbox("Premultiply alpha", &premultiplyAlpha);
+		ImGui::Checkbox("Flip images (off flips V at model import)", &flipImages);
+		ImGui::TextUnformatted("Changes apply to textures cooked from now on");
+		ImGui::DragInt("Benchmark size", &benchmarkSize, 64.f, 256, 8192);
+		ImGui::SameLine();
+		if (ImGui::Button("Benchmark pixel ops"))
+			BenchmarkPixelOps(static_cast<uint>(benchmarkSize));
+	}
+}
+
+void ModuleTextures::OnLoad(const JSONReader& reader)
+{
+	if (reader.HasMember("textures"))
+	{
+		const auto& config = reader["textures"];
+		LOAD_JSON_BOOL(compressTextures)
+		LOAD_JSON_INT(compressionQuality)
+		LOAD_JSON_BOOL(generateMips)
+		LOAD_JSON_INT(mipFilter)
+		LOAD_JSON_BOOL(gammaCorrectMips)
+		LOAD_JSON_BOOL(expandRGB)
+		LOAD_JSON_BOOL(premultiplyAlpha)
+		LOAD_JSON_BOOL(flipImages)
+		LOAD_JSON_FLOAT(budgetMB)
+		LOAD_JSON_BOOL(streamTextures)
+		LOAD_JSON_INT(streamingMinSize)
+	}
+}
+
+void ModuleTextures::OnSave(JSONWriter& writer) const
+{
+	writer.String("textures");
+	writer.StartObject();
+	SAVE_JSON_BOOL(compressTextures)
+	SAVE_JSON_INT(compressionQuality)
+	SAVE_JSON_BOOL(generateMips)
+	SAVE_JSON_INT(mipFilter)
+	SAVE_JSON_BOOL(gammaCorrectMips)
+	SAVE_JSON_BOOL(expandRGB)
+	SAVE_JSON_BOOL(premultiplyAlpha)
+	SAVE_JSON_BOOL(flipImages)
+	SAVE_JSON_FLOAT(budgetMB)
+	SAVE_JSON_BOOL(streamTextures)
+	SAVE_JSON_INT(streamingMinSize)
+	writer.EndObject();
+}
+
 // Load new texture from file path
-const TextureObject& ModuleTextures::Load(const std::string& path, bool useMipMaps)
+TextureHandle ModuleTextures::Load(const std::string& path, bool useMipMaps)
 {
+	if (const TextureHandle* texture = textures.Find(HashAssetPath(path)))
+		return *texture;
+
 	TTLOG("+++ Loading texture -> %s +++\n", path.c_str());
 
-	ILuint imageId;
-	ilGenImages(1, &imageId);
-	ilBindImage(imageId);
+	TextureData texture;
+	if (Read(path, texture))
+		return Add(path, texture, useMipMaps);
 
-	char* data;
-	uint bytes = app->fileSystem->Load(path.c_str(), &data);
+	return Get(HashAssetPath("BLACK_FALLBACK"));
+}
 
-	if (bytes != 0)
+void ModuleTextures::LoadBatch(const std::vector<std::string>& paths, bool useMipMaps)
+{
+	std::vector<std::string> pending;
+	FlatHashMap<AssetId, bool, AssetIdHash> queued;
+	for (const std::string& path : paths)
 	{
-		if (ilLoadL(IL_TYPE_UNKNOWN, data, bytes))
+		const AssetId id = HashAssetPath(path);
+		if (!Find(id) && !queued.Contains(id))
 		{
-			GLuint textureId = 0;
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glGenTextures(1, &textureId);
+			queued.Insert(id, true);
+			pending.push_back(path);
+		}
+	}
 
-			glBindTexture(GL_TEXTURE_2D, textureId);
+	if (pending.empty())
+		return;
 
-			ILinfo ImageInfo;
-			iluGetImageInfo(&ImageInfo);
-			if (ImageInfo.Origin == IL_ORIGIN_UPPER_LEFT)
-			{
-				iluFlipImage();
-			}
+	TTLOG("+++ Decoding %u textures on %u threads +++\n", static_cast<uint>(pending.size()), app->jobs->GetNumThreads() - 1);
+	PerfTimer timer;
+
+	std::shared_ptr<DecodeQueue> queue = std::make_shared<DecodeQueue>();
+	for (const std::string& path : pending)
+	{
+		app->jobs->Schedule([this, queue, path]()
+		{
+			DecodeQueue::Entry entry;
+			entry.path = path;
+			entry.success = Read(path, entry.texture);
 
-			int channels = ilGetInteger(IL_IMAGE_CHANNELS);
-			if (channels == 3)
-			{
-				ilConvertImage(IL_RGB, IL_UNSIGNED_BYTE);
-			}
-			else if (channels == 4)
 			{
-				ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+				std::lock_guard<std::mutex> lock(queue->mutex);
+				queue->decoded.push(std::move(entry));
 			}
+			queue->ready.notify_one();
+		});
+	}
 
-			ILubyte* imageData = ilGetData();
-			int width = ilGetInteger(IL_IMAGE_WIDTH);
-			int height = ilGetInteger(IL_IMAGE_HEIGHT);
+	// Staged upload, every image goes to GL as soon as it is decoded while the workers keep going with the rest
+	for (uint i = 0; i < pending.size(); ++i)
+	{
+		DecodeQueue::Entry entry;
+		{
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			queue->ready.wait(lock, [&queue]() { return !queue->decoded.empty(); });
+			entry = std::move(queue->decoded.front());
+			queue->decoded.pop();
+		}
 
-			glTexImage2D(GL_TEXTURE_2D, 0, ilGetInteger(IL_IMAGE_FORMAT), width, height, 0, ilGetInteger(IL_IMAGE_FORMAT), GL_UNSIGNED_BYTE, imageData);
+		if (!entry.success)
+		{
+			TTLOG("### Error decoding texture %s ###\n", entry.path.c_str());
+			continue;
+		}
 
-			if (useMipMaps)
-			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		Add(entry.path, entry.texture, useMipMaps);
+	}
 
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glGenerateMipmap(GL_TEXTURE_2D);
-			}
-			else
-			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	TTLOG("+++ Loaded %u textures in %.2f ms +++\n", static_cast<uint>(pending.size()), timer.ReadMs());
+}
 
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			}
+bool ModuleTextures::Cook(const std::string& path, std::string& libraryPath)
+{
+	TextureData texture;
+	if (!Import(path, texture) || !SaveToLibrary(path, texture))
+	{
+		TTLOG("### Error cooking texture %s ###\n", path.c_str());
+		return false;
+	}
+
+	libraryPath = GetLibraryPath(path);
+	return true;
+}
+
+std::string ModuleTextures::GetLibraryPath(const std::string& path) const
+{
+	std::string file;
+	app->fileSystem->SplitFilePath(path.c_str(), nullptr, &file);
+
+	// The id keeps assets with the same file name in different folders apart, the name is only there to read
+	char id[20];
+	snprintf(id, 20, "_%016llx", HashAssetPath(path));
+	return TEXTURES_PATH + file + id + ".tex";
+}
+
+void ModuleTextures::SetNormalMapHint(AssetId id, bool isNormalMap)
+{
+	std::lock_guard<std::mutex> lock(hintMutex);
+	normalMapHints.Insert(id, isNormalMap);
+}
+
+bool ModuleTextures::IsNormalMap(const std::string& path) const
+{
+	{
+		std::lock_guard<std::mutex> lock(hintMutex);
+		if (const bool* hint = normalMapHints.Find(HashAssetPath(path)))
+			return *hint;
+	}
+
+	// Textures no material has named, a color texture with a matching name is encoded as normals
+	return HasNormalMapSuffix(path);
+}
+
+bool ModuleTextures::IsFormatSupported(TextureFormat format) const
+{
+	// Without a render device only the uncompressed formats are assumed to work
+	if (device == nullptr)
+		return format == TextureFormat::RGB8 || format == TextureFormat::RGBA8;
+
+	return device->IsFormatSupported(format);
+}
+
+bool ModuleTextures::Decode(const char* buffer, uint size, TextureData& texture) const
+{
+	bool upperLeft = false, swapRedBlue = false;
+
+	// TGA needs no DevIL at all, so the workers decode those at the same time
+	if (ImageDecoder::DecodeTGA(buffer, size, texture, upperLeft))
+	{
+		swapRedBlue = true;
+	}
+	else if (!DecodeDevIL(buffer, size, texture, upperLeft, swapRedBlue))
+	{
+		return false;
+	}
+
+	// GL wants the bottom row first, the V flip at import wants the top row first
+	const bool flip = upperLeft == flipImages;
+	texture.topDown = !flipImages;
+
+	PixelOps pixelOps(app->jobs);
+	if (swapRedBlue)
+		pixelOps.SwapRedBlue(texture);
+	if (flip)
+		pixelOps.FlipVertically(texture);
+	if (expandRGB)
+		pixelOps.ExpandRGBToRGBA(texture);
+	if (premultiplyAlpha)
+		pixelOps.PremultiplyAlpha(texture);
+
+	return true;
+}
+
+bool ModuleTextures::DecodeDevIL(const char* buffer, uint size, TextureData& texture, bool& upperLeft, bool& swapRedBlue) const
+{
+	ILuint imageId;
+	const ILubyte* imageData = nullptr;
+	{
+		// Only the DevIL calls are serialized, the copy of the pixels below runs with the lock released
+		std::lock_guard<std::mutex> lock(devilMutex);
+
+		ilGenImages(1, &imageId);
+		ilBindImage(imageId);
+
+		if (!ilLoadL(IL_TYPE_UNKNOWN, buffer, size))
+		{
 			ilDeleteImages(1, &imageId);
+			return false;
+		}
+
+		ILinfo ImageInfo;
+		iluGetImageInfo(&ImageInfo);
+		upperLeft = ImageInfo.Origin == IL_ORIGIN_UPPER_LEFT;
+
+		// 8 bit RGB(A) and BGR(A) are copied as they are, only the rarer layouts go through ilConvertImage()
+		const int type = ilGetInteger(IL_IMAGE_TYPE);
+		const int layout = ilGetInteger(IL_IMAGE_FORMAT);
+		if (type == IL_UNSIGNED_BYTE && (layout == IL_RGB || layout == IL_BGR))
+		{
+			texture.format = TextureFormat::RGB8;
+			swapRedBlue = layout == IL_BGR;
+		}
+		else if (type == IL_UNSIGNED_BYTE && (layout == IL_RGBA || layout == IL_BGRA))
+		{
+			texture.format = TextureFormat::RGBA8;
+			swapRedBlue = layout == IL_BGRA;
+		}
+		else if (ilGetInteger(IL_IMAGE_CHANNELS) == 3)
+		{
+			ilConvertImage(IL_RGB, IL_UNSIGNED_BYTE);
+			texture.format = TextureFormat::RGB8;
+		}
+		else
+		{
+			ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+			texture.format = TextureFormat::RGBA8;
+		}
+
+		texture.width = ilGetInteger(IL_IMAGE_WIDTH);
+		texture.height = ilGetInteger(IL_IMAGE_HEIGHT);
+		// Owned by the image, other threads binding their own images leave it in place until it is deleted
+		imageData = ilGetData();
+	}
+
+	texture.levels.resize(1);
+	TextureLevel& level = texture.levels[0];
+	level.width = texture.width;
+	level.height = texture.height;
+	level.data.assign(imageData, imageData + texture.width * texture.height * texture.GetBytesPerPixel());
+
+	std::lock_guard<std::mutex> lock(devilMutex);
+	ilDeleteImages(1, &imageId);
+	return true;
+}
+
+void ModuleTextures::BenchmarkPixelOps(uint size)
+{
+	TTLOG("+++ Benchmarking a %ux%u RGB image +++\n", size, size);
+
+	std::vector<uchar> image(size * size * 3);
+	for (uint i = 0; i < image.size(); ++i)
+		image[i] = static_cast<uchar>(i * 31);
+
+	PerfTimer timer;
+	{
+		std::lock_guard<std::mutex> lock(devilMutex);
+
+		ILuint imageId;
+		ilGenImages(1, &imageId);
+		ilBindImage(imageId);
+		ilTexImage(size, size, 1, 3, IL_RGB, IL_UNSIGNED_BYTE, image.data());
+
+		timer.Start();
+		iluFlipImage();
+		TTLOG("+++ DevIL iluFlipImage: %.2f ms +++\n", timer.ReadMs());
+
+		timer.Start();
+		ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+		TTLOG("+++ DevIL ilConvertImage RGB to RGBA: %.2f ms +++\n", timer.ReadMs());
+
+		ilDeleteImages(1, &imageId);
+	}
+
+	PixelOps pixelOps(app->jobs);
+	std::vector<uchar> expanded(size * size * 4);
+
+	timer.Start();
+	pixelOps.FlipRows(image.data(), size * 3, size);
+	TTLOG("+++ PixelOps flip: %.2f ms +++\n", timer.ReadMs());
 
-			glBindTexture(GL_TEXTURE_2D, 0);
+	timer.Start();
+	pixelOps.ExpandRows(image.data(), expanded.data(), size, size);
+	TTLOG("+++ PixelOps RGB to RGBA: %.2f ms +++\n", timer.ReadMs());
 
-			textures.insert(std::make_pair(path, TextureObject(path, static_cast<uint>(textureId), width, height)));
+	timer.Start();
+	pixelOps.SwapRedBlueRows(expanded.data(), size, size, 4);
+	TTLOG("+++ PixelOps swizzle: %.2f ms +++\n", timer.ReadMs());
 
-			delete[] data;
-			return textures[path];
+	timer.Start();
+	pixelOps.PremultiplyRows(expanded.data(), size, size);
+	TTLOG("+++ PixelOps premultiply: %.2f ms on %u threads +++\n", timer.ReadMs(), app->jobs->GetNumThreads());
+}
+
+bool ModuleTextures::Import(const std::string& path, TextureData& texture) const
+{
+	if (!DecodeAsset(path, texture))
+		return false;
+
+	Process(texture, IsNormalMap(path), 0);
+	return true;
+}
+
+bool ModuleTextures::DecodeAsset(const std::string& path, TextureData& texture) const
+{
+	char* buffer = nullptr;
+	const uint bytes = app->fileSystem->Load(path.c_str(), &buffer);
+	const bool ret = bytes != 0 && Decode(buffer, bytes, texture);
+	RELEASE_ARRAY(buffer);
+
+	return ret;
+}
+
+void ModuleTextures::Process(TextureData& texture, bool isNormalMap, uint maxMipLevels) const
+{
+	if (generateMips)
+	{
+		// Normal maps hold vectors, not colors, so they are never filtered in linear space
+		MipGenerator mipGenerator(static_cast<MipFilter>(mipFilter), gammaCorrectMips && !isNormalMap, app->jobs);
+		mipGenerator.Generate(texture);
+
+		if (maxMipLevels != 0 && texture.levels.size() > maxMipLevels)
+			texture.levels.resize(maxMipLevels);
+	}
+
+	if (!compressTextures)
+		return;
+
+	TextureCompressor compressor(static_cast<CompressionQuality>(compressionQuality), app->jobs);
+	const TextureFormat format = compressor.ChooseFormat(texture, isNormalMap);
+
+	// The headless cooker has no GL context to ask, it always writes the configured format
+	if (!app->headless && !IsFormatSupported(format))
+		return;
+
+	TextureData compressed;
+	if (compressor.Compress(texture, format, compressed))
+		texture = std::move(compressed);
+}
+
+void ModuleTextures::BuildAtlases(const std::string& owner, const std::vector<AssetId>& sources, uint pageSize, FlatHashMap<AssetId, AtlasRegion, AssetIdHash>& regions)
+{
+	// A new import may need fewer pages, or none at all
+	ReleaseAtlases(owner);
+
+	// The cooked versions may be block compressed, the atlas is built from the decoded assets
+	std::vector<std::string> paths;
+	for (AssetId id : sources)
+	{
+		if (const TextureHandle* texture = textures.Find(id))
+			paths.push_back((*texture)->name);
+	}
+
+	std::vector<TextureData> decoded(paths.size());
+	std::vector<uchar> decodedOk(paths.size(), 0);
+	app->jobs->ParallelFor(static_cast<uint>(paths.size()), [&](uint i) { decodedOk[i] = DecodeAsset(paths[i], decoded[i]) ? 1 : 0; });
+
+	// The padding counts, a texture as large as the page would not fit
+	TextureAtlas atlas(pageSize, ATLAS_PADDING);
+	std::vector<const TextureData*> packed;
+	std::vector<AssetId> packedIds;
+	for (uint i = 0; i < paths.size(); ++i)
+	{
+		if (decodedOk[i] && atlas.Fits(decoded[i].width, decoded[i].height))
+		{
+			packed.push_back(&decoded[i]);
+			packedIds.push_back(HashAssetPath(paths[i]));
 		}
-		delete[] data;
 	}
-	return textures["BLACK_FALLBACK"];
+
+	if (packed.size() < 2)
+		return;
+
+	std::vector<AtlasRect> rects;
+	const uint numPages = atlas.Pack(packed, rects);
+
+	std::vector<TextureHandle> pages(numPages);
+	for (uint page = 0; page < numPages; ++page)
+	{
+		TextureData pageData;
+		atlas.Compose(page, packed, rects, pageData);
+		Process(pageData, false, atlas.GetSafeMipLevels());
+
+		pages[page] = Insert(GetAtlasPageName(owner, page), Upload(pageData, false), pageData);
+	}
+
+	for (uint i = 0; i < packed.size(); ++i)
+	{
+		const AtlasRect& rect = rects[i];
+		if (rect.page == ATLAS_NO_PAGE)
+			continue;
+
+		const TextureHandle& page = pages[rect.page];
+
+		AtlasRegion region;
+		region.page = page;
+		region.offset[0] = static_cast<float>(rect.x) / page->width;
+		region.offset[1] = static_cast<float>(rect.y) / page->height;
+		region.scale[0] = static_cast<float>(rect.width) / page->width;
+		region.scale[1] = static_cast<float>(rect.height) / page->height;
+		regions.Insert(packedIds[i], region);
+	}
+
+	TTLOG("+++ Packed %u textures of %s into %u atlas pages +++\n", static_cast<uint>(packed.size()), owner.c_str(), numPages);
 }
 
-const TextureObject& ModuleTextures::Get(const std::string& path)
+void ModuleTextures::ReleaseAtlases(const std::string& owner)
 {
-	const auto textureId = textures.find(path);
-	if (textureId != textures.end())
-		return (*textureId).second;
+	for (uint page = 0;; ++page)
+	{
+		const AssetId id = HashAssetPath(GetAtlasPageName(owner, page));
+		const TextureHandle* found = textures.Find(id);
+		if (found == nullptr)
+			break;
 
-	TTLOG("### Error getting texture. Not found ###\n");
-	return textures["BLACK_FALLBACK"];
+		retiredTextures.push_back(*found);
+		textures.Erase(id);
+	}
 }
 
-bool ModuleTextures::Find(const std::string& path) const
+bool ModuleTextures::SaveToLibrary(const std::string& path, const TextureData& texture) const
 {
-	auto textureId = textures.find(path);
-	if (textureId != textures.end())
-		return true;
+	char* buffer = nullptr;
+	const std::string libraryPath = GetLibraryPath(path);
+	const uint bytes = texture.Serialize(&buffer);
+	const bool ret = app->fileSystem->Save(libraryPath.c_str(), buffer, bytes) == bytes;
+	RELEASE_ARRAY(buffer);
 
-	return false;
+	return ret;
+}
+
+bool ModuleTextures::Read(const std::string& path, TextureData& texture) const
+{
+	const std::string libraryPath = GetLibraryPath(path);
+	if (IsCookedUpToDate(path))
+	{
+		char* buffer = nullptr;
+		const uint bytes = app->fileSystem->Load(libraryPath.c_str(), &buffer);
+		const bool cooked = texture.Deserialize(buffer, bytes) && IsCookedUsable(path, texture);
+		RELEASE_ARRAY(buffer);
+
+		if (cooked)
+			return true;
+	}
+
+	// Cook on first use so the next launch only reads the Library
+	if (!Import(path, texture))
+		return false;
+
+	if (!SaveToLibrary(path, texture))
+		TTLOG("### Error saving cooked texture %s ###\n", libraryPath.c_str());
+
+	return true;
+}
+
+bool ModuleTextures::ReadLevels(const std::string& path, uint mip, TextureData& texture) const
+{
+	const std::string libraryPath = GetLibraryPath(path);
+	if (IsCookedUpToDate(path))
+	{
+		char* buffer = nullptr;
+		uint bytes = app->fileSystem->LoadRange(libraryPath.c_str(), 0, TextureData::GetMaxHeaderSize(), &buffer);
+		std::vector<TextureLevelRange> ranges;
+		const bool cooked = texture.DeserializeHeader(buffer, bytes, ranges) && IsCookedUsable(path, texture);
+		RELEASE_ARRAY(buffer);
+
+		if (cooked)
+		{
+			// The levels are stored from the most detailed one, everything from the mip on is one contiguous read
+			const uint first = MIN(mip, static_cast<uint>(ranges.size()) - 1);
+			const uint offset = ranges[first].offset;
+			const uint size = ranges.back().offset + ranges.back().size - offset;
+
+			bytes = app->fileSystem->LoadRange(libraryPath.c_str(), offset, size, &buffer);
+			const bool read = texture.DeserializeLevels(buffer, bytes, first, ranges);
+			RELEASE_ARRAY(buffer);
+
+			if (read)
+				return true;
+		}
+	}
+
+	// Stale or missing, cook it again and keep the levels that were asked for
+	if (!Read(path, texture))
+		return false;
+
+	texture.DropLevels(mip);
+	return true;
+}
+
+bool ModuleTextures::IsCookedUpToDate(const std::string& path) const
+{
+	const std::string libraryPath = GetLibraryPath(path);
+	return app->fileSystem->Exists(libraryPath) && app->fileSystem->GetLastModTime(libraryPath.c_str()) >= app->fileSystem->GetLastModTime(path.c_str());
+}
+
+bool ModuleTextures::IsCookedUsable(const std::string& path, const TextureData& texture) const
+{
+	// Color textures cooked as normals before a material said otherwise are cooked again
+	return IsFormatSupported(texture.format) && texture.topDown == !flipImages && (texture.format != TextureFormat::BC5 || IsNormalMap(path));
+}
+
+uint ModuleTextures::Upload(const TextureData& texture, bool useMipMaps) const
+{
+	return device->CreateTexture(texture, useMipMaps);
+}
+
+TextureHandle ModuleTextures::Insert(const std::string& path, uint textureId, const TextureData& texture)
+{
+	TextureHandle handle = std::make_shared<TextureObject>(path, textureId, texture.width, texture.height);
+	handle->size = texture.GetSizeInBytes();
+	handle->lastUsedFrame = frame;
+
+	residentBytes += handle->size;
+	textures.Insert(handle->assetId, handle);
+
+	return handle;
+}
+
+TextureHandle ModuleTextures::Add(const std::string& path, TextureData& texture, bool useMipMaps)
+{
+	const uint width = texture.width, height = texture.height;
+	const uint numLevels = static_cast<uint>(texture.levels.size());
+	const uint64 baseSize = texture.levels[0].data.size();
+
+	uint residentMip = 0;
+	const bool streamable = streamTextures && numLevels > 1;
+	if (streamable)
+	{
+		// The detail comes later, once something shows the texture big enough to need it
+		residentMip = TextureStreamer(streamingMinSize).GetMinimumMip(width, height, numLevels);
+		texture.DropLevels(residentMip);
+	}
+
+	TextureHandle handle = Insert(path, Upload(texture, useMipMaps), texture);
+	handle->width = width;
+	handle->height = height;
+	handle->streamable = streamable;
+	handle->numLevels = numLevels;
+	handle->residentMip = residentMip;
+	handle->baseSize = baseSize;
+
+	return handle;
+}
+
+void ModuleTextures::UpdateStreaming()
+{
+	for (uint uploads = 0; uploads < MAX_STREAMED_UPLOADS && pendingStreams > 0; ++uploads)
+	{
+		DecodeQueue::Entry entry;
+		{
+			std::lock_guard<std::mutex> lock(streamQueue->mutex);
+			if (streamQueue->decoded.empty())
+				break;
+
+			entry = std::move(streamQueue->decoded.front());
+			streamQueue->decoded.pop();
+		}
+
+		--pendingStreams;
+		if (entry.success)
+			ApplyStreamed(entry.texture, entry.path);
+		else
+			TTLOG("### Error streaming texture %s ###\n", entry.path.c_str());
+	}
+
+	if (frame % STREAMING_INTERVAL != 0)
+		return;
+
+	std::vector<TextureHandle> streamed;
+	std::vector<StreamingTexture> states;
+	uint64 fixedBytes = 0;
+
+	for (const auto& t : textures)
+	{
+		TextureObject& texture = *t.second;
+		if (!texture.streamable)
+		{
+			fixedBytes += texture.size;
+			continue;
+		}
+
+		StreamingTexture state;
+		state.width = texture.width;
+		state.height = texture.height;
+		state.numLevels = texture.numLevels;
+		state.baseSize = texture.baseSize;
+		state.screenSize = texture.screenSize;
+		state.residentMip = texture.residentMip;
+
+		streamed.push_back(t.second);
+		states.push_back(state);
+		texture.screenSize = 0.f;
+	}
+
+	const uint64 budget = static_cast<uint64>(budgetMB * 1024.f * 1024.f);
+	TextureStreamer(streamingMinSize).Plan(states, budget > fixedBytes ? budget - fixedBytes : 0);
+
+	for (uint i = 0; i < streamed.size(); ++i)
+	{
+		if (!streamed[i]->streaming && states[i].targetMip != streamed[i]->residentMip)
+			RequestMip(streamed[i], states[i].targetMip);
+	}
+}
+
+void ModuleTextures::RequestMip(const TextureHandle& texture, uint mip)
+{
+	texture->streaming = true;
+	++pendingStreams;
+
+	std::shared_ptr<DecodeQueue> queue = streamQueue;
+	const std::string path = texture->name;
+	app->jobs->Schedule([this, queue, path, mip]()
+	{
+		DecodeQueue::Entry entry;
+		entry.path = path;
+		entry.success = ReadLevels(path, mip, entry.texture);
+
+		{
+			std::lock_guard<std::mutex> lock(queue->mutex);
+			queue->decoded.push(std::move(entry));
+		}
+		queue->ready.notify_one();
+	});
+}
+
+void ModuleTextures::ApplyStreamed(TextureData& texture, const std::string& path)
+{
+	// Evicted or reloaded while the read was in flight
+	const TextureHandle* found = textures.Find(HashAssetPath(path));
+	if (found == nullptr || !(*found)->streaming)
+		return;
+
+	TextureObject& object = **found;
+	object.streaming = false;
+
+	// The Library may have been cooked again with a different chain
+	if (texture.levels.size() > object.numLevels)
+		return;
+
+	device->DeleteTexture(object.id);
+	object.id = Upload(texture, false);
+	object.residentMip = object.numLevels - static_cast<uint>(texture.levels.size());
+
+	residentBytes -= object.size;
+	object.size = texture.GetSizeInBytes();
+	residentBytes += object.size;
+}
+
+void ModuleTextures::EvictUnused(uint64 targetBytes)
+{
+	std::vector<TextureHandle> unused;
+	for (const auto& t : textures)
+	{
+		if (!t.second->persistent && t.second.use_count() == 1)
+			unused.push_back(t.second);
+	}
+
+	std::sort(unused.begin(), unused.end(), [](const TextureHandle& a, const TextureHandle& b) { return a->lastUsedFrame < b->lastUsedFrame; });
+
+	uint evicted = 0;
+	for (uint i = 0; i < unused.size() && residentBytes > targetBytes; ++i)
+	{
+		device->DeleteTexture(unused[i]->id);
+		residentBytes -= unused[i]->size;
+		textures.Erase(unused[i]->assetId);
+		++evicted;
+	}
+
+	if (evicted > 0)
+		TTLOG("+++ Evicted %u unused textures, %.2f MB resident +++\n", evicted, BYTES_TO_MB(residentBytes));
+}
+
+TextureHandle ModuleTextures::Get(AssetId id)
+{
+	if (const TextureHandle* texture = textures.Find(id))
+		return *texture;
+
+	TTLOG("### Error getting texture. Not found ###\n");
+	const TextureHandle* fallback = textures.Find(HashAssetPath("BLACK_FALLBACK"));
+	return fallback != nullptr ? *fallback : TextureHandle();
+}
+
+bool ModuleTextures::Find(AssetId id) const
+{
+	return textures.Contains(id);
 }
\ No newline at end of file
@@ -2,20 +2,67 @@
 #define __MODULE_TEXTURES_H__
 
 #include "Module.h"
+#include "AssetId.h"
+#include "FlatHashMap.h"
 
-#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
+// Texels around every packed texture, a texture needs its size plus twice this to fit on an atlas page
+#define ATLAS_PADDING 4
 
 
+
+struct TextureData;
+class RenderDevice;
+struct DecodeQueue;
+enum class TextureFormat : uint;
+
 struct TextureObject
 {
 	TextureObject() = default;
 
-	TextureObject(std::string name, uint id, uint width, uint height) : name(name), id(id), width(width), height(height) {};
+	TextureObject(std::string name, uint id, uint width, uint height) : name(name), assetId(HashAssetPath(name)), id(id), width(width), height(height) {};
 	std::string name;
+	AssetId assetId = INVALID_ASSET_ID;
 	uint id = 0;
+	// Full resolution, even when only the low mips are resident
 	uint width = 0, height = 0;
+
+	// Bytes of every level in VRAM
+	uint64 size = 0;
+	// Frame the texture was last bound for drawing
+	uint64 lastUsedFrame = 0;
+	// Fallbacks are never evicted
+	bool persistent = false;
+
+	// ----- Mip streaming -----
+
+	// Cooked textures with a mip chain can stream their detail in and out
+	bool streamable = false;
+	// A read of other levels is in flight
+	bool streaming = false;
+	uint numLevels = 1;
+	// Most detailed level resident in VRAM
+	uint residentMip = 0;
+	// Bytes of the full resolution level
+	uint64 baseSize = 0;
+	// Largest projected size in pixels since the last streaming pass
+	float screenSize = 0.f;
+	// -------------------------
+};
+
+// Refcounted texture, the cache holds one reference so a texture nobody else holds can be evicted
+typedef std::shared_ptr<TextureObject> TextureHandle;
+
+// Where a packed texture ended up, uv' = offset + uv * scale
+struct AtlasRegion
+{
+	TextureHandle page;
+	float offset[2] = { 0.f, 0.f };
+	float scale[2] = { 1.f, 1.f };
 };
 
 
@@ -30,25 +77,138 @@ public:
 	bool Init() override;
 	// Load the Texture Loader
 	bool Start() override;
+	// Keep the resident textures under the budget
+	UpdateStatus PreUpdate(float dt) override;
 	// Called before quitting
 	bool CleanUp() override;
 
-
-	// Load new texture from file path
-	const TextureObject& Load(const std::string& path, bool useMipMaps = false);
-	// Get texture from path
-	const TextureObject& Get(const std::string& path);
-	// Find texture in path
-	bool Find(const std::string& path) const;
+	// Draw the texture import options
+	void OnGui() override;
+	// Load the texture import options
+	void OnLoad(const JSONReader& reader) override;
+	// Save the texture import options
+	void OnSave(JSONWriter& writer) const override;
+
+
+	// Load new texture from file path, the cooked Library version is used when it is up to date
+	TextureHandle Load(const std::string& path, bool useMipMaps = false);
+	// Load many textures at once, decoded on the workers and uploaded on this thread as they arrive
+	void LoadBatch(const std::vector<std::string>& paths, bool useMipMaps = false);
+	// Decode an asset into the Library texture format, does not need a GL context
+	bool Cook(const std::string& path, std::string& libraryPath);
+	// Pack loaded textures into atlas pages named after the owner asset, regions gets the placement of every texture that was packed
+	// Pages a previous build of the same owner left are replaced
+	void BuildAtlases(const std::string& owner, const std::vector<AssetId>& sources, uint pageSize, FlatHashMap<AssetId, AtlasRegion, AssetIdHash>& regions);
+	// Get texture from its asset id
+	TextureHandle Get(AssetId id);
+	inline TextureHandle Get(const std::string& path) { return Get(HashAssetPath(path)); }
+	// Find texture by its asset id
+	bool Find(AssetId id) const;
+	inline bool Find(const std::string& path) const { return Find(HashAssetPath(path)); }
+
+	// What a material samples a texture as, it takes precedence over the file name suffix, safe from any thread
+	void SetNormalMapHint(AssetId id, bool isNormalMap);
+
+	// Library file that stores the cooked version of an asset
+	std::string GetLibraryPath(const std::string& path) const;
+	// Whether the render device can sample a texture format
+	bool IsFormatSupported(TextureFormat format) const;
+	// Time the DevIL flip and conversion against PixelOps on a synthetic image, results go to the console
+	void BenchmarkPixelOps(uint size);
+
+	// Delete the least recently used textures that nothing references until the resident size fits in the given bytes
+	void EvictUnused(uint64 targetBytes);
+	inline uint64 GetResidentBytes() const { return residentBytes; }
+	inline uint64 GetFrame() const { return frame; }
+
+private:
+
+	// Whether a texture holds normals, from the material hints or else from its file name
+	bool IsNormalMap(const std::string& path) const;
+	// Decode an image file from memory, no GL calls
+	bool Decode(const char* buffer, uint size, TextureData& texture) const;
+	// Decode with DevIL, rows in the order it stores them and the channel order of the file
+	bool DecodeDevIL(const char* buffer, uint size, TextureData& texture, bool& upperLeft, bool& swapRedBlue) const;
+	// Decode an asset and block compress it with the current import options
+	bool Import(const std::string& path, TextureData& texture) const;
+	// Load and decode an asset, uncompressed with a single level
+	bool DecodeAsset(const std::string& path, TextureData& texture) const;
+	// Mips and block compression with the current import options, 0 keeps every mip level
+	void Process(TextureData& texture, bool isNormalMap, uint maxMipLevels) const;
+	// Whether the Library has a cooked texture of an asset that is newer than it
+	bool IsCookedUpToDate(const std::string& path) const;
+	// Whether a cooked texture matches the device and the current import options
+	bool IsCookedUsable(const std::string& path, const TextureData& texture) const;
+	// Write the cooked texture of an asset to the Library
+	bool SaveToLibrary(const std::string& path, const TextureData& texture) const;
+	// Read the cooked texture if it is newer than the asset, otherwise import the asset and cook it
+	bool Read(const std::string& path, TextureData& texture) const;
+	// Read the levels from a mip down, seeking past the detail above it when the cooked texture is up to date
+	bool ReadLevels(const std::string& path, uint mip, TextureData& texture) const;
+	// Create a texture on the render device from CPU side data
+	uint Upload(const TextureData& texture, bool useMipMaps) const;
+	// Take the atlas pages of an asset out of the cache, they are deleted once nothing draws with them
+	void ReleaseAtlases(const std::string& owner);
+	// Add an uploaded texture to the cache
+	TextureHandle Insert(const std::string& path, uint textureId, const TextureData& texture);
+	// Upload a decoded asset and add it to the cache, with streaming only its low mips are uploaded
+	TextureHandle Add(const std::string& path, TextureData& texture, bool useMipMaps);
+
+	// Apply the finished reads and plan which mips every texture needs
+	void UpdateStreaming();
+	// Read the levels from a mip down in the background
+	void RequestMip(const TextureHandle& texture, uint mip);
+	// Replace the GL texture with the levels that were read
+	void ApplyStreamed(TextureData& texture, const std::string& path);
 
 public:
 
 	// ----- Texture Variables -----
 	
 	uint32 whiteFallback = 0, blackFallback = 0, checkers = 0;
-	std::map<const std::string, TextureObject> textures;
+	FlatHashMap<AssetId, TextureHandle, AssetIdHash> textures;
+	// VRAM the cache may keep before unreferenced textures are evicted
+	float budgetMB = 512.f;
+	// Start with the low mips and stream the rest by on-screen size
+	bool streamTextures = true;
+	// Largest dimension of the levels that are always resident
+	int streamingMinSize = 64;
 	// -----------------------------
 
+	// ----- Import Options -----
+
+	bool compressTextures = true;
+	// CompressionQuality preset
+	int compressionQuality = 1;
+	bool generateMips = true;
+	// MipFilter used for every level
+	int mipFilter = 1;
+	bool gammaCorrectMips = true;
+	bool expandRGB = true;
+	bool premultiplyAlpha = false;
+	// Off keeps images in file order and flips the V coordinates of imported models instead
+	bool flipImages = true;
+	int benchmarkSize = 8192;
+	// --------------------------
+
+private:
+
+	// Set on Start, the cooker has none
+	RenderDevice* device = nullptr;
+	uint64 residentBytes = 0;
+	uint64 frame = 0;
+
+	// Out of the cache but still held by older objects, their VRAM counts until they are deleted
+	std::vector<TextureHandle> retiredTextures;
+
+	// Written by model imports, read by texture cooks on the workers
+	FlatHashMap<AssetId, bool, AssetIdHash> normalMapHints;
+	mutable std::mutex hintMutex;
+
+	// Reads of streamed levels waiting for the GL thread
+	std::shared_ptr<DecodeQueue> streamQueue;
+	uint pendingStreams = 0;
+
 };
 
 #endif // !__MODULE_TEXTURES_H__
\ No newline at end of file
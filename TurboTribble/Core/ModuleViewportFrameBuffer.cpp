@@ -2,14 +2,15 @@
 
 #include "Application.h"
 #include "ModuleWindow.h"
+#include "ModuleRenderer3D.h"
+#include "RenderDevice.h"
 
 #include "Globals.h"
 
 #include <string>
+#include <math.h>
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_internal.h"
-#include "glew.h"
-#include <gl/GL.h>
 
 
 
@@ -29,48 +30,58 @@ bool ModuleViewportFrameBuffer::Init()
 
 bool ModuleViewportFrameBuffer::Start()
 {
-	glGenFramebuffers(1, &frameBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, app->window->width, app->window->height ,0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	device = app->renderer3D->GetDevice();
+	capture.Init(device);
 
-	glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture
-
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
-
-	// Render Buffers
-	glGenRenderbuffers(1, &renderBufferoutput);
-	glBindRenderbuffer(GL_RENDERBUFFER, renderBufferoutput);
-
-	// Bind tex data with render buffers
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, app->window->width, app->window->height);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderBufferoutput);
-
-	// After binding tex data, we must unbind renderbuffer and framebuffer not usefull anymore
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// The editor reports the real panel size once it drew the panel
+	SetPanelSize(app->window->width, app->window->height);
+	ResizeTargets();
 
+	if (app->captureDirectory != nullptr)
+		capture.StartSequence(app->captureDirectory);
 
 	return true;
 }
 
 UpdateStatus ModuleViewportFrameBuffer::PreUpdate(float dt)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	UpdateRenderScale(dt);
+
+	// A splitter being dragged changes the size every frame, wait for it to settle before reallocating
+	if (panelWidth != targetWidth || panelHeight != targetHeight)
+	{
+		if (settledFrames >= RESIZE_SETTLE_FRAMES)
+			ResizeTargets();
+		else
+			++settledFrames;
+	}
+
+	renderWidth = MAX(1u, static_cast<uint>(targetWidth * renderScale + 0.5f));
+	renderHeight = MAX(1u, static_cast<uint>(targetHeight * renderScale + 0.5f));
+
+	device->BindFramebuffer(frameBuffer);
+	device->SetViewport(0, 0, renderWidth, renderHeight);
+	device->Clear(0.3f, 0.3f, 0.3f, 1.0f);
 	
 	return UpdateStatus::UPDATE_CONTINUE;
 }
 
 UpdateStatus ModuleViewportFrameBuffer::PostUpdate(float dt)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (IsScaled())
+	{
+		if (displayFrameBuffer == 0)
+			displayFrameBuffer = device->CreateFramebuffer(targetWidth, targetHeight, displayTexture, nullptr);
+
+		RenderProfiler& profiler = app->renderer3D->GetProfiler();
+		profiler.BeginPass("Upscale");
+		device->BlitFramebuffer(frameBuffer, renderWidth, renderHeight, displayFrameBuffer, targetWidth, targetHeight);
+		profiler.EndPass();
+	}
+
+	capture.Update(IsScaled() ? displayFrameBuffer : frameBuffer, targetWidth, targetHeight);
+
+	device->BindFramebuffer(0);
 	
 	return UpdateStatus::UPDATE_CONTINUE;
 }
@@ -79,9 +90,99 @@ bool ModuleViewportFrameBuffer::CleanUp()
 {
 	TTLOG("+++++ Quitting Viewport Frame Buffer Module +++++\n");
 
-	texture ? glDeleteTextures(1, &texture) : 0;
-	frameBuffer ? glDeleteFramebuffers(1, &frameBuffer) : 0;
-	renderBufferoutput ? glDeleteRenderbuffers(1, &renderBufferoutput): 0;
+	if (device != nullptr)
+	{
+		capture.CleanUp();
+		device->DeleteFramebuffer(frameBuffer, texture, renderBufferoutput);
+		device->DeleteFramebuffer(displayFrameBuffer, displayTexture, 0);
+	}
 
 	return true;
+}
+
+void ModuleViewportFrameBuffer::SetPanelSize(uint width, uint height)
+{
+	width = MAX(1u, width);
+	height = MAX(1u, height);
+	if (width != panelWidth || height != panelHeight)
+		settledFrames = 0;
+
+	panelWidth = width;
+	panelHeight = height;
+}
+
+void ModuleViewportFrameBuffer::OnGui()
+{
+	if (ImGui::CollapsingHeader("Viewport"))
+	{
+		ImGui::Text("Panel: %u x %u", targetWidth, targetHeight);
+		ImGui::Text("Rendering: %u x %u (%.0f%%)", renderWidth, renderHeight, renderScale * 100.f);
+
+		ImGui::Checkbox("Dynamic Resolution", &dynamicResolution);
+		if (dynamicResolution)
+		{
+			ImGui::SliderFloat("Target Frame Rate", &targetFrameRate, 15.f, 240.f, "%.0f");
+			ImGui::SliderFloat("Min Render Scale", &minRenderScale, MIN_RENDER_SCALE, 1.f);
+			ImGui::Text("Smoothed frame time: %.2f ms", frameMs);
+		}
+		else
+		{
+			ImGui::SliderFloat("Render Scale", &renderScale, MIN_RENDER_SCALE, 1.f);
+		}
+
+		ImGui::Separator();
+		capture.OnGui();
+	}
+}
+
+void ModuleViewportFrameBuffer::OnLoad(const JSONReader& reader)
+{
+	if (reader.HasMember("viewport"))
+	{
+		const auto& config = reader["viewport"];
+		LOAD_JSON_FLOAT(renderScale)
+		LOAD_JSON_BOOL(dynamicResolution)
+		LOAD_JSON_FLOAT(targetFrameRate)
+		LOAD_JSON_FLOAT(minRenderScale)
+	}
+}
+
+void ModuleViewportFrameBuffer::OnSave(JSONWriter& writer) const
+{
+	writer.String("viewport");
+	writer.StartObject();
+	SAVE_JSON_FLOAT(renderScale)
+	SAVE_JSON_BOOL(dynamicResolution)
+	SAVE_JSON_FLOAT(targetFrameRate)
+	SAVE_JSON_FLOAT(minRenderScale)
+	writer.EndObject();
+}
+
+void ModuleViewportFrameBuffer::ResizeTargets()
+{
+	device->DeleteFramebuffer(frameBuffer, texture, renderBufferoutput);
+	device->DeleteFramebuffer(displayFrameBuffer, displayTexture, 0);
+	displayFrameBuffer = displayTexture = 0;
+
+	targetWidth = panelWidth;
+	targetHeight = panelHeight;
+	frameBuffer = device->CreateFramebuffer(targetWidth, targetHeight, texture, &renderBufferoutput);
+}
+
+void ModuleViewportFrameBuffer::UpdateRenderScale(float dt)
+{
+	if (!dynamicResolution)
+		return;
+
+	const float ms = dt * 1000.f;
+	frameMs = frameMs == 0.f ? ms : frameMs + (ms - frameMs) * DYNAMIC_SCALE_RESPONSE;
+
+	const float load = frameMs * targetFrameRate / 1000.f;
+	if (load > 1.f - DYNAMIC_SCALE_TOLERANCE && load < 1.f + DYNAMIC_SCALE_TOLERANCE)
+		return;
+
+	// Fill cost follows the pixel count, which goes with the square of the scale
+	const float ideal = renderScale / sqrtf(MAX(load, 0.01f));
+	renderScale += (ideal - renderScale) * DYNAMIC_SCALE_RESPONSE;
+	renderScale = MAX(MIN(minRenderScale, 1.f), MIN(renderScale, 1.f));
 }
\ No newline at end of file
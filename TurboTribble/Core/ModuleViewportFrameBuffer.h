@@ -5,10 +5,23 @@
 
 #include "Globals.h"
 
+#include "FrameCapture.h"
+
 #include <string>
 
+// Lowest render scale either mode can reach
+#define MIN_RENDER_SCALE 0.25f
+// Share of the way to the ideal scale covered every frame, low values keep the scale from oscillating
+#define DYNAMIC_SCALE_RESPONSE 0.1f
+// Frame times this close to the target leave the scale alone
+#define DYNAMIC_SCALE_TOLERANCE 0.05f
+// Frames the panel size has to hold before the targets are recreated at it
+#define RESIZE_SETTLE_FRAMES 1
+
 
 
+class RenderDevice;
+
 class ModuleViewportFrameBuffer : public Module
 {
 public:
@@ -20,15 +33,40 @@ public:
 
 	// Init module
 	bool Init() override;
-	// Initalize the Viewport Frame Buffer
+	// Initalize the Viewport Frame Buffer on the render device
 	bool Start() override;
 	// Clears buffers
 	UpdateStatus PreUpdate(float dt) override;
-	// Binds buffers
+	// Upscales the scene when it was rendered below panel size, queues the frame grabs and binds the window back
 	UpdateStatus PostUpdate(float dt) override;
 	// Called before quitting
 	bool CleanUp();
 
+	// Size of the scene panel in pixels, the targets follow it once it stops changing
+	void SetPanelSize(uint width, uint height);
+	// Scene at panel size, ready to show
+	inline uint GetDisplayTexture() const { return IsScaled() ? displayTexture : texture; }
+	inline bool IsScaled() const { return renderWidth != targetWidth || renderHeight != targetHeight; }
+	// Height the scene is rendered at this frame, the panel height times the render scale
+	inline uint GetRenderHeight() const { return renderHeight; }
+	// Grabs of the scene at panel size
+	inline FrameCapture& GetCapture() { return capture; }
+
+	// Draws Viewport Info
+	void OnGui() override;
+
+	// Load Viewport Info
+	void OnLoad(const JSONReader& reader) override;
+	// Save Viewport Info
+	void OnSave(JSONWriter& writer) const override;
+
+private:
+
+	// Recreate the targets at panel size, the scaled frames render into a corner of them
+	void ResizeTargets();
+	// Move the scale towards the one that hits the target frame rate
+	void UpdateRenderScale(float dt);
+
 public:
 
 	// ----- Viewport Fram Buffer Variables -----
@@ -37,8 +75,33 @@ public:
 	uint renderBufferoutput = 0;
 	uint texture = 0;
 	bool showViewportWindow = true;
+
+	// Share of the panel width and height that is rendered
+	float renderScale = 1.f;
+	bool dynamicResolution = false;
+	float targetFrameRate = 60.f;
+	float minRenderScale = 0.5f;
 	// ------------------------------------------
 
+private:
+
+	RenderDevice* device = nullptr;
+
+	uint panelWidth = 0, panelHeight = 0;
+	// Frames the panel size has not changed for
+	uint settledFrames = 0;
+	uint targetWidth = 0, targetHeight = 0;
+	uint renderWidth = 0, renderHeight = 0;
+
+	// Upscaled frames, only created once the scale goes below 1
+	uint displayFrameBuffer = 0;
+	uint displayTexture = 0;
+
+	// Smoothed frame time the dynamic scale reacts to
+	float frameMs = 0.f;
+
+	FrameCapture capture;
+
 };
 
 #endif // !__MODULE_VIEWPORT_FRAME_BUFFER_H__
\ No newline at end of file
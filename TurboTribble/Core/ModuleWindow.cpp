@@ -44,15 +44,16 @@ bool ModuleWindow::Init()
 		// Create window
 		width = SCREEN_WIDTH * SCREEN_SIZE;
 		height = SCREEN_HEIGHT * SCREEN_SIZE;
-		flags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
+		// The null renderer never draws, its window only feeds input and the editor
+		flags = app->nullRender ? SDL_WINDOW_HIDDEN : SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
 
-		// Use OpenGL 2.1
-		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		// Use OpenGL 3.3, the renderer draws with GLSL 3.30 shaders
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, CORE_PROFILE ? SDL_GL_CONTEXT_PROFILE_CORE : SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
 		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 		SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 
 		if(WIN_FULLSCREEN == true)
 		{
@@ -91,7 +92,8 @@ bool ModuleWindow::Init()
 			// Get window surface
 			screenSurface = SDL_GetWindowSurface(window);
 
-			context = SDL_GL_CreateContext(window);
+			if (!app->nullRender)
+				context = SDL_GL_CreateContext(window);
 		}
 	}
 
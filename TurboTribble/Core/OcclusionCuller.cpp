@@ -0,0 +1,225 @@
+#include "OcclusionCuller.h"
+
+#include "JobSystem.h"
+#include "CpuInfo.h"
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+
+
+OcclusionCuller::OcclusionCuller(bool allowAVX2) : hasAVX2(allowAVX2 && HasAVX2())
+{}
+
+void OcclusionCuller::Init(JobSystem* jobs)
+{
+	this->jobs = jobs;
+	depth.assign(OCCLUSION_WIDTH * OCCLUSION_HEIGHT, 0.f);
+}
+
+void OcclusionCuller::Begin(const float4x4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	occluders.clear();
+	numTriangles = 0;
+	std::fill(depth.begin(), depth.end(), 0.f);
+}
+
+void OcclusionCuller::AddOccluder(const float4x4& transform, const float3* vertices, uint numVertices, const uint* indices, uint numIndices)
+{
+	Occluder occluder;
+	occluder.transform = transform;
+	occluder.vertices = vertices;
+	occluder.numVertices = numVertices;
+	occluder.indices = indices;
+	occluder.numIndices = numIndices;
+	occluder.firstTriangle = 0;
+	occluders.push_back(occluder);
+}
+
+void OcclusionCuller::Rasterize()
+{
+	uint total = 0;
+	for (Occluder& occluder : occluders)
+	{
+		occluder.firstTriangle = total;
+		total += occluder.numIndices / 3;
+	}
+
+	triangles.resize(total);
+	validTriangles.assign(total, 0);
+
+	// Every occluder writes its own range of triangles
+	auto setup = [this](uint index)
+	{
+		const Occluder& occluder = occluders[index];
+		const float4x4 toClip = viewProjection * occluder.transform;
+
+		std::vector<float4> clip(occluder.numVertices);
+		for (uint i = 0; i < occluder.numVertices; ++i)
+			clip[i] = toClip * float4(occluder.vertices[i], 1.f);
+
+		for (uint i = 0; i + 2 < occluder.numIndices; i += 3)
+		{
+			const uint slot = occluder.firstTriangle + i / 3;
+			validTriangles[slot] = Setup(clip[occluder.indices[i]], clip[occluder.indices[i + 1]], clip[occluder.indices[i + 2]], triangles[slot]) ? 1 : 0;
+		}
+	};
+
+	const uint numOccluders = static_cast<uint>(occluders.size());
+	const uint numBands = (OCCLUSION_HEIGHT + OCCLUSION_BAND_ROWS - 1) / OCCLUSION_BAND_ROWS;
+	auto band = [this](uint index)
+	{
+		const uint first = index * OCCLUSION_BAND_ROWS;
+		const uint last = MIN(first + OCCLUSION_BAND_ROWS, static_cast<uint>(OCCLUSION_HEIGHT));
+		hasAVX2 ? RasterizeBandAVX2(first, last) : RasterizeBand(first, last);
+	};
+
+	if (jobs != nullptr)
+	{
+		jobs->ParallelFor(numOccluders, setup);
+		jobs->ParallelFor(numBands, band);
+	}
+	else
+	{
+		for (uint i = 0; i < numOccluders; ++i)
+			setup(i);
+		for (uint i = 0; i < numBands; ++i)
+			band(i);
+	}
+
+	numTriangles = 0;
+	for (uchar valid : validTriangles)
+		numTriangles += valid;
+}
+
+bool OcclusionCuller::IsVisible(const AABB& box) const
+{
+	if (occluders.empty())
+		return true;
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = 0.f;
+	for (int i = 0; i < 8; ++i)
+	{
+		const float4 clip = viewProjection * float4(box.CornerPoint(i), 1.f);
+
+		// Boxes around the camera can not be judged by their corners
+		if (clip.w < OCCLUSION_MIN_W)
+			return true;
+
+		const float invW = 1.f / clip.w;
+		const float x = (clip.x * invW * .5f + .5f) * OCCLUSION_WIDTH;
+		const float y = (clip.y * invW * .5f + .5f) * OCCLUSION_HEIGHT;
+		minX = MIN(minX, x);
+		maxX = MAX(maxX, x);
+		minY = MIN(minY, y);
+		maxY = MAX(maxY, y);
+		nearest = MAX(nearest, invW);
+	}
+
+	// Every pixel the rectangle touches, whole or not
+	const int firstX = MAX(0, static_cast<int>(floorf(minX)));
+	const int lastX = MIN(OCCLUSION_WIDTH - 1, static_cast<int>(floorf(maxX)));
+	const int firstY = MAX(0, static_cast<int>(floorf(minY)));
+	const int lastY = MIN(OCCLUSION_HEIGHT - 1, static_cast<int>(floorf(maxY)));
+
+	// Off screen boxes are left to the frustum
+	if (firstX > lastX || firstY > lastY)
+		return true;
+
+	if (hasAVX2)
+		return IsRectVisibleAVX2(firstX, lastX, firstY, lastY, nearest);
+
+	for (int y = firstY; y <= lastY; ++y)
+	{
+		const float* row = &depth[y * OCCLUSION_WIDTH];
+		for (int x = firstX; x <= lastX; ++x)
+		{
+			if (row[x] <= nearest)
+				return true;
+		}
+	}
+	return false;
+}
+
+bool OcclusionCuller::Setup(const float4& a, const float4& b, const float4& c, Triangle& triangle)
+{
+	// Clipping is not worth it, an occluder that loses a triangle only hides less
+	if (a.w < OCCLUSION_MIN_W || b.w < OCCLUSION_MIN_W || c.w < OCCLUSION_MIN_W)
+		return false;
+
+	float x[3], y[3], z[3];
+	const float4* vertices[3] = { &a, &b, &c };
+	for (int i = 0; i < 3; ++i)
+	{
+		z[i] = 1.f / vertices[i]->w;
+		x[i] = (vertices[i]->x * z[i] * .5f + .5f) * OCCLUSION_WIDTH;
+		y[i] = (vertices[i]->y * z[i] * .5f + .5f) * OCCLUSION_HEIGHT;
+	}
+
+	const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (fabsf(area) < 1e-6f)
+		return false;
+
+	// Pixels whose center can be inside
+	triangle.minX = MAX(0, static_cast<int>(ceilf(MIN(x[0], MIN(x[1], x[2])) - .5f)));
+	triangle.maxX = MIN(OCCLUSION_WIDTH - 1, static_cast<int>(floorf(MAX(x[0], MAX(x[1], x[2])) - .5f)));
+	triangle.minY = MAX(0, static_cast<int>(ceilf(MIN(y[0], MIN(y[1], y[2])) - .5f)));
+	triangle.maxY = MIN(OCCLUSION_HEIGHT - 1, static_cast<int>(floorf(MAX(y[0], MAX(y[1], y[2])) - .5f)));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return false;
+
+	// Both windings are drawn, the edges are flipped so the inside is positive
+	const float sign = area > 0.f ? 1.f : -1.f;
+	for (int i = 0; i < 3; ++i)
+	{
+		const int j = (i + 1) % 3;
+		triangle.edges[i][0] = (y[i] - y[j]) * sign;
+		triangle.edges[i][1] = (x[j] - x[i]) * sign;
+		triangle.edges[i][2] = (x[i] * y[j] - y[i] * x[j]) * sign;
+	}
+
+	// 1 / w is linear in screen space
+	triangle.plane[0] = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	triangle.plane[1] = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	triangle.plane[2] = z[0] - triangle.plane[0] * x[0] - triangle.plane[1] * y[0];
+	return true;
+}
+
+void OcclusionCuller::RasterizeBand(uint firstRow, uint lastRow)
+{
+	for (uint t = 0; t < triangles.size(); ++t)
+	{
+		if (!validTriangles[t])
+			continue;
+
+		const Triangle& triangle = triangles[t];
+		const int firstY = MAX(triangle.minY, static_cast<int>(firstRow));
+		const int lastY = MIN(triangle.maxY, static_cast<int>(lastRow) - 1);
+
+		for (int y = firstY; y <= lastY; ++y)
+		{
+			// Same order of operations as the AVX2 path, both round the same way and fill the same pixels
+			const float cy = y + .5f;
+			const float rowEdge0 = triangle.edges[0][1] * cy + triangle.edges[0][2];
+			const float rowEdge1 = triangle.edges[1][1] * cy + triangle.edges[1][2];
+			const float rowEdge2 = triangle.edges[2][1] * cy + triangle.edges[2][2];
+			const float rowPlane = triangle.plane[1] * cy + triangle.plane[2];
+			float* row = &depth[y * OCCLUSION_WIDTH];
+
+			for (int x = triangle.minX; x <= triangle.maxX; ++x)
+			{
+				const float cx = x + .5f;
+				if (triangle.edges[0][0] * cx + rowEdge0 < 0.f ||
+					triangle.edges[1][0] * cx + rowEdge1 < 0.f ||
+					triangle.edges[2][0] * cx + rowEdge2 < 0.f)
+					continue;
+
+				const float z = triangle.plane[0] * cx + rowPlane;
+				row[x] = MAX(row[x], z);
+			}
+		}
+	}
+}
\ No newline at end of file
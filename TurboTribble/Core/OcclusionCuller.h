@@ -0,0 +1,99 @@
+#ifndef __OCCLUSION_CULLER_H__
+#define __OCCLUSION_CULLER_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <vector>
+#include "Math/float3.h"
+#include "Math/float4.h"
+#include "Math/float4x4.h"
+#include "Geometry/AABB.h"
+
+// Depth buffer resolution, the width must be a multiple of 8
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+// Rows rasterized by one job, every job owns its rows so no two write the same pixel
+#define OCCLUSION_BAND_ROWS 16
+// Closer than this in clip space counts as crossing the near plane
+#define OCCLUSION_MIN_W 0.0001f
+
+
+
+class JobSystem;
+
+// Software occlusion on the CPU, no GPU involved
+// Occluder triangles are rasterized into a small buffer of 1 / w, the closest occluder wins every pixel
+// A box is hidden when every pixel its screen rectangle covers holds an occluder closer than the box's nearest corner
+// Pixels are sampled at their center, a gap thinner than a pixel of the buffer can be closed by its neighbours
+class OcclusionCuller
+{
+public:
+
+	// Constructor, AVX2 is used when the CPU has it unless allowAVX2 is false
+	OcclusionCuller(bool allowAVX2 = true);
+
+	void Init(JobSystem* jobs);
+
+	// Clear the buffer for a frame seen through viewProjection, M * v convention
+	void Begin(const float4x4& viewProjection);
+	// Queue the triangles of an occluder, the arrays must stay alive until Rasterize returns
+	void AddOccluder(const float4x4& transform, const float3* vertices, uint numVertices, const uint* indices, uint numIndices);
+	// Transform every queued occluder and rasterize them on the workers
+	void Rasterize();
+
+	// Whether anything of the box can be seen past the occluders, only reads so recording jobs can call it
+	bool IsVisible(const AABB& box) const;
+
+	inline bool HasOccluders() const { return !occluders.empty(); }
+	inline uint GetNumOccluders() const { return static_cast<uint>(occluders.size()); }
+	inline uint GetNumTriangles() const { return numTriangles; }
+	inline bool UsesAVX2() const { return hasAVX2; }
+	inline const float* GetDepth() const { return depth.data(); }
+
+private:
+
+	struct Occluder
+	{
+		float4x4 transform;
+		const float3* vertices;
+		uint numVertices;
+		const uint* indices;
+		uint numIndices;
+		// First slot of its triangles in the setup array
+		uint firstTriangle;
+	};
+
+	// Screen space triangle ready to rasterize, edges and depth are planes a * x + b * y + c
+	struct Triangle
+	{
+		int minX, maxX, minY, maxY;
+		float edges[3][3];
+		float plane[3];
+	};
+
+	// Project one triangle, false when it is degenerate, off screen or crosses the near plane
+	static bool Setup(const float4& a, const float4& b, const float4& c, Triangle& triangle);
+	// Draw the part of the triangles inside rows [firstRow, lastRow)
+	void RasterizeBand(uint firstRow, uint lastRow);
+	void RasterizeBandAVX2(uint firstRow, uint lastRow);
+	bool IsRectVisibleAVX2(int minX, int maxX, int minY, int maxY, float nearest) const;
+
+private:
+
+	JobSystem* jobs = nullptr;
+	bool hasAVX2 = false;
+
+	float4x4 viewProjection;
+	std::vector<Occluder> occluders;
+	std::vector<Triangle> triangles;
+	// Setup rejects some triangles, only the valid slots are rasterized
+	std::vector<uchar> validTriangles;
+	uint numTriangles = 0;
+
+	// 1 / w per pixel, 0 is infinitely far, rows go bottom to top
+	std::vector<float> depth;
+
+};
+
+#endif // !__OCCLUSION_CULLER_H__
\ No newline at end of file
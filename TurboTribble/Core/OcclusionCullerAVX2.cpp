@@ -0,0 +1,87 @@
+#include "OcclusionCuller.h"
+
+// Built with AVX2 enabled, only called after the CPU check of the constructor
+#include <immintrin.h>
+
+
+
+void OcclusionCuller::RasterizeBandAVX2(uint firstRow, uint lastRow)
+{
+	const __m256 laneCenters = _mm256_setr_ps(.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (uint t = 0; t < triangles.size(); ++t)
+	{
+		if (!validTriangles[t])
+			continue;
+
+		const Triangle& triangle = triangles[t];
+		const int firstY = MAX(triangle.minY, static_cast<int>(firstRow));
+		const int lastY = MIN(triangle.maxY, static_cast<int>(lastRow) - 1);
+
+		const __m256 edgeX0 = _mm256_set1_ps(triangle.edges[0][0]);
+		const __m256 edgeX1 = _mm256_set1_ps(triangle.edges[1][0]);
+		const __m256 edgeX2 = _mm256_set1_ps(triangle.edges[2][0]);
+		const __m256 planeX = _mm256_set1_ps(triangle.plane[0]);
+
+		for (int y = firstY; y <= lastY; ++y)
+		{
+			const float cy = y + .5f;
+			const __m256 rowEdge0 = _mm256_set1_ps(triangle.edges[0][1] * cy + triangle.edges[0][2]);
+			const __m256 rowEdge1 = _mm256_set1_ps(triangle.edges[1][1] * cy + triangle.edges[1][2]);
+			const __m256 rowEdge2 = _mm256_set1_ps(triangle.edges[2][1] * cy + triangle.edges[2][2]);
+			const __m256 rowPlane = _mm256_set1_ps(triangle.plane[1] * cy + triangle.plane[2]);
+			float* row = &depth[y * OCCLUSION_WIDTH];
+
+			// Groups of 8 start aligned, the width is a multiple of 8 so a group never leaves the row
+			for (int x = triangle.minX & ~7; x <= triangle.maxX; x += 8)
+			{
+				const __m256 cx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneCenters);
+
+				const __m256 e0 = _mm256_add_ps(_mm256_mul_ps(edgeX0, cx), rowEdge0);
+				const __m256 e1 = _mm256_add_ps(_mm256_mul_ps(edgeX1, cx), rowEdge1);
+				const __m256 e2 = _mm256_add_ps(_mm256_mul_ps(edgeX2, cx), rowEdge2);
+				const __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+				if (_mm256_movemask_ps(inside) == 0)
+					continue;
+
+				const __m256 z = _mm256_add_ps(_mm256_mul_ps(planeX, cx), rowPlane);
+				const __m256 current = _mm256_loadu_ps(row + x);
+				_mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_max_ps(current, z), inside));
+			}
+		}
+	}
+
+	// The rest of the engine is SSE code, leaving the upper halves dirty slows it down
+	_mm256_zeroupper();
+}
+
+bool OcclusionCuller::IsRectVisibleAVX2(int minX, int maxX, int minY, int maxY, float nearest) const
+{
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i afterFirst = _mm256_set1_epi32(minX - 1);
+	const __m256i beforeLast = _mm256_set1_epi32(maxX + 1);
+	const __m256 boxDepth = _mm256_set1_ps(nearest);
+
+	bool visible = false;
+	for (int y = minY; y <= maxY && !visible; ++y)
+	{
+		const float* row = &depth[y * OCCLUSION_WIDTH];
+		for (int x = minX & ~7; x <= maxX; x += 8)
+		{
+			// Lanes left and right of the rectangle do not count
+			const __m256i laneX = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+			const __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi32(laneX, afterFirst), _mm256_cmpgt_epi32(beforeLast, laneX));
+
+			const __m256 open = _mm256_cmp_ps(_mm256_loadu_ps(row + x), boxDepth, _CMP_LE_OQ);
+			if (_mm256_movemask_ps(_mm256_and_ps(open, _mm256_castsi256_ps(inRange))) != 0)
+			{
+				visible = true;
+				break;
+			}
+		}
+	}
+
+	_mm256_zeroupper();
+	return visible;
+}
\ No newline at end of file
@@ -5,35 +5,39 @@
 
 #include "PerfTimer.h"
 
-#include "SDL\include\SDL_timer.h"
+#include <chrono>
 
 
 
-uint64 PerfTimer::frequency = 0;
+// Ticks are nanoseconds of the steady clock
+uint64 PerfTimer::frequency = 1000000000ull;
+
+// Nanoseconds since an arbitrary origin
+static uint64 GetCounter()
+{
+	return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
 // ---------------------------------------------
 PerfTimer::PerfTimer()
 {
-	if(frequency == 0)
-		frequency = SDL_GetPerformanceFrequency();
-
 	Start();
 }
 
 // ---------------------------------------------
 void PerfTimer::Start()
 {
-	startedAt = SDL_GetPerformanceCounter();
+	startedAt = GetCounter();
 }
 
 // ---------------------------------------------
 double PerfTimer::ReadMs() const
 {
-	return 1000.0 * (double(SDL_GetPerformanceCounter() - startedAt) / double(frequency));
+	return 1000.0 * (double(GetCounter() - startedAt) / double(frequency));
 }
 
 // ---------------------------------------------
 uint64 PerfTimer::ReadTicks() const
 {
-	return SDL_GetPerformanceCounter() - startedAt;
+	return GetCounter() - startedAt;
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "PixelOps.h"
+
+#include "JobSystem.h"
+#include "CpuInfo.h"
+
+#include <string.h>
+#include <emmintrin.h>
+
+
+
+// Every CPU with SSE4.1 has SSSE3
+PixelOps::PixelOps(JobSystem* jobs) : jobs(jobs), hasSSSE3(HasSSE41())
+{}
+
+void PixelOps::FlipVertically(TextureData& texture) const
+{
+	if (texture.IsCompressed())
+		return;
+
+	const uint bytesPerPixel = texture.GetBytesPerPixel();
+	for (TextureLevel& level : texture.levels)
+	{
+		if (level.height > 1)
+			FlipRows(level.data.data(), level.width * bytesPerPixel, level.height);
+	}
+}
+
+void PixelOps::ExpandRGBToRGBA(TextureData& texture) const
+{
+	if (texture.format != TextureFormat::RGB8)
+		return;
+
+	for (TextureLevel& level : texture.levels)
+	{
+		std::vector<uchar> expanded(level.width * level.height * 4);
+		ExpandRows(level.data.data(), expanded.data(), level.width, level.height);
+		level.data.swap(expanded);
+	}
+	texture.format = TextureFormat::RGBA8;
+}
+
+void PixelOps::SwapRedBlue(TextureData& texture) const
+{
+	if (texture.IsCompressed())
+		return;
+
+	const uint bytesPerPixel = texture.GetBytesPerPixel();
+	for (TextureLevel& level : texture.levels)
+		SwapRedBlueRows(level.data.data(), level.width, level.height, bytesPerPixel);
+}
+
+void PixelOps::PremultiplyAlpha(TextureData& texture) const
+{
+	if (texture.format != TextureFormat::RGBA8)
+		return;
+
+	for (TextureLevel& level : texture.levels)
+		PremultiplyRows(level.data.data(), level.width, level.height);
+}
+
+void PixelOps::FlipRows(uchar* data, uint pitch, uint height) const
+{
+	// Every band swaps its own pairs of rows, top half against bottom half
+	ForEachBand(height / 2, [data, pitch, height](uint first, uint last)
+	{
+		for (uint row = first; row < last; ++row)
+		{
+			uchar* top = data + row * pitch;
+			uchar* bottom = data + (height - 1 - row) * pitch;
+
+			uint i = 0;
+			for (; i + 16 <= pitch; i += 16)
+			{
+				const __m128i a = _mm_loadu_si128((const __m128i*)(top + i));
+				const __m128i b = _mm_loadu_si128((const __m128i*)(bottom + i));
+				_mm_storeu_si128((__m128i*)(top + i), b);
+				_mm_storeu_si128((__m128i*)(bottom + i), a);
+			}
+			for (; i < pitch; ++i)
+			{
+				const uchar t = top[i];
+				top[i] = bottom[i];
+				bottom[i] = t;
+			}
+		}
+	});
+}
+
+void PixelOps::ExpandRows(const uchar* source, uchar* destination, uint width, uint height) const
+{
+	const bool ssse3 = hasSSSE3;
+	ForEachBand(height, [source, destination, width, ssse3](uint first, uint last)
+	{
+		// Rows are tightly packed, a band is one run of pixels
+		const uchar* input = source + first * width * 3;
+		uint* output = (uint*)(destination + first * width * 4);
+		const uint count = (last - first) * width;
+
+		uint i = ssse3 ? ExpandSSSE3(input, output, count) : 0;
+		for (; i < count; ++i)
+		{
+			const uchar* pixel = input + i * 3;
+			output[i] = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) | 0xFF000000;
+		}
+	});
+}
+
+void PixelOps::SwapRedBlueRows(uchar* data, uint width, uint height, uint bytesPerPixel) const
+{
+	const bool ssse3 = hasSSSE3;
+	ForEachBand(height, [data, width, bytesPerPixel, ssse3](uint first, uint last)
+	{
+		uchar* pixels = data + first * width * bytesPerPixel;
+		const uint count = (last - first) * width;
+
+		uint i = 0;
+		if (bytesPerPixel == 4)
+		{
+			// Red and blue are the even bytes of every pixel, shifting by 16 swaps them
+			const __m128i redBlue = _mm_set1_epi32(0x00FF00FF);
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128i rgba = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+				const __m128i rb = _mm_and_si128(rgba, redBlue);
+				const __m128i ga = _mm_andnot_si128(redBlue, rgba);
+				const __m128i br = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+				_mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_or_si128(br, ga));
+			}
+		}
+		else if (ssse3)
+		{
+			i = SwapRedBlueSSSE3(pixels, count);
+		}
+		for (; i < count; ++i)
+		{
+			uchar* pixel = pixels + i * bytesPerPixel;
+			const uchar t = pixel[0];
+			pixel[0] = pixel[2];
+			pixel[2] = t;
+		}
+	});
+}
+
+void PixelOps::PremultiplyRows(uchar* data, uint width, uint height) const
+{
+	ForEachBand(height, [data, width](uint first, uint last)
+	{
+		uchar* pixels = data + first * width * 4;
+		const uint count = (last - first) * width;
+
+		const __m128i zero = _mm_setzero_si128();
+		// Alpha is multiplied by 255 so it survives the division
+		const __m128i keepAlpha = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+		const __m128i colorMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+		const __m128i half = _mm_set1_epi16(128);
+
+		uint i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i rgba = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+			__m128i halves[2] = { _mm_unpacklo_epi8(rgba, zero), _mm_unpackhi_epi8(rgba, zero) };
+
+			for (__m128i& x : halves)
+			{
+				__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				alpha = _mm_or_si128(_mm_and_si128(alpha, colorMask), keepAlpha);
+
+				// Exact x * a / 255 with rounding, (t + (t >> 8)) >> 8 where t = x * a + 128
+				const __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, alpha), half);
+				x = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+			}
+
+			_mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+		}
+		for (; i < count; ++i)
+		{
+			uchar* pixel = pixels + i * 4;
+			for (uint c = 0; c < 3; ++c)
+			{
+				const uint t = pixel[c] * pixel[3] + 128;
+				pixel[c] = static_cast<uchar>((t + (t >> 8)) >> 8);
+			}
+		}
+	});
+}
+
+void PixelOps::ForEachBand(uint rows, const std::function<void(uint, uint)>& func) const
+{
+	const uint bands = (rows + PIXEL_OPS_BAND_ROWS - 1) / PIXEL_OPS_BAND_ROWS;
+	const auto band = [rows, &func](uint i) { func(i * PIXEL_OPS_BAND_ROWS, MIN((i + 1) * PIXEL_OPS_BAND_ROWS, rows)); };
+
+	if (jobs != nullptr && bands > 1)
+	{
+		jobs->ParallelFor(bands, band);
+	}
+	else
+	{
+		for (uint i = 0; i < bands; ++i)
+			band(i);
+	}
+}
\ No newline at end of file
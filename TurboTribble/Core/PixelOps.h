@@ -0,0 +1,58 @@
+#ifndef __PIXEL_OPS_H__
+#define __PIXEL_OPS_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "TextureData.h"
+
+#include <functional>
+
+// Rows handed to one job
+#define PIXEL_OPS_BAND_ROWS 64
+
+
+
+class JobSystem;
+
+// Pixel conversions of the texture load path, SSE2/SSSE3 per pixel and one job per band of rows
+// They replace the generic iluFlipImage()/ilConvertImage() copies and run outside of the DevIL lock
+class PixelOps
+{
+public:
+
+	// Constructor, SSSE3 is used when the CPU has it
+	PixelOps(JobSystem* jobs = nullptr);
+
+	// Reverse the row order of every level in place
+	void FlipVertically(TextureData& texture) const;
+	// RGB8 to RGBA8 with opaque alpha
+	void ExpandRGBToRGBA(TextureData& texture) const;
+	// Swap the red and blue channels of RGB8/RGBA8, BGR(A) images become RGB(A)
+	void SwapRedBlue(TextureData& texture) const;
+	// Multiply the color channels of RGBA8 by alpha
+	void PremultiplyAlpha(TextureData& texture) const;
+
+	// Single level versions, also used by the benchmark
+	void FlipRows(uchar* data, uint pitch, uint height) const;
+	void ExpandRows(const uchar* source, uchar* destination, uint width, uint height) const;
+	void SwapRedBlueRows(uchar* data, uint width, uint height, uint bytesPerPixel) const;
+	void PremultiplyRows(uchar* data, uint width, uint height) const;
+
+private:
+
+	// Run func(firstRow, lastRow) for every band of rows, on the workers when there are any
+	void ForEachBand(uint rows, const std::function<void(uint, uint)>& func) const;
+
+	// SSSE3 kernels, built on their own with the instruction set enabled, return the pixels they converted
+	static uint ExpandSSSE3(const uchar* input, uint* output, uint count);
+	static uint SwapRedBlueSSSE3(uchar* pixels, uint count);
+
+private:
+
+	JobSystem* jobs = nullptr;
+	bool hasSSSE3 = false;
+
+};
+
+#endif // !__PIXEL_OPS_H__
\ No newline at end of file
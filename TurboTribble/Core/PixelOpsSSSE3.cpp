@@ -0,0 +1,34 @@
+#include "PixelOps.h"
+
+#include <tmmintrin.h>
+
+
+
+uint PixelOps::ExpandSSSE3(const uchar* input, uint* output, uint count)
+{
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+	// 4 pixels per step, the 16 byte load reads into the next pixels so the last ones go scalar
+	uint i = 0;
+	for (; i + 6 <= count; i += 4)
+	{
+		const __m128i rgb = _mm_loadu_si128((const __m128i*)(input + i * 3));
+		_mm_storeu_si128((__m128i*)(output + i), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+	}
+	return i;
+}
+
+uint PixelOps::SwapRedBlueSSSE3(uchar* pixels, uint count)
+{
+	// 5 pixels per step, byte 15 belongs to the next pixel and is written back untouched
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+
+	uint i = 0;
+	for (; i + 6 <= count; i += 5)
+	{
+		const __m128i bgr = _mm_loadu_si128((const __m128i*)(pixels + i * 3));
+		_mm_storeu_si128((__m128i*)(pixels + i * 3), _mm_shuffle_epi8(bgr, shuffle));
+	}
+	return i;
+}
\ No newline at end of file
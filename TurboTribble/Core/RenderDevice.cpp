@@ -0,0 +1,220 @@
+#include "RenderDevice.h"
+
+
+
+// ----- Cached state -----
+
+void RenderDevice::BindFramebuffer(uint framebuffer)
+{
+	if (Filter(state.framebuffer == framebuffer))
+		return;
+
+	state.framebuffer = framebuffer;
+	ApplyFramebuffer(framebuffer);
+}
+
+void RenderDevice::UseProgram(uint program)
+{
+	if (Filter(state.program == program))
+		return;
+
+	state.program = program;
+	ApplyProgram(program);
+}
+
+void RenderDevice::BindVertexArray(uint vertexArray)
+{
+	if (Filter(state.vertexArray == vertexArray))
+		return;
+
+	state.vertexArray = vertexArray;
+	state.indexBuffer = UNKNOWN_STATE;
+	ApplyVertexArray(vertexArray);
+}
+
+void RenderDevice::SetIndexBuffer(uint buffer)
+{
+	if (Filter(state.indexBuffer == buffer))
+		return;
+
+	state.indexBuffer = buffer;
+	ApplyIndexBuffer(buffer);
+}
+
+void RenderDevice::BindUniformBuffer(uint binding, uint buffer, uint64 offset, uint64 size)
+{
+	if (binding >= MAX_CACHED_UNIFORM_BINDINGS)
+	{
+		++stats.stateChanges;
+		ApplyUniformBuffer(binding, buffer, offset, size);
+		return;
+	}
+
+	RenderState::UniformBinding& bound = state.uniformBuffers[binding];
+	if (Filter(bound.buffer == buffer && bound.offset == offset && bound.size == size))
+		return;
+
+	bound.buffer = buffer;
+	bound.offset = offset;
+	bound.size = size;
+	ApplyUniformBuffer(binding, buffer, offset, size);
+}
+
+void RenderDevice::BindTexture(uint texture)
+{
+	if (Filter(state.texture == texture))
+		return;
+
+	state.texture = texture;
+	++stats.textureBinds;
+	ApplyTexture(texture);
+}
+
+void RenderDevice::SetPolygonMode(bool wireframe)
+{
+	if (Filter(state.wireframe == static_cast<int>(wireframe)))
+		return;
+
+	state.wireframe = wireframe;
+	ApplyPolygonMode(wireframe);
+}
+
+void RenderDevice::SetDepthTest(bool enabled)
+{
+	if (Filter(state.depthTest == static_cast<int>(enabled)))
+		return;
+
+	state.depthTest = enabled;
+	ApplyDepthTest(enabled);
+}
+
+void RenderDevice::SetDepthWrite(bool enabled)
+{
+	if (Filter(state.depthWrite == static_cast<int>(enabled)))
+		return;
+
+	state.depthWrite = enabled;
+	ApplyDepthWrite(enabled);
+}
+
+void RenderDevice::SetCullFace(bool enabled)
+{
+	if (Filter(state.cullFace == static_cast<int>(enabled)))
+		return;
+
+	state.cullFace = enabled;
+	ApplyCullFace(enabled);
+}
+
+void RenderDevice::SetBlend(bool enabled)
+{
+	if (Filter(state.blend == static_cast<int>(enabled)))
+		return;
+
+	state.blend = enabled;
+	ApplyBlend(enabled);
+}
+
+void RenderDevice::SetViewport(int x, int y, int width, int height)
+{
+	if (Filter(state.viewport[0] == x && state.viewport[1] == y && state.viewport[2] == width && state.viewport[3] == height))
+		return;
+
+	state.viewport[0] = x;
+	state.viewport[1] = y;
+	state.viewport[2] = width;
+	state.viewport[3] = height;
+	ApplyViewport(x, y, width, height);
+}
+
+void RenderDevice::ForgetBuffer(uint buffer)
+{
+	if (state.indexBuffer == buffer)
+		state.indexBuffer = UNKNOWN_STATE;
+
+	for (RenderState::UniformBinding& bound : state.uniformBuffers)
+	{
+		if (bound.buffer == buffer)
+			bound.buffer = UNKNOWN_STATE;
+	}
+}
+
+void RenderDevice::ForgetTexture(uint texture)
+{
+	if (state.texture == texture)
+		state.texture = UNKNOWN_STATE;
+}
+
+void RenderDevice::ForgetProgram(uint program)
+{
+	if (state.program == program)
+		state.program = UNKNOWN_STATE;
+}
+
+void RenderDevice::ForgetVertexArray(uint vertexArray)
+{
+	if (state.vertexArray == vertexArray)
+	{
+		state.vertexArray = UNKNOWN_STATE;
+		state.indexBuffer = UNKNOWN_STATE;
+	}
+}
+
+void RenderDevice::ForgetFramebuffer(uint framebuffer)
+{
+	if (state.framebuffer == framebuffer)
+		state.framebuffer = UNKNOWN_STATE;
+}
+// ------------------------
+
+void RenderDevice::EndFrame()
+{
+	totalStats.drawCalls += stats.drawCalls;
+	totalStats.instancedDrawCalls += stats.instancedDrawCalls;
+	totalStats.multiDrawCalls += stats.multiDrawCalls;
+	totalStats.indirectDraws += stats.indirectDraws;
+	totalStats.primitives += stats.primitives;
+	totalStats.vertices += stats.vertices;
+	totalStats.stateChanges += stats.stateChanges;
+	totalStats.filteredCalls += stats.filteredCalls;
+	totalStats.textureBinds += stats.textureBinds;
+	totalStats.bufferUploads += stats.bufferUploads;
+	totalStats.bufferBytes += stats.bufferBytes;
+	totalStats.textureBytes += stats.textureBytes;
+	totalStats.buffersCreated += stats.buffersCreated;
+	totalStats.texturesCreated += stats.texturesCreated;
+
+	lastFrameStats = stats;
+	stats = RenderStats();
+}
+
+void RenderDevice::CountDraw(Primitive primitive, uint count, uint numInstances)
+{
+	const uint perPrimitive = primitive == Primitive::PRIMITIVE_TRIANGLES ? 3 : 2;
+
+	++stats.drawCalls;
+	if (numInstances > 1)
+		++stats.instancedDrawCalls;
+	stats.primitives += static_cast<uint64>(count / perPrimitive) * numInstances;
+	stats.vertices += static_cast<uint64>(count) * numInstances;
+}
+
+void RenderDevice::CountMultiDraw(Primitive primitive, const IndirectDraw* draws, uint drawCount)
+{
+	const uint perPrimitive = primitive == Primitive::PRIMITIVE_TRIANGLES ? 3 : 2;
+
+	++stats.drawCalls;
+	++stats.multiDrawCalls;
+	stats.indirectDraws += drawCount;
+	for (uint i = 0; i < drawCount; ++i)
+	{
+		stats.primitives += static_cast<uint64>(draws[i].numIndices / perPrimitive) * draws[i].numInstances;
+		stats.vertices += static_cast<uint64>(draws[i].numIndices) * draws[i].numInstances;
+	}
+}
+
+void RenderDevice::CountUpload(uint64 size)
+{
+	++stats.bufferUploads;
+	stats.bufferBytes += size;
+}
\ No newline at end of file
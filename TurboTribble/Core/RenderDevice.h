@@ -0,0 +1,286 @@
+#ifndef __RENDER_DEVICE_H__
+#define __RENDER_DEVICE_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "TextureData.h"
+
+#include <vector>
+
+// Indexed uniform buffer bindings the state cache tracks, the rest always reach the backend
+#define MAX_CACHED_UNIFORM_BINDINGS 8
+// Cached binding or handle that the device does not know
+#define UNKNOWN_STATE 0xFFFFFFFF
+
+
+
+enum class BufferTarget
+{
+	BUFFER_VERTEX,
+	BUFFER_INDEX,
+	BUFFER_UNIFORM,
+	// Draw parameters read by the GPU, an array of IndirectDraw
+	BUFFER_INDIRECT,
+	// Pixels read from a framebuffer
+	BUFFER_PIXEL
+};
+
+enum class BufferUsage
+{
+	USAGE_STATIC,
+	USAGE_DYNAMIC,
+	USAGE_STREAM,
+	// Written by the GPU and read back by the CPU
+	USAGE_READBACK
+};
+
+enum class Primitive
+{
+	PRIMITIVE_TRIANGLES,
+	PRIMITIVE_LINES
+};
+
+enum class AttributeType
+{
+	ATTRIBUTE_FLOAT,
+	// Unsigned bytes read as [0, 1]
+	ATTRIBUTE_UNORM8
+};
+
+// One draw of a multi draw, layout of the commands glMultiDrawElementsIndirect reads
+struct IndirectDraw
+{
+	uint numIndices;
+	uint numInstances;
+	uint firstIndex;
+	int baseVertex;
+	// Added to the instance index of the attributes with a divisor, gl_InstanceID does not see it
+	uint baseInstance;
+};
+
+// Synchronization point inserted in the command stream, the GL backend wraps a GLsync
+typedef void* RenderFence;
+
+// What a device did during a frame, both backends count the same way
+struct RenderStats
+{
+	uint drawCalls = 0;
+	uint instancedDrawCalls = 0;
+	// Multi draw calls and the draws inside them, each call also counts as one draw call
+	uint multiDrawCalls = 0;
+	uint indirectDraws = 0;
+	uint64 primitives = 0;
+	// Vertices fed to the vertex shader, every instance counts
+	uint64 vertices = 0;
+	uint stateChanges = 0;
+	// State calls dropped because the cache already matched
+	uint filteredCalls = 0;
+	// Texture binds that reached the backend
+	uint textureBinds = 0;
+	// Writes into existing or new buffers, mapped writes are not seen by the device
+	uint bufferUploads = 0;
+	uint64 bufferBytes = 0;
+	uint64 textureBytes = 0;
+	uint buffersCreated = 0;
+	uint texturesCreated = 0;
+};
+
+// Bindings and toggles the backend was last told to use
+// Starts unknown so the first call of each kind always goes through, nothing is ever read back from the driver
+struct RenderState
+{
+	uint framebuffer = UNKNOWN_STATE;
+	uint program = UNKNOWN_STATE;
+	uint vertexArray = UNKNOWN_STATE;
+	// Part of the bound vertex array, unknown again whenever it changes
+	uint indexBuffer = UNKNOWN_STATE;
+	uint texture = UNKNOWN_STATE;
+
+	struct UniformBinding
+	{
+		uint buffer = UNKNOWN_STATE;
+		uint64 offset = 0;
+		uint64 size = 0;
+	};
+	UniformBinding uniformBuffers[MAX_CACHED_UNIFORM_BINDINGS];
+
+	// -1 unknown, 0 off, 1 on
+	int wireframe = -1;
+	int depthTest = -1;
+	int depthWrite = -1;
+	int cullFace = -1;
+	int blend = -1;
+
+	int viewport[4] = { -1, -1, -1, -1 };
+};
+
+// Thin layer between the engine and the graphics API
+// RenderDeviceGL issues the real calls, RenderDeviceNull only records them so full frames run without a context
+// Binding and toggle calls go through a shadow of the state and only reach the backend when they change something
+class RenderDevice
+{
+public:
+
+	virtual ~RenderDevice() {}
+
+	// Whether the backend draws anything at all
+	virtual bool IsNull() const = 0;
+
+	// ----- Buffers -----
+
+	// New buffer with its initial contents, data can be nullptr to only reserve the storage
+	virtual uint CreateBuffer(BufferTarget target, uint64 size, const void* data, BufferUsage usage) = 0;
+	// Replace the storage and contents, the GPU keeps reading the old storage until it is done with it
+	virtual void SetBufferData(BufferTarget target, uint buffer, uint64 size, const void* data, BufferUsage usage) = 0;
+	virtual void UpdateBuffer(BufferTarget target, uint buffer, uint64 offset, uint64 size, const void* data) = 0;
+	// Storage mapped for the whole life of the buffer, nullptr when the backend can not map persistently
+	virtual void* CreateMappedBuffer(BufferTarget target, uint64 size, uint& buffer) = 0;
+	virtual void DeleteBuffer(uint buffer) = 0;
+	// Map a readback buffer for reading, only once the GPU is done writing it or the call stalls
+	// The buffer can not be used by the GPU again until it is unmapped
+	virtual const void* MapBuffer(uint buffer, uint64 size) = 0;
+	virtual void UnmapBuffer(uint buffer) = 0;
+
+	virtual RenderFence InsertFence() = 0;
+	// Block until the GPU passed the fence, false when it timed out
+	virtual bool WaitFence(RenderFence fence, uint64 timeoutNs) = 0;
+	virtual void DeleteFence(RenderFence fence) = 0;
+	// -------------------
+
+	// ----- Textures -----
+
+	virtual bool IsFormatSupported(TextureFormat format) const = 0;
+	// Upload every level, a single uncompressed level gets its mips generated when useMipMaps is set
+	virtual uint CreateTexture(const TextureData& texture, bool useMipMaps, bool nearest = false) = 0;
+	virtual void DeleteTexture(uint texture) = 0;
+
+	// Color texture and depth buffer to draw into, 0 for the window
+	// A null depthBuffer leaves the framebuffer color only, for targets that are only blitted into
+	virtual uint CreateFramebuffer(uint width, uint height, uint& colorTexture, uint* depthBuffer) = 0;
+	virtual void DeleteFramebuffer(uint framebuffer, uint colorTexture, uint depthBuffer) = 0;
+	void BindFramebuffer(uint framebuffer);
+	// Stretch the bottom left source rectangle over the whole target, filtered linearly, the bound framebuffer stays bound
+	virtual void BlitFramebuffer(uint source, uint sourceWidth, uint sourceHeight, uint target, uint targetWidth, uint targetHeight) = 0;
+	// Queue a copy of the bottom left color pixels into a readback buffer, BGRA8 rows from bottom to top
+	// Returns without waiting for the GPU, a fence inserted afterwards tells when the buffer can be mapped
+	virtual void ReadFramebuffer(uint framebuffer, uint width, uint height, uint buffer) = 0;
+	// --------------------
+
+	// ----- Shaders -----
+
+	// Compile and link, every attribute gets the location of its index in the list, 0 on error
+	virtual uint CreateProgram(const char* vertexSource, const char* fragmentSource, const std::vector<const char*>& attributes) = 0;
+	virtual void DeleteProgram(uint program) = 0;
+	virtual int GetUniformLocation(uint program, const char* name) = 0;
+	virtual void BindUniformBlock(uint program, const char* name, uint binding) = 0;
+	void UseProgram(uint program);
+	virtual void SetUniform(int location, int value) = 0;
+	// -------------------
+
+	// ----- Vertex input -----
+
+	virtual uint CreateVertexArray() = 0;
+	virtual void DeleteVertexArray(uint vertexArray) = 0;
+	void BindVertexArray(uint vertexArray);
+	// Read the attribute from a buffer of the bound vertex array
+	virtual void SetVertexAttribute(uint attribute, uint buffer, uint components, AttributeType type, uint stride, uint offset) = 0;
+	// Stop reading the attribute, every vertex gets the constant value instead
+	virtual void DisableVertexAttribute(uint attribute, float x, float y, float z, float w) = 0;
+	// Advance the attribute once every divisor instances instead of every vertex, 0 goes back to per vertex
+	virtual void SetVertexAttributeDivisor(uint attribute, uint divisor) = 0;
+	void SetIndexBuffer(uint buffer);
+	void BindUniformBuffer(uint binding, uint buffer, uint64 offset, uint64 size);
+	// ------------------------
+
+	// ----- State -----
+
+	void BindTexture(uint texture);
+	void SetPolygonMode(bool wireframe);
+	void SetDepthTest(bool enabled);
+	// Off keeps the depth buffer as it is, fragments are still tested against it. Clear only resets depth while it is on
+	void SetDepthWrite(bool enabled);
+	void SetCullFace(bool enabled);
+	// Alpha blending with the source alpha
+	void SetBlend(bool enabled);
+	void SetViewport(int x, int y, int width, int height);
+	virtual void Clear(float r, float g, float b, float a) = 0;
+	// -----------------
+
+	// ----- Timer queries -----
+
+	virtual uint CreateTimerQuery() = 0;
+	virtual void DeleteTimerQuery(uint query) = 0;
+	// GPU time of the commands issued between Begin and End, only one query can be running
+	virtual void BeginTimerQuery(uint query) = 0;
+	virtual void EndTimerQuery() = 0;
+	// Never waits, false while the GPU has not finished the timed commands
+	virtual bool GetTimerQueryResult(uint query, uint64& nanoseconds) = 0;
+	// -------------------------
+
+	// ----- Draws -----
+
+	// Indices are 32 bits and read from the bound index buffer starting at firstIndex, baseVertex is added to each of them
+	virtual void DrawIndexed(Primitive primitive, uint numIndices, uint numInstances = 1, uint firstIndex = 0, int baseVertex = 0) = 0;
+	virtual void Draw(Primitive primitive, uint first, uint count) = 0;
+	// Whether DrawIndexedIndirect can be called, base instances included
+	virtual bool SupportsMultiDraw() const = 0;
+	// Issue drawCount draws in one call, their parameters are read from buffer at offset
+	// draws is the CPU copy of those parameters and only feeds the stats
+	virtual void DrawIndexedIndirect(Primitive primitive, uint buffer, uint64 offset, const IndirectDraw* draws, uint drawCount) = 0;
+	// -----------------
+
+	// Stats of the frame so far and of the last finished one
+	inline const RenderStats& GetStats() const { return stats; }
+	inline const RenderStats& GetLastFrameStats() const { return lastFrameStats; }
+	inline const RenderStats& GetTotalStats() const { return totalStats; }
+	// Close the frame, its stats become the last frame ones
+	void EndFrame();
+
+protected:
+
+	// ----- Backend side of the cached calls, only reached when the state changes -----
+
+	virtual void ApplyFramebuffer(uint framebuffer) = 0;
+	virtual void ApplyProgram(uint program) = 0;
+	virtual void ApplyVertexArray(uint vertexArray) = 0;
+	virtual void ApplyIndexBuffer(uint buffer) = 0;
+	virtual void ApplyUniformBuffer(uint binding, uint buffer, uint64 offset, uint64 size) = 0;
+	virtual void ApplyTexture(uint texture) = 0;
+	virtual void ApplyPolygonMode(bool wireframe) = 0;
+	virtual void ApplyDepthTest(bool enabled) = 0;
+	virtual void ApplyDepthWrite(bool enabled) = 0;
+	virtual void ApplyCullFace(bool enabled) = 0;
+	virtual void ApplyBlend(bool enabled) = 0;
+	virtual void ApplyViewport(int x, int y, int width, int height) = 0;
+	// ---------------------------------------------------------------------------------
+
+	// Deleted handles get reused, a cached binding of one must not filter the next bind
+	void ForgetBuffer(uint buffer);
+	void ForgetTexture(uint texture);
+	void ForgetProgram(uint program);
+	void ForgetVertexArray(uint vertexArray);
+	void ForgetFramebuffer(uint framebuffer);
+
+	// Count a draw of count vertices or indices
+	void CountDraw(Primitive primitive, uint count, uint numInstances);
+	void CountMultiDraw(Primitive primitive, const IndirectDraw* draws, uint drawCount);
+	void CountUpload(uint64 size);
+
+	// Count a state call, true when it changes nothing and must be dropped
+	inline bool Filter(bool unchanged)
+	{
+		unchanged ? ++stats.filteredCalls : ++stats.stateChanges;
+		return unchanged;
+	}
+
+protected:
+
+	RenderState state;
+	RenderStats stats;
+	RenderStats lastFrameStats;
+	RenderStats totalStats;
+
+};
+
+#endif // !__RENDER_DEVICE_H__
\ No newline at end of file
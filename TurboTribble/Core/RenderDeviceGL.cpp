@@ -0,0 +1,579 @@
+#include "RenderDeviceGL.h"
+
+#include "glew.h"
+
+#define SHADER_LOG_SIZE 1024
+
+
+
+static GLenum GetGLUsage(BufferUsage usage)
+{
+	switch (usage)
+	{
+	case BufferUsage::USAGE_DYNAMIC:
+		return GL_DYNAMIC_DRAW;
+	case BufferUsage::USAGE_STREAM:
+		return GL_STREAM_DRAW;
+	case BufferUsage::USAGE_READBACK:
+		return GL_STREAM_READ;
+	default:
+		break;
+	}
+	return GL_STATIC_DRAW;
+}
+
+static GLenum GetGLPrimitive(Primitive primitive)
+{
+	return primitive == Primitive::PRIMITIVE_LINES ? GL_LINES : GL_TRIANGLES;
+}
+
+static GLenum GetGLFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::RGB8:
+		return GL_RGB;
+	case TextureFormat::BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TextureFormat::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case TextureFormat::BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	case TextureFormat::BC7:
+		return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+	default:
+		break;
+	}
+	return GL_RGBA;
+}
+
+// ----- Buffers -----
+
+// Buffers are filled through GL_COPY_WRITE_BUFFER, which no draw reads, so the cached bindings stay valid
+// Binding GL_ELEMENT_ARRAY_BUFFER would also change the index buffer of the bound vertex array
+
+uint RenderDeviceGL::CreateBuffer(BufferTarget target, uint64 size, const void* data, BufferUsage usage)
+{
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), data, GetGLUsage(usage));
+
+	++stats.buffersCreated;
+	CountUpload(size);
+	return buffer;
+}
+
+void RenderDeviceGL::SetBufferData(BufferTarget target, uint buffer, uint64 size, const void* data, BufferUsage usage)
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), data, GetGLUsage(usage));
+
+	CountUpload(size);
+}
+
+void RenderDeviceGL::UpdateBuffer(BufferTarget target, uint buffer, uint64 offset, uint64 size, const void* data)
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+
+	CountUpload(size);
+}
+
+void* RenderDeviceGL::CreateMappedBuffer(BufferTarget target, uint64 size, uint& buffer)
+{
+	buffer = 0;
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+		return nullptr;
+
+	// Coherent so nothing has to be flushed before drawing
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+	void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(size), flags);
+
+	++stats.buffersCreated;
+	return mapped;
+}
+
+void RenderDeviceGL::DeleteBuffer(uint buffer)
+{
+	// Deleting a buffer also unmaps it
+	if (buffer != 0)
+	{
+		glDeleteBuffers(1, &buffer);
+		ForgetBuffer(buffer);
+		if (arrayBuffer == buffer)
+			arrayBuffer = UNKNOWN_STATE;
+		if (indirectBuffer == buffer)
+			indirectBuffer = UNKNOWN_STATE;
+	}
+}
+
+// Mapped through GL_COPY_READ_BUFFER, which no draw reads either
+
+const void* RenderDeviceGL::MapBuffer(uint buffer, uint64 size)
+{
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	return glMapBufferRange(GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+}
+
+void RenderDeviceGL::UnmapBuffer(uint buffer)
+{
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	if (glUnmapBuffer(GL_COPY_READ_BUFFER) == GL_FALSE)
+		TTLOG("### Buffer %u lost its contents while mapped ###\n", buffer);
+}
+
+RenderFence RenderDeviceGL::InsertFence()
+{
+	return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool RenderDeviceGL::WaitFence(RenderFence fence, uint64 timeoutNs)
+{
+	return glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs) != GL_TIMEOUT_EXPIRED;
+}
+
+void RenderDeviceGL::DeleteFence(RenderFence fence)
+{
+	if (fence != nullptr)
+		glDeleteSync(static_cast<GLsync>(fence));
+}
+
+// ----- Textures -----
+
+bool RenderDeviceGL::IsFormatSupported(TextureFormat format) const
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+	case TextureFormat::BC3:
+		return GLEW_EXT_texture_compression_s3tc != 0;
+	case TextureFormat::BC5:
+		return GLEW_VERSION_3_0 != 0 || GLEW_ARB_texture_compression_rgtc != 0;
+	case TextureFormat::BC7:
+		return GLEW_ARB_texture_compression_bptc != 0;
+	default:
+		break;
+	}
+	return true;
+}
+
+uint RenderDeviceGL::CreateTexture(const TextureData& texture, bool useMipMaps, bool nearest)
+{
+	const GLenum format = GetGLFormat(texture.format);
+
+	GLuint textureId = 0;
+	glGenTextures(1, &textureId);
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (uint i = 0; i < texture.levels.size(); ++i)
+	{
+		const TextureLevel& level = texture.levels[i];
+		if (texture.IsCompressed())
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, static_cast<GLsizei>(level.data.size()), &level.data[0]);
+		else
+			glTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, &level.data[0]);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+
+	// Cooked textures carry their whole chain, GL can not generate mips for block compressed ones anyway
+	if (texture.levels.size() > 1)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size()) - 1);
+	}
+	else if (useMipMaps && !texture.IsCompressed())
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+	}
+
+	RestoreTexture();
+
+	++stats.texturesCreated;
+	stats.textureBytes += texture.GetSizeInBytes();
+	return textureId;
+}
+
+void RenderDeviceGL::DeleteTexture(uint texture)
+{
+	if (texture != 0)
+	{
+		glDeleteTextures(1, &texture);
+		ForgetTexture(texture);
+	}
+}
+
+uint RenderDeviceGL::CreateFramebuffer(uint width, uint height, uint& colorTexture, uint* depthBuffer)
+{
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glGenTextures(1, &colorTexture);
+	glBindTexture(GL_TEXTURE_2D, colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	RestoreTexture();
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+
+	if (depthBuffer != nullptr)
+	{
+		glGenRenderbuffers(1, depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, *depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, *depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		TTLOG("### Framebuffer %u x %u is incomplete ###\n", width, height);
+
+	// Back to the cached framebuffer, the window one when nothing was bound yet
+	if (state.framebuffer == UNKNOWN_STATE)
+		state.framebuffer = 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+
+	++stats.texturesCreated;
+	stats.textureBytes += static_cast<uint64>(width) * height * 3;
+	return framebuffer;
+}
+
+void RenderDeviceGL::DeleteFramebuffer(uint framebuffer, uint colorTexture, uint depthBuffer)
+{
+	if (colorTexture != 0)
+		glDeleteTextures(1, &colorTexture);
+	if (framebuffer != 0)
+		glDeleteFramebuffers(1, &framebuffer);
+	if (depthBuffer != 0)
+		glDeleteRenderbuffers(1, &depthBuffer);
+
+	ForgetTexture(colorTexture);
+	ForgetFramebuffer(framebuffer);
+}
+
+void RenderDeviceGL::BlitFramebuffer(uint source, uint sourceWidth, uint sourceHeight, uint target, uint targetWidth, uint targetHeight)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+	glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	// Both bindings back to the cached framebuffer
+	if (state.framebuffer == UNKNOWN_STATE)
+		state.framebuffer = 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+}
+
+void RenderDeviceGL::ReadFramebuffer(uint framebuffer, uint width, uint height, uint buffer)
+{
+	// BGRA is the layout most drivers copy without converting
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (state.framebuffer == UNKNOWN_STATE)
+		state.framebuffer = 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, state.framebuffer);
+}
+
+void RenderDeviceGL::ApplyFramebuffer(uint framebuffer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+// ----- Shaders -----
+
+uint RenderDeviceGL::CreateProgram(const char* vertexSource, const char* fragmentSource, const std::vector<const char*>& attributes)
+{
+	const GLuint vertex = CompileStage(GL_VERTEX_SHADER, vertexSource);
+	const GLuint fragment = CompileStage(GL_FRAGMENT_SHADER, fragmentSource);
+	if (vertex == 0 || fragment == 0)
+	{
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+
+	for (uint i = 0; i < attributes.size(); ++i)
+		glBindAttribLocation(program, i, attributes[i]);
+
+	glLinkProgram(program);
+
+	// The program keeps the stages it needs
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		char log[SHADER_LOG_SIZE];
+		glGetProgramInfoLog(program, SHADER_LOG_SIZE, nullptr, log);
+		TTLOG("### Error linking shader program: %s ###\n", log);
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+void RenderDeviceGL::DeleteProgram(uint program)
+{
+	if (program != 0)
+	{
+		glDeleteProgram(program);
+		ForgetProgram(program);
+	}
+}
+
+int RenderDeviceGL::GetUniformLocation(uint program, const char* name)
+{
+	return glGetUniformLocation(program, name);
+}
+
+void RenderDeviceGL::BindUniformBlock(uint program, const char* name, uint binding)
+{
+	const GLuint index = glGetUniformBlockIndex(program, name);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, binding);
+}
+
+void RenderDeviceGL::ApplyProgram(uint program)
+{
+	glUseProgram(program);
+}
+
+void RenderDeviceGL::SetUniform(int location, int value)
+{
+	glUniform1i(location, value);
+	++stats.stateChanges;
+}
+
+uint RenderDeviceGL::CompileStage(uint type, const char* source)
+{
+	const GLuint stage = glCreateShader(type);
+	glShaderSource(stage, 1, &source, nullptr);
+	glCompileShader(stage);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(stage, GL_COMPILE_STATUS, &compiled);
+	if (compiled != GL_TRUE)
+	{
+		char log[SHADER_LOG_SIZE];
+		glGetShaderInfoLog(stage, SHADER_LOG_SIZE, nullptr, log);
+		TTLOG("### Error compiling %s shader: %s ###\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+		glDeleteShader(stage);
+		return 0;
+	}
+
+	return stage;
+}
+
+// ----- Vertex input -----
+
+uint RenderDeviceGL::CreateVertexArray()
+{
+	GLuint vertexArray = 0;
+	glGenVertexArrays(1, &vertexArray);
+	return vertexArray;
+}
+
+void RenderDeviceGL::DeleteVertexArray(uint vertexArray)
+{
+	if (vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &vertexArray);
+		ForgetVertexArray(vertexArray);
+	}
+}
+
+void RenderDeviceGL::ApplyVertexArray(uint vertexArray)
+{
+	glBindVertexArray(vertexArray);
+}
+
+void RenderDeviceGL::SetVertexAttribute(uint attribute, uint buffer, uint components, AttributeType type, uint stride, uint offset)
+{
+	const bool normalized = type == AttributeType::ATTRIBUTE_UNORM8;
+
+	// The attribute keeps the buffer bound when it was set, GL_ARRAY_BUFFER itself is not part of any draw state
+	if (arrayBuffer != buffer)
+	{
+		arrayBuffer = buffer;
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	}
+	glVertexAttribPointer(attribute, components, normalized ? GL_UNSIGNED_BYTE : GL_FLOAT, normalized ? GL_TRUE : GL_FALSE, stride, (const void*)(size_t)offset);
+	glEnableVertexAttribArray(attribute);
+	++stats.stateChanges;
+}
+
+void RenderDeviceGL::DisableVertexAttribute(uint attribute, float x, float y, float z, float w)
+{
+	glDisableVertexAttribArray(attribute);
+	glVertexAttrib4f(attribute, x, y, z, w);
+	++stats.stateChanges;
+}
+
+void RenderDeviceGL::SetVertexAttributeDivisor(uint attribute, uint divisor)
+{
+	glVertexAttribDivisor(attribute, divisor);
+	++stats.stateChanges;
+}
+
+void RenderDeviceGL::ApplyIndexBuffer(uint buffer)
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+}
+
+void RenderDeviceGL::ApplyUniformBuffer(uint binding, uint buffer, uint64 offset, uint64 size)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+}
+
+// ----- State -----
+
+void RenderDeviceGL::ApplyTexture(uint texture)
+{
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void RenderDeviceGL::ApplyPolygonMode(bool wireframe)
+{
+	glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
+}
+
+void RenderDeviceGL::ApplyDepthTest(bool enabled)
+{
+	enabled ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+}
+
+void RenderDeviceGL::ApplyDepthWrite(bool enabled)
+{
+	glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void RenderDeviceGL::ApplyCullFace(bool enabled)
+{
+	enabled ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+}
+
+void RenderDeviceGL::ApplyBlend(bool enabled)
+{
+	enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+}
+
+void RenderDeviceGL::ApplyViewport(int x, int y, int width, int height)
+{
+	glViewport(x, y, width, height);
+}
+
+void RenderDeviceGL::RestoreTexture()
+{
+	if (state.texture == UNKNOWN_STATE)
+		state.texture = 0;
+	glBindTexture(GL_TEXTURE_2D, state.texture);
+}
+
+void RenderDeviceGL::Clear(float r, float g, float b, float a)
+{
+	glClearColor(r, g, b, a);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+// ----- Timer queries -----
+
+uint RenderDeviceGL::CreateTimerQuery()
+{
+	GLuint query = 0;
+	glGenQueries(1, &query);
+	return query;
+}
+
+void RenderDeviceGL::DeleteTimerQuery(uint query)
+{
+	glDeleteQueries(1, &query);
+}
+
+void RenderDeviceGL::BeginTimerQuery(uint query)
+{
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void RenderDeviceGL::EndTimerQuery()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+bool RenderDeviceGL::GetTimerQueryResult(uint query, uint64& nanoseconds)
+{
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE)
+		return false;
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+	nanoseconds = elapsed;
+	return true;
+}
+
+// ----- Draws -----
+
+void RenderDeviceGL::DrawIndexed(Primitive primitive, uint numIndices, uint numInstances, uint firstIndex, int baseVertex)
+{
+	const void* indices = (const void*)(sizeof(uint) * firstIndex);
+
+	if (baseVertex != 0)
+		glDrawElementsInstancedBaseVertex(GetGLPrimitive(primitive), numIndices, GL_UNSIGNED_INT, indices, numInstances, baseVertex);
+	else if (numInstances > 1)
+		glDrawElementsInstanced(GetGLPrimitive(primitive), numIndices, GL_UNSIGNED_INT, indices, numInstances);
+	else
+		glDrawElements(GetGLPrimitive(primitive), numIndices, GL_UNSIGNED_INT, indices);
+
+	CountDraw(primitive, numIndices, numInstances);
+}
+
+void RenderDeviceGL::Draw(Primitive primitive, uint first, uint count)
+{
+	glDrawArrays(GetGLPrimitive(primitive), first, count);
+
+	CountDraw(primitive, count, 1);
+}
+
+bool RenderDeviceGL::SupportsMultiDraw() const
+{
+	return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+void RenderDeviceGL::DrawIndexedIndirect(Primitive primitive, uint buffer, uint64 offset, const IndirectDraw* draws, uint drawCount)
+{
+	// Only read by indirect draws, so the cached binding stays valid
+	if (indirectBuffer != buffer)
+	{
+		indirectBuffer = buffer;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+	}
+	glMultiDrawElementsIndirect(GetGLPrimitive(primitive), GL_UNSIGNED_INT, (const void*)(size_t)offset, drawCount, sizeof(IndirectDraw));
+
+	CountMultiDraw(primitive, draws, drawCount);
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef __RENDER_DEVICE_GL_H__
+#define __RENDER_DEVICE_GL_H__
+
+#include "RenderDevice.h"
+
+
+
+// OpenGL 3.3 backend, needs a current context for every call
+class RenderDeviceGL : public RenderDevice
+{
+public:
+
+	bool IsNull() const override { return false; }
+
+	// ----- Buffers -----
+
+	uint CreateBuffer(BufferTarget target, uint64 size, const void* data, BufferUsage usage) override;
+	void SetBufferData(BufferTarget target, uint buffer, uint64 size, const void* data, BufferUsage usage) override;
+	void UpdateBuffer(BufferTarget target, uint buffer, uint64 offset, uint64 size, const void* data) override;
+	void* CreateMappedBuffer(BufferTarget target, uint64 size, uint& buffer) override;
+	void DeleteBuffer(uint buffer) override;
+	const void* MapBuffer(uint buffer, uint64 size) override;
+	void UnmapBuffer(uint buffer) override;
+
+	RenderFence InsertFence() override;
+	bool WaitFence(RenderFence fence, uint64 timeoutNs) override;
+	void DeleteFence(RenderFence fence) override;
+	// -------------------
+
+	// ----- Textures -----
+
+	bool IsFormatSupported(TextureFormat format) const override;
+	uint CreateTexture(const TextureData& texture, bool useMipMaps, bool nearest = false) override;
+	void DeleteTexture(uint texture) override;
+
+	uint CreateFramebuffer(uint width, uint height, uint& colorTexture, uint* depthBuffer) override;
+	void DeleteFramebuffer(uint framebuffer, uint colorTexture, uint depthBuffer) override;
+	void BlitFramebuffer(uint source, uint sourceWidth, uint sourceHeight, uint target, uint targetWidth, uint targetHeight) override;
+	void ReadFramebuffer(uint framebuffer, uint width, uint height, uint buffer) override;
+	// --------------------
+
+	// ----- Shaders -----
+
+	uint CreateProgram(const char* vertexSource, const char* fragmentSource, const std::vector<const char*>& attributes) override;
+	void DeleteProgram(uint program) override;
+	int GetUniformLocation(uint program, const char* name) override;
+	void BindUniformBlock(uint program, const char* name, uint binding) override;
+	void SetUniform(int location, int value) override;
+	// -------------------
+
+	// ----- Vertex input -----
+
+	uint CreateVertexArray() override;
+	void DeleteVertexArray(uint vertexArray) override;
+	void SetVertexAttribute(uint attribute, uint buffer, uint components, AttributeType type, uint stride, uint offset) override;
+	void DisableVertexAttribute(uint attribute, float x, float y, float z, float w) override;
+	void SetVertexAttributeDivisor(uint attribute, uint divisor) override;
+	// ------------------------
+
+	void Clear(float r, float g, float b, float a) override;
+
+	// ----- Timer queries -----
+
+	uint CreateTimerQuery() override;
+	void DeleteTimerQuery(uint query) override;
+	void BeginTimerQuery(uint query) override;
+	void EndTimerQuery() override;
+	bool GetTimerQueryResult(uint query, uint64& nanoseconds) override;
+	// -------------------------
+
+	// ----- Draws -----
+
+	void DrawIndexed(Primitive primitive, uint numIndices, uint numInstances = 1, uint firstIndex = 0, int baseVertex = 0) override;
+	void Draw(Primitive primitive, uint first, uint count) override;
+	// GL 4.3 or the multi draw indirect and base instance extensions
+	bool SupportsMultiDraw() const override;
+	void DrawIndexedIndirect(Primitive primitive, uint buffer, uint64 offset, const IndirectDraw* draws, uint drawCount) override;
+	// -----------------
+
+protected:
+
+	void ApplyFramebuffer(uint framebuffer) override;
+	void ApplyProgram(uint program) override;
+	void ApplyVertexArray(uint vertexArray) override;
+	void ApplyIndexBuffer(uint buffer) override;
+	void ApplyUniformBuffer(uint binding, uint buffer, uint64 offset, uint64 size) override;
+	void ApplyTexture(uint texture) override;
+	void ApplyPolygonMode(bool wireframe) override;
+	void ApplyDepthTest(bool enabled) override;
+	void ApplyDepthWrite(bool enabled) override;
+	void ApplyCullFace(bool enabled) override;
+	void ApplyBlend(bool enabled) override;
+	void ApplyViewport(int x, int y, int width, int height) override;
+
+private:
+
+	// Compile one stage, 0 on error
+	static uint CompileStage(uint type, const char* source);
+	// Rebind the cached texture after binding another one to fill it
+	void RestoreTexture();
+
+private:
+
+	// Only written by SetVertexAttribute, so its last value is still bound
+	uint arrayBuffer = UNKNOWN_STATE;
+	// Only written by DrawIndexedIndirect
+	uint indirectBuffer = UNKNOWN_STATE;
+
+};
+
+#endif // !__RENDER_DEVICE_GL_H__
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "RenderDeviceNull.h"
+
+
+
+uint RenderDeviceNull::CreateBuffer(BufferTarget target, uint64 size, const void* data, BufferUsage usage)
+{
+	++stats.buffersCreated;
+	CountUpload(size);
+	return NextHandle();
+}
+
+void RenderDeviceNull::SetBufferData(BufferTarget target, uint buffer, uint64 size, const void* data, BufferUsage usage)
+{
+	CountUpload(size);
+}
+
+void RenderDeviceNull::UpdateBuffer(BufferTarget target, uint buffer, uint64 offset, uint64 size, const void* data)
+{
+	CountUpload(size);
+}
+
+void* RenderDeviceNull::CreateMappedBuffer(BufferTarget target, uint64 size, uint& buffer)
+{
+	buffer = NextHandle();
+	++stats.buffersCreated;
+
+	std::vector<uchar>& memory = mappedBuffers[buffer];
+	memory.resize(static_cast<size_t>(size));
+	return memory.data();
+}
+
+void RenderDeviceNull::DeleteBuffer(uint buffer)
+{
+	mappedBuffers.erase(buffer);
+	ForgetBuffer(buffer);
+}
+
+const void* RenderDeviceNull::MapBuffer(uint buffer, uint64 size)
+{
+	std::vector<uchar>& memory = mappedBuffers[buffer];
+	if (memory.size() < size)
+		memory.resize(static_cast<size_t>(size));
+	return memory.data();
+}
+
+RenderFence RenderDeviceNull::InsertFence()
+{
+	// Any non null value, waits never block
+	return this;
+}
+
+uint RenderDeviceNull::CreateTexture(const TextureData& texture, bool useMipMaps, bool nearest)
+{
+	++stats.texturesCreated;
+	stats.textureBytes += texture.GetSizeInBytes();
+	return NextHandle();
+}
+
+uint RenderDeviceNull::CreateFramebuffer(uint width, uint height, uint& colorTexture, uint* depthBuffer)
+{
+	colorTexture = NextHandle();
+	if (depthBuffer != nullptr)
+		*depthBuffer = NextHandle();
+
+	++stats.texturesCreated;
+	stats.textureBytes += static_cast<uint64>(width) * height * 3;
+	return NextHandle();
+}
+
+void RenderDeviceNull::DeleteFramebuffer(uint framebuffer, uint colorTexture, uint depthBuffer)
+{
+	ForgetTexture(colorTexture);
+	ForgetFramebuffer(framebuffer);
+}
+
+void RenderDeviceNull::DrawIndexed(Primitive primitive, uint numIndices, uint numInstances, uint firstIndex, int baseVertex)
+{
+	CountDraw(primitive, numIndices, numInstances);
+}
+
+void RenderDeviceNull::Draw(Primitive primitive, uint first, uint count)
+{
+	CountDraw(primitive, count, 1);
+}
+
+void RenderDeviceNull::DrawIndexedIndirect(Primitive primitive, uint buffer, uint64 offset, const IndirectDraw* draws, uint drawCount)
+{
+	CountMultiDraw(primitive, draws, drawCount);
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef __RENDER_DEVICE_NULL_H__
+#define __RENDER_DEVICE_NULL_H__
+
+#include "RenderDevice.h"
+
+#include <map>
+
+
+
+// Backend without a context, every call only updates the stats so runs without a GPU still catch draw and upload regressions
+// Handles are unique and mapped buffers point to real memory, callers run the same paths as with GL
+class RenderDeviceNull : public RenderDevice
+{
+public:
+
+	// Multi draw is off by default like on the GL 3.3 contexts without ARB_multi_draw_indirect, on covers the indirect path
+	RenderDeviceNull(bool multiDraw = false) : multiDraw(multiDraw) {}
+
+	bool IsNull() const override { return true; }
+
+	// ----- Buffers -----
+
+	uint CreateBuffer(BufferTarget target, uint64 size, const void* data, BufferUsage usage) override;
+	void SetBufferData(BufferTarget target, uint buffer, uint64 size, const void* data, BufferUsage usage) override;
+	void UpdateBuffer(BufferTarget target, uint buffer, uint64 offset, uint64 size, const void* data) override;
+	void* CreateMappedBuffer(BufferTarget target, uint64 size, uint& buffer) override;
+	void DeleteBuffer(uint buffer) override;
+	// Readback buffers are never written, they map to zeroed memory
+	const void* MapBuffer(uint buffer, uint64 size) override;
+	void UnmapBuffer(uint buffer) override {}
+
+	RenderFence InsertFence() override;
+	bool WaitFence(RenderFence fence, uint64 timeoutNs) override { return true; }
+	void DeleteFence(RenderFence fence) override {}
+	// -------------------
+
+	// ----- Textures -----
+
+	bool IsFormatSupported(TextureFormat format) const override { return true; }
+	uint CreateTexture(const TextureData& texture, bool useMipMaps, bool nearest = false) override;
+	void DeleteTexture(uint texture) override { ForgetTexture(texture); }
+
+	uint CreateFramebuffer(uint width, uint height, uint& colorTexture, uint* depthBuffer) override;
+	void DeleteFramebuffer(uint framebuffer, uint colorTexture, uint depthBuffer) override;
+	void BlitFramebuffer(uint source, uint sourceWidth, uint sourceHeight, uint target, uint targetWidth, uint targetHeight) override {}
+	void ReadFramebuffer(uint framebuffer, uint width, uint height, uint buffer) override {}
+	// --------------------
+
+	// ----- Shaders -----
+
+	uint CreateProgram(const char* vertexSource, const char* fragmentSource, const std::vector<const char*>& attributes) override { return NextHandle(); }
+	void DeleteProgram(uint program) override { ForgetProgram(program); }
+	int GetUniformLocation(uint program, const char* name) override { return 0; }
+	void BindUniformBlock(uint program, const char* name, uint binding) override {}
+	void SetUniform(int location, int value) override { ++stats.stateChanges; }
+	// -------------------
+
+	// ----- Vertex input -----
+
+	uint CreateVertexArray() override { return NextHandle(); }
+	void DeleteVertexArray(uint vertexArray) override { ForgetVertexArray(vertexArray); }
+	void SetVertexAttribute(uint attribute, uint buffer, uint components, AttributeType type, uint stride, uint offset) override { ++stats.stateChanges; }
+	void DisableVertexAttribute(uint attribute, float x, float y, float z, float w) override { ++stats.stateChanges; }
+	void SetVertexAttributeDivisor(uint attribute, uint divisor) override { ++stats.stateChanges; }
+	// ------------------------
+
+	void Clear(float r, float g, float b, float a) override {}
+
+	// ----- Timer queries -----
+
+	// Nothing runs on a GPU, every query is ready at once and took no time
+	uint CreateTimerQuery() override { return NextHandle(); }
+	void DeleteTimerQuery(uint query) override {}
+	void BeginTimerQuery(uint query) override {}
+	void EndTimerQuery() override {}
+	bool GetTimerQueryResult(uint query, uint64& nanoseconds) override { nanoseconds = 0; return true; }
+	// -------------------------
+
+	// ----- Draws -----
+
+	void DrawIndexed(Primitive primitive, uint numIndices, uint numInstances = 1, uint firstIndex = 0, int baseVertex = 0) override;
+	void Draw(Primitive primitive, uint first, uint count) override;
+	// Counted like the GL path so runs without a GPU cover it too
+	bool SupportsMultiDraw() const override { return multiDraw; }
+	void DrawIndexedIndirect(Primitive primitive, uint buffer, uint64 offset, const IndirectDraw* draws, uint drawCount) override;
+	// -----------------
+
+protected:
+
+	// The base class already counted and filtered the call
+	void ApplyFramebuffer(uint framebuffer) override {}
+	void ApplyProgram(uint program) override {}
+	void ApplyVertexArray(uint vertexArray) override {}
+	void ApplyIndexBuffer(uint buffer) override {}
+	void ApplyUniformBuffer(uint binding, uint buffer, uint64 offset, uint64 size) override {}
+	void ApplyTexture(uint texture) override {}
+	void ApplyPolygonMode(bool wireframe) override {}
+	void ApplyDepthTest(bool enabled) override {}
+	void ApplyDepthWrite(bool enabled) override {}
+	void ApplyCullFace(bool enabled) override {}
+	void ApplyBlend(bool enabled) override {}
+	void ApplyViewport(int x, int y, int width, int height) override {}
+
+private:
+
+	inline uint NextHandle() { return ++lastHandle; }
+
+private:
+
+	uint lastHandle = 0;
+	bool multiDraw = false;
+	// Memory behind the persistently mapped and the readback buffers
+	std::map<uint, std::vector<uchar>> mappedBuffers;
+
+};
+
+#endif // !__RENDER_DEVICE_NULL_H__
\ No newline at end of file
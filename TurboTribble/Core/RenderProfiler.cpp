@@ -0,0 +1,238 @@
+#include "RenderProfiler.h"
+
+#include "Application.h"
+#include "ModuleFileSystem.h"
+
+#include <string.h>
+#include "ImGui/imgui.h"
+
+
+
+void RenderProfiler::Init(RenderDevice* device)
+{
+	this->device = device;
+
+	for (PendingFrame& frame : frames)
+	{
+		for (uint& query : frame.queries)
+			query = device->CreateTimerQuery();
+	}
+}
+
+void RenderProfiler::CleanUp()
+{
+	if (capturing)
+		StopCapture();
+
+	for (PendingFrame& frame : frames)
+	{
+		for (uint& query : frame.queries)
+		{
+			device->DeleteTimerQuery(query);
+			query = 0;
+		}
+		frame.pending = false;
+	}
+	device = nullptr;
+}
+
+void RenderProfiler::BeginPass(const char* name)
+{
+	if (passOpen)
+		EndPass();
+
+	FrameProfile& profile = frames[current].profile;
+	if (profile.numPasses == MAX_PROFILED_PASSES)
+		return;
+
+	profile.passes[profile.numPasses].name = name;
+	device->BeginTimerQuery(frames[current].queries[profile.numPasses]);
+	passOpen = true;
+}
+
+void RenderProfiler::EndPass()
+{
+	if (!passOpen)
+		return;
+
+	device->EndTimerQuery();
+	++frames[current].profile.numPasses;
+	passOpen = false;
+}
+
+void RenderProfiler::EndFrame(float frameMs, const RenderStats& stats)
+{
+	EndPass();
+
+	PendingFrame& ended = frames[current];
+	ended.profile.frame = frameCount++;
+	ended.profile.frameMs = frameMs;
+	ended.profile.stats = stats;
+	ended.pending = true;
+
+	current = (current + 1) % PROFILER_LATENCY_FRAMES;
+
+	// Stop at the first frame still on the GPU so rows stay in frame order
+	for (uint i = 0; i < PROFILER_LATENCY_FRAMES; ++i)
+	{
+		PendingFrame& frame = frames[(current + i) % PROFILER_LATENCY_FRAMES];
+		if (frame.pending && !Resolve(frame))
+			break;
+	}
+
+	// The next frame reuses the oldest queries, waiting for them would stall the pipeline
+	if (frames[current].pending)
+	{
+		frames[current].pending = false;
+		++droppedFrames;
+	}
+	frames[current].profile.numPasses = 0;
+}
+
+void RenderProfiler::StartCapture(const char* file)
+{
+	if (capturing)
+		StopCapture();
+
+	captureFile = file;
+	capturePasses.clear();
+	captureBuffer.clear();
+	capturedFrames = 0;
+	captureWritten = false;
+	capturing = true;
+
+	TTLOG("+++ Capturing render stats to %s +++\n", file);
+}
+
+void RenderProfiler::StopCapture()
+{
+	if (!capturing)
+		return;
+
+	FlushCapture();
+	capturing = false;
+
+	TTLOG("+++ Captured render stats of %u frames to %s +++\n", capturedFrames, captureFile.c_str());
+}
+
+void RenderProfiler::OnGui()
+{
+	ImGui::Text("GPU %.2f ms in frame %llu, %u frames in flight", lastProfile.gpuMs, lastProfile.frame, PROFILER_LATENCY_FRAMES);
+	for (uint i = 0; i < lastProfile.numPasses; ++i)
+		ImGui::BulletText("%s: %.3f ms", lastProfile.passes[i].name, lastProfile.passes[i].gpuMs);
+
+	if (!gpuLog.empty())
+	{
+		char title[25];
+		snprintf(title, 25, "GPU ms %.2f", gpuLog.back());
+		ImGui::PlotLines("##gpu", &gpuLog[0], gpuLog.size(), 0, title, 0.0f, 33.0f, ImVec2(310, 80));
+	}
+
+	if (droppedFrames > 0)
+		ImGui::TextColored(ImVec4(1, 1, 0, 1), "Timings of %u frames came back too late", droppedFrames);
+
+	if (capturing)
+	{
+		ImGui::Text("Capturing to %s: %u frames", captureFile.c_str(), capturedFrames);
+		if (ImGui::Button("Stop Capture"))
+			StopCapture();
+	}
+	else
+	{
+		ImGui::InputText("Capture File", captureInput, sizeof(captureInput));
+		if (ImGui::Button("Start Capture") && captureInput[0] != '\0')
+			StartCapture(captureInput);
+	}
+}
+
+bool RenderProfiler::Resolve(PendingFrame& frame)
+{
+	FrameProfile& profile = frame.profile;
+	float gpuMs = 0.f;
+
+	for (uint i = 0; i < profile.numPasses; ++i)
+	{
+		uint64 nanoseconds = 0;
+		if (!device->GetTimerQueryResult(frame.queries[i], nanoseconds))
+			return false;
+
+		profile.passes[i].gpuMs = static_cast<float>(nanoseconds / 1000000.0);
+		gpuMs += profile.passes[i].gpuMs;
+	}
+
+	profile.gpuMs = gpuMs;
+	frame.pending = false;
+	lastProfile = profile;
+
+	if (gpuLog.size() == PROFILER_HISTORY_FRAMES)
+		gpuLog.erase(gpuLog.begin());
+	gpuLog.push_back(gpuMs);
+
+	if (capturing)
+		WriteRow(profile);
+
+	return true;
+}
+
+void RenderProfiler::WriteRow(const FrameProfile& profile)
+{
+	char cell[64];
+
+	// The passes of the first frame become the columns, every frame of a run times the same ones
+	if (capturedFrames == 0)
+	{
+		for (uint i = 0; i < profile.numPasses; ++i)
+			capturePasses.push_back(profile.passes[i].name);
+
+		captureBuffer += "frame,frame_ms,gpu_ms,draws,instanced_draws,multi_draws,indirect_draws,primitives,vertices,state_changes,filtered_calls,texture_binds,buffer_uploads,buffer_bytes,texture_bytes";
+		for (const char* pass : capturePasses)
+		{
+			captureBuffer += ",gpu_ms_";
+			captureBuffer += pass;
+		}
+		captureBuffer += "\n";
+	}
+
+	const RenderStats& stats = profile.stats;
+	snprintf(cell, 64, "%llu,%.3f,%.3f,", profile.frame, profile.frameMs, profile.gpuMs);
+	captureBuffer += cell;
+	snprintf(cell, 64, "%u,%u,%u,%u,", stats.drawCalls, stats.instancedDrawCalls, stats.multiDrawCalls, stats.indirectDraws);
+	captureBuffer += cell;
+	snprintf(cell, 64, "%llu,%llu,", stats.primitives, stats.vertices);
+	captureBuffer += cell;
+	snprintf(cell, 64, "%u,%u,%u,%u,", stats.stateChanges, stats.filteredCalls, stats.textureBinds, stats.bufferUploads);
+	captureBuffer += cell;
+	snprintf(cell, 64, "%llu,%llu", stats.bufferBytes, stats.textureBytes);
+	captureBuffer += cell;
+
+	// A pass missing from this frame is left empty
+	for (const char* pass : capturePasses)
+	{
+		captureBuffer += ",";
+		for (uint i = 0; i < profile.numPasses; ++i)
+		{
+			if (strcmp(profile.passes[i].name, pass) == 0)
+			{
+				snprintf(cell, 64, "%.3f", profile.passes[i].gpuMs);
+				captureBuffer += cell;
+				break;
+			}
+		}
+	}
+	captureBuffer += "\n";
+
+	++capturedFrames;
+	if (captureBuffer.size() >= PROFILER_CAPTURE_CHUNK)
+		FlushCapture();
+}
+
+void RenderProfiler::FlushCapture()
+{
+	if (captureBuffer.empty())
+		return;
+
+	// The first chunk replaces whatever an older capture left in the file
+	app->fileSystem->Save(captureFile.c_str(), captureBuffer.data(), static_cast<uint>(captureBuffer.size()), captureWritten);
+	captureBuffer.clear();
+	captureWritten = true;
+}
\ No newline at end of file
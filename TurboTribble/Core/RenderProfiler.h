@@ -0,0 +1,115 @@
+#ifndef __RENDER_PROFILER_H__
+#define __RENDER_PROFILER_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "RenderDevice.h"
+
+#include <string>
+#include <vector>
+
+// Frames a timer query result is left for, the driver keeps running ahead and reading it never waits for the GPU
+#define PROFILER_LATENCY_FRAMES 4
+#define MAX_PROFILED_PASSES 8
+// Resolved frames shown in the graph
+#define PROFILER_HISTORY_FRAMES 60
+// Captured rows are written in chunks of about this size
+#define PROFILER_CAPTURE_CHUNK 65536
+
+
+
+// GPU time of a named part of the frame
+struct PassTiming
+{
+	const char* name = nullptr;
+	float gpuMs = 0.f;
+};
+
+// One frame once the GPU finished it
+struct FrameProfile
+{
+	uint64 frame = 0;
+	// Wall time since the previous frame ended
+	float frameMs = 0.f;
+	// Sum of every timed pass
+	float gpuMs = 0.f;
+	RenderStats stats;
+	uint numPasses = 0;
+	PassTiming passes[MAX_PROFILED_PASSES];
+};
+
+// Per pass GPU timings on top of the device counters
+// Every frame gets its own timer queries, they are read PROFILER_LATENCY_FRAMES frames later or given up when still not ready
+// Resolved frames can be captured to a CSV file, one row per frame
+class RenderProfiler
+{
+public:
+
+	// Create the timer queries of every frame in flight
+	void Init(RenderDevice* device);
+	void CleanUp();
+
+	// Time the GPU work issued until EndPass, passes can not nest and the name must live as long as the profiler
+	void BeginPass(const char* name);
+	void EndPass();
+
+	// Close the frame with its counters and resolve every finished frame, oldest first
+	void EndFrame(float frameMs, const RenderStats& stats);
+
+	// Rows go to file inside the write directory, it is replaced
+	void StartCapture(const char* file);
+	// Write the pending rows and close the capture
+	void StopCapture();
+	inline bool IsCapturing() const { return capturing; }
+
+	// Latest frame whose timings came back
+	inline const FrameProfile& GetLastProfile() const { return lastProfile; }
+	inline uint GetDroppedFrames() const { return droppedFrames; }
+
+	// Pass timings, GPU graph and capture controls
+	void OnGui();
+
+private:
+
+	struct PendingFrame
+	{
+		bool pending = false;
+		FrameProfile profile;
+		uint queries[MAX_PROFILED_PASSES] = {};
+	};
+
+	// Read the queries of a frame, false when the GPU is not done with it
+	bool Resolve(PendingFrame& frame);
+	void WriteRow(const FrameProfile& profile);
+	// Append the buffered rows to the capture file
+	void FlushCapture();
+
+private:
+
+	RenderDevice* device = nullptr;
+	PendingFrame frames[PROFILER_LATENCY_FRAMES];
+	uint current = 0;
+	uint64 frameCount = 0;
+	bool passOpen = false;
+	uint droppedFrames = 0;
+
+	FrameProfile lastProfile;
+	std::vector<float> gpuLog;
+
+	// ----- Capture -----
+
+	bool capturing = false;
+	std::string captureFile;
+	// Pass columns, taken from the first captured frame
+	std::vector<const char*> capturePasses;
+	std::string captureBuffer;
+	uint capturedFrames = 0;
+	// Whether the file already holds the first chunk, the rest is appended
+	bool captureWritten = false;
+	char captureInput[128] = "render_stats.csv";
+	// -------------------
+
+};
+
+#endif // !__RENDER_PROFILER_H__
\ No newline at end of file
@@ -0,0 +1,593 @@
+#include "RenderQueue.h"
+
+#include "JobSystem.h"
+#include "RenderDevice.h"
+
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Vertex attribute locations of the mesh shader
+#define ATTRIB_POSITION 0
+#define ATTRIB_NORMAL 1
+#define ATTRIB_TEXCOORD 2
+#define ATTRIB_DRAW_INDEX 3
+
+
+
+// Both blocks must match FrameUniforms and DRAWS_PER_BLOCK, the light blocks ClusterLight, ClusterUniforms and the LightClusters sizes
+static const char* meshVertexSource = R"(
+#version 330 core
+layout(std140) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+	vec4 ambient;
+	vec4 lightPositions[8];
+	vec4 lightAmbients[8];
+	vec4 lightDiffuses[8];
+	int numLights;
+};
+
+layout(std140) uniform Draws
+{
+	mat4 models[256];
+};
+
+uniform int firstDraw;
+
+in vec3 position;
+in vec3 normal;
+in vec2 texCoord;
+in float drawIndex;
+
+out vec3 worldPosition;
+out vec3 worldNormal;
+out vec2 uv;
+out float viewDepth;
+out vec4 clipPosition;
+
+void main()
+{
+	mat4 model = models[firstDraw + int(drawIndex)];
+	vec4 world = model * vec4(position, 1.0);
+	vec4 viewPosition = view * world;
+	worldPosition = world.xyz;
+	// Cofactor matrix, the inverse transpose scaled by the determinant, so non uniform scale keeps normals perpendicular
+	// The sign of the determinant undoes the flip of mirrored transforms, the length is normalized per pixel
+	vec3 axisX = model[0].xyz;
+	vec3 axisY = model[1].xyz;
+	vec3 axisZ = model[2].xyz;
+	mat3 cofactor = mat3(cross(axisY, axisZ), cross(axisZ, axisX), cross(axisX, axisY));
+	worldNormal = cofactor * normal * sign(dot(axisX, cross(axisY, axisZ)));
+	uv = texCoord;
+	viewDepth = -viewPosition.z;
+	clipPosition = projection * viewPosition;
+	gl_Position = clipPosition;
+}
+)";
+
+static const char* meshFragmentSource = R"(
+#version 330 core
+layout(std140) uniform Frame
+{
+	mat4 view;
+	mat4 projection;
+	vec4 ambient;
+	vec4 lightPositions[8];
+	vec4 lightAmbients[8];
+	vec4 lightDiffuses[8];
+	int numLights;
+};
+
+struct ClusterLight
+{
+	vec4 positionRange;
+	vec4 colorCosInner;
+	vec4 directionCosOuter;
+};
+
+layout(std140) uniform Lights
+{
+	ClusterLight clusterLights[256];
+};
+
+layout(std140) uniform Clusters
+{
+	vec4 sliceParams;
+	uvec4 clusters[768];
+};
+
+// 16 bit light indices, eight per uvec4
+layout(std140) uniform LightIndices
+{
+	uvec4 lightIndices[1024];
+};
+
+uniform sampler2D diffuse;
+uniform bool textured;
+uniform bool lighting;
+
+in vec3 worldPosition;
+in vec3 worldNormal;
+in vec2 uv;
+in float viewDepth;
+in vec4 clipPosition;
+
+out vec4 color;
+
+// Same grid as LightClusters: 16 x 8 tiles across the screen and 24 slices along the depth
+uint FindCluster()
+{
+	vec2 ndc = clipPosition.xy / clipPosition.w;
+	ivec2 tile = clamp(ivec2((ndc * 0.5 + 0.5) * vec2(16.0, 8.0)), ivec2(0), ivec2(15, 7));
+	int slice = clamp(int(log(max(viewDepth, 0.0001)) * sliceParams.x + sliceParams.y), 0, 23);
+	return uint(tile.x + (tile.y + slice * 8) * 16);
+}
+
+// Diffuse of the dynamic lights binned into this fragment's cluster, fading out at their range and spot edges
+vec3 ShadeClusterLights(vec3 normal)
+{
+	uint cluster = FindCluster();
+	uint packed = clusters[cluster >> 2][cluster & 3u];
+	uint offset = packed & 0xFFFFu;
+	uint count = packed >> 16;
+
+	vec3 shade = vec3(0.0);
+	for (uint i = offset; i < offset + count; ++i)
+	{
+		uint index = (lightIndices[i >> 3][(i >> 1) & 3u] >> ((i & 1u) * 16u)) & 0xFFFFu;
+		ClusterLight light = clusterLights[index];
+
+		vec3 toLight = light.positionRange.xyz - worldPosition;
+		float lightDistance = length(toLight);
+		toLight /= max(lightDistance, 0.0001);
+
+		float falloff = clamp(1.0 - (lightDistance * lightDistance) / (light.positionRange.w * light.positionRange.w), 0.0, 1.0);
+		float spot = smoothstep(light.directionCosOuter.w, light.colorCosInner.w, dot(-toLight, light.directionCosOuter.xyz));
+		shade += light.colorCosInner.rgb * max(dot(normal, toLight), 0.0) * falloff * falloff * spot;
+	}
+	return shade;
+}
+
+void main()
+{
+	color = textured ? texture(diffuse, uv) : vec4(1.0);
+
+	// Same terms as the old fixed function setup: global ambient plus ambient and diffuse of every light, then the dynamic lights
+	if (lighting)
+	{
+		vec3 normal = normalize(worldNormal);
+		vec3 shade = ambient.rgb;
+		for (int i = 0; i < numLights; ++i)
+		{
+			vec3 toLight = normalize(lightPositions[i].xyz - worldPosition);
+			shade += lightAmbients[i].rgb + lightDiffuses[i].rgb * max(dot(normal, toLight), 0.0);
+		}
+		shade += ShadeClusterLights(normal);
+		color.rgb *= min(shade, vec3(1.0));
+	}
+}
+)";
+
+bool RenderQueue::Init(RenderDevice* device, JobSystem* jobs)
+{
+	this->device = device;
+	this->jobs = jobs;
+
+	if (!shader.Create(device, meshVertexSource, meshFragmentSource, { "position", "normal", "texCoord", "drawIndex" }))
+	{
+		TTLOG("### Error creating the mesh shader ###\n");
+		return false;
+	}
+
+	shader.BindUniformBlock("Frame", FRAME_BLOCK_BINDING);
+	shader.BindUniformBlock("Draws", DRAWS_BLOCK_BINDING);
+	shader.BindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+	shader.BindUniformBlock("Clusters", CLUSTERS_BLOCK_BINDING);
+	shader.BindUniformBlock("LightIndices", LIGHT_INDICES_BLOCK_BINDING);
+	firstDrawLocation = shader.GetUniformLocation("firstDraw");
+	lightingLocation = shader.GetUniformLocation("lighting");
+	texturedLocation = shader.GetUniformLocation("textured");
+
+	device->UseProgram(shader.GetProgram());
+	device->SetUniform(shader.GetUniformLocation("diffuse"), 0);
+	device->UseProgram(0);
+
+	// Core profile needs a vertex array bound to draw, one is shared and its pointers follow the bound mesh
+	vertexArray = device->CreateVertexArray();
+	drawBuffer = device->CreateBuffer(BufferTarget::BUFFER_UNIFORM, 0, nullptr, BufferUsage::USAGE_STREAM);
+	indirectBuffer = device->CreateBuffer(BufferTarget::BUFFER_INDIRECT, 0, nullptr, BufferUsage::USAGE_STREAM);
+
+	// Instance i of a draw reads slot baseInstance + i, plain draws have a base instance of 0
+	float drawIndices[DRAWS_PER_BLOCK];
+	for (uint i = 0; i < DRAWS_PER_BLOCK; ++i)
+		drawIndices[i] = static_cast<float>(i);
+	drawIndexBuffer = device->CreateBuffer(BufferTarget::BUFFER_VERTEX, sizeof(drawIndices), drawIndices, BufferUsage::USAGE_STATIC);
+
+	device->BindVertexArray(vertexArray);
+	device->SetVertexAttribute(ATTRIB_DRAW_INDEX, drawIndexBuffer, 1, AttributeType::ATTRIBUTE_FLOAT, 0, 0);
+	device->SetVertexAttributeDivisor(ATTRIB_DRAW_INDEX, 1);
+	device->BindVertexArray(0);
+	return true;
+}
+
+void RenderQueue::CleanUp()
+{
+	shader.Destroy();
+
+	if (vertexArray != 0)
+	{
+		device->DeleteVertexArray(vertexArray);
+		vertexArray = 0;
+	}
+
+	if (drawBuffer != 0)
+	{
+		device->DeleteBuffer(drawBuffer);
+		drawBuffer = 0;
+	}
+
+	if (indirectBuffer != 0)
+	{
+		device->DeleteBuffer(indirectBuffer);
+		indirectBuffer = 0;
+	}
+
+	if (drawIndexBuffer != 0)
+	{
+		device->DeleteBuffer(drawIndexBuffer);
+		drawIndexBuffer = 0;
+	}
+}
+
+void RenderCommandList::Add(const DrawCommand& command, float depth)
+{
+	DrawItem item;
+	// Buffer names are small, unlike the first index of a pooled mesh they fit the field whole
+	item.key = RenderQueue::MakeKey(command.pass, command.vertexBuffer, command.texture, RenderQueue::GetMeshId(command), depth);
+	item.command = static_cast<uint>(commands.size());
+
+	items.push_back(item);
+	commands.push_back(command);
+}
+
+void RenderQueue::SetNumLists(uint count)
+{
+	lists.resize(MAX(count, 1u));
+}
+
+void RenderQueue::Merge()
+{
+	for (RenderCommandList& list : lists)
+	{
+		const uint base = static_cast<uint>(commands.size());
+		for (DrawItem item : list.items)
+		{
+			item.command += base;
+			items.push_back(item);
+		}
+		commands.insert(commands.end(), list.commands.begin(), list.commands.end());
+
+		list.items.clear();
+		list.commands.clear();
+	}
+}
+
+void RenderQueue::Flush(bool instancing, bool multiDraw, bool lighting)
+{
+	Merge();
+	Sort();
+	Submit(instancing, multiDraw, lighting);
+
+	items.clear();
+	commands.clear();
+}
+
+uint64 RenderQueue::MakeKey(RenderPass pass, uint buffer, uint texture, uint mesh, float depth)
+{
+	const uint64 depthMax = (1ull << RENDER_KEY_DEPTH_BITS) - 1;
+	const float clamped = depth < 0.f ? 0.f : (depth > 1.f ? 1.f : depth);
+	uint64 quantizedDepth = static_cast<uint64>(clamped * depthMax);
+
+	uint64 key = static_cast<uint64>(pass) & ((1ull << RENDER_KEY_PASS_BITS) - 1);
+
+	// Blending needs the far draws first whatever their state
+	if (pass == RenderPass::PASS_TRANSPARENT)
+	{
+		quantizedDepth = depthMax - quantizedDepth;
+		key = (key << RENDER_KEY_DEPTH_BITS) | quantizedDepth;
+		key = (key << RENDER_KEY_BUFFER_BITS) | (buffer & ((1ull << RENDER_KEY_BUFFER_BITS) - 1));
+		key = (key << RENDER_KEY_TEXTURE_BITS) | (texture & ((1ull << RENDER_KEY_TEXTURE_BITS) - 1));
+		key = (key << RENDER_KEY_MESH_BITS) | (mesh & ((1ull << RENDER_KEY_MESH_BITS) - 1));
+		return key;
+	}
+
+	key = (key << RENDER_KEY_BUFFER_BITS) | (buffer & ((1ull << RENDER_KEY_BUFFER_BITS) - 1));
+	key = (key << RENDER_KEY_TEXTURE_BITS) | (texture & ((1ull << RENDER_KEY_TEXTURE_BITS) - 1));
+	key = (key << RENDER_KEY_MESH_BITS) | (mesh & ((1ull << RENDER_KEY_MESH_BITS) - 1));
+	key = (key << RENDER_KEY_DEPTH_BITS) | quantizedDepth;
+	return key;
+}
+
+uint RenderQueue::GetMeshId(const DrawCommand& command)
+{
+	// Only matters inside a pool page, meshes with their own buffers are already split by the buffer field
+	// Two pooled meshes that collide only interleave by depth and lose instancing against each other
+	uint hash = command.firstIndex;
+	hash = hash * 31u + static_cast<uint>(command.baseVertex);
+	hash = hash * 31u + command.numIndices;
+	return (hash * 2654435761u) >> (32 - RENDER_KEY_MESH_BITS);
+}
+
+void RenderQueue::Sort()
+{
+	scratch.resize(items.size());
+
+	for (uint shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		uint offsets[RADIX_BUCKETS];
+		memset(offsets, 0, sizeof(offsets));
+
+		for (const DrawItem& item : items)
+			++offsets[(item.key >> shift) & (RADIX_BUCKETS - 1)];
+
+		// Every key lands in the same bucket, this digit does not change the order
+		if (!items.empty() && offsets[(items[0].key >> shift) & (RADIX_BUCKETS - 1)] == items.size())
+			continue;
+
+		uint total = 0;
+		for (uint& offset : offsets)
+		{
+			const uint count = offset;
+			offset = total;
+			total += count;
+		}
+
+		for (const DrawItem& item : items)
+			scratch[offsets[(item.key >> shift) & (RADIX_BUCKETS - 1)]++] = item;
+
+		items.swap(scratch);
+	}
+}
+
+void RenderQueue::Submit(bool instancing, bool multiDraw, bool lighting)
+{
+	lastDraws = lastStateChanges = lastInstancedDraws = lastMultiDraws = lastIndirectDraws = 0;
+
+	if (items.empty() || !shader.IsValid())
+		return;
+
+	// Sorting put identical draws next to each other, without instancing every draw is its own group
+	groups.clear();
+	for (uint i = 0; i < items.size();)
+	{
+		const DrawCommand& command = commands[items[i].command];
+
+		uint end = i + 1;
+		while (instancing && end < items.size() && SameBatch(command, commands[items[end].command]))
+			++end;
+
+		DrawGroup group;
+		group.first = i;
+		group.count = end - i;
+		groups.push_back(group);
+		i = end;
+	}
+
+	// Whole blocks only, every bound range has the size the shader declares
+	const uint numItems = static_cast<uint>(items.size());
+	const uint numBlocks = (numItems + DRAWS_PER_BLOCK - 1) / DRAWS_PER_BLOCK;
+	drawMatrices.resize(numBlocks * DRAWS_PER_BLOCK);
+
+	// Slot i holds the matrix of item i, every job fills its own range
+	auto pack = [this, numItems](uint job)
+	{
+		const uint last = MIN(numItems, (job + 1) * MATRICES_PER_PACK_JOB);
+		for (uint i = job * MATRICES_PER_PACK_JOB; i < last; ++i)
+			drawMatrices[i] = commands[items[i].command].transform->Transposed();
+	};
+
+	const uint numJobs = (numItems + MATRICES_PER_PACK_JOB - 1) / MATRICES_PER_PACK_JOB;
+	if (jobs != nullptr)
+	{
+		jobs->ParallelFor(numJobs, pack);
+	}
+	else
+	{
+		for (uint job = 0; job < numJobs; ++job)
+			pack(job);
+	}
+
+	for (uint i = numItems; i < drawMatrices.size(); ++i)
+		drawMatrices[i] = float4x4::identity;
+
+	device->SetBufferData(BufferTarget::BUFFER_UNIFORM, drawBuffer, sizeof(float4x4) * drawMatrices.size(), drawMatrices.data(), BufferUsage::USAGE_STREAM);
+
+	const bool indirect = multiDraw && device->SupportsMultiDraw();
+	if (indirect)
+		BuildIndirectDraws();
+
+	const RenderStats before = device->GetStats();
+
+	device->UseProgram(shader.GetProgram());
+	device->SetUniform(lightingLocation, lighting ? 1 : 0);
+	device->BindVertexArray(vertexArray);
+
+	stateValid = false;
+	boundBlock = INVALID_BLOCK;
+
+	if (indirect)
+	{
+		// Every indirect draw carries its slot as base instance
+		device->SetUniform(firstDrawLocation, 0);
+
+		for (const DrawBatch& batch : batches)
+		{
+			const DrawCommand& command = commands[items[groups[batch.group].first].command];
+			ApplyState(command);
+			ApplyBuffers(command);
+			BindBlock(batch.block);
+			device->DrawIndexedIndirect(Primitive::PRIMITIVE_TRIANGLES, indirectBuffer, sizeof(IndirectDraw) * batch.firstDraw, &indirectDraws[batch.firstDraw], batch.numDraws);
+		}
+	}
+	else
+	{
+		for (const DrawGroup& group : groups)
+		{
+			const DrawCommand& command = commands[items[group.first].command];
+			ApplyState(command);
+			ApplyBuffers(command);
+			DrawRange(command, group.first, group.count);
+		}
+	}
+
+	device->BindVertexArray(0);
+	device->UseProgram(0);
+	device->BindTexture(0);
+	device->SetBlend(false);
+
+	// What this flush issued, the device counts the same calls for the whole frame
+	const RenderStats& after = device->GetStats();
+	lastDraws = after.drawCalls - before.drawCalls;
+	lastInstancedDraws = after.instancedDrawCalls - before.instancedDrawCalls;
+	lastMultiDraws = after.multiDrawCalls - before.multiDrawCalls;
+	lastIndirectDraws = after.indirectDraws - before.indirectDraws;
+	lastStateChanges = after.stateChanges - before.stateChanges;
+}
+
+bool RenderQueue::SameBatch(const DrawCommand& a, const DrawCommand& b)
+{
+	return SameState(a, b) && a.numIndices == b.numIndices && a.firstIndex == b.firstIndex && a.baseVertex == b.baseVertex;
+}
+
+bool RenderQueue::SameState(const DrawCommand& a, const DrawCommand& b)
+{
+	return a.pass == b.pass && a.texture == b.texture && a.vertexBuffer == b.vertexBuffer && a.normalBuffer == b.normalBuffer && a.texCoordBuffer == b.texCoordBuffer && a.indexBuffer == b.indexBuffer;
+}
+
+void RenderQueue::BuildIndirectDraws()
+{
+	batches.clear();
+	indirectDraws.clear();
+
+	for (uint g = 0; g < groups.size(); ++g)
+	{
+		const DrawCommand& command = commands[items[groups[g].first].command];
+		uint first = groups[g].first;
+		uint count = groups[g].count;
+
+		while (count > 0)
+		{
+			const uint block = first / DRAWS_PER_BLOCK;
+			const uint slot = first % DRAWS_PER_BLOCK;
+			const uint drawn = MIN(count, DRAWS_PER_BLOCK - slot);
+
+			// A new state or block starts a new multi draw
+			if (batches.empty() || batches.back().block != block || !SameState(commands[items[groups[batches.back().group].first].command], command))
+			{
+				DrawBatch batch;
+				batch.group = g;
+				batch.firstDraw = static_cast<uint>(indirectDraws.size());
+				batch.numDraws = 0;
+				batch.block = block;
+				batches.push_back(batch);
+			}
+
+			IndirectDraw draw;
+			draw.numIndices = command.numIndices;
+			draw.numInstances = drawn;
+			draw.firstIndex = command.firstIndex;
+			draw.baseVertex = command.baseVertex;
+			draw.baseInstance = slot;
+			indirectDraws.push_back(draw);
+			++batches.back().numDraws;
+
+			first += drawn;
+			count -= drawn;
+		}
+	}
+
+	device->SetBufferData(BufferTarget::BUFFER_INDIRECT, indirectBuffer, sizeof(IndirectDraw) * indirectDraws.size(), indirectDraws.data(), BufferUsage::USAGE_STREAM);
+}
+
+void RenderQueue::ApplyState(const DrawCommand& command)
+{
+	if (!stateValid || command.pass != boundPass)
+	{
+		boundPass = command.pass;
+		device->SetPolygonMode(boundPass == RenderPass::PASS_WIREFRAME);
+		device->SetBlend(boundPass == RenderPass::PASS_TRANSPARENT);
+	}
+
+	if (!stateValid || command.texture != boundTexture)
+	{
+		boundTexture = command.texture;
+		device->BindTexture(boundTexture);
+		device->SetUniform(texturedLocation, boundTexture != 0 ? 1 : 0);
+	}
+}
+
+void RenderQueue::ApplyBuffers(const DrawCommand& command)
+{
+	// Each attribute keeps the buffer it was set with, so only the ones that changed are touched
+	if (!stateValid || command.vertexBuffer != boundVertexBuffer)
+	{
+		boundVertexBuffer = command.vertexBuffer;
+		device->SetVertexAttribute(ATTRIB_POSITION, boundVertexBuffer, 3, AttributeType::ATTRIBUTE_FLOAT, 0, 0);
+	}
+
+	// Meshes without normals light as if facing +Z, like the fixed function default normal
+	if (!stateValid || command.normalBuffer != boundNormalBuffer)
+	{
+		boundNormalBuffer = command.normalBuffer;
+		if (boundNormalBuffer != 0)
+			device->SetVertexAttribute(ATTRIB_NORMAL, boundNormalBuffer, 3, AttributeType::ATTRIBUTE_FLOAT, 0, 0);
+		else
+			device->DisableVertexAttribute(ATTRIB_NORMAL, 0.f, 0.f, 1.f, 1.f);
+	}
+
+	if (!stateValid || command.texCoordBuffer != boundTexCoordBuffer)
+	{
+		boundTexCoordBuffer = command.texCoordBuffer;
+		if (boundTexCoordBuffer != 0)
+			device->SetVertexAttribute(ATTRIB_TEXCOORD, boundTexCoordBuffer, 2, AttributeType::ATTRIBUTE_FLOAT, 0, 0);
+		else
+			device->DisableVertexAttribute(ATTRIB_TEXCOORD, 0.f, 0.f, 0.f, 1.f);
+	}
+
+	if (!stateValid || command.indexBuffer != boundIndexBuffer)
+	{
+		boundIndexBuffer = command.indexBuffer;
+		device->SetIndexBuffer(boundIndexBuffer);
+	}
+
+	stateValid = true;
+}
+
+void RenderQueue::DrawRange(const DrawCommand& command, uint first, uint count)
+{
+	// A run can straddle two blocks of the draw buffer, it is split at the boundary
+	while (count > 0)
+	{
+		BindBlock(first / DRAWS_PER_BLOCK);
+
+		const uint slot = first % DRAWS_PER_BLOCK;
+		const uint drawn = MIN(count, DRAWS_PER_BLOCK - slot);
+		device->SetUniform(firstDrawLocation, slot);
+		device->DrawIndexed(Primitive::PRIMITIVE_TRIANGLES, command.numIndices, drawn, command.firstIndex, command.baseVertex);
+
+		first += drawn;
+		count -= drawn;
+	}
+}
+
+void RenderQueue::BindBlock(uint block)
+{
+	if (block == boundBlock)
+		return;
+
+	boundBlock = block;
+	device->BindUniformBuffer(DRAWS_BLOCK_BINDING, drawBuffer, sizeof(float4x4) * DRAWS_PER_BLOCK * block, sizeof(float4x4) * DRAWS_PER_BLOCK);
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "Shader.h"
+#include "RenderDevice.h"
+#include "LightClusters.h"
+
+#include <vector>
+#include "Math/float4.h"
+#include "Math/float4x4.h"
+
+// Sort key layout from the most significant bit: pass 2 | buffer 16 | texture 16 | mesh 12 | depth 18
+// Every draw uses the queue's only shader, so it has no field
+// The buffer comes first so the draws of a pool page stay together for the multi draws
+// The meshes of a page share its buffer, the mesh field keeps the copies of each one together for instancing
+#define RENDER_KEY_PASS_BITS 2
+#define RENDER_KEY_BUFFER_BITS 16
+#define RENDER_KEY_TEXTURE_BITS 16
+#define RENDER_KEY_MESH_BITS 12
+#define RENDER_KEY_DEPTH_BITS 18
+// Uniform block bindings of the mesh shader
+#define FRAME_BLOCK_BINDING 0
+#define DRAWS_BLOCK_BINDING 1
+#define LIGHTS_BLOCK_BINDING 2
+#define CLUSTERS_BLOCK_BINDING 3
+#define LIGHT_INDICES_BLOCK_BINDING 4
+// World matrices per bound range of the draw buffer, 16KB is the smallest block size GL 3.3 guarantees
+#define DRAWS_PER_BLOCK 256
+#define MAX_FRAME_LIGHTS 8
+#define INVALID_BLOCK 0xFFFFFFFF
+// World matrices packed by one job
+#define MATRICES_PER_PACK_JOB 1024
+
+
+
+enum class RenderPass : uint
+{
+	PASS_OPAQUE = 0,
+	PASS_WIREFRAME,
+	// Sorted back to front before any state
+	PASS_TRANSPARENT
+};
+
+// Everything needed to issue one draw, the owner keeps the buffers and the transform alive for the frame
+struct DrawCommand
+{
+	RenderPass pass = RenderPass::PASS_OPAQUE;
+	uint vertexBuffer = 0;
+	uint normalBuffer = 0;
+	uint texCoordBuffer = 0;
+	uint indexBuffer = 0;
+	uint numIndices = 0;
+	// Meshes of the geometry pool share their buffers and start somewhere inside them
+	uint firstIndex = 0;
+	int baseVertex = 0;
+	uint texture = 0;
+	const float4x4* transform = nullptr;
+};
+
+class JobSystem;
+
+// Sort key and the command it orders
+struct DrawItem
+{
+	uint64 key;
+	uint command;
+};
+
+// Draws recorded by one job, the queue merges every list before sorting so recording needs no locks
+class RenderCommandList
+{
+public:
+
+	// Queue a draw, depth is the view distance normalized to [0, 1]
+	void Add(const DrawCommand& command, float depth);
+
+	inline uint GetNumDraws() const { return static_cast<uint>(items.size()); }
+
+private:
+
+	friend class RenderQueue;
+
+	std::vector<DrawItem> items;
+	std::vector<DrawCommand> commands;
+
+};
+
+// Camera and lights, std140 layout of the Frame uniform block, filled once per frame by the renderer
+struct FrameUniforms
+{
+	float4x4 view;
+	float4x4 projection;
+	float4 ambient;
+	// World position, w unused
+	float4 lightPositions[MAX_FRAME_LIGHTS];
+	float4 lightAmbients[MAX_FRAME_LIGHTS];
+	float4 lightDiffuses[MAX_FRAME_LIGHTS];
+	int numLights;
+	int padding[3];
+};
+
+// Light grid, std140 layout of the Clusters uniform block, filled once per frame by the renderer
+struct ClusterUniforms
+{
+	// log(depth) * x + y is the slice of a view depth
+	float4 sliceParams;
+	// Offset and count of every cluster as LightClusters packs them, four per uvec4
+	uint clusters[CLUSTER_COUNT];
+};
+
+// Draws recorded on the job system, radix sorted by key and submitted in order from the render thread
+// Every draw goes through one core profile shader, world matrices are uploaded once per flush to a uniform buffer
+// Submission only changes the GL state that differs from the previous draw
+// Runs of draws that only differ in their transform become one instanced draw
+// With multi draw, runs that share their buffers and texture become one indirect draw whatever their meshes
+class RenderQueue
+{
+public:
+
+	// Create the mesh shader, its vertex array and the draw buffer on the device
+	bool Init(RenderDevice* device, JobSystem* jobs);
+	void CleanUp();
+
+	// Lists for the next flush, every recording job writes only to its own
+	void SetNumLists(uint count);
+	inline RenderCommandList& GetList(uint index) { return lists[index]; }
+	inline uint GetNumLists() const { return static_cast<uint>(lists.size()); }
+
+	// Merge the lists, sort by key and issue every draw, the queue is empty afterwards
+	// multiDraw is ignored when the device can not draw indirect
+	void Flush(bool instancing, bool multiDraw, bool lighting);
+
+	// Key of a draw, opaque draws go front to back inside their state and transparent ones back to front
+	// buffer is the vertex buffer, pooled meshes share the one of their page and mesh tells their ranges apart
+	static uint64 MakeKey(RenderPass pass, uint buffer, uint texture, uint mesh, float depth);
+	// Id of the index range a draw uses, folded to the key field so two meshes can share one
+	static uint GetMeshId(const DrawCommand& command);
+
+	// Stats of the last flush
+	inline uint GetNumDraws() const { return lastDraws; }
+	inline uint GetNumStateChanges() const { return lastStateChanges; }
+	inline uint GetNumInstancedDraws() const { return lastInstancedDraws; }
+	inline uint GetNumMultiDraws() const { return lastMultiDraws; }
+	inline uint GetNumIndirectDraws() const { return lastIndirectDraws; }
+
+private:
+
+	// Move the draws of every list into the queue
+	void Merge();
+	// Least significant digit first, 8 bits per pass, passes where every key has the same digit are skipped
+	void Sort();
+	void Submit(bool instancing, bool multiDraw, bool lighting);
+	// Whether two draws can share an instanced draw
+	static bool SameBatch(const DrawCommand& a, const DrawCommand& b);
+	// Whether two draws can share a multi draw
+	static bool SameState(const DrawCommand& a, const DrawCommand& b);
+	// Turn every group into indirect draws, split at block boundaries, and upload them
+	void BuildIndirectDraws();
+	// Polygon mode and texture
+	void ApplyState(const DrawCommand& command);
+	// Vertex attributes and index buffer of the shared vertex array
+	void ApplyBuffers(const DrawCommand& command);
+	// Draw count copies of the mesh, their matrices start at slot first of the draw buffer
+	void DrawRange(const DrawCommand& command, uint first, uint count);
+	void BindBlock(uint block);
+
+private:
+
+	// Run of sorted items that share everything but the transform, the matrices use the same slots as the items
+	struct DrawGroup
+	{
+		uint first;
+		uint count;
+	};
+
+	// Indirect draws issued by one multi draw, all in the same block of the draw buffer
+	struct DrawBatch
+	{
+		uint group;
+		uint firstDraw;
+		uint numDraws;
+		uint block;
+	};
+
+	RenderDevice* device = nullptr;
+	JobSystem* jobs = nullptr;
+	std::vector<RenderCommandList> lists;
+
+	std::vector<DrawItem> items;
+	std::vector<DrawItem> scratch;
+	std::vector<DrawCommand> commands;
+	std::vector<DrawGroup> groups;
+	std::vector<DrawBatch> batches;
+	std::vector<IndirectDraw> indirectDraws;
+
+	// Column major world matrices in submission order, padded to whole blocks and packed on the workers
+	std::vector<float4x4> drawMatrices;
+	uint drawBuffer = 0;
+	uint indirectBuffer = 0;
+	// 0 to DRAWS_PER_BLOCK - 1 read once per instance, base instances offset it to the slot of each indirect draw
+	uint drawIndexBuffer = 0;
+	uint vertexArray = 0;
+	Shader shader;
+	int firstDrawLocation = -1, lightingLocation = -1, texturedLocation = -1;
+
+	// ----- Bound state -----
+
+	// False at the start of a flush, the first draw sets everything
+	bool stateValid = false;
+	RenderPass boundPass = RenderPass::PASS_OPAQUE;
+	uint boundTexture = 0, boundVertexBuffer = 0, boundNormalBuffer = 0, boundTexCoordBuffer = 0, boundIndexBuffer = 0;
+	uint boundBlock = INVALID_BLOCK;
+	// -----------------------
+
+	uint lastDraws = 0;
+	uint lastStateChanges = 0;
+	uint lastInstancedDraws = 0;
+	uint lastMultiDraws = 0;
+	uint lastIndirectDraws = 0;
+
+};
+
+#endif // !__RENDER_QUEUE_H__
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "Shader.h"
+
+#include "RenderDevice.h"
+
+
+
+bool Shader::Create(RenderDevice* device, const char* vertexSource, const char* fragmentSource, const std::vector<const char*>& attributes)
+{
+	Destroy();
+
+	this->device = device;
+	program = device->CreateProgram(vertexSource, fragmentSource, attributes);
+	return program != 0;
+}
+
+void Shader::Destroy()
+{
+	if (program != 0)
+	{
+		device->DeleteProgram(program);
+		program = 0;
+	}
+}
+
+int Shader::GetUniformLocation(const char* name) const
+{
+	return program != 0 ? device->GetUniformLocation(program, name) : -1;
+}
+
+void Shader::BindUniformBlock(const char* name, uint binding) const
+{
+	if (program != 0)
+		device->BindUniformBlock(program, name, binding);
+}
\ No newline at end of file
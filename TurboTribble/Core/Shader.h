@@ -0,0 +1,37 @@
+#ifndef __SHADER_H__
+#define __SHADER_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <vector>
+
+class RenderDevice;
+
+
+
+// GLSL program built from a vertex and a fragment stage
+class Shader
+{
+public:
+
+	// Compile and link on the device, every attribute gets the location of its index in the list
+	bool Create(RenderDevice* device, const char* vertexSource, const char* fragmentSource, const std::vector<const char*>& attributes);
+	// Delete the program
+	void Destroy();
+
+	// Uniform location, -1 when the program does not use it
+	int GetUniformLocation(const char* name) const;
+	// Read the uniform block from the buffer bound at binding, ignored when the program does not use it
+	void BindUniformBlock(const char* name, uint binding) const;
+	inline uint GetProgram() const { return program; }
+	inline bool IsValid() const { return program != 0; }
+
+private:
+
+	RenderDevice* device = nullptr;
+	uint program = 0;
+
+};
+
+#endif // !__SHADER_H__
\ No newline at end of file
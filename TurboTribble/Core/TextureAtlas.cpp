@@ -0,0 +1,131 @@
+#include "TextureAtlas.h"
+
+#include <string.h>
+#include <algorithm>
+
+
+
+static inline uint AlignUp(uint value, uint alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+TextureAtlas::TextureAtlas(uint pageSize, uint padding) : pageSize(pageSize), padding(AlignUp(MAX(padding, 1u), 4))
+{}
+
+bool TextureAtlas::Fits(uint width, uint height) const
+{
+	return AlignUp(width, 4) + padding * 2 <= pageSize && AlignUp(height, 4) + padding * 2 <= pageSize;
+}
+
+uint TextureAtlas::Pack(const std::vector<const TextureData*>& textures, std::vector<AtlasRect>& rects)
+{
+	rects.assign(textures.size(), AtlasRect());
+	pageHeights.clear();
+
+	std::vector<uint> order(textures.size());
+	for (uint i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [&textures](uint a, uint b) { return textures[a]->height > textures[b]->height; });
+
+	uint page = 0, cursorX = 0, shelfY = 0, shelfHeight = 0;
+	bool placed = false;
+	for (uint i : order)
+	{
+		// Would overflow even an empty page
+		if (!Fits(textures[i]->width, textures[i]->height))
+		{
+			rects[i].page = ATLAS_NO_PAGE;
+			continue;
+		}
+
+		const uint cellWidth = AlignUp(textures[i]->width, 4) + padding * 2;
+		const uint cellHeight = AlignUp(textures[i]->height, 4) + padding * 2;
+
+		// Next shelf when the row is full, next page when the shelves are
+		if (cursorX + cellWidth > pageSize)
+		{
+			shelfY += shelfHeight;
+			cursorX = 0;
+			shelfHeight = 0;
+		}
+		if (shelfY + cellHeight > pageSize)
+		{
+			pageHeights.push_back(shelfY);
+			++page;
+			cursorX = shelfY = shelfHeight = 0;
+		}
+
+		AtlasRect& rect = rects[i];
+		rect.page = page;
+		rect.x = cursorX + padding;
+		rect.y = shelfY + padding;
+		rect.width = textures[i]->width;
+		rect.height = textures[i]->height;
+
+		cursorX += cellWidth;
+		shelfHeight = MAX(shelfHeight, cellHeight);
+		placed = true;
+	}
+
+	if (placed)
+		pageHeights.push_back(shelfY + shelfHeight);
+
+	return static_cast<uint>(pageHeights.size());
+}
+
+void TextureAtlas::Compose(uint page, const std::vector<const TextureData*>& textures, const std::vector<AtlasRect>& rects, TextureData& atlas) const
+{
+	uint height = 4;
+	while (height < pageHeights[page])
+		height *= 2;
+
+	atlas.format = TextureFormat::RGBA8;
+	atlas.width = pageSize;
+	atlas.height = MIN(height, pageSize);
+	atlas.levels.resize(1);
+
+	TextureLevel& level = atlas.levels[0];
+	level.width = atlas.width;
+	level.height = atlas.height;
+	level.data.assign(level.width * level.height * 4, 0);
+
+	for (uint i = 0; i < textures.size(); ++i)
+	{
+		const AtlasRect& rect = rects[i];
+		if (rect.page != page)
+			continue;
+
+		const TextureLevel& source = textures[i]->levels[0];
+		const uint bytesPerPixel = textures[i]->GetBytesPerPixel();
+
+		// Padding included, texels outside the texture clamp to its edge
+		for (int y = -static_cast<int>(padding); y < static_cast<int>(rect.height + padding); ++y)
+		{
+			const uint sourceY = static_cast<uint>(y < 0 ? 0 : MIN(static_cast<uint>(y), rect.height - 1));
+			const uchar* sourceRow = &source.data[sourceY * source.width * bytesPerPixel];
+			uchar* destinationRow = &level.data[((rect.y + y) * level.width + rect.x) * 4];
+
+			for (int x = -static_cast<int>(padding); x < static_cast<int>(rect.width + padding); ++x)
+			{
+				const uint sourceX = static_cast<uint>(x < 0 ? 0 : MIN(static_cast<uint>(x), rect.width - 1));
+				const uchar* texel = sourceRow + sourceX * bytesPerPixel;
+				uchar* output = destinationRow + x * 4;
+
+				output[0] = texel[0];
+				output[1] = texel[1];
+				output[2] = texel[2];
+				output[3] = bytesPerPixel == 4 ? texel[3] : 255;
+			}
+		}
+	}
+}
+
+uint TextureAtlas::GetSafeMipLevels() const
+{
+	uint levels = 1;
+	for (uint gutter = padding; gutter > 1; gutter /= 2)
+		++levels;
+	return levels;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef __TEXTURE_ATLAS_H__
+#define __TEXTURE_ATLAS_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "TextureData.h"
+
+#include <vector>
+
+// Page of a texture whose padded cell is larger than a page, it is left out of the atlas
+#define ATLAS_NO_PAGE 0xFFFFFFFF
+
+
+
+// Inner area of a packed texture, without its padding
+struct AtlasRect
+{
+	uint page = 0;
+	uint x = 0, y = 0;
+	uint width = 0, height = 0;
+};
+
+// Packs small RGB8/RGBA8 textures into RGBA8 pages with shelf packing, tallest first
+// Each texture is surrounded by padding that repeats its edge texels, so bilinear filtering and the first mips do not bleed
+class TextureAtlas
+{
+public:
+
+	// Constructor, the padding is rounded up to a multiple of 4 to keep every texture block aligned
+	TextureAtlas(uint pageSize, uint padding);
+
+	// Whether a texture of this size fits on a page once aligned and padded
+	bool Fits(uint width, uint height) const;
+	// Place every texture, returns the number of pages used, the ones that never fit get ATLAS_NO_PAGE
+	uint Pack(const std::vector<const TextureData*>& textures, std::vector<AtlasRect>& rects);
+	// Build a page from the textures placed on it, its height shrinks to the used power of two
+	void Compose(uint page, const std::vector<const TextureData*>& textures, const std::vector<AtlasRect>& rects, TextureData& atlas) const;
+
+	// Mip levels that still keep one texel of padding
+	uint GetSafeMipLevels() const;
+	inline uint GetPadding() const { return padding; }
+
+private:
+
+	uint pageSize;
+	uint padding;
+	// Height used on every page
+	std::vector<uint> pageHeights;
+
+};
+
+#endif // !__TEXTURE_ATLAS_H__
\ No newline at end of file
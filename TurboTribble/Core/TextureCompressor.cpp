@@ -0,0 +1,612 @@
+#include "TextureCompressor.h"
+
+#include "JobSystem.h"
+
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+
+#define BLOCK_PIXELS 16
+#define POWER_ITERATIONS 4
+#define REFINE_ITERATIONS 2
+
+
+
+// 4x4 block split in channels, so every SSE register holds one channel of four pixels
+struct Block
+{
+	alignas(16) float channels[4][BLOCK_PIXELS];
+};
+
+// 128 bit block written from the least significant bit up, as BC7 expects
+struct BlockBits
+{
+	void Write(uint value, uint count)
+	{
+		for (uint i = 0; i < count; ++i, ++position)
+		{
+			if ((value >> i) & 1u)
+				bits[position >> 6] |= 1ull << (position & 63);
+		}
+	}
+
+	uint64 bits[2] = { 0, 0 };
+	uint position = 0;
+};
+
+// BC7 interpolation weights for 4 bit indices, out of 64
+static const uint bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static inline float Clamp255(float value)
+{
+	return value < 0.f ? 0.f : (value > 255.f ? 255.f : value);
+}
+
+static void LoadBlock(const TextureLevel& level, uint bytesPerPixel, uint blockX, uint blockY, Block& block)
+{
+	for (uint y = 0; y < 4; ++y)
+	{
+		// Blocks past the edge repeat the last row and column
+		const uint sourceY = MIN(blockY * 4 + y, level.height - 1);
+		for (uint x = 0; x < 4; ++x)
+		{
+			const uint sourceX = MIN(blockX * 4 + x, level.width - 1);
+			const uchar* pixel = &level.data[(sourceY * level.width + sourceX) * bytesPerPixel];
+
+			const uint i = y * 4 + x;
+			block.channels[0][i] = pixel[0];
+			block.channels[1][i] = pixel[1];
+			block.channels[2][i] = pixel[2];
+			block.channels[3][i] = bytesPerPixel == 4 ? pixel[3] : 255.f;
+		}
+	}
+}
+
+// ----- Endpoint search -----
+
+static void BoundingBox(const Block& block, uint firstChannel, uint dims, float start[4], float end[4])
+{
+	for (uint c = firstChannel; c < firstChannel + dims; ++c)
+	{
+		__m128 low = _mm_load_ps(&block.channels[c][0]);
+		__m128 high = low;
+		for (uint group = 1; group < 4; ++group)
+		{
+			const __m128 values = _mm_load_ps(&block.channels[c][group * 4]);
+			low = _mm_min_ps(low, values);
+			high = _mm_max_ps(high, values);
+		}
+
+		alignas(16) float lows[4], highs[4];
+		_mm_store_ps(lows, low);
+		_mm_store_ps(highs, high);
+		start[c] = MIN(MIN(lows[0], lows[1]), MIN(lows[2], lows[3]));
+		end[c] = MAX(MAX(highs[0], highs[1]), MAX(highs[2], highs[3]));
+	}
+}
+
+// Extremes of the block along its principal axis, found with a few power iterations over the covariance
+static void PrincipalAxis(const Block& block, uint dims, float start[4], float end[4])
+{
+	float mean[4] = { 0.f, 0.f, 0.f, 0.f };
+	for (uint c = 0; c < dims; ++c)
+	{
+		for (uint i = 0; i < BLOCK_PIXELS; ++i)
+			mean[c] += block.channels[c][i];
+		mean[c] /= BLOCK_PIXELS;
+	}
+
+	float covariance[4][4] = {};
+	for (uint i = 0; i < BLOCK_PIXELS; ++i)
+	{
+		float delta[4];
+		for (uint c = 0; c < dims; ++c)
+			delta[c] = block.channels[c][i] - mean[c];
+
+		for (uint a = 0; a < dims; ++a)
+		{
+			for (uint b = 0; b < dims; ++b)
+				covariance[a][b] += delta[a] * delta[b];
+		}
+	}
+
+	// Start from the row of the channel with the most variance
+	uint largest = 0;
+	for (uint c = 1; c < dims; ++c)
+	{
+		if (covariance[c][c] > covariance[largest][largest])
+			largest = c;
+	}
+
+	float axis[4] = { 0.f, 0.f, 0.f, 0.f };
+	for (uint c = 0; c < dims; ++c)
+		axis[c] = covariance[largest][c];
+
+	for (uint iteration = 0; iteration < POWER_ITERATIONS; ++iteration)
+	{
+		float next[4] = { 0.f, 0.f, 0.f, 0.f };
+		float length = 0.f;
+		for (uint a = 0; a < dims; ++a)
+		{
+			for (uint b = 0; b < dims; ++b)
+				next[a] += covariance[a][b] * axis[b];
+			length += next[a] * next[a];
+		}
+
+		// Flat block, every pixel is the mean
+		if (length < 1e-8f)
+		{
+			for (uint c = 0; c < dims; ++c)
+				start[c] = end[c] = mean[c];
+			return;
+		}
+
+		length = 1.f / sqrtf(length);
+		for (uint c = 0; c < dims; ++c)
+			axis[c] = next[c] * length;
+	}
+
+	float lowest = 0.f, highest = 0.f;
+	for (uint i = 0; i < BLOCK_PIXELS; ++i)
+	{
+		float projection = 0.f;
+		for (uint c = 0; c < dims; ++c)
+			projection += (block.channels[c][i] - mean[c]) * axis[c];
+		lowest = MIN(lowest, projection);
+		highest = MAX(highest, projection);
+	}
+
+	for (uint c = 0; c < dims; ++c)
+	{
+		start[c] = Clamp255(mean[c] + axis[c] * lowest);
+		end[c] = Clamp255(mean[c] + axis[c] * highest);
+	}
+}
+
+static void FindEndpoints(const Block& block, uint dims, CompressionQuality quality, float start[4], float end[4])
+{
+	if (quality == CompressionQuality::FAST)
+		BoundingBox(block, 0, dims, start, end);
+	else
+		PrincipalAxis(block, dims, start, end);
+}
+
+// Endpoints minimizing the squared error for fixed weights, pixel = (1 - w) * start + w * end
+static bool LeastSquares(const Block& block, uint dims, const float weights[BLOCK_PIXELS], float start[4], float end[4])
+{
+	float aa = 0.f, bb = 0.f, ab = 0.f;
+	float ax[4] = { 0.f, 0.f, 0.f, 0.f }, bx[4] = { 0.f, 0.f, 0.f, 0.f };
+	for (uint i = 0; i < BLOCK_PIXELS; ++i)
+	{
+		const float b = weights[i];
+		const float a = 1.f - b;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (uint c = 0; c < dims; ++c)
+		{
+			ax[c] += a * block.channels[c][i];
+			bx[c] += b * block.channels[c][i];
+		}
+	}
+
+	const float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+
+	const float inverse = 1.f / determinant;
+	for (uint c = 0; c < dims; ++c)
+	{
+		start[c] = Clamp255((ax[c] * bb - bx[c] * ab) * inverse);
+		end[c] = Clamp255((bx[c] * aa - ax[c] * ab) * inverse);
+	}
+	return true;
+}
+
+// ----- Index selection -----
+
+// Nearest palette entry of every pixel over the given channels, returns the summed squared error
+static float SelectIndices(const Block& block, uint firstChannel, uint dims, const float palette[][4], uint paletteSize, uint indices[BLOCK_PIXELS])
+{
+	__m128 totalError = _mm_setzero_ps();
+	for (uint group = 0; group < 4; ++group)
+	{
+		__m128 values[4];
+		for (uint c = firstChannel; c < firstChannel + dims; ++c)
+			values[c] = _mm_load_ps(&block.channels[c][group * 4]);
+
+		__m128 bestDistance = _mm_set1_ps(3.4e38f);
+		__m128 bestIndex = _mm_setzero_ps();
+		for (uint i = 0; i < paletteSize; ++i)
+		{
+			__m128 distance = _mm_setzero_ps();
+			for (uint c = firstChannel; c < firstChannel + dims; ++c)
+			{
+				const __m128 delta = _mm_sub_ps(values[c], _mm_set1_ps(palette[i][c]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+			}
+
+			const __m128 closer = _mm_cmplt_ps(distance, bestDistance);
+			bestDistance = _mm_min_ps(distance, bestDistance);
+			bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(i))), _mm_andnot_ps(closer, bestIndex));
+		}
+
+		totalError = _mm_add_ps(totalError, bestDistance);
+
+		alignas(16) int groupIndices[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(groupIndices), _mm_cvttps_epi32(bestIndex));
+		for (uint k = 0; k < 4; ++k)
+			indices[group * 4 + k] = static_cast<uint>(groupIndices[k]);
+	}
+
+	alignas(16) float errors[4];
+	_mm_store_ps(errors, totalError);
+	return errors[0] + errors[1] + errors[2] + errors[3];
+}
+
+// ----- BC1 color block -----
+
+static inline uint PackRGB565(const float color[4])
+{
+	const uint r = static_cast<uint>(Clamp255(color[0]) * 31.f / 255.f + 0.5f);
+	const uint g = static_cast<uint>(Clamp255(color[1]) * 63.f / 255.f + 0.5f);
+	const uint b = static_cast<uint>(Clamp255(color[2]) * 31.f / 255.f + 0.5f);
+	return (r << 11) | (g << 5) | b;
+}
+
+static inline void UnpackRGB565(uint packed, float color[4])
+{
+	const uint r = (packed >> 11) & 31u, g = (packed >> 5) & 63u, b = packed & 31u;
+	color[0] = static_cast<float>((r << 3) | (r >> 2));
+	color[1] = static_cast<float>((g << 2) | (g >> 4));
+	color[2] = static_cast<float>((b << 3) | (b >> 2));
+	color[3] = 255.f;
+}
+
+// Quantize both endpoints and pick the indices, always in the four color mode
+static float EncodeColorEndpoints(const Block& block, const float start[4], const float end[4], uint& color0, uint& color1, uint indices[BLOCK_PIXELS])
+{
+	color0 = PackRGB565(start);
+	color1 = PackRGB565(end);
+	if (color0 < color1)
+	{
+		const uint swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	float palette[4][4];
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+
+	// Equal endpoints select the three color mode, where only index 0 is safe
+	if (color0 == color1)
+		return SelectIndices(block, 0, 3, palette, 1, indices);
+
+	for (uint c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+		palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+	}
+
+	return SelectIndices(block, 0, 3, palette, 4, indices);
+}
+
+static void EncodeColorBlock(const Block& block, CompressionQuality quality, uchar* output)
+{
+	float start[4], end[4];
+	FindEndpoints(block, 3, quality, start, end);
+
+	// Pull the endpoints in a bit, the extremes are rarely the best pair once interpolated
+	for (uint c = 0; c < 3; ++c)
+	{
+		const float inset = (end[c] - start[c]) / 16.f;
+		start[c] += inset;
+		end[c] -= inset;
+	}
+
+	uint color0 = 0, color1 = 0, indices[BLOCK_PIXELS];
+	float error = EncodeColorEndpoints(block, start, end, color0, color1, indices);
+
+	if (quality == CompressionQuality::HIGH)
+	{
+		// Weight of color1 for every index
+		static const float indexWeights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+		for (uint iteration = 0; iteration < REFINE_ITERATIONS && color0 != color1; ++iteration)
+		{
+			float weights[BLOCK_PIXELS];
+			for (uint i = 0; i < BLOCK_PIXELS; ++i)
+				weights[i] = indexWeights[indices[i]];
+
+			if (!LeastSquares(block, 3, weights, start, end))
+				break;
+
+			uint refined0 = 0, refined1 = 0, refinedIndices[BLOCK_PIXELS];
+			const float refinedError = EncodeColorEndpoints(block, start, end, refined0, refined1, refinedIndices);
+			if (refinedError >= error)
+				break;
+
+			error = refinedError;
+			color0 = refined0;
+			color1 = refined1;
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+	}
+
+	uint indexBits = 0;
+	for (uint i = 0; i < BLOCK_PIXELS; ++i)
+		indexBits |= indices[i] << (i * 2);
+
+	output[0] = static_cast<uchar>(color0 & 0xFF);
+	output[1] = static_cast<uchar>(color0 >> 8);
+	output[2] = static_cast<uchar>(color1 & 0xFF);
+	output[3] = static_cast<uchar>(color1 >> 8);
+	memcpy(output + 4, &indexBits, sizeof(indexBits));
+}
+
+// ----- BC3 alpha / BC5 channel block -----
+
+static float EncodeChannelEndpoints(const Block& block, uint channel, int value0, int value1, uint indices[BLOCK_PIXELS])
+{
+	// Eight value mode, index 0 and 1 are the endpoints and 2-7 go from value0 towards value1
+	float palette[8][4];
+	palette[0][channel] = static_cast<float>(value0);
+	palette[1][channel] = static_cast<float>(value1);
+	for (uint i = 2; i < 8; ++i)
+		palette[i][channel] = ((8 - i) * value0 + (i - 1) * value1) / 7.f;
+
+	return SelectIndices(block, channel, 1, palette, 8, indices);
+}
+
+static void EncodeChannelBlock(const Block& block, uint channel, CompressionQuality quality, uchar* output)
+{
+	float low[4], high[4];
+	BoundingBox(block, channel, 1, low, high);
+
+	const int value0 = static_cast<int>(high[channel] + 0.5f);
+	const int value1 = static_cast<int>(low[channel] + 0.5f);
+
+	uint indices[BLOCK_PIXELS] = {};
+	int best0 = value0, best1 = value1;
+	if (value0 != value1)
+	{
+		float error = EncodeChannelEndpoints(block, channel, value0, value1, indices);
+
+		// Shrinking the range trades the extremes for finer steps in between
+		const int maxInset = quality == CompressionQuality::HIGH ? 3 : 0;
+		for (int inset = 1; inset <= maxInset && value0 - inset > value1 + inset; ++inset)
+		{
+			uint insetIndices[BLOCK_PIXELS];
+			const float insetError = EncodeChannelEndpoints(block, channel, value0 - inset, value1 + inset, insetIndices);
+			if (insetError < error)
+			{
+				error = insetError;
+				best0 = value0 - inset;
+				best1 = value1 + inset;
+				memcpy(indices, insetIndices, sizeof(indices));
+			}
+		}
+	}
+
+	uint64 indexBits = 0;
+	for (uint i = 0; i < BLOCK_PIXELS; ++i)
+		indexBits |= static_cast<uint64>(indices[i]) << (i * 3);
+
+	output[0] = static_cast<uchar>(best0);
+	output[1] = static_cast<uchar>(best1);
+	for (uint i = 0; i < 6; ++i)
+		output[2 + i] = static_cast<uchar>((indexBits >> (i * 8)) & 0xFF);
+}
+
+// ----- BC7 mode 6 block -----
+
+// 7 bit endpoint plus the shared bit that gives the least error
+static void QuantizeBC7Endpoint(const float endpoint[4], uint quantized[4], uint& pBit)
+{
+	float bestError = 3.4e38f;
+	for (uint p = 0; p < 2; ++p)
+	{
+		uint candidate[4];
+		float error = 0.f;
+		for (uint c = 0; c < 4; ++c)
+		{
+			const int value = static_cast<int>((endpoint[c] - p) / 2.f + 0.5f);
+			candidate[c] = static_cast<uint>(value < 0 ? 0 : (value > 127 ? 127 : value));
+
+			const float delta = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+			error += delta * delta;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			pBit = p;
+			memcpy(quantized, candidate, sizeof(candidate));
+		}
+	}
+}
+
+static float EncodeBC7Endpoints(const Block& block, const float start[4], const float end[4], uint quantized[2][4], uint pBits[2], uint indices[BLOCK_PIXELS])
+{
+	QuantizeBC7Endpoint(start, quantized[0], pBits[0]);
+	QuantizeBC7Endpoint(end, quantized[1], pBits[1]);
+
+	float palette[16][4];
+	for (uint i = 0; i < 16; ++i)
+	{
+		for (uint c = 0; c < 4; ++c)
+		{
+			const uint endpoint0 = (quantized[0][c] << 1) | pBits[0];
+			const uint endpoint1 = (quantized[1][c] << 1) | pBits[1];
+			palette[i][c] = static_cast<float>(((64 - bc7Weights[i]) * endpoint0 + bc7Weights[i] * endpoint1 + 32) >> 6);
+		}
+	}
+
+	return SelectIndices(block, 0, 4, palette, 16, indices);
+}
+
+static void EncodeBC7Block(const Block& block, CompressionQuality quality, uchar* output)
+{
+	float start[4], end[4];
+	FindEndpoints(block, 4, quality, start, end);
+
+	uint quantized[2][4], pBits[2], indices[BLOCK_PIXELS];
+	float error = EncodeBC7Endpoints(block, start, end, quantized, pBits, indices);
+
+	const uint iterations = quality == CompressionQuality::HIGH ? REFINE_ITERATIONS : 0;
+	for (uint iteration = 0; iteration < iterations; ++iteration)
+	{
+		float weights[BLOCK_PIXELS];
+		for (uint i = 0; i < BLOCK_PIXELS; ++i)
+			weights[i] = bc7Weights[indices[i]] / 64.f;
+
+		if (!LeastSquares(block, 4, weights, start, end))
+			break;
+
+		uint refinedQuantized[2][4], refinedPBits[2], refinedIndices[BLOCK_PIXELS];
+		const float refinedError = EncodeBC7Endpoints(block, start, end, refinedQuantized, refinedPBits, refinedIndices);
+		if (refinedError >= error)
+			break;
+
+		error = refinedError;
+		memcpy(quantized, refinedQuantized, sizeof(quantized));
+		memcpy(pBits, refinedPBits, sizeof(pBits));
+		memcpy(indices, refinedIndices, sizeof(indices));
+	}
+
+	// The anchor index is stored with 3 bits, so its top bit has to be 0
+	if (indices[0] & 8u)
+	{
+		for (uint c = 0; c < 4; ++c)
+		{
+			const uint swap = quantized[0][c];
+			quantized[0][c] = quantized[1][c];
+			quantized[1][c] = swap;
+		}
+
+		const uint swap = pBits[0];
+		pBits[0] = pBits[1];
+		pBits[1] = swap;
+
+		for (uint i = 0; i < BLOCK_PIXELS; ++i)
+			indices[i] = 15u - indices[i];
+	}
+
+	BlockBits bits;
+	bits.Write(1u << 6, 7);
+	for (uint c = 0; c < 4; ++c)
+	{
+		bits.Write(quantized[0][c], 7);
+		bits.Write(quantized[1][c], 7);
+	}
+	bits.Write(pBits[0], 1);
+	bits.Write(pBits[1], 1);
+
+	bits.Write(indices[0], 3);
+	for (uint i = 1; i < BLOCK_PIXELS; ++i)
+		bits.Write(indices[i], 4);
+
+	memcpy(output, bits.bits, sizeof(bits.bits));
+}
+
+// ----- TextureCompressor -----
+
+TextureCompressor::TextureCompressor(CompressionQuality quality, JobSystem* jobs) : quality(quality), jobs(jobs)
+{}
+
+TextureFormat TextureCompressor::ChooseFormat(const TextureData& source, bool isNormalMap) const
+{
+	if (isNormalMap)
+		return TextureFormat::BC5;
+
+	if (quality == CompressionQuality::HIGH)
+		return TextureFormat::BC7;
+
+	if (source.format == TextureFormat::RGBA8 && !source.levels.empty())
+	{
+		const std::vector<uchar>& data = source.levels[0].data;
+		for (uint i = 3; i < data.size(); i += 4)
+		{
+			if (data[i] != 255)
+				return TextureFormat::BC3;
+		}
+	}
+
+	return TextureFormat::BC1;
+}
+
+bool TextureCompressor::Compress(const TextureData& source, TextureFormat format, TextureData& compressed) const
+{
+	const uint bytesPerPixel = source.GetBytesPerPixel();
+
+	compressed.format = format;
+	const uint blockSize = compressed.GetBlockSize();
+	if (bytesPerPixel == 0 || blockSize == 0)
+		return false;
+
+	compressed.width = source.width;
+	compressed.height = source.height;
+	compressed.topDown = source.topDown;
+	compressed.levels.resize(source.levels.size());
+
+	for (uint i = 0; i < source.levels.size(); ++i)
+	{
+		if (source.levels[i].width == 0 || source.levels[i].height == 0)
+			return false;
+
+		CompressLevel(source.levels[i], bytesPerPixel, format, blockSize, compressed.levels[i]);
+	}
+
+	return !compressed.levels.empty();
+}
+
+void TextureCompressor::CompressLevel(const TextureLevel& source, uint bytesPerPixel, TextureFormat format, uint blockSize, TextureLevel& compressed) const
+{
+	const uint blocksX = (source.width + 3) / 4;
+	const uint blocksY = (source.height + 3) / 4;
+
+	compressed.width = source.width;
+	compressed.height = source.height;
+	compressed.data.resize(blocksX * blocksY * blockSize);
+
+	auto compressRow = [&](uint blockY)
+	{
+		Block block;
+		for (uint blockX = 0; blockX < blocksX; ++blockX)
+		{
+			LoadBlock(source, bytesPerPixel, blockX, blockY, block);
+			uchar* output = &compressed.data[(blockY * blocksX + blockX) * blockSize];
+
+			switch (format)
+			{
+			case TextureFormat::BC1:
+				EncodeColorBlock(block, quality, output);
+				break;
+			case TextureFormat::BC3:
+				EncodeChannelBlock(block, 3, quality, output);
+				EncodeColorBlock(block, quality, output + 8);
+				break;
+			case TextureFormat::BC5:
+				EncodeChannelBlock(block, 0, quality, output);
+				EncodeChannelBlock(block, 1, quality, output + 8);
+				break;
+			case TextureFormat::BC7:
+				EncodeBC7Block(block, quality, output);
+				break;
+			default:
+				break;
+			}
+		}
+	};
+
+	if (jobs != nullptr)
+	{
+		jobs->ParallelFor(blocksY, compressRow);
+	}
+	else
+	{
+		for (uint blockY = 0; blockY < blocksY; ++blockY)
+			compressRow(blockY);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef __TEXTURE_COMPRESSOR_H__
+#define __TEXTURE_COMPRESSOR_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include "TextureData.h"
+
+
+
+class JobSystem;
+
+enum class CompressionQuality
+{
+	// Bounding box endpoints
+	FAST = 0,
+	// Principal axis endpoints
+	NORMAL,
+	// Least squares refined endpoints, BC7 for color textures
+	HIGH
+};
+
+// CPU block compression encoder used when cooking textures, SSE2 per block and one job per row of blocks
+class TextureCompressor
+{
+public:
+
+	// Constructor, without a job system every level is compressed on the calling thread
+	TextureCompressor(CompressionQuality quality, JobSystem* jobs = nullptr);
+
+	// Best block format for an uncompressed texture
+	TextureFormat ChooseFormat(const TextureData& source, bool isNormalMap) const;
+	// Compress every level of an RGB8/RGBA8 texture into a BC format
+	bool Compress(const TextureData& source, TextureFormat format, TextureData& compressed) const;
+
+private:
+
+	void CompressLevel(const TextureLevel& source, uint bytesPerPixel, TextureFormat format, uint blockSize, TextureLevel& compressed) const;
+
+private:
+
+	CompressionQuality quality;
+	JobSystem* jobs = nullptr;
+
+};
+
+#endif // !__TEXTURE_COMPRESSOR_H__
\ No newline at end of file
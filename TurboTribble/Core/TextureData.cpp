@@ -0,0 +1,228 @@
+#include "TextureData.h"
+
+#include <string.h>
+
+#define TEXTURE_FLAG_TOP_DOWN 1
+
+
+
+struct TextureFileHeader
+{
+	uint magic;
+	uint version;
+	uint format;
+	uint width;
+	uint height;
+	uint numLevels;
+	uint flags;
+};
+
+// Levels of a full chain down to 1x1
+static uint CountLevels(uint width, uint height)
+{
+	uint levels = 1;
+	for (uint size = MAX(width, height); size > 1; size /= 2)
+		++levels;
+	return levels;
+}
+
+uint TextureData::Serialize(char** buffer) const
+{
+	// The level table sits right after the header so a reader can seek to any level without reading the ones before it
+	const uint tableSize = sizeof(TextureLevelRange) * levels.size();
+	uint size = sizeof(TextureFileHeader) + tableSize;
+	for (const TextureLevel& level : levels)
+		size += level.data.size();
+
+	*buffer = new char[size];
+	char* cursor = *buffer;
+
+	TextureFileHeader header;
+	header.magic = TEXTURE_FILE_MAGIC;
+	header.version = TEXTURE_FILE_VERSION;
+	header.format = static_cast<uint>(format);
+	header.width = width;
+	header.height = height;
+	header.numLevels = levels.size();
+	header.flags = topDown ? TEXTURE_FLAG_TOP_DOWN : 0;
+	memcpy(cursor, &header, sizeof(header));
+	cursor += sizeof(header);
+
+	uint offset = sizeof(TextureFileHeader) + tableSize;
+	for (const TextureLevel& level : levels)
+	{
+		TextureLevelRange range;
+		range.offset = offset;
+		range.size = level.data.size();
+		memcpy(cursor, &range, sizeof(range));
+		cursor += sizeof(range);
+		offset += range.size;
+	}
+
+	for (const TextureLevel& level : levels)
+	{
+		if (!level.data.empty())
+			memcpy(cursor, &level.data[0], level.data.size());
+		cursor += level.data.size();
+	}
+
+	return size;
+}
+
+bool TextureData::Deserialize(const char* buffer, uint size)
+{
+	std::vector<TextureLevelRange> ranges;
+	if (!DeserializeHeader(buffer, size, ranges))
+		return false;
+
+	const uint offset = ranges[0].offset;
+	return DeserializeLevels(buffer + offset, size - offset, 0, ranges);
+}
+
+bool TextureData::DeserializeHeader(const char* buffer, uint size, std::vector<TextureLevelRange>& ranges)
+{
+	levels.clear();
+	ranges.clear();
+	if (buffer == nullptr || size < sizeof(TextureFileHeader))
+		return false;
+
+	TextureFileHeader header;
+	memcpy(&header, buffer, sizeof(header));
+	if (header.magic != TEXTURE_FILE_MAGIC || header.version != TEXTURE_FILE_VERSION)
+	{
+		TTLOG("### Texture container has a wrong magic or version ###\n");
+		return false;
+	}
+
+	// Nothing past this point is trusted, the levels go straight to the device
+	if (header.format > static_cast<uint>(TextureFormat::BC7) || header.width == 0 || header.height == 0 || header.width > TEXTURE_MAX_SIZE || header.height > TEXTURE_MAX_SIZE)
+	{
+		TTLOG("### Texture container has a wrong format or size ###\n");
+		return false;
+	}
+
+	const uint maxLevels = CountLevels(header.width, header.height);
+	if (header.numLevels == 0 || header.numLevels > maxLevels)
+	{
+		TTLOG("### Texture container has %u levels, at most %u fit ###\n", header.numLevels, maxLevels);
+		return false;
+	}
+
+	const uint tableSize = sizeof(TextureLevelRange) * header.numLevels;
+	if (size - sizeof(header) < tableSize)
+		return false;
+
+	format = static_cast<TextureFormat>(header.format);
+	width = header.width;
+	height = header.height;
+	topDown = (header.flags & TEXTURE_FLAG_TOP_DOWN) != 0;
+	levels.resize(header.numLevels);
+	ranges.resize(header.numLevels);
+	memcpy(&ranges[0], buffer + sizeof(header), tableSize);
+
+	uint offset = sizeof(header) + tableSize;
+	for (uint i = 0; i < levels.size(); ++i)
+	{
+		// Every level halves the one before it, the way the mips are generated, and follows it in the file
+		TextureLevel& level = levels[i];
+		level.width = MAX(1u, width >> i);
+		level.height = MAX(1u, height >> i);
+		if (ranges[i].offset != offset || ranges[i].size != GetLevelSize(level.width, level.height))
+		{
+			TTLOG("### Texture container level %u is corrupt ###\n", i);
+			levels.clear();
+			ranges.clear();
+			return false;
+		}
+		offset += ranges[i].size;
+	}
+
+	return true;
+}
+
+bool TextureData::DeserializeLevels(const char* buffer, uint size, uint first, const std::vector<TextureLevelRange>& ranges)
+{
+	if (first >= levels.size() || ranges.size() != levels.size())
+		return false;
+
+	// The levels are stored back to back, so the buffer holds all of them from the first one on
+	const uint start = ranges[first].offset;
+	for (uint i = first; i < levels.size(); ++i)
+	{
+		const TextureLevelRange& range = ranges[i];
+		if (size < range.offset - start || size - (range.offset - start) < range.size)
+		{
+			TTLOG("### Texture container level %u is cut short ###\n", i);
+			levels.clear();
+			return false;
+		}
+
+		const char* data = buffer + (range.offset - start);
+		levels[i].data.assign(data, data + range.size);
+	}
+
+	DropLevels(first);
+	return true;
+}
+
+uint TextureData::GetMaxHeaderSize()
+{
+	return sizeof(TextureFileHeader) + sizeof(TextureLevelRange) * CountLevels(TEXTURE_MAX_SIZE, TEXTURE_MAX_SIZE);
+}
+
+uint TextureData::GetBytesPerPixel() const
+{
+	switch (format)
+	{
+	case TextureFormat::RGB8:
+		return 3;
+	case TextureFormat::RGBA8:
+		return 4;
+	default:
+		break;
+	}
+	return 0;
+}
+
+uint TextureData::GetBlockSize() const
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return 8;
+	case TextureFormat::BC3:
+	case TextureFormat::BC5:
+	case TextureFormat::BC7:
+		return 16;
+	default:
+		break;
+	}
+	return 0;
+}
+
+uint TextureData::GetLevelSize(uint width, uint height) const
+{
+	const uint blockSize = GetBlockSize();
+	if (blockSize != 0)
+		return ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+
+	return width * height * GetBytesPerPixel();
+}
+
+uint TextureData::GetSizeInBytes() const
+{
+	uint size = 0;
+	for (const TextureLevel& level : levels)
+		size += level.data.size();
+	return size;
+}
+
+void TextureData::DropLevels(uint count)
+{
+	if (count == 0 || count >= levels.size())
+		return;
+
+	levels.erase(levels.begin(), levels.begin() + count);
+	width = levels[0].width;
+	height = levels[0].height;
+}
\ No newline at end of file
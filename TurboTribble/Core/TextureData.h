@@ -0,0 +1,75 @@
+#ifndef __TEXTURE_DATA_H__
+#define __TEXTURE_DATA_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <vector>
+
+// Cooked texture container stored in the Library ("TTEX")
+#define TEXTURE_FILE_MAGIC 0x58455454
+#define TEXTURE_FILE_VERSION 4
+// Largest dimension a container may declare, anything bigger is a corrupt file
+#define TEXTURE_MAX_SIZE 16384
+
+
+
+enum class TextureFormat : uint
+{
+	RGB8 = 0,
+	RGBA8,
+	// Block compressed, every 4x4 block of pixels is stored in GetBlockSize() bytes
+	BC1,
+	BC3,
+	BC5,
+	BC7
+};
+
+struct TextureLevel
+{
+	uint width = 0, height = 0;
+	std::vector<uchar> data;
+};
+
+// Entry of the level table after the container header, offsets count from the start of the file
+struct TextureLevelRange
+{
+	uint offset = 0;
+	uint size = 0;
+};
+
+// CPU side texture, independent of any GL context so it can be decoded and cooked on worker threads
+struct TextureData
+{
+	// Write the Library container, the caller owns the returned buffer
+	uint Serialize(char** buffer) const;
+	// Read a Library container
+	bool Deserialize(const char* buffer, uint size);
+	// Read the header and level table of a Library container, the levels get their sizes but no data
+	bool DeserializeHeader(const char* buffer, uint size, std::vector<TextureLevelRange>& ranges);
+	// Fill the levels from first on with the bytes from the offset of that level, the levels before it are dropped
+	bool DeserializeLevels(const char* buffer, uint size, uint first, const std::vector<TextureLevelRange>& ranges);
+	// Bytes of the header and level table of the largest container, enough to read any header in one go
+	static uint GetMaxHeaderSize();
+
+	// Bytes per pixel of uncompressed formats
+	uint GetBytesPerPixel() const;
+	// Bytes per 4x4 block of compressed formats
+	uint GetBlockSize() const;
+	inline bool IsCompressed() const { return GetBlockSize() != 0; }
+	// Bytes of one level of the given size in this format
+	uint GetLevelSize(uint width, uint height) const;
+	// Sum of all levels
+	uint GetSizeInBytes() const;
+	// Remove the most detailed levels, the next one becomes the full resolution image
+	void DropLevels(uint count);
+
+	TextureFormat format = TextureFormat::RGBA8;
+	uint width = 0, height = 0;
+	// Rows are in file order instead of the bottom up order of GL, the model UVs are flipped instead
+	bool topDown = false;
+	// Level 0 is the full resolution image
+	std::vector<TextureLevel> levels;
+};
+
+#endif // !__TEXTURE_DATA_H__
\ No newline at end of file
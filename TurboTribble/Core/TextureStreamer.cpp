@@ -0,0 +1,113 @@
+#include "TextureStreamer.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Smallest level stored, one compressed block
+#define MIN_LEVEL_SIZE 16
+
+
+
+TextureStreamer::TextureStreamer(uint minResidentSize) : minResidentSize(MAX(minResidentSize, 1u))
+{}
+
+float TextureStreamer::ProjectedSize(const Frustum& frustum, const AABB& bounds, float viewportHeight)
+{
+	if (!frustum.Intersects(bounds))
+		return 0.f;
+
+	const float3 center = bounds.CenterPoint();
+	const float radius = bounds.HalfDiagonal().Length();
+
+	if (frustum.type == FrustumType::OrthographicFrustum)
+		return viewportHeight * radius * 2.f / frustum.orthographicHeight;
+
+	// Inside the bounds the object covers the whole view
+	const float distance = center.Distance(frustum.pos);
+	if (distance <= radius)
+		return viewportHeight;
+
+	return MIN(viewportHeight * radius / (distance * tanf(frustum.verticalFov * 0.5f)), viewportHeight);
+}
+
+uint TextureStreamer::GetMinimumMip(uint width, uint height, uint numLevels) const
+{
+	uint mip = 0;
+	for (uint size = MAX(width, height); size > minResidentSize && mip + 1 < numLevels; size /= 2)
+		++mip;
+	return mip;
+}
+
+uint TextureStreamer::GetWantedMip(uint width, uint height, uint numLevels, float screenSize) const
+{
+	const uint minimumMip = GetMinimumMip(width, height, numLevels);
+	if (screenSize <= 0.f)
+		return minimumMip;
+
+	// Level whose size is still at least the size on screen
+	const float ratio = static_cast<float>(MAX(width, height)) / screenSize;
+	const uint mip = ratio > 1.f ? static_cast<uint>(floorf(log2f(ratio))) : 0;
+	return MIN(mip, minimumMip);
+}
+
+uint64 TextureStreamer::GetChainSize(uint64 baseSize, uint numLevels, uint mip)
+{
+	uint64 size = 0;
+	for (uint level = mip; level < numLevels; ++level)
+		size += MAX(baseSize >> (level * 2), static_cast<uint64>(MIN_LEVEL_SIZE));
+	return size;
+}
+
+void TextureStreamer::Plan(std::vector<StreamingTexture>& textures, uint64 budgetBytes) const
+{
+	std::vector<uint> wanted(textures.size());
+	uint64 total = 0;
+
+	// Detail already resident is kept while there is room for it
+	for (uint i = 0; i < textures.size(); ++i)
+	{
+		StreamingTexture& texture = textures[i];
+		wanted[i] = GetWantedMip(texture.width, texture.height, texture.numLevels, texture.screenSize);
+		texture.targetMip = MIN(wanted[i], texture.residentMip);
+		total += GetChainSize(texture.baseSize, texture.numLevels, texture.targetMip);
+	}
+
+	if (total <= budgetBytes)
+		return;
+
+	std::vector<uint> order(textures.size());
+	for (uint i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [&textures](uint a, uint b) { return textures[a].screenSize < textures[b].screenSize; });
+
+	// First the detail nobody needs right now, least visible textures first
+	for (uint i = 0; i < order.size() && total > budgetBytes; ++i)
+	{
+		StreamingTexture& texture = textures[order[i]];
+		if (texture.targetMip < wanted[order[i]])
+		{
+			total -= GetChainSize(texture.baseSize, texture.numLevels, texture.targetMip);
+			texture.targetMip = wanted[order[i]];
+			total += GetChainSize(texture.baseSize, texture.numLevels, texture.targetMip);
+		}
+	}
+
+	// Then one level at a time from every texture, so the loss is spread instead of ruining a few
+	bool dropped = true;
+	while (total > budgetBytes && dropped)
+	{
+		dropped = false;
+		for (uint i = 0; i < order.size() && total > budgetBytes; ++i)
+		{
+			StreamingTexture& texture = textures[order[i]];
+			if (texture.targetMip >= GetMinimumMip(texture.width, texture.height, texture.numLevels))
+				continue;
+
+			total -= GetChainSize(texture.baseSize, texture.numLevels, texture.targetMip);
+			++texture.targetMip;
+			total += GetChainSize(texture.baseSize, texture.numLevels, texture.targetMip);
+			dropped = true;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef __TEXTURE_STREAMER_H__
+#define __TEXTURE_STREAMER_H__
+
+#include "Globals.h"
+#include "p2Defs.h"
+
+#include <vector>
+#include "Geometry/Frustum.h"
+#include "Geometry/AABB.h"
+
+
+
+// What the streamer needs to know about a texture, filled by the texture cache every planning pass
+struct StreamingTexture
+{
+	// Full resolution and levels of the cooked chain
+	uint width = 0, height = 0;
+	uint numLevels = 1;
+	// Bytes of the full resolution level, smaller levels are derived from it
+	uint64 baseSize = 0;
+	// Largest projected size in pixels since the last pass, 0 when it was not seen
+	float screenSize = 0.f;
+	// Most detailed level resident in VRAM
+	uint residentMip = 0;
+
+	// Output, most detailed level that should be resident
+	uint targetMip = 0;
+};
+
+// Decides which mip levels of every texture should be resident, no GL involved
+// Textures always keep the levels under the minimum resident size, detail above it follows the on-screen size
+// Under memory pressure the least visible textures lose their detail first
+class TextureStreamer
+{
+public:
+
+	// Constructor, minResidentSize is the largest dimension of the lowest detail ever resident
+	TextureStreamer(uint minResidentSize = 64);
+
+	// Projected height in pixels of a box, 0 when it is outside the frustum
+	static float ProjectedSize(const Frustum& frustum, const AABB& bounds, float viewportHeight);
+
+	// Level that is always resident
+	uint GetMinimumMip(uint width, uint height, uint numLevels) const;
+	// Least detailed level that still has a texel for every pixel at a screen size
+	uint GetWantedMip(uint width, uint height, uint numLevels, float screenSize) const;
+	// Bytes of the levels from a mip down to the smallest one
+	static uint64 GetChainSize(uint64 baseSize, uint numLevels, uint mip);
+
+	// Fill targetMip of every texture so the chains fit in the budget whenever the minimum levels do
+	void Plan(std::vector<StreamingTexture>& textures, uint64 budgetBytes) const;
+
+private:
+
+	uint minResidentSize;
+
+};
+
+#endif // !__TEXTURE_STREAMER_H__
\ No newline at end of file
@@ -5,8 +5,17 @@
 
 #include "Timer.h"
 
+#include <chrono>
 
 
+
+// Milliseconds since the first call, wraps after 49 days
+static uint32 GetTicks()
+{
+	static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	return static_cast<uint32>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - origin).count());
+}
+
 // ---------------------------------------------
 Timer::Timer()
 {
@@ -17,22 +26,22 @@ Timer::Timer()
 void Timer::Start()
 {
 	running = true;
-	startedAt = SDL_GetTicks();
+	startedAt = GetTicks();
 }
 
 // ---------------------------------------------
 void Timer::Stop()
 {
 	running = false;
-	stoppedAt = SDL_GetTicks();
+	stoppedAt = GetTicks();
 }
 
 // ---------------------------------------------
-Uint32 Timer::Read()
+uint32 Timer::Read()
 {
 	if (running == true)
 	{
-		return SDL_GetTicks() - startedAt;
+		return GetTicks() - startedAt;
 	}
 	else
 	{
@@ -42,5 +51,5 @@ Uint32 Timer::Read()
 
 float Timer::ReadSec() const
 {
-	return float(SDL_GetTicks() - startedAt) / 1000.0f;
+	return float(GetTicks() - startedAt) / 1000.0f;
 }
\ No newline at end of file
@@ -3,7 +3,6 @@
 
 #include "Globals.h"
 #include "p2Defs.h"
-#include "SDL\include\SDL.h"
 
 
 
@@ -18,14 +17,14 @@ public:
 	void Stop();
 
 
-	Uint32 Read();
+	uint32 Read();
 	float ReadSec() const;
 
 private:
 
 	bool	running;
-	Uint32	startedAt;
-	Uint32	stoppedAt;
+	uint32	startedAt;
+	uint32	stoppedAt;
 };
 
 #endif // !__TIMER_H__
\ No newline at end of file
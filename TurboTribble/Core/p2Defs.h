@@ -39,8 +39,8 @@
 #define TO_BOOL( a )  ( (a != 0) ? true : false )
 
 typedef unsigned int uint;
-typedef unsigned __int32 uint32;
-typedef unsigned __int64 uint64;
+typedef unsigned int uint32;
+typedef unsigned long long uint64;
 typedef unsigned char uchar;
 
 template <class VALUE_TYPE> void SWAP(VALUE_TYPE& a, VALUE_TYPE& b)
@@ -59,7 +59,7 @@ template <class VALUE_TYPE> void SWAP(VALUE_TYPE& a, VALUE_TYPE& b)
 inline const char* const PATH(const char* folder, const char* file)
 {
 	static char path[MID_STR];
-	sprintf_s(path, MID_STR, "%s/%s", folder, file);
+	snprintf(path, MID_STR, "%s/%s", folder, file);
 	return path;
 }
 
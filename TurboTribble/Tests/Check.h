@@ -0,0 +1,19 @@
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <stdio.h>
+
+// Returned by a test that can not run on this machine, ctest reports it as skipped
+#define TEST_SKIPPED 77
+
+
+
+// Every test is its own executable, main returns CHECK_RESULT() so ctest sees the failures
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { printf("%s(%d) : CHECK failed: %s\n", __FILE__, __LINE__, #condition); ++checkFailures; } } while (0)
+
+#define CHECK_RESULT() (checkFailures == 0 ? 0 : 1)
+
+#endif // !__CHECK_H__
\ No newline at end of file
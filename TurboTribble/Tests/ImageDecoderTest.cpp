@@ -0,0 +1,99 @@
+// ----------------------------------------------------
+// ImageDecoderTest.cpp
+// TGA decoding without DevIL, raw and RLE files give the same pixels and anything else is left to DevIL
+// ----------------------------------------------------
+
+#include "Check.h"
+
+#include "ImageDecoder.h"
+
+#include <string.h>
+#include <vector>
+
+#define TEST_WIDTH 5
+#define TEST_HEIGHT 3
+
+
+
+static std::vector<uchar> MakeHeader(uint imageType, uint bitsPerPixel, uint descriptor)
+{
+	std::vector<uchar> file(TGA_HEADER_SIZE, 0);
+	file[2] = static_cast<uchar>(imageType);
+	file[12] = TEST_WIDTH;
+	file[14] = TEST_HEIGHT;
+	file[16] = static_cast<uchar>(bitsPerPixel);
+	file[17] = static_cast<uchar>(descriptor);
+	return file;
+}
+
+// Every pixel different, BGRA order like the file
+static std::vector<uchar> MakePixels(uint bytesPerPixel)
+{
+	std::vector<uchar> pixels(TEST_WIDTH * TEST_HEIGHT * bytesPerPixel);
+	for (uint i = 0; i < pixels.size(); ++i)
+		pixels[i] = static_cast<uchar>(i * 7 + 1);
+	return pixels;
+}
+
+int main()
+{
+	TextureData texture;
+	bool upperLeft = true;
+
+	// Uncompressed 24 bit, bottom row first
+	const std::vector<uchar> pixels24 = MakePixels(3);
+	std::vector<uchar> raw = MakeHeader(2, 24, 0);
+	raw.insert(raw.end(), pixels24.begin(), pixels24.end());
+	CHECK(ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(raw.data()), static_cast<uint>(raw.size()), texture, upperLeft));
+	CHECK(!upperLeft);
+	CHECK(texture.format == TextureFormat::RGB8 && texture.width == TEST_WIDTH && texture.height == TEST_HEIGHT);
+	CHECK(texture.levels.size() == 1 && texture.levels[0].data == pixels24);
+
+	// Cut short by one byte
+	CHECK(!ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(raw.data()), static_cast<uint>(raw.size()) - 1, texture, upperLeft));
+
+	// RLE 32 bit with 8 alpha bits, top row first, an image id to skip, one run crossing rows and raw packets for the rest
+	std::vector<uchar> pixels32 = MakePixels(4);
+	for (uint i = 1; i < 7; ++i)
+		memcpy(&pixels32[i * 4], &pixels32[0], 4);
+
+	std::vector<uchar> rle = MakeHeader(10, 32, 0x28);
+	rle[0] = 3;
+	rle.insert(rle.end(), { 'i', 'd', '!' });
+	rle.push_back(0x80 | 6);
+	rle.insert(rle.end(), pixels32.begin(), pixels32.begin() + 4);
+	rle.push_back(7);
+	rle.insert(rle.end(), pixels32.begin() + 7 * 4, pixels32.end());
+	CHECK(ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(rle.data()), static_cast<uint>(rle.size()), texture, upperLeft));
+	CHECK(upperLeft);
+	CHECK(texture.format == TextureFormat::RGBA8);
+	CHECK(texture.levels.size() == 1 && texture.levels[0].data == pixels32);
+
+	// A run longer than the image is a corrupt file
+	std::vector<uchar> overrun = MakeHeader(10, 24, 0);
+	for (uint i = 0; i < 2; ++i)
+	{
+		overrun.push_back(0x80 | 127);
+		overrun.insert(overrun.end(), { 1, 2, 3 });
+	}
+	CHECK(!ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(overrun.data()), static_cast<uint>(overrun.size()), texture, upperLeft));
+
+	// 32 bit without alpha bits is opaque whatever the padding holds
+	std::vector<uchar> padded = MakeHeader(2, 32, 0);
+	padded.insert(padded.end(), pixels32.begin(), pixels32.end());
+	CHECK(ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(padded.data()), static_cast<uint>(padded.size()), texture, upperLeft));
+	CHECK(texture.levels.size() == 1 && texture.levels[0].data[3] == 255 && texture.levels[0].data[TEST_WIDTH * TEST_HEIGHT * 4 - 1] == 255);
+
+	// Other formats and the TGA layouts that are not handled go to DevIL
+	const uchar png[TGA_HEADER_SIZE + 8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	CHECK(!ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(png), sizeof(png), texture, upperLeft));
+	std::vector<uchar> mapped = MakeHeader(1, 8, 0);
+	mapped[1] = 1;
+	mapped.resize(mapped.size() + 1024);
+	CHECK(!ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(mapped.data()), static_cast<uint>(mapped.size()), texture, upperLeft));
+	std::vector<uchar> mirrored = MakeHeader(2, 24, 0x10);
+	mirrored.insert(mirrored.end(), pixels24.begin(), pixels24.end());
+	CHECK(!ImageDecoder::DecodeTGA(reinterpret_cast<const char*>(mirrored.data()), static_cast<uint>(mirrored.size()), texture, upperLeft));
+
+	return CHECK_RESULT();
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+// ----------------------------------------------------
+// LightClustersTest.cpp
+// Point and spot lights land in the clusters worked out by hand, and the empty clusters take no indices
+// ----------------------------------------------------
+
+#include "Check.h"
+
+#include "LightClusters.h"
+#include "JobSystem.h"
+
+#include <vector>
+
+// 90 degrees both ways, tiles are 1/8 of the depth wide and 1/4 high
+// Slices split 1 to 1024 exponentially, slice s starts at a depth of 2^(10s/24), slice 12 covers 32 to 42.7
+#define TEST_NEAR 1.f
+#define TEST_FAR 1024.f
+
+
+
+static ClusterLight MakePoint(const float3& position, float range)
+{
+	ClusterLight light;
+	light.positionRange = float4(position, range);
+	light.colorCosInner = float4(1.f, 1.f, 1.f, 1.f);
+	light.directionCosOuter = float4(0.f, 0.f, -1.f, POINT_LIGHT_COS);
+	return light;
+}
+
+static ClusterLight MakeSpot(const float3& position, const float3& direction, float range, float cosOuter)
+{
+	ClusterLight light;
+	light.positionRange = float4(position, range);
+	light.colorCosInner = float4(1.f, 1.f, 1.f, 1.f);
+	light.directionCosOuter = float4(direction, cosOuter);
+	return light;
+}
+
+// Exactly the clusters listed hold the light, the light is the only one binned
+static void CheckSingle(LightClusters& clusters, const ClusterLight& light, const std::vector<uint>& expected)
+{
+	clusters.Bin(float4x4::identity, &light, 1);
+	CHECK(clusters.GetNumVisibleLights() == 1);
+	CHECK(clusters.GetNumIndices() == expected.size());
+
+	uint found = 0;
+	for (uint cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+	{
+		if (clusters.GetCount(cluster) == 0)
+			continue;
+
+		++found;
+		bool listed = false;
+		for (uint index : expected)
+			listed = listed || index == cluster;
+		CHECK(listed);
+		CHECK(clusters.GetCount(cluster) == 1 && clusters.GetIndex(clusters.GetOffset(cluster)) == 0);
+	}
+	CHECK(found == expected.size());
+}
+
+static void RunChecks(JobSystem* jobs)
+{
+	LightClusters clusters;
+	clusters.Init(jobs);
+	clusters.SetProjection(1.f, 1.f, TEST_NEAR, TEST_FAR);
+
+	CHECK(clusters.GetSlice(31.f) == 11);
+	CHECK(clusters.GetSlice(33.f) == 12);
+	CHECK(clusters.GetSlice(0.1f) == 0);
+	CHECK(clusters.GetSlice(5000.f) == CLUSTER_SLICES - 1);
+
+	// Centered in the cluster at x 0.125 to 0.25 and y 0.25 to 0.5 of the depth
+	const uint inside = LightClusters::GetClusterIndex(9, 5, 12);
+	CheckSingle(clusters, MakePoint(float3(6.9375f, 13.875f, -37.f), 0.5f), { inside });
+
+	// Narrow spot, bounded by the sphere through its tip, centered on the same spot
+	CheckSingle(clusters, MakeSpot(float3(6.9375f, 13.875f, -36.4444f), float3(0.f, 0.f, -1.f), 1.f, 0.9f), { inside });
+	// Wide spot, bounded by the sphere through its rim
+	CheckSingle(clusters, MakeSpot(float3(6.9375f, 13.875f, -36.5f), float3(0.f, 0.f, -1.f), 1.f, 0.5f), { inside });
+
+	// On the edge between two tiles across, and on the edge between two slices
+	const uint across = LightClusters::GetClusterIndex(10, 5, 12);
+	const uint nearer = LightClusters::GetClusterIndex(9, 5, 11);
+	CheckSingle(clusters, MakePoint(float3(9.25f, 13.875f, -37.f), 0.5f), { inside, across });
+	CheckSingle(clusters, MakePoint(float3(6.f, 12.f, -32.f), 0.5f), { nearer, inside });
+
+	// Behind the camera, and a spot in front of the near plane facing away from the view while a point light there reaches into it
+	ClusterLight hidden[2] = { MakePoint(float3(0.f, 0.f, 10.f), 5.f), MakeSpot(float3(0.f, 0.f, -0.5f), float3(0.f, 0.f, 1.f), 2.f, 0.9f) };
+	clusters.Bin(float4x4::identity, hidden, 2);
+	CHECK(clusters.GetNumVisibleLights() == 0);
+	CHECK(clusters.GetNumIndices() == 0);
+	const ClusterLight reaching = MakePoint(float3(0.f, 0.f, -0.5f), 2.f);
+	clusters.Bin(float4x4::identity, &reaching, 1);
+	CHECK(clusters.GetNumVisibleLights() == 1);
+
+	// Together, the lists follow the cluster order and the light order inside each cluster
+	ClusterLight lights[3] = { MakePoint(float3(6.9375f, 13.875f, -37.f), 0.5f), MakePoint(float3(9.25f, 13.875f, -37.f), 0.5f), MakePoint(float3(6.f, 12.f, -32.f), 0.5f) };
+	clusters.Bin(float4x4::identity, lights, 3);
+	CHECK(clusters.GetNumLights() == 3);
+	CHECK(clusters.GetNumIndices() == 5);
+	CHECK(clusters.GetMaxLightsPerCluster() == 3);
+	CHECK(clusters.GetNumDroppedIndices() == 0);
+
+	CHECK(clusters.GetOffset(nearer) == 0 && clusters.GetCount(nearer) == 1);
+	CHECK(clusters.GetIndex(0) == 2);
+	CHECK(clusters.GetOffset(inside) == 1 && clusters.GetCount(inside) == 3);
+	CHECK(clusters.GetIndex(1) == 0 && clusters.GetIndex(2) == 1 && clusters.GetIndex(3) == 2);
+	CHECK(clusters.GetOffset(across) == 4 && clusters.GetCount(across) == 1);
+	CHECK(clusters.GetIndex(4) == 1);
+
+	// Empty clusters point at where the next list starts and take no room
+	uint next = 0;
+	for (uint cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+	{
+		CHECK(clusters.GetOffset(cluster) == next);
+		next += clusters.GetCount(cluster);
+	}
+	CHECK(next == clusters.GetNumIndices());
+}
+
+int main()
+{
+	// On the calling thread and split by slice over the workers
+	RunChecks(nullptr);
+
+	JobSystem jobs(2);
+	RunChecks(&jobs);
+
+	return CHECK_RESULT();
+}
\ No newline at end of file
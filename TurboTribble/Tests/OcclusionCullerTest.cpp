@@ -0,0 +1,114 @@
+// ----------------------------------------------------
+// OcclusionCullerTest.cpp
+// The AVX2 rasterizer must fill the same buffer and hide the same boxes as the scalar one
+// ----------------------------------------------------
+
+#include "Check.h"
+
+#include "OcclusionCuller.h"
+#include "CpuInfo.h"
+#include "JobSystem.h"
+
+#include <math.h>
+#include <vector>
+#include "Geometry/Frustum.h"
+#include "Math/float4x4.h"
+
+
+
+// Small LCG so the scene is the same on every run and platform
+static float Random(uint& seed, float min, float max)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return min + (max - min) * static_cast<float>(seed >> 8) / 16777216.f;
+}
+
+static Frustum MakeCamera()
+{
+	Frustum frustum;
+	frustum.type = FrustumType::PerspectiveFrustum;
+	frustum.pos = float3(0.f, 2.f, -20.f);
+	frustum.front = float3(0.f, 0.f, 1.f);
+	frustum.up = float3(0.f, 1.f, 0.f);
+	frustum.nearPlaneDistance = 0.1f;
+	frustum.farPlaneDistance = 200.f;
+	frustum.verticalFov = 1.f;
+	frustum.horizontalFov = 2.f * atanf(tanf(frustum.verticalFov * 0.5f) * 2.f);
+	return frustum;
+}
+
+int main()
+{
+	if (!HasAVX2())
+	{
+		printf("No AVX2 on this CPU, only the scalar path can run\n");
+		return TEST_SKIPPED;
+	}
+
+	JobSystem jobs(2);
+	OcclusionCuller scalar(false);
+	OcclusionCuller wide;
+	scalar.Init(&jobs);
+	wide.Init(&jobs);
+	CHECK(!scalar.UsesAVX2());
+	CHECK(wide.UsesAVX2());
+
+	// Quads of random size and depth, some of them partly behind the camera or off screen
+	uint seed = 12345u;
+	std::vector<float3> vertices;
+	std::vector<uint> indices;
+	for (uint i = 0; i < 64; ++i)
+	{
+		const float3 center(Random(seed, -30.f, 30.f), Random(seed, -15.f, 15.f), Random(seed, -25.f, 60.f));
+		const float3 extent(Random(seed, 0.2f, 6.f), Random(seed, 0.2f, 6.f), Random(seed, -2.f, 2.f));
+
+		const uint first = static_cast<uint>(vertices.size());
+		vertices.push_back(center + float3(-extent.x, -extent.y, -extent.z));
+		vertices.push_back(center + float3(extent.x, -extent.y, extent.z));
+		vertices.push_back(center + float3(extent.x, extent.y, extent.z));
+		vertices.push_back(center + float3(-extent.x, extent.y, -extent.z));
+
+		const uint quad[6] = { 0, 1, 2, 0, 2, 3 };
+		for (uint index : quad)
+			indices.push_back(first + index);
+	}
+
+	const Frustum camera = MakeCamera();
+	const float4x4 viewProjection = camera.ViewProjMatrix();
+	for (OcclusionCuller* culler : { &scalar, &wide })
+	{
+		culler->Begin(viewProjection);
+		culler->AddOccluder(float4x4::identity, vertices.data(), static_cast<uint>(vertices.size()), indices.data(), static_cast<uint>(indices.size()));
+		culler->Rasterize();
+	}
+
+	CHECK(scalar.GetNumTriangles() == wide.GetNumTriangles());
+	CHECK(scalar.GetNumTriangles() > 0);
+
+	// Bit for bit, both paths evaluate the edges and the depth plane in the same order
+	uint covered = 0, different = 0;
+	for (uint i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; ++i)
+	{
+		covered += scalar.GetDepth()[i] > 0.f ? 1 : 0;
+		different += scalar.GetDepth()[i] != wide.GetDepth()[i] ? 1 : 0;
+	}
+	CHECK(covered > 0);
+	CHECK(different == 0);
+
+	uint hidden = 0, mismatches = 0;
+	for (uint i = 0; i < 2000; ++i)
+	{
+		const float3 center(Random(seed, -40.f, 40.f), Random(seed, -20.f, 20.f), Random(seed, -10.f, 120.f));
+		const float3 halfSize(Random(seed, 0.05f, 3.f), Random(seed, 0.05f, 3.f), Random(seed, 0.05f, 3.f));
+		const AABB box(center - halfSize, center + halfSize);
+
+		const bool visible = scalar.IsVisible(box);
+		hidden += visible ? 0 : 1;
+		mismatches += visible != wide.IsVisible(box) ? 1 : 0;
+	}
+	CHECK(hidden > 0);
+	CHECK(mismatches == 0);
+
+	printf("%u covered pixels, %u of 2000 boxes hidden\n", covered, hidden);
+	return CHECK_RESULT();
+}
\ No newline at end of file
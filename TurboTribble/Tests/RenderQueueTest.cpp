@@ -0,0 +1,99 @@
+// ----------------------------------------------------
+// RenderQueueTest.cpp
+// Copies of a pooled mesh stay one instanced draw with other meshes of the page between them in depth, with and without multi draw
+// ----------------------------------------------------
+
+#include "Check.h"
+
+#include "RenderQueue.h"
+#include "RenderDeviceNull.h"
+
+#include "Math/float4x4.h"
+
+#define NUM_COPIES 10
+
+
+
+// Copies of two meshes of one pool page, the stats of every flush mode on a device with or without multi draw
+static void RunChecks(bool deviceMultiDraw)
+{
+	RenderDeviceNull device(deviceMultiDraw);
+	CHECK(device.SupportsMultiDraw() == deviceMultiDraw);
+
+	RenderQueue queue;
+	CHECK(queue.Init(&device, nullptr));
+	queue.SetNumLists(1);
+
+	// Two meshes of the same pool page, same buffers and different ranges
+	DrawCommand first;
+	first.vertexBuffer = device.CreateBuffer(BufferTarget::BUFFER_VERTEX, 1024, nullptr, BufferUsage::USAGE_STATIC);
+	first.normalBuffer = device.CreateBuffer(BufferTarget::BUFFER_VERTEX, 1024, nullptr, BufferUsage::USAGE_STATIC);
+	first.texCoordBuffer = device.CreateBuffer(BufferTarget::BUFFER_VERTEX, 1024, nullptr, BufferUsage::USAGE_STATIC);
+	first.indexBuffer = device.CreateBuffer(BufferTarget::BUFFER_INDEX, 1024, nullptr, BufferUsage::USAGE_STATIC);
+	first.numIndices = 36;
+	first.firstIndex = 0;
+	first.baseVertex = 0;
+
+	DrawCommand second = first;
+	second.numIndices = 36;
+	second.firstIndex = 36;
+	second.baseVertex = 24;
+
+	CHECK(RenderQueue::GetMeshId(first) != RenderQueue::GetMeshId(second));
+
+	const float4x4 transform = float4x4::identity;
+	first.transform = second.transform = &transform;
+
+	for (bool multiDraw : { false, true })
+	{
+		for (bool instancing : { true, false })
+		{
+			// Alternating depths, a key without the mesh field sorts them first, second, first...
+			for (uint i = 0; i < NUM_COPIES; ++i)
+			{
+				queue.GetList(0).Add(first, (2 * i) / (2.f * NUM_COPIES));
+				queue.GetList(0).Add(second, (2 * i + 1) / (2.f * NUM_COPIES));
+			}
+
+			const uint64 primitives = device.GetStats().primitives;
+			queue.Flush(instancing, multiDraw, false);
+
+			// Every mode draws the same triangles
+			CHECK(device.GetStats().primitives - primitives == 2 * NUM_COPIES * 12);
+
+			// Multi draw is ignored when the device can not do it
+			if (multiDraw && deviceMultiDraw)
+			{
+				// One page and one state, a single multi draw holding every group
+				CHECK(queue.GetNumDraws() == 1);
+				CHECK(queue.GetNumMultiDraws() == 1);
+				CHECK(queue.GetNumIndirectDraws() == (instancing ? 2 : 2 * NUM_COPIES));
+				CHECK(queue.GetNumInstancedDraws() == 0);
+			}
+			else
+			{
+				CHECK(queue.GetNumDraws() == (instancing ? 2 : 2 * NUM_COPIES));
+				CHECK(queue.GetNumInstancedDraws() == (instancing ? 2 : 0));
+				CHECK(queue.GetNumMultiDraws() == 0);
+				CHECK(queue.GetNumIndirectDraws() == 0);
+			}
+		}
+	}
+
+	queue.CleanUp();
+}
+
+int main()
+{
+	// Opaque draws still go front to back inside a mesh, the nearest copy has the smallest key
+	CHECK(RenderQueue::MakeKey(RenderPass::PASS_OPAQUE, 1, 0, 5, 0.1f) < RenderQueue::MakeKey(RenderPass::PASS_OPAQUE, 1, 0, 5, 0.2f));
+	CHECK(RenderQueue::MakeKey(RenderPass::PASS_OPAQUE, 1, 0, 5, 0.9f) < RenderQueue::MakeKey(RenderPass::PASS_OPAQUE, 1, 0, 6, 0.1f));
+	// Transparent ones back to front whatever their mesh
+	CHECK(RenderQueue::MakeKey(RenderPass::PASS_TRANSPARENT, 1, 0, 6, 0.9f) < RenderQueue::MakeKey(RenderPass::PASS_TRANSPARENT, 1, 0, 5, 0.1f));
+
+	// The default matches a GL 3.3 context, the other setting covers the indirect path
+	RunChecks(false);
+	RunChecks(true);
+
+	return CHECK_RESULT();
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+// ----------------------------------------------------
+// TextureStreamerTest.cpp
+// Mip selection from the projected size and the budget, and the level reads the streamer does
+// ----------------------------------------------------
+
+#include "Check.h"
+
+#include "TextureStreamer.h"
+#include "TextureData.h"
+
+#include <math.h>
+#include <vector>
+#include "Math/MathConstants.h"
+
+
+
+static Frustum MakeCamera()
+{
+	Frustum frustum;
+	frustum.type = FrustumType::PerspectiveFrustum;
+	frustum.pos = float3::zero;
+	frustum.front = float3::unitZ;
+	frustum.up = float3::unitY;
+	frustum.nearPlaneDistance = 0.1f;
+	frustum.farPlaneDistance = 1000.f;
+	frustum.verticalFov = pi / 2.f;
+	frustum.horizontalFov = pi / 2.f;
+	return frustum;
+}
+
+static StreamingTexture MakeTexture(uint size, float screenSize, uint residentMip)
+{
+	StreamingTexture texture;
+	texture.width = texture.height = size;
+	texture.numLevels = static_cast<uint>(log2f(static_cast<float>(size))) + 1;
+	texture.baseSize = static_cast<uint64>(size) * size * 4;
+	texture.screenSize = screenSize;
+	texture.residentMip = residentMip;
+	return texture;
+}
+
+int main()
+{
+	TextureStreamer streamer(64);
+
+	// 1024 down to 1 has 11 levels, 64 is level 4
+	CHECK(streamer.GetMinimumMip(1024, 1024, 11) == 4);
+	CHECK(streamer.GetMinimumMip(1024, 256, 11) == 4);
+	CHECK(streamer.GetMinimumMip(32, 32, 6) == 0);
+	// A chain cut short keeps its last level
+	CHECK(streamer.GetMinimumMip(1024, 1024, 3) == 2);
+
+	// The least detailed level that is still at least as big as the screen size
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 0.f) == 4);
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 2048.f) == 0);
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 1024.f) == 0);
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 1000.f) == 0);
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 512.f) == 1);
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 256.f) == 2);
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 200.f) == 2);
+	// Never less detail than the resident minimum
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, 8.f) == 4);
+
+	// A box one unit wide ten units away, the size follows the height it is rendered at
+	const Frustum frustum = MakeCamera();
+	const AABB box(float3(-0.5f, -0.5f, 9.5f), float3(0.5f, 0.5f, 10.5f));
+	const float full = TextureStreamer::ProjectedSize(frustum, box, 1080.f);
+	const float half = TextureStreamer::ProjectedSize(frustum, box, 540.f);
+	CHECK(fabsf(full - 1080.f * box.HalfDiagonal().Length() / 10.f) < 0.01f);
+	CHECK(fabsf(full - half * 2.f) < 0.01f);
+	// Rendering at half scale needs one level less of detail
+	CHECK(streamer.GetWantedMip(1024, 1024, 11, full) + 1 == streamer.GetWantedMip(1024, 1024, 11, half));
+	// Behind the camera nothing is wanted, close enough to contain the camera the whole height is
+	CHECK(TextureStreamer::ProjectedSize(frustum, AABB(float3(-1.f, -1.f, -11.f), float3(1.f, 1.f, -9.f)), 1080.f) == 0.f);
+	CHECK(TextureStreamer::ProjectedSize(frustum, AABB(float3(-1.f, -1.f, -1.f), float3(1.f, 1.f, 1.f)), 1080.f) == 1080.f);
+
+	// Enough budget, every texture gets the detail it wants
+	std::vector<StreamingTexture> textures;
+	textures.push_back(MakeTexture(1024, 1024.f, 4));
+	textures.push_back(MakeTexture(1024, 256.f, 4));
+	textures.push_back(MakeTexture(1024, 0.f, 4));
+	streamer.Plan(textures, 64 * 1024 * 1024);
+	CHECK(textures[0].targetMip == 0);
+	CHECK(textures[1].targetMip == 2);
+	CHECK(textures[2].targetMip == 4);
+
+	// One level short of the wanted detail, the least visible texture gives it up
+	const uint64 baseSize = textures[0].baseSize;
+	uint64 budget = TextureStreamer::GetChainSize(baseSize, 11, 0) + TextureStreamer::GetChainSize(baseSize, 11, 3) + TextureStreamer::GetChainSize(baseSize, 11, 4);
+	streamer.Plan(textures, budget);
+	CHECK(textures[0].targetMip == 0);
+	CHECK(textures[1].targetMip == 3);
+	CHECK(textures[2].targetMip == 4);
+
+	// Far too little, every texture ends at its minimum instead of failing
+	budget = TextureStreamer::GetChainSize(baseSize, 11, 4) * 3;
+	streamer.Plan(textures, budget);
+	CHECK(textures[0].targetMip == 4);
+	CHECK(textures[1].targetMip == 4);
+	CHECK(textures[2].targetMip == 4);
+
+	// Detail already resident is only dropped when something else needs the room
+	textures[1].residentMip = 0;
+	streamer.Plan(textures, 64 * 1024 * 1024);
+	CHECK(textures[1].targetMip == 0);
+
+	// A streamed read of the container only needs the header and the bytes from the wanted level on
+	TextureData cooked;
+	cooked.format = TextureFormat::RGBA8;
+	cooked.width = cooked.height = 16;
+	for (uint size = 16; size > 0; size /= 2)
+	{
+		TextureLevel level;
+		level.width = level.height = size;
+		level.data.assign(size * size * 4, static_cast<uchar>(size));
+		cooked.levels.push_back(level);
+	}
+
+	char* buffer = nullptr;
+	const uint bytes = cooked.Serialize(&buffer);
+
+	TextureData streamed;
+	std::vector<TextureLevelRange> ranges;
+	CHECK(streamed.DeserializeHeader(buffer, MIN(bytes, TextureData::GetMaxHeaderSize()), ranges));
+	CHECK(ranges.size() == 5);
+	if (ranges.size() == 5)
+	{
+		CHECK(ranges.back().offset + ranges.back().size == bytes);
+		CHECK(streamed.DeserializeLevels(buffer + ranges[2].offset, bytes - ranges[2].offset, 2, ranges));
+		CHECK(streamed.width == 4 && streamed.height == 4);
+		CHECK(streamed.levels.size() == 3);
+		CHECK(streamed.levels.size() == 3 && streamed.levels[0].data == cooked.levels[2].data && streamed.levels[2].data == cooked.levels[4].data);
+		// Cut short, the read fails instead of uploading garbage
+		TextureData cut;
+		CHECK(cut.DeserializeHeader(buffer, bytes, ranges));
+		CHECK(!cut.DeserializeLevels(buffer + ranges[2].offset, ranges[2].size, 2, ranges));
+	}
+
+	TextureData whole;
+	CHECK(whole.Deserialize(buffer, bytes));
+	CHECK(whole.levels.size() == 5 && whole.levels[1].data == cooked.levels[1].data);
+	CHECK(!whole.Deserialize(buffer, bytes - 1));
+	delete[] buffer;
+
+	return CHECK_RESULT();
+}
\ No newline at end of file